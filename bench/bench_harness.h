@@ -0,0 +1,175 @@
+// 基准测试用的小工具：计时、延迟分位数、进程 CPU/RSS 采样和 JSON 输出
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsedMs(Clock::time_point begin, Clock::time_point end = Clock::now()) {
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+// 一组延迟样本的统计（毫秒）
+struct LatencyStats {
+    size_t count = 0;
+    double mean = 0;
+    double p50 = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double max = 0;
+
+    static LatencyStats from(std::vector<double> samples) {
+        LatencyStats stats;
+        if (samples.empty()) return stats;
+        std::sort(samples.begin(), samples.end());
+        auto at = [&samples](double q) {
+            size_t index = static_cast<size_t>(q * static_cast<double>(samples.size() - 1) + 0.5);
+            return samples[std::min(index, samples.size() - 1)];
+        };
+        double sum = 0;
+        for (double sample : samples) sum += sample;
+        stats.count = samples.size();
+        stats.mean = sum / static_cast<double>(samples.size());
+        stats.p50 = at(0.50);
+        stats.p90 = at(0.90);
+        stats.p99 = at(0.99);
+        stats.max = samples.back();
+        return stats;
+    }
+};
+
+// 进程级资源占用：CPU 时间包含所有线程（包括负载生成线程）
+struct ResourceUsage {
+    double cpuMs = 0;
+    long rssKb = 0;
+    long peakRssKb = 0;
+
+    static ResourceUsage now() {
+        ResourceUsage usage;
+        struct rusage ru{};
+        getrusage(RUSAGE_SELF, &ru);
+        usage.cpuMs = (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000.0 +
+                      (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000.0;
+        usage.peakRssKb = ru.ru_maxrss;
+
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.rfind("VmRSS:", 0) == 0) {
+                usage.rssKb = std::strtol(line.c_str() + 6, nullptr, 10);
+                break;
+            }
+        }
+        return usage;
+    }
+};
+
+// 一个工作负载的结果：参数与指标都是扁平的键值对
+struct Result {
+    std::string name;
+    std::string component;
+    std::map<std::string, std::string> params;
+    std::map<std::string, double> metrics;
+
+    void addLatency(const std::string& prefix, const LatencyStats& stats) {
+        metrics[prefix + "_count"] = static_cast<double>(stats.count);
+        metrics[prefix + "_mean_ms"] = stats.mean;
+        metrics[prefix + "_p50_ms"] = stats.p50;
+        metrics[prefix + "_p90_ms"] = stats.p90;
+        metrics[prefix + "_p99_ms"] = stats.p99;
+        metrics[prefix + "_max_ms"] = stats.max;
+    }
+
+    void addResources(const ResourceUsage& before, const ResourceUsage& after, double wallMs) {
+        metrics["wall_ms"] = wallMs;
+        metrics["cpu_ms"] = after.cpuMs - before.cpuMs;
+        metrics["cpu_utilization"] = wallMs > 0 ? (after.cpuMs - before.cpuMs) / wallMs : 0;
+        metrics["rss_kb"] = static_cast<double>(after.rssKb);
+        metrics["rss_delta_kb"] = static_cast<double>(after.rssKb - before.rssKb);
+        metrics["peak_rss_kb"] = static_cast<double>(after.peakRssKb);
+    }
+};
+
+inline std::string jsonEscape(const std::string& value) {
+    std::string out;
+    for (char c : value) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+inline std::string jsonNumber(double value) {
+    // JSON 没有 nan/inf，没有有效结果的指标（例如零次迭代的比值）输出 null
+    if (!std::isfinite(value)) return "null";
+    std::ostringstream out;
+    out.precision(6);
+    out << std::fixed << value;
+    std::string text = out.str();
+    // 去掉多余的 0，保持输出紧凑
+    text.erase(text.find_last_not_of('0') + 1);
+    if (!text.empty() && text.back() == '.') text.pop_back();
+    return text;
+}
+
+// 输出格式：{"suite":..., "timestamp":..., "host":{...}, "results":[{name, component, params, metrics}]}
+inline void writeJson(std::ostream& out, const std::string& suite, const std::vector<Result>& results) {
+    char host[256] = {0};
+    gethostname(host, sizeof(host) - 1);
+
+    out << "{\n";
+    out << "  \"suite\": \"" << jsonEscape(suite) << "\",\n";
+    out << "  \"timestamp\": " << static_cast<long long>(std::time(nullptr)) << ",\n";
+    out << "  \"host\": {\"name\": \"" << jsonEscape(host) << "\", \"cpus\": "
+        << sysconf(_SC_NPROCESSORS_ONLN) << "},\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << jsonEscape(result.name)
+            << "\", \"component\": \"" << jsonEscape(result.component) << "\",\n";
+        out << "     \"params\": {";
+        size_t n = 0;
+        for (const auto& param : result.params) {
+            out << (n++ ? ", " : "") << "\"" << jsonEscape(param.first) << "\": \""
+                << jsonEscape(param.second) << "\"";
+        }
+        out << "},\n     \"metrics\": {";
+        n = 0;
+        for (const auto& metric : result.metrics) {
+            out << (n++ ? ", " : "") << "\"" << jsonEscape(metric.first) << "\": "
+                << jsonNumber(metric.second);
+        }
+        out << "}}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+}
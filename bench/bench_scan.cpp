@@ -0,0 +1,173 @@
+// 扫描基准：生成 N 个文件的目录树，测量递归扫描耗时与状态表内存，
+// 指定 --threads=1,2,4 时改为比较并行扫描的吞吐
+#include "configtracker/watch_backend.h"
+#include "configtracker/file_state_cache.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+using namespace configtracker;
+
+namespace {
+
+// 当前进程的常驻内存（KB）
+long residentKb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmRSS:", 0) == 0) {
+            return std::strtol(line.c_str() + 6, nullptr, 10);
+        }
+    }
+    return 0;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// 每个目录 100 个文件，两级目录
+void createTree(const std::string& root, size_t files) {
+    std::filesystem::create_directories(root);
+    for (size_t i = 0; i < files; ++i) {
+        if (i % 100 == 0) {
+            std::filesystem::create_directories(root + "/d" + std::to_string(i / 10000) +
+                                                "/d" + std::to_string(i / 100));
+        }
+        std::ofstream file(root + "/d" + std::to_string(i / 10000) + "/d" + std::to_string(i / 100) +
+                           "/f" + std::to_string(i) + ".conf");
+        file << "key" << i << "=value" << i << "\n";
+    }
+}
+
+void runScan(size_t files) {
+    std::string root = "./bench_tree_" + std::to_string(files);
+    createTree(root, files);
+
+    ScanOptions options;
+    options.recursive = true;
+
+    long rssBefore = residentKb();
+    PollingBackend backend(std::chrono::seconds(2), options);
+    backend.addWatch(root);
+
+    size_t events = 0;
+    auto begin = std::chrono::steady_clock::now();
+    backend.scanOnce([&events](const std::string&) { ++events; });
+    double coldMs = elapsedMs(begin);
+
+    begin = std::chrono::steady_clock::now();
+    size_t warmEvents = 0;
+    backend.scanOnce([&warmEvents](const std::string&) { ++warmEvents; });
+    double warmMs = elapsedMs(begin);
+    long rssAfter = residentKb();
+
+    // 内容哈希确认（首次启动时每个文件都要读取一次）
+    FileStateCache cache;
+    begin = std::chrono::steady_clock::now();
+    PollingBackend lister(std::chrono::seconds(2), options);
+    lister.addWatch(root);
+    lister.scanOnce([&cache](const std::string& path) { cache.refresh(path); });
+    double hashMs = elapsedMs(begin);
+
+    // 对照：旧实现使用的 std::map<std::string, file_time_type>
+    long mapBefore = residentKb();
+    std::map<std::string, std::filesystem::file_time_type> nodeMap;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(root)) {
+        if (entry.is_regular_file()) {
+            nodeMap[entry.path().string()] = std::filesystem::file_time_type();
+        }
+    }
+    long mapKb = residentKb() - mapBefore;
+
+    std::cout << "files=" << files
+              << " events=" << events
+              << " cold_scan_ms=" << coldMs
+              << " warm_scan_ms=" << warmMs
+              << " warm_events=" << warmEvents
+              << " hash_confirm_ms=" << hashMs
+              << " table_bytes=" << backend.memoryUsage()
+              << " state_cache_bytes=" << cache.memoryUsage()
+              << " rss_delta_kb=" << (rssAfter - rssBefore)
+              << " std_map_rss_kb=" << mapKb
+              << std::endl;
+
+    std::filesystem::remove_all(root);
+}
+
+// 同一棵树在不同线程数下的扫描吞吐
+void runThreadScaling(size_t files, const std::vector<size_t>& threadCounts) {
+    std::string root = "./bench_tree_" + std::to_string(files);
+    createTree(root, files);
+
+    for (size_t threads : threadCounts) {
+        ScanOptions options;
+        options.recursive = true;
+        options.threads = threads;
+
+        PollingBackend backend(std::chrono::seconds(2), options);
+        backend.addWatch(root);
+
+        size_t events = 0;
+        auto begin = std::chrono::steady_clock::now();
+        backend.scanOnce([&events](const std::string&) { ++events; });
+        double coldMs = elapsedMs(begin);
+
+        begin = std::chrono::steady_clock::now();
+        backend.scanOnce([](const std::string&) {});
+        double warmMs = elapsedMs(begin);
+
+        std::cout << "files=" << files
+                  << " threads=" << threads
+                  << " events=" << events
+                  << " cold_scan_ms=" << coldMs
+                  << " warm_scan_ms=" << warmMs
+                  << " files_per_sec=" << static_cast<size_t>(files / (warmMs / 1000.0))
+                  << std::endl;
+    }
+
+    std::filesystem::remove_all(root);
+}
+
+std::vector<size_t> parseList(const std::string& text) {
+    std::vector<size_t> values;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t comma = text.find(',', pos);
+        if (comma == std::string::npos) comma = text.size();
+        values.push_back(static_cast<size_t>(std::strtoull(text.substr(pos, comma - pos).c_str(), nullptr, 10)));
+        pos = comma + 1;
+    }
+    return values;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    std::vector<size_t> threadCounts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--threads=", 0) == 0) {
+            threadCounts = parseList(arg.substr(10));
+        } else {
+            sizes.push_back(static_cast<size_t>(std::strtoull(argv[i], nullptr, 10)));
+        }
+    }
+    if (sizes.empty()) {
+        sizes = {10000, 100000, 1000000};
+    }
+    for (size_t files : sizes) {
+        if (threadCounts.empty()) {
+            runScan(files);
+        } else {
+            runThreadScaling(files, threadCounts);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,649 @@
+// 监控到提交全链路的基准测试，结果以 JSON 输出，用于比较不同版本之间的回归。
+//
+//   ./configtracker_bench [--quick] [--out=result.json] [--filter=name] [--verbose]
+//                         [--files=N] [--rate=M] [--duration=S] [--burst=K] [--tree-files=N]
+//
+// 工作负载：
+//   watcher_edits      N 个文件，每秒 M 次修改，测量检测延迟（inotify 与轮询）
+//   deep_tree_edits    深层目录树上的同样负载
+//   git_commit         每次提交 1/10/100 个文件，测量提交延迟与 commits/sec
+//   large_tree         5000 与 --tree-files（默认 50 万）个文件的仓库中每次提交 10 个文件，
+//                      测量提交延迟、每次提交重写的树对象数，以及从索引整体写树的耗时作为对照
+//   large_files        大文件写入对象库的吞吐（Direct 与 WorkTreeCopy）
+//   pipeline_burst     一次部署写入 K 个文件，测量从写入到提交完成的端到端延迟
+//   tracker_burst      同样的部署经过 ConfigTracker，测量最后一个文件进入 HEAD 的时间
+#include "bench_harness.h"
+
+#include "configtracker/config_tracker.h"
+#include "configtracker/file_watcher.h"
+#include "configtracker/git_repo_manager.h"
+#include "configtracker/commit_batcher.h"
+#include "configtracker/metrics.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace configtracker;
+using bench::Clock;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+    bool quick = false;
+    bool verbose = false;
+    std::string out;
+    std::string filter;
+    size_t files = 2000;
+    size_t rate = 500;
+    double duration = 5;
+    size_t burst = 2000;
+    size_t commits = 200;
+    size_t largeFiles = 4;
+    size_t largeFileMb = 32;
+    size_t treeFiles = 500000;
+};
+
+std::string workDir(const std::string& name) {
+    std::string dir = "./bench_work/" + name;
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir;
+}
+
+void writeFile(const std::string& path, const std::string& content) {
+    std::ofstream out(path, std::ios::trunc);
+    out << content;
+}
+
+// 平铺：每个目录 100 个文件；深层：16 个分支，每个分支 depth 层
+std::vector<std::string> createFiles(const std::string& root, size_t files, size_t depth) {
+    std::vector<std::string> paths;
+    paths.reserve(files);
+    for (size_t i = 0; i < files; ++i) {
+        std::string dir = root;
+        if (depth == 0) {
+            dir += "/d" + std::to_string(i / 100);
+        } else {
+            dir += "/b" + std::to_string(i % 16);
+            for (size_t level = 0; level < depth; ++level) {
+                dir += "/l" + std::to_string(level);
+            }
+        }
+        if (depth > 0 ? i < 16 : i % 100 == 0) {
+            fs::create_directories(dir);
+        }
+        paths.push_back(dir + "/f" + std::to_string(i) + ".conf");
+        writeFile(paths.back(), "key" + std::to_string(i) + "=initial\n");
+    }
+    return paths;
+}
+
+// 简单的线性同余随机数，保证各次运行的负载一致
+struct Lcg {
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    size_t next(size_t bound) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<size_t>(state >> 33) % bound;
+    }
+};
+
+// 记录每个路径最早一次未被观察到的写入时间
+class PendingWrites {
+public:
+    void wrote(const std::string& path, Clock::time_point at) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.emplace(path, at);
+    }
+
+    // 返回 true 表示该路径有待观察的写入，latencyMs 为写入到现在的时间
+    bool observed(const std::string& path, Clock::time_point now, double& latencyMs) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pending_.find(path);
+        if (it == pending_.end()) return false;
+        latencyMs = bench::elapsedMs(it->second, now);
+        pending_.erase(it);
+        return true;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pending_.size();
+    }
+
+    bool waitEmpty(std::chrono::milliseconds timeout) {
+        auto deadline = Clock::now() + timeout;
+        while (Clock::now() < deadline) {
+            if (size() == 0) return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return size() == 0;
+    }
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, Clock::time_point> pending_;
+};
+
+struct SampleLog {
+    std::mutex mutex;
+    std::vector<double> samples;
+
+    void add(double value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        samples.push_back(value);
+    }
+};
+
+const char* backendName(WatchBackendType type) {
+    switch (type) {
+    case WatchBackendType::Inotify: return "inotify";
+    case WatchBackendType::Polling: return "polling";
+    default: return "auto";
+    }
+}
+
+bench::Result runWatcherEdits(const Options& options, WatchBackendType backend, size_t depth) {
+    bench::Result result;
+    result.name = depth > 0 ? "deep_tree_edits" : "watcher_edits";
+    result.component = "FileWatcher";
+    result.params["backend"] = backendName(backend);
+    result.params["files"] = std::to_string(options.files);
+    result.params["edits_per_sec"] = std::to_string(options.rate);
+    result.params["duration_s"] = bench::jsonNumber(options.duration);
+    result.params["depth"] = std::to_string(depth);
+
+    std::string root = workDir(result.name + "_" + backendName(backend)) + "/tree";
+    std::vector<std::string> paths = createFiles(root, options.files, depth);
+
+    WatchOptions watchOptions;
+    watchOptions.backend = backend;
+    watchOptions.pollInterval = std::chrono::milliseconds(100);
+    watchOptions.recursive = true;
+
+    PendingWrites pending;
+    SampleLog latencies;
+    auto before = bench::ResourceUsage::now();
+    auto begin = Clock::now();
+
+    FileWatcher watcher(watchOptions);
+    watcher.addWatch(root);
+    watcher.startWatching([&](std::string path) {
+        double latency;
+        if (pending.observed(path, Clock::now(), latency)) {
+            latencies.add(latency);
+        }
+    });
+    // 等待初始扫描完成（首次扫描会把所有文件当作新增上报）
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    Lcg random;
+    size_t edits = 0;
+    auto interval = std::chrono::duration<double>(1.0 / static_cast<double>(options.rate));
+    auto writeBegin = Clock::now();
+    auto writeEnd = writeBegin + std::chrono::duration_cast<Clock::duration>(
+                                     std::chrono::duration<double>(options.duration));
+    while (Clock::now() < writeEnd) {
+        const std::string& path = paths[random.next(paths.size())];
+        writeFile(path, "key=" + std::to_string(edits) + "\n");
+        pending.wrote(path, Clock::now());
+        ++edits;
+        std::this_thread::sleep_until(writeBegin + std::chrono::duration_cast<Clock::duration>(interval * edits));
+    }
+    pending.waitEmpty(std::chrono::seconds(3));
+    size_t missed = pending.size();
+    watcher.stop();
+
+    auto after = bench::ResourceUsage::now();
+    result.addLatency("detection", bench::LatencyStats::from(latencies.samples));
+    result.addResources(before, after, bench::elapsedMs(begin));
+    result.metrics["edits"] = static_cast<double>(edits);
+    result.metrics["missed"] = static_cast<double>(missed);
+    return result;
+}
+
+bench::Result runGitCommit(const Options& options, size_t batchSize) {
+    bench::Result result;
+    result.name = "git_commit";
+    result.component = "GitRepoManager";
+    result.params["files_per_commit"] = std::to_string(batchSize);
+    result.params["commits"] = std::to_string(options.commits);
+
+    std::string dir = workDir("git_commit_" + std::to_string(batchSize));
+    std::vector<std::string> paths = createFiles(dir + "/src", batchSize, 0);
+
+    std::vector<double> latencies;
+    auto before = bench::ResourceUsage::now();
+    auto begin = Clock::now();
+    {
+        GitRepoManager git(dir + "/repo");
+        git.init();
+        for (size_t i = 0; i < options.commits; ++i) {
+            for (const auto& path : paths) {
+                writeFile(path, "revision=" + std::to_string(i) + "\n");
+            }
+            auto commitBegin = Clock::now();
+            git.addFiles(paths);
+            git.commit("bench commit " + std::to_string(i));
+            latencies.push_back(bench::elapsedMs(commitBegin));
+        }
+    }
+    double wallMs = bench::elapsedMs(begin);
+    auto after = bench::ResourceUsage::now();
+
+    double commitMs = 0;
+    for (double latency : latencies) commitMs += latency;
+    result.addLatency("commit", bench::LatencyStats::from(latencies));
+    result.addResources(before, after, wallMs);
+    result.metrics["commits_per_sec"] = commitMs > 0 ? latencies.size() * 1000.0 / commitMs : 0;
+    result.metrics["files_per_sec"] = commitMs > 0 ? latencies.size() * batchSize * 1000.0 / commitMs : 0;
+    return result;
+}
+
+// 大仓库中的小提交：文件内容直接在内存中生成并暂存，不在磁盘上创建几十万个文件
+bench::Result runLargeTree(const Options& options, size_t files) {
+    const size_t perCommit = 10;
+    bench::Result result;
+    result.name = "large_tree";
+    result.component = "GitRepoManager";
+    result.params["files"] = std::to_string(files);
+    result.params["files_per_commit"] = std::to_string(perCommit);
+    result.params["commits"] = std::to_string(options.commits);
+
+    std::string dir = workDir("large_tree_" + std::to_string(files));
+    std::string root = fs::absolute(dir).string() + "/src";
+    // 每个目录 100 个文件，每 100 个目录再归入一个上级目录。编号补零，
+    // 按编号顺序暂存时路径也是有序的，初始导入时索引只在末尾追加
+    auto pathOf = [&root](size_t i) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "/s%04zu/m%02zu/f%08zu.conf", i / 10000, i / 100 % 100, i);
+        return root + name;
+    };
+
+    std::vector<double> latencies;
+    double initialMs = 0;
+    double fullWriteMs = 0;
+    uint64_t trees = 0;
+    auto before = bench::ResourceUsage::now();
+    auto begin = Clock::now();
+    {
+        GitRepoManager git(dir + "/repo");
+        git.init();
+        std::vector<FileContent> batch;
+        const size_t stageBatch = 50000;
+        auto initialBegin = Clock::now();
+        for (size_t i = 0; i < files; ++i) {
+            FileContent file;
+            file.path = pathOf(i);
+            file.data = "key" + std::to_string(i) + "=initial\n";
+            batch.push_back(std::move(file));
+            if (batch.size() == stageBatch || i + 1 == files) {
+                git.addContents(batch);
+                batch.clear();
+            }
+        }
+        git.commit("initial");
+        initialMs = bench::elapsedMs(initialBegin);
+
+        Lcg random;
+        Counter& written = CoreMetrics::get().treesWritten;
+        uint64_t writtenBefore = written.value();
+        for (size_t c = 0; c < options.commits; ++c) {
+            batch.clear();
+            for (size_t k = 0; k < perCommit; ++k) {
+                size_t i = random.next(files);
+                FileContent file;
+                file.path = pathOf(i);
+                file.data = "key" + std::to_string(i) + "=" + std::to_string(c) + "\n";
+                batch.push_back(std::move(file));
+            }
+            auto commitBegin = Clock::now();
+            git.addContents(batch);
+            git.commit("bench commit " + std::to_string(c));
+            latencies.push_back(bench::elapsedMs(commitBegin));
+        }
+        trees = written.value() - writtenBefore;
+
+        // 对照：同样的索引不借助任何缓存、从头写出整个树的耗时，即每次提交原本的开销
+        git.flushIndex();
+        git_repository* repo = git.openReadHandle();
+        git_index* disk = nullptr;
+        git_index* fresh = nullptr;
+        if (repo && git_repository_index(&disk, repo) == 0 && git_index_new(&fresh) == 0) {
+            for (size_t i = 0; i < git_index_entrycount(disk); ++i) {
+                git_index_add(fresh, git_index_get_byindex(disk, i));
+            }
+            git_oid tree;
+            auto writeBegin = Clock::now();
+            if (git_index_write_tree_to(&tree, fresh, repo) == 0) {
+                fullWriteMs = bench::elapsedMs(writeBegin);
+            }
+        }
+        git_index_free(fresh);
+        git_index_free(disk);
+        git_repository_free(repo);
+    }
+    double wallMs = bench::elapsedMs(begin);
+    auto after = bench::ResourceUsage::now();
+
+    double commitMs = 0;
+    for (double latency : latencies) commitMs += latency;
+    result.addLatency("commit", bench::LatencyStats::from(latencies));
+    result.addResources(before, after, wallMs);
+    result.metrics["commits_per_sec"] = commitMs > 0 ? latencies.size() * 1000.0 / commitMs : 0;
+    result.metrics["trees_written_per_commit"] =
+        latencies.empty() ? 0 : static_cast<double>(trees) / static_cast<double>(latencies.size());
+    result.metrics["initial_commit_ms"] = initialMs;
+    result.metrics["full_tree_write_ms"] = fullWriteMs;
+    return result;
+}
+
+bench::Result runLargeFiles(const Options& options, IngestMode mode) {
+    bench::Result result;
+    result.name = "large_files";
+    result.component = "GitRepoManager";
+    result.params["ingest"] = mode == IngestMode::Direct ? "direct" : "work_tree_copy";
+    result.params["files"] = std::to_string(options.largeFiles);
+    result.params["file_mb"] = std::to_string(options.largeFileMb);
+
+    std::string dir = workDir(std::string("large_files_") + result.params["ingest"]);
+    fs::create_directories(dir + "/src");
+    std::vector<std::string> paths;
+    std::string content(options.largeFileMb << 20, '\0');
+    Lcg random;
+    for (auto& c : content) c = static_cast<char>('a' + random.next(26));
+    for (size_t i = 0; i < options.largeFiles; ++i) {
+        paths.push_back(dir + "/src/large" + std::to_string(i) + ".conf");
+    }
+
+    const size_t rounds = 3;
+    std::vector<double> latencies;
+    auto before = bench::ResourceUsage::now();
+    auto begin = Clock::now();
+    {
+        GitRepoManager git(dir + "/repo", std::chrono::seconds(1), mode);
+        git.init();
+        for (size_t round = 0; round < rounds; ++round) {
+            for (size_t i = 0; i < paths.size(); ++i) {
+                content[0] = static_cast<char>('A' + (round * paths.size() + i) % 26);
+                writeFile(paths[i], content);
+            }
+            auto commitBegin = Clock::now();
+            git.addFiles(paths);
+            git.commit("large round " + std::to_string(round));
+            latencies.push_back(bench::elapsedMs(commitBegin));
+        }
+    }
+    double wallMs = bench::elapsedMs(begin);
+    auto after = bench::ResourceUsage::now();
+
+    double commitMs = 0;
+    for (double latency : latencies) commitMs += latency;
+    double megabytes = static_cast<double>(rounds * paths.size() * options.largeFileMb);
+    result.addLatency("commit", bench::LatencyStats::from(latencies));
+    result.addResources(before, after, wallMs);
+    result.metrics["ingest_mb_per_sec"] = commitMs > 0 ? megabytes * 1000.0 / commitMs : 0;
+    return result;
+}
+
+// 与 ConfigTracker 相同的组装方式，但在提交回调中记录每个文件的端到端延迟
+bench::Result runPipelineBurst(const Options& options) {
+    bench::Result result;
+    result.name = "pipeline_burst";
+    result.component = "FileWatcher+CommitBatcher+GitRepoManager";
+    result.params["files"] = std::to_string(options.burst);
+
+    std::string dir = workDir("pipeline_burst");
+    std::string root = dir + "/tree";
+    fs::create_directories(root);
+
+    PendingWrites detectPending;
+    PendingWrites commitPending;
+    SampleLog detection;
+    SampleLog endToEnd;
+    std::vector<double> commitLatencies;
+    std::atomic<size_t> commits{0};
+
+    auto before = bench::ResourceUsage::now();
+    auto begin = Clock::now();
+    {
+        GitRepoManager git(dir + "/repo");
+        git.init();
+        CommitBatcher batcher(std::chrono::milliseconds(200), std::chrono::milliseconds(2000),
+            [&](const std::vector<std::string>& paths) {
+                auto commitBegin = Clock::now();
+                git.addFiles(paths);
+                git.commit("Auto commit: " + std::to_string(paths.size()) + " files changed");
+                auto done = Clock::now();
+                commitLatencies.push_back(bench::elapsedMs(commitBegin, done));
+                ++commits;
+                for (const auto& path : paths) {
+                    double latency;
+                    if (commitPending.observed(path, done, latency)) {
+                        endToEnd.add(latency);
+                    }
+                }
+            });
+        batcher.start();
+
+        WatchOptions watchOptions;
+        watchOptions.recursive = true;
+        FileWatcher watcher(watchOptions);
+        watcher.addWatch(root);
+        watcher.startWatching([&](std::string path) {
+            double latency;
+            if (detectPending.observed(path, Clock::now(), latency)) {
+                detection.add(latency);
+            }
+            batcher.enqueue(path);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+        // 一次部署：尽快写入全部文件
+        for (size_t i = 0; i < options.burst; ++i) {
+            if (i % 100 == 0) fs::create_directories(root + "/d" + std::to_string(i / 100));
+            std::string path = root + "/d" + std::to_string(i / 100) + "/f" + std::to_string(i) + ".conf";
+            writeFile(path, "deployed=" + std::to_string(i) + "\n");
+            auto now = Clock::now();
+            detectPending.wrote(path, now);
+            commitPending.wrote(path, now);
+        }
+        commitPending.waitEmpty(std::chrono::seconds(30));
+        result.metrics["uncommitted"] = static_cast<double>(commitPending.size());
+        watcher.stop();
+        batcher.stop();
+    }
+    double wallMs = bench::elapsedMs(begin);
+    auto after = bench::ResourceUsage::now();
+
+    result.addLatency("detection", bench::LatencyStats::from(detection.samples));
+    result.addLatency("end_to_end", bench::LatencyStats::from(endToEnd.samples));
+    result.addLatency("commit", bench::LatencyStats::from(commitLatencies));
+    result.addResources(before, after, wallMs);
+    result.metrics["commits"] = static_cast<double>(commits);
+    return result;
+}
+
+// 只通过公开接口观察：轮询 HEAD，直到最后写入的文件出现在提交中
+bench::Result runTrackerBurst(const Options& options) {
+    bench::Result result;
+    result.name = "tracker_burst";
+    result.component = "ConfigTracker";
+    result.params["files"] = std::to_string(options.burst);
+
+    std::string dir = workDir("tracker_burst");
+    std::string root = dir + "/tree";
+    fs::create_directories(root);
+
+    TrackConfig config;
+    config.watchPaths = {root};
+    config.repoRoot = dir + "/repo";
+    config.retentionDays = 0;
+    config.logLevel = Logger::level();
+
+    auto before = bench::ResourceUsage::now();
+    auto begin = Clock::now();
+    ConfigTracker tracker(config);
+    tracker.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    std::string lastPath;
+    auto burstBegin = Clock::now();
+    for (size_t i = 0; i < options.burst; ++i) {
+        if (i % 100 == 0) fs::create_directories(root + "/d" + std::to_string(i / 100));
+        lastPath = root + "/d" + std::to_string(i / 100) + "/f" + std::to_string(i) + ".conf";
+        writeFile(lastPath, "deployed=" + std::to_string(i) + "\n");
+    }
+    double writeMs = bench::elapsedMs(burstBegin);
+
+    std::string treePath = fs::absolute(lastPath).lexically_normal().relative_path().generic_string();
+    git_repository* repo = nullptr;
+    bool committed = false;
+    if (git_repository_open(&repo, config.repoRoot.c_str()) == 0) {
+        auto deadline = Clock::now() + std::chrono::seconds(30);
+        while (!committed && Clock::now() < deadline) {
+            git_oid head;
+            git_commit* commit = nullptr;
+            git_tree* tree = nullptr;
+            git_tree_entry* entry = nullptr;
+            committed = git_reference_name_to_id(&head, repo, "HEAD") == 0 &&
+                        git_commit_lookup(&commit, repo, &head) == 0 &&
+                        git_commit_tree(&tree, commit) == 0 &&
+                        git_tree_entry_bypath(&entry, tree, treePath.c_str()) == 0;
+            git_tree_entry_free(entry);
+            git_tree_free(tree);
+            git_commit_free(commit);
+            if (!committed) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        git_repository_free(repo);
+    }
+    double burstMs = bench::elapsedMs(burstBegin);
+    tracker.stop();
+
+    double wallMs = bench::elapsedMs(begin);
+    auto after = bench::ResourceUsage::now();
+    result.addResources(before, after, wallMs);
+    result.metrics["write_ms"] = writeMs;
+    result.metrics["burst_to_head_ms"] = committed ? burstMs : -1;
+    result.metrics["files_per_sec"] = committed && burstMs > 0 ? options.burst * 1000.0 / burstMs : 0;
+    return result;
+}
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&arg](const char* prefix) -> const char* {
+            size_t len = std::strlen(prefix);
+            return arg.compare(0, len, prefix) == 0 ? arg.c_str() + len : nullptr;
+        };
+        if (arg == "--quick") {
+            options.quick = true;
+            options.files = 200;
+            options.rate = 100;
+            options.duration = 1.5;
+            options.burst = 200;
+            options.commits = 30;
+            options.largeFiles = 2;
+            options.largeFileMb = 4;
+            options.treeFiles = 50000;
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else if (const char* v = value("--out=")) {
+            options.out = v;
+        } else if (const char* v = value("--filter=")) {
+            options.filter = v;
+        } else if (const char* v = value("--files=")) {
+            options.files = std::strtoul(v, nullptr, 10);
+        } else if (const char* v = value("--rate=")) {
+            options.rate = std::max<size_t>(1, std::strtoul(v, nullptr, 10));
+        } else if (const char* v = value("--duration=")) {
+            options.duration = std::strtod(v, nullptr);
+        } else if (const char* v = value("--burst=")) {
+            options.burst = std::strtoul(v, nullptr, 10);
+        } else if (const char* v = value("--tree-files=")) {
+            options.treeFiles = std::max<size_t>(1, std::strtoul(v, nullptr, 10));
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        std::cerr << "Usage: configtracker_bench [--quick] [--out=file.json] [--filter=name] [--verbose]\n"
+                     "                           [--files=N] [--rate=M] [--duration=S] [--burst=K]\n"
+                     "                           [--tree-files=N]\n";
+        return 1;
+    }
+
+    // 库内部的进度日志默认关闭，避免干扰 JSON 输出和计时
+    Logger::setLevel(options.verbose ? LogLevel::Debug : LogLevel::Warn);
+
+    git_libgit2_init();
+    std::vector<bench::Result> results;
+    auto wanted = [&options](const std::string& name) {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    };
+    auto progress = [](const std::string& name) { std::cerr << "[Bench] " << name << std::endl; };
+
+    if (wanted("watcher_edits")) {
+        progress("watcher_edits");
+        results.push_back(runWatcherEdits(options, WatchBackendType::Inotify, 0));
+        results.push_back(runWatcherEdits(options, WatchBackendType::Polling, 0));
+    }
+    if (wanted("deep_tree_edits")) {
+        progress("deep_tree_edits");
+        results.push_back(runWatcherEdits(options, WatchBackendType::Inotify, 12));
+    }
+    if (wanted("git_commit")) {
+        progress("git_commit");
+        for (size_t batch : {1, 10, 100}) {
+            results.push_back(runGitCommit(options, batch));
+        }
+    }
+    if (wanted("large_tree")) {
+        progress("large_tree");
+        results.push_back(runLargeTree(options, 5000));
+        results.push_back(runLargeTree(options, options.treeFiles));
+    }
+    if (wanted("large_files")) {
+        progress("large_files");
+        results.push_back(runLargeFiles(options, IngestMode::Direct));
+        results.push_back(runLargeFiles(options, IngestMode::WorkTreeCopy));
+    }
+    if (wanted("pipeline_burst")) {
+        progress("pipeline_burst");
+        results.push_back(runPipelineBurst(options));
+    }
+    if (wanted("tracker_burst")) {
+        progress("tracker_burst");
+        results.push_back(runTrackerBurst(options));
+    }
+    git_libgit2_shutdown();
+    fs::remove_all("./bench_work");
+
+    Logger::instance().flush();
+    if (options.out.empty()) {
+        bench::writeJson(std::cout, "configtracker", results);
+    } else {
+        std::ofstream out(options.out, std::ios::trunc);
+        bench::writeJson(out, "configtracker", results);
+        std::cerr << "[Bench] Results written to " << options.out << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <future>
+#include <functional>
+#include <type_traits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "git_repo_manager.h"
+#include "work_stealing_pool.h"
+
+namespace configtracker {
+
+// GitRepoManager 的异步外观：调用方只投递任务并拿到 std::future，不在自己的线程上执行 git 操作。
+// 写操作（暂存、提交、检出、恢复、历史压缩）在唯一的写线程上按投递顺序串行执行；
+// 只读操作在读线程池上执行，每个读线程有自己的仓库句柄，读取 blob、列树和比较提交时不占用提交锁，
+// 彼此之间以及与写操作并发。历史查询走提交索引，只短暂持有提交锁。
+// 事件循环中可以用 future.wait_for(0) 轮询结果，不会阻塞
+class AsyncGitRepo {
+public:
+    // git 必须已经 init()，且比 AsyncGitRepo 活得更久
+    explicit AsyncGitRepo(GitRepoManager& git, size_t readThreads = 2);
+    // 执行完已投递的任务后返回
+    ~AsyncGitRepo();
+
+    AsyncGitRepo(const AsyncGitRepo&) = delete;
+    AsyncGitRepo& operator=(const AsyncGitRepo&) = delete;
+
+    // 写操作
+    std::future<void> addFiles(std::vector<std::string> paths);
+    // 返回提交后的 HEAD，提交失败时为空
+    std::future<std::string> commit(std::string message);
+    std::future<bool> checkoutCommit(std::string hash);
+    std::future<void> squashCommitsOlderThan(int days);
+    // 把 paths（为空时为全部文件）恢复到 hash 时的内容并生成恢复提交
+    std::future<bool> restore(std::string hash, std::vector<std::string> paths);
+
+    // 只读操作，失败时 optional 为空
+    std::future<std::vector<std::string>> listCommits();
+    std::future<std::vector<std::string>> latestCommits(size_t count);
+    std::future<std::vector<std::string>> commitsTouching(std::string path, size_t limit = 0);
+    std::future<std::vector<KeyChange>> keyHistory(std::string path, std::string key, size_t limit = 0);
+    std::future<std::optional<std::string>> readBlob(git_oid oid);
+    std::future<std::optional<std::vector<TreeFile>>> listFiles(std::string hash);
+    std::future<std::optional<std::vector<std::string>>> diffCommits(std::string from, std::string to);
+
+    // 自定义操作：read 的函数在读线程上以 (GitRepoManager&, 本线程的只读句柄) 调用，
+    // 句柄可能为 nullptr（打开失败），此时应使用加锁的接口；write 的函数在写线程上以 GitRepoManager& 调用
+    template <typename F>
+    auto read(F fn) -> std::future<std::invoke_result_t<F, GitRepoManager&, git_repository*>>;
+    template <typename F>
+    auto write(F fn) -> std::future<std::invoke_result_t<F, GitRepoManager&>>;
+
+    size_t readThreads() const { return handles_.size(); }
+
+private:
+    using ReadJob = std::function<void(GitRepoManager&, git_repository*)>;
+    using WriteJob = std::function<void(GitRepoManager&)>;
+
+    GitRepoManager& git_;
+
+    // 以读线程序号为下标，只由对应的线程在第一次使用时打开
+    std::vector<git_repository*> handles_;
+    std::unique_ptr<WorkStealingPool> readers_;
+
+    std::thread writer_;
+    std::mutex writeMutex_;
+    std::condition_variable writeCv_;
+    std::deque<WriteJob> writes_;
+    bool stopping_ = false;
+
+    void submitRead(ReadJob job);
+    void submitWrite(WriteJob job);
+    void writeLoop();
+};
+
+template <typename F>
+auto AsyncGitRepo::read(F fn) -> std::future<std::invoke_result_t<F, GitRepoManager&, git_repository*>> {
+    using Result = std::invoke_result_t<F, GitRepoManager&, git_repository*>;
+    // std::function 要求可复制，packaged_task 放在 shared_ptr 中
+    auto task = std::make_shared<std::packaged_task<Result(GitRepoManager&, git_repository*)>>(std::move(fn));
+    std::future<Result> result = task->get_future();
+    submitRead([task](GitRepoManager& git, git_repository* handle) { (*task)(git, handle); });
+    return result;
+}
+
+template <typename F>
+auto AsyncGitRepo::write(F fn) -> std::future<std::invoke_result_t<F, GitRepoManager&>> {
+    using Result = std::invoke_result_t<F, GitRepoManager&>;
+    auto task = std::make_shared<std::packaged_task<Result(GitRepoManager&)>>(std::move(fn));
+    std::future<Result> result = task->get_future();
+    submitWrite([task](GitRepoManager& git) { (*task)(git); });
+    return result;
+}
+
+}
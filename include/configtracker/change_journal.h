@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+
+namespace configtracker {
+
+// 从内存写入仓库的文件内容（日志模式合并时使用），path 为被监控文件的路径
+struct FileContent {
+    std::string path;
+    std::string data;
+    bool removed = false;   // 文件已删除
+};
+
+enum class JournalOp : uint8_t {
+    Write = 1,
+    Remove = 2
+};
+
+// 回放时的一条记录，content 是应用增量后的完整内容
+struct JournalEntry {
+    uint64_t sequence = 0;
+    int64_t time = 0;           // system_clock 纳秒
+    std::string_view path;
+    JournalOp op = JournalOp::Write;
+    std::string_view content;
+};
+
+// 只追加的变更日志，用于频繁改写的配置：每条记录是（时间, 路径, 相对同一路径上一版本的增量），
+// 带 XXH64 校验，经共享映射直接写入文件，追加路径上没有系统调用和 fsync，确认在微秒级完成。
+//
+// 日志按段存放在 dir/journal.<段号>，每个段内一个路径的第一条记录是完整内容，之后只记录与上一版本
+// 不同的中间部分。进程崩溃后映射中的数据仍由内核写回；重新打开时按段号顺序校验回放，
+// 停在每个段中第一条不完整或校验失败的记录。sync() 把脏页写回磁盘，控制掉电时最多丢失的数据。
+//
+// 合并（fold）时把自上次合并以来每个路径的最终状态交给调用方写成提交，同时切换到新段；
+// 提交成功后 finishFold 删除旧段。提交前崩溃则旧段保留，重启后再次合并
+class ChangeJournal {
+public:
+    ChangeJournal() = default;
+    ~ChangeJournal();
+    ChangeJournal(const ChangeJournal&) = delete;
+    ChangeJournal& operator=(const ChangeJournal&) = delete;
+
+    // 打开 dir 下的日志并回放已有的段；segmentSize 为每个段的大小，写满后切换到新段
+    bool open(const std::string& dir, size_t segmentSize = 16 << 20);
+    void close();
+
+    // 追加一条记录，time 为 0 时取当前时间。返回序号，失败返回 0
+    uint64_t append(std::string_view path, std::string_view content, int64_t time = 0);
+    uint64_t appendRemove(std::string_view path, int64_t time = 0);
+    // 把当前段中已写入的部分同步到磁盘
+    bool sync();
+
+    // 路径尚未合并的最新内容，没有记录或最后一次为删除时返回 false
+    bool current(std::string_view path, std::string& out) const;
+    // 尚未合并的路径数
+    size_t pending() const;
+    uint64_t lastSequence() const;
+
+    // 取出尚未合并的每个路径的最终状态并切换到新段，token 交给 finishFold。没有待合并的变更时返回 false。
+    // 提交失败时不调用 finishFold，这些路径在下一次 beginFold 时再次返回
+    bool beginFold(std::vector<FileContent>& out, uint64_t& token);
+    // 合并结果已经提交，删除 token 及之前的段
+    void finishFold(uint64_t token);
+
+    // 按顺序遍历仍保留（尚未确认合并）的记录
+    void replay(const std::function<void(const JournalEntry&)>& visit) const;
+
+private:
+    struct PathState {
+        std::string content;
+        bool removed = false;
+        uint64_t segment = 0;       // 最后一条记录所在的段：决定下一条能否写增量，大于 folded_ 时待合并
+    };
+
+    struct Segment {
+        uint64_t number = 0;
+        int fd = -1;
+        char* base = nullptr;
+        size_t size = 0;
+        size_t used = 0;
+    };
+
+    mutable std::mutex mutex_;
+    std::string dir_;
+    size_t segmentSize_ = 0;
+    Segment active_;
+    std::vector<uint64_t> sealed_;   // 已切换出去、尚未确认合并的段
+    std::unordered_map<std::string, PathState> paths_;
+    std::string keyBuffer_;
+    uint64_t sequence_ = 0;
+    uint64_t folded_ = 0;            // 这个段号及之前的段已经合并
+
+    std::string segmentPath(uint64_t number) const;
+    // 创建新段（大小至少为 minSize）作为当前段
+    bool createSegment(uint64_t number, size_t minSize);
+    // 映射已有的段作为当前段，validEnd 之后的内容清零
+    bool reopenSegment(uint64_t number, size_t validEnd);
+    void closeSegment();
+    bool rotateLocked(size_t minSize);
+    // 按顺序校验一个段中的记录并交给 visit，返回有效数据的末尾
+    size_t load(const char* base, size_t size, uint64_t segment,
+                const std::function<void(const JournalEntry&)>& visit) const;
+    uint64_t appendLocked(std::string_view path, JournalOp op, std::string_view content, int64_t time);
+};
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+#include "spsc_ring.h"
+#include "path_table.h"
+#include "key_history.h"
+#include "config_snapshot.h"
+
+namespace configtracker {
+
+// 一次提交中变化的一个文件
+struct ChangedFile {
+    PathId id = kInvalidPathId;  // 跟踪器内稳定的路径 ID，可用作订阅者自己的表的下标
+    std::string_view path;       // 被监控文件的路径，指向所属 ChangeBatch 的 buffer
+    bool removed = false;
+    uint32_t firstKey = 0;       // keyChanges 中属于该文件的区间
+    uint32_t keyCount = 0;
+};
+
+// 一次提交（自动提交、日志合并或恢复）的全部变更，发布后只读，由所有订阅者共享
+struct ChangeBatch {
+    std::string shard;                  // 所在分片的名称，非分片模式为空
+    std::string commit;                 // 提交哈希
+    int64_t time = 0;                   // 提交时间（秒）
+    SnapshotPtr snapshot;               // 该提交的快照，可直接读取新内容
+    std::vector<ChangedFile> files;
+    std::vector<KeyChange> keyChanges;  // 按文件分组；未开启 keyDiff 或没有订阅者需要时为空
+    std::string buffer;                 // 全部文件路径，files 中的视图指向这里
+};
+using ChangeBatchPtr = std::shared_ptr<const ChangeBatch>;
+
+// 交给一个订阅者的事件
+struct ChangeEvent {
+    ChangeBatchPtr batch;
+    std::vector<uint32_t> files;   // batch->files 中与订阅前缀匹配的下标
+    // 此前因队列满丢弃、没有投递的批次数，非零时应以 batch->snapshot 为准重新加载：
+    // 携带它的事件不早于任何被丢弃的批次，它的快照包含了这些批次的全部变更
+    uint64_t missed = 0;
+};
+
+struct SubscribeOptions {
+    size_t capacity = 256;              // 环形队列容量（批次数），满时丢弃新的批次并计入 missed
+    // 只接收这些前缀下的文件，按路径分量匹配（/etc/app 不匹配 /etc/app2），为空时接收全部
+    std::vector<std::string> prefixes;
+    bool keyChanges = true;             // 是否需要键级变更
+};
+
+using SubscriptionId = uint64_t;
+using ChangeHandler = std::function<void(const ChangeEvent&)>;
+
+// 一个订阅者：发布者把匹配的批次放入它自己的单生产者单消费者环形队列，
+// 由它自己的投递线程调用回调。回调再慢也只会让自己的队列积压，不影响检测和提交。
+// 丢弃在发布一侧计数，计数随下一个成功入队的事件投递；之后没有新批次时，
+// 队列排空后补投最后被丢弃的批次，订阅者总能看到最新的快照
+class Subscription {
+public:
+    Subscription(SubscriptionId id, SubscribeOptions options, ChangeHandler handler);
+    ~Subscription();
+
+    Subscription(const Subscription&) = delete;
+    Subscription& operator=(const Subscription&) = delete;
+
+    SubscriptionId id() const { return id_; }
+    bool wantsKeyChanges() const { return options_.keyChanges; }
+    // 按前缀过滤后放入队列，没有匹配的文件时不投递。返回 false 表示队列已满、批次被丢弃，
+    // 此时只记录丢弃数和这个批次，不等待投递线程。
+    // 同一时刻只能有一个线程调用（由 ConfigTracker 串行）
+    bool offer(const ChangeBatchPtr& batch);
+    // 投递完队列中剩余的事件后结束投递线程。不能在回调中调用
+    void stop();
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t delivered() const { return delivered_.load(std::memory_order_relaxed); }
+
+private:
+    SubscriptionId id_;
+    SubscribeOptions options_;
+    ChangeHandler handler_;
+    SpscRing<ChangeEvent> ring_;
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> delivered_{0};
+
+    // 投递线程只在队列为空时睡眠：waiting_ 为 true 时生产者才加锁通知
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<bool> waiting_{false};
+    bool stopping_ = false;
+    // 尚未告知订阅者的丢弃：missed_ 为计数（包括 resync_），resync_ 是最后一个被丢弃的事件，由 mutex_ 保护。
+    // 只在丢弃之后使用，正常的入队不加锁；dropsPending_ 只在发布线程上访问
+    uint64_t missed_ = 0;
+    ChangeEvent resync_;
+    bool dropsPending_ = false;
+
+    bool matches(std::string_view path) const;
+    void run();
+};
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+#include "mpsc_queue.h"
+#include "path_table.h"
+
+namespace configtracker {
+
+// 事件队列满时生产者（监控线程）的处理方式
+enum class BackpressurePolicy {
+    Coalesce,  // 放入去重的溢出集合，不丢事件也不阻塞（默认）
+    Block,     // 等待提交线程腾出空间
+    Drop       // 丢弃事件并计数；文件仍处于未提交状态，下次变更或重启后会重新上报
+};
+
+// 提交工作线程：监控线程通过有界无锁队列投递变更路径，工作线程在静默窗口内
+// 没有新事件、或距第一个事件超过最大延迟时，把去重后的路径作为一个批次交给回调，
+// 所有 git 操作都在工作线程上执行。生产者把路径复制进队列槽位中预留了容量的字符串，
+// 不加锁也不分配内存；工作线程在批次内驻留去重，批次取走后重置，临时文件名不会一直占用内存
+class CommitBatcher {
+public:
+    using FlushCallback = std::function<void(const std::vector<std::string>& paths)>;
+
+    CommitBatcher(std::chrono::milliseconds quietWindow,
+                  std::chrono::milliseconds maxLatency,
+                  FlushCallback onFlush,
+                  size_t queueCapacity = 4096,
+                  BackpressurePolicy policy = BackpressurePolicy::Coalesce);
+    ~CommitBatcher();
+
+    void start();
+    // 可从多个线程并发调用，队列未满时不加锁
+    void enqueue(const std::string& path);
+    // 立即提交已投递的事件，返回时本批次已经提交
+    void flush();
+    // 提交队列中剩余的事件后停止工作线程
+    void stop();
+
+    // 背压计数
+    uint64_t coalescedEvents() const { return coalesced_.load(std::memory_order_relaxed); }
+    uint64_t blockedEvents() const { return blocked_.load(std::memory_order_relaxed); }
+    uint64_t droppedEvents() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::chrono::milliseconds quietWindow_;
+    std::chrono::milliseconds maxLatency_;
+    FlushCallback onFlush_;
+    BackpressurePolicy policy_;
+
+    // 槽位中的字符串只复制赋值、不移走，容量在多轮之间保留
+    MpscQueue<std::string> queue_;
+    // 工作线程即将休眠时置位，生产者只在此时才需要加锁唤醒
+    std::atomic<bool> waiting_{false};
+    std::atomic<bool> workerExited_{true};
+
+    std::mutex overflowMutex_;
+    std::unordered_set<std::string> overflow_;
+    std::atomic<bool> hasOverflow_{false};
+
+    std::mutex spaceMutex_;
+    std::condition_variable spaceCv_;
+
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> blocked_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable flushedCv_;
+    bool running_ = false;
+    bool stopping_ = false;
+    uint64_t flushRequested_ = 0;
+    uint64_t flushCompleted_ = 0;
+
+    // 以下只在工作线程上访问（工作线程未运行时由 flush/stop 的调用线程访问）
+    // 当前批次的路径，驻留即去重，ID 是首次出现的顺序
+    PathTable pending_;
+    Clock::time_point firstEvent_;
+    Clock::time_point lastEvent_;
+
+    void run();
+    void wakeWorker();
+    void coalesce(const std::string& path);
+    // 把队列和溢出集合中的事件并入当前批次
+    void drain();
+    std::vector<std::string> takeBatch();
+    void deliver(const std::vector<std::string>& batch);
+};
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+#include <git2.h>
+
+#include "path_table.h"
+#include "lru_cache.h"
+
+namespace configtracker {
+
+// 提交索引中的一条记录，按提交顺序追加，磁盘布局与内存布局一致
+struct CommitRecord {
+    git_oid oid;
+    git_oid parent;          // 第一个父提交，根提交为全零
+    int64_t time;            // 提交时间（秒）
+    int64_t orderTime;       // 单调不减的排序键 max(time, 前一条的 orderTime)，时钟回拨时也能二分
+    uint32_t pathsOffset;    // 在路径 ID 数组中的起始下标
+    uint32_t pathsCount;
+};
+static_assert(sizeof(CommitRecord) == 64, "CommitRecord is stored as-is on disk");
+
+// 追加或重建索引时传入的提交信息
+struct CommitInfo {
+    git_oid oid;
+    git_oid parent;
+    int64_t time = 0;
+    std::vector<std::string> paths;  // 相对于仓库根目录
+};
+
+// 提交元数据索引，保存在 .git/configtracker 下的三个追加式文件中：
+//   commits.idx    头部 + CommitRecord[]
+//   commits.paths  头部 + uint32 路径 ID 数组
+//   commits.names  头部 + 路径字符串（uint32 长度 + 内容），ID 即出现顺序
+// 记录区与路径 ID 区通过 mmap 访问；按时间的查询在 orderTime 上二分，
+// 按路径的查询使用加载时建立的倒排表，按 oid 的查询使用加载时建立的哈希表
+class CommitIndex {
+public:
+    static constexpr size_t npos = SIZE_MAX;
+
+    CommitIndex() = default;
+    ~CommitIndex();
+    CommitIndex(const CommitIndex&) = delete;
+    CommitIndex& operator=(const CommitIndex&) = delete;
+
+    // 打开 dir 下的索引，文件不存在或已损坏时从空索引开始
+    bool open(const std::string& dir);
+    void close();
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    const CommitRecord& at(size_t pos) const { return records_[pos]; }
+    std::vector<std::string_view> pathsOf(size_t pos) const;
+    // 记录 [0, pos] 修改过的全部路径（去重）
+    std::vector<std::string> pathsUpTo(size_t pos) const;
+
+    // 追加一个提交，立即写入文件
+    bool append(const CommitInfo& info);
+    // 用给定的提交序列整体替换索引（重建、历史压缩后使用）
+    bool rewrite(const std::vector<CommitInfo>& commits);
+    // 只保留前 count 条记录（分支被回退到较早的提交时）
+    bool truncate(size_t count);
+
+    // 按 oid 查找记录，不存在返回 npos
+    size_t find(const git_oid& oid) const;
+    // orderTime 落在 [from, to] 内的记录区间 [first, last)
+    std::pair<size_t, size_t> range(int64_t from, int64_t to) const;
+    // 最后一个 orderTime < time 的记录，不存在返回 npos
+    size_t lastBefore(int64_t time) const;
+    // 修改过 path 的记录位置，从旧到新；从未出现过的路径返回 nullptr
+    const std::vector<uint32_t>* touching(std::string_view path) const;
+
+private:
+    struct Mapping {
+        int fd = -1;
+        char* base = nullptr;
+        size_t size = 0;
+    };
+
+    std::string dir_;
+    uint64_t generation_ = 0;
+    Mapping idx_;
+    Mapping paths_;
+    Mapping names_;
+
+    const CommitRecord* records_ = nullptr;
+    size_t count_ = 0;
+    const uint32_t* pathIds_ = nullptr;
+    size_t pathIdCount_ = 0;
+
+    PathTable pathNames_;
+    std::vector<std::vector<uint32_t>> postings_;  // 按路径 ID 存放记录位置
+    std::unordered_map<git_oid, uint32_t, OidHash, OidEqual> positions_;  // oid → 记录位置
+
+    bool openFiles();
+    bool remap(Mapping& mapping);
+    void updateViews();
+    bool load();
+    bool writeFresh(const std::string& suffix, uint64_t generation,
+                    const std::vector<CommitInfo>& commits);
+};
+
+// 按时间查询所需的部分（orderTime 与 oid）的只读副本，提交锁内生成、原子发布，读取方不加锁使用。
+// 条目按固定大小的块存放，新版本与旧版本共享已写满的块，追加一个提交只复制最后一块
+class CommitTimeline {
+public:
+    static constexpr size_t npos = SIZE_MAX;
+
+    // 由整个索引生成
+    static std::shared_ptr<const CommitTimeline> build(const CommitIndex& index);
+    // 在末尾追加一条记录得到的新版本，本对象不变
+    std::shared_ptr<const CommitTimeline> append(const CommitRecord& record) const;
+
+    size_t size() const { return size_; }
+    const git_oid& oid(size_t pos) const { return entry(pos).oid; }
+    // 最后一个 orderTime < time 的条目，不存在返回 npos
+    size_t lastBefore(int64_t time) const;
+
+private:
+    static constexpr size_t kChunkSize = 256;
+    struct Entry {
+        int64_t orderTime;
+        git_oid oid;
+    };
+    using Chunk = std::vector<Entry>;
+
+    std::vector<std::shared_ptr<const Chunk>> chunks_;
+    size_t size_ = 0;
+
+    const Entry& entry(size_t pos) const { return (*chunks_[pos / kChunkSize])[pos % kChunkSize]; }
+};
+
+}
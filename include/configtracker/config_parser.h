@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string_view>
+#include <functional>
+
+namespace configtracker {
+
+// 可以做键级比较的配置格式
+enum class ConfigFormat {
+    Unknown,   // 不解析，只做文件级跟踪
+    KeyValue,  // key=value / key: value，# 或 ; 开头为注释（.conf、.cfg、.properties、.env 等）
+    Ini,       // KeyValue 加 [section]，键名为 section.key
+    Json       // 嵌套对象展开为 a.b.c，数组元素为 a[0]
+};
+
+// 按扩展名判断格式；没有已知扩展名时，内容以 '{' 开头视为 JSON
+ConfigFormat detectFormat(std::string_view path, std::string_view data);
+
+// 每个键值对回调一次。value 指向 data 内部，在 data 有效期间一直有效；
+// key 可能是拼接出来的，只在回调期间有效
+using KeyValueSink = std::function<void(std::string_view key, std::string_view value)>;
+
+// 流式解析，不构造中间的树。JSON 字符串值不做转义解码，保留原文；空对象和空数组本身作为一个键。
+// 格式错误时返回 false（已回调的键值对不撤销）
+bool parseConfig(ConfigFormat format, std::string_view data, const KeyValueSink& sink);
+
+}
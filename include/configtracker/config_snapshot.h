@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <functional>
+#include <unordered_map>
+#include <git2.h>
+
+namespace configtracker {
+
+// 一个文件版本的内容，创建后不再修改。oid 相同的内容在各个快照之间共享同一份
+struct Blob {
+    git_oid oid;
+    std::string data;
+};
+using BlobPtr = std::shared_ptr<const Blob>;
+
+// 按 oid 去重的 blob 表：仍被某个快照持有的内容直接复用，否则从对象库读取
+class BlobStore {
+public:
+    using Reader = std::function<bool(const git_oid&, std::string&)>;
+
+    explicit BlobStore(Reader reader);
+    // 读取失败时返回 nullptr
+    BlobPtr get(const git_oid& oid);
+    // 当前仍有快照引用的 blob 数
+    size_t liveCount();
+
+private:
+    Reader reader_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::weak_ptr<const Blob>> blobs_;  // 以 20 字节原始 oid 为键
+    size_t sweepAt_ = 1024;
+
+    void sweepLocked();
+};
+
+// 提交树中的一个普通文件
+struct TreeFile {
+    std::string path;   // 仓库内路径
+    git_oid oid;
+    uint32_t mode = 0;
+};
+
+// 某个提交中全部被跟踪文件的只读视图（路径 → 内容），发布后不再修改，
+// 读者持有 shared_ptr 即可在任意线程无锁读取
+class ConfigSnapshot {
+public:
+    // 用一个提交的文件列表构造快照。与 previous 中 oid 相同且已加载的内容直接共享；
+    // eager 为 true 时立即加载其余内容，否则在第一次读取时才从对象库加载
+    static std::shared_ptr<const ConfigSnapshot> build(std::string commit, const std::vector<TreeFile>& files,
+                                                       const ConfigSnapshot* previous,
+                                                       const std::shared_ptr<BlobStore>& store, bool eager);
+    // 在 previous 的基础上替换 changed、删除 removed 得到下一个版本，不重新遍历整个树。
+    // 未改动的条目与 previous 共享，eager 只作用于 changed 中内容不同的文件
+    static std::shared_ptr<const ConfigSnapshot> derive(std::string commit, const ConfigSnapshot& previous,
+                                                        const std::vector<TreeFile>& changed,
+                                                        const std::vector<std::string>& removed,
+                                                        const std::shared_ptr<BlobStore>& store, bool eager);
+
+    ConfigSnapshot(const ConfigSnapshot&) = delete;
+    ConfigSnapshot& operator=(const ConfigSnapshot&) = delete;
+
+    // 快照对应的提交，仓库还没有提交时为空
+    const std::string& commit() const { return commit_; }
+    size_t size() const { return size_; }
+    // path 可以是仓库内路径，也可以是被监控文件的绝对路径（Direct 模式）
+    bool contains(const std::string& path) const;
+    // 文件内容；不存在或无法加载时返回 nullptr。返回的 Blob 在快照释放后仍然有效
+    BlobPtr get(const std::string& path) const;
+    // 内容视图，在快照存活期间有效；不存在时返回 false
+    bool read(const std::string& path, std::string_view& out) const;
+    // 全部仓库内路径，已排序
+    std::vector<std::string> paths() const;
+
+private:
+    struct Entry {
+        git_oid oid;
+        // 延迟加载的内容，只会从空变为非空一次，用 std::atomic_load / atomic_compare_exchange 访问
+        mutable BlobPtr blob;
+        bool removed = false;  // 只出现在 overlay_ 中，表示 base_ 里的文件已删除
+
+        Entry() = default;
+        Entry(const Entry& other);
+        Entry& operator=(const Entry&) = delete;
+    };
+    using Table = std::unordered_map<std::string, Entry>;
+
+    ConfigSnapshot() = default;
+    const Entry* find(const std::string& path) const;
+    // 按仓库内路径精确查找
+    const Entry* lookup(const std::string& path) const;
+    // 把 overlay_ 合并进一张新的 base_
+    void flatten();
+
+    std::string commit_;
+    // 连续的版本共享同一张 base_，各自只复制相对它的改动；overlay_ 超过 base_ 大小的平方根时
+    // 合并成新的 base_，每次发布的开销与改动的文件数相当，而不是与文件总数相当
+    std::shared_ptr<const Table> base_;
+    Table overlay_;
+    size_t size_ = 0;
+    // 延迟加载使用；跟踪器销毁后尚未加载的内容返回 nullptr
+    std::weak_ptr<BlobStore> store_;
+};
+
+using SnapshotPtr = std::shared_ptr<const ConfigSnapshot>;
+
+// 历史快照的 LRU 缓存，以提交哈希为键
+class SnapshotCache {
+public:
+    explicit SnapshotCache(size_t capacity) : capacity_(capacity) {}
+
+    SnapshotPtr get(const std::string& commit);
+    void put(const SnapshotPtr& snapshot);
+    size_t size();
+
+private:
+    size_t capacity_;
+    std::mutex mutex_;
+    std::list<SnapshotPtr> lru_;  // 最近使用的在前
+    std::unordered_map<std::string, std::list<SnapshotPtr>::iterator> byCommit_;
+};
+
+}
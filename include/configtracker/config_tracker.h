@@ -5,18 +5,82 @@
 #include <vector>
 #include <memory>
 #include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "git_repo_manager.h"  
 #include "file_watcher.h"      
+#include "commit_batcher.h"
+#include "change_journal.h"
+#include "change_subscription.h"
+#include "config_snapshot.h"
+#include "history_reader.h"
+#include "async_git_repo.h"
+#include "metrics.h"
+#include "logger.h"
 
 
 namespace configtracker {
 
+// 多仓库分片方式
+enum class ShardMode {
+    None,          // 所有监控路径共用 repoRoot 一个仓库（默认）
+    PerWatchRoot,  // 每个监控根目录一个仓库，位于 <repoRoot>/shards/<目录名>-<哈希>
+    HashBucket     // 按文件路径哈希分到 shardCount 个仓库，位于 <repoRoot>/shards/bucket-<i>
+};
+
+// 变更的持久化方式
+enum class StorageMode {
+    Git,      // 每批变更直接生成提交（默认）
+    Journal   // 先追加到变更日志，按 journalFoldMs 的节奏合并为提交，适合频繁改写的配置
+};
+
 struct TrackConfig {
     std::vector<std::string> watchPaths;
     int retentionDays = 7;
     bool enableAutoCommit = true;
     std::string repoRoot = ".configtracker";
+    IngestMode ingestMode = IngestMode::Direct;  // 文件写入仓库的方式，见 IngestMode
+    WatchBackendType watchBackend = WatchBackendType::Auto;  // 文件监控后端
+    int pollIntervalMs = 2000;                                // 轮询后端的扫描间隔
+    int batchQuietMs = 200;          // 自动提交：静默这么久没有新变更后提交一批
+    int batchMaxLatencyMs = 2000;    // 自动提交：批次从第一个变更起最长等待时间
+    std::string stateFile;           // 文件状态缓存位置，默认 <repoRoot>/.git/configtracker/watcher.state
+    bool recursive = true;                       // 是否监控子目录
+    std::vector<std::string> includePatterns;    // glob，为空时跟踪全部文件
+    std::vector<std::string> excludePatterns;    // glob，命中的文件或目录被忽略
+    int scanThreads = 1;                         // 轮询扫描的并行线程数，大目录树或 NFS 上可调大
+    size_t commitQueueCapacity = 4096;   // 监控线程到提交线程的事件队列容量
+    BackpressurePolicy backpressure = BackpressurePolicy::Coalesce;  // 队列满时的处理方式
+    int retentionSliceMs = 50;           // 后台历史压缩每次最多占用仓库的时长
+    int retentionIntervalMinutes = 60;   // 历史压缩完成后，隔多久再检查一次
+    LogLevel logLevel = LogLevel::Info;  // 低于该级别的日志不输出
+    std::string logFile;                 // 日志文件，为空时输出到控制台
+    std::string metricsDumpPath;         // Prometheus 文本定期写入的文件，"unix:<path>" 表示发送到 Unix 域套接字
+    int metricsDumpIntervalMs = 10000;   // 指标导出间隔
+    size_t snapshotCacheSize = 16;       // snapshotAt 缓存的历史快照数
+    bool keyDiff = true;                 // 提交时对 .conf/.ini/JSON 文件做键级比较并记录
+    ShardMode sharding = ShardMode::None;  // 分片时每个仓库有自己的提交线程，提交并行执行
+    int shardCount = 0;                    // HashBucket 的分片数，0 表示 CPU 核数
+    bool packMaintenance = true;           // 后台把松散对象打包，历史压缩后清理不可达对象
+    int maintenanceIntervalMinutes = 10;   // 两轮打包维护之间的间隔
+    int maintenanceCpuPercent = 10;        // 打包维护最多占用一个核的百分比
+    int maintenanceIoMBps = 8;             // 打包维护的写盘速率上限（MB/s），0 表示不限
+    StorageMode storage = StorageMode::Git;  // 日志模式下 batchQuietMs/batchMaxLatencyMs 不再使用
+    int journalFoldMs = 5000;              // 日志模式：把日志中的变更合并为一次提交的间隔
+    int journalSyncMs = 1000;              // 日志模式：把日志刷到磁盘的间隔，0 表示交给内核写回
+    size_t largeFileChunkKB = 1024;        // 不小于这个大小的文件按内容分块存储，只写入变化的块，0 表示关闭
+    size_t historyTreeCacheSize = 4096;    // readAt/diffBetween 每个分片缓存的目录数
+    size_t historyBlobCacheMB = 64;        // readAt 每个分片缓存的文件内容大小
+    int asyncReadThreads = 2;              // asyncRepo 每个分片的读线程数
+};
+
+// 跨分片合并查询返回的提交
+struct ShardCommit {
+    std::string shard;   // 所在分片的名称，非分片模式为空
+    std::string hash;
+    int64_t time = 0;    // 提交时间（秒）
 };
 
 class GitRepoManager;
@@ -29,13 +93,130 @@ public:
     void stop();
     void manualCommit();
     void cleanOld();
+    // 把被监控的文件恢复到某个提交时的内容：只改写内容不同的文件，写回原位置，
+    // 并生成一次恢复提交
     void restoreTo(const std::string& commitHash);
+    // 只恢复这些文件或目录
+    bool restorePaths(const std::string& commitHash, const std::vector<std::string>& paths);
+    // 当前各组件的计数器、队列深度和延迟分位数
+    MetricsSnapshot metrics() const;
+    // 最新提交的只读快照，每次提交后整体替换（日志模式下为每次合并后）。读者无需加锁，持有期间内容不变。
+    // 启动后的第一个快照在第一次调用时才列出文件
+    // 分片模式下返回第一个分片的快照，按文件读取使用 snapshotFor
+    SnapshotPtr snapshot() const;
+    // 负责 path 的分片的最新快照
+    SnapshotPtr snapshotFor(const std::string& path) const;
+    // 任意提交的快照：只读取文件列表，内容在第一次访问时从对象库加载，最近用过的快照会缓存
+    SnapshotPtr snapshotAt(const std::string& commitHash);
+    // 某个提交修改了哪些键
+    std::vector<KeyChange> keyChanges(const std::string& commitHash);
+    // 一个键的变更历史，从新到旧
+    std::vector<KeyChange> keyHistory(const std::string& path, const std::string& key, size_t limit = 0);
+    // 文件在时间点 at 时的内容，不检出、不移动 HEAD。at 早于第一次提交或文件当时不存在时返回 nullptr，
+    // commit 非空时返回所用的提交
+    BlobPtr readAt(const std::string& path, std::chrono::system_clock::time_point at,
+                   std::string* commit = nullptr);
+    // from 时与 to 时之间变化的文件，覆盖全部分片，按分片和路径排序
+    std::vector<FileDiff> diffBetween(std::chrono::system_clock::time_point from,
+                                      std::chrono::system_clock::time_point to);
+
+    // 以下查询覆盖全部分片，结果按提交时间从新到旧合并
+    std::vector<ShardCommit> latestCommits(size_t count);
+    std::vector<ShardCommit> commitsBetween(std::chrono::system_clock::time_point from,
+                                            std::chrono::system_clock::time_point to);
+    // 只查询负责 path 的分片
+    std::vector<ShardCommit> commitsTouching(const std::string& path, size_t limit = 0);
+    // 各分片仓库的路径，非分片模式只有 repoRoot
+    std::vector<std::string> shardRepos() const;
+    // 负责 path 的分片仓库的异步接口，path 为空时为第一个分片；第一次调用时创建读写线程，
+    // 与跟踪器同生命周期。经它提交或检出不会更新 snapshot() 和订阅，恢复文件应使用 restoreTo/restorePaths
+    AsyncGitRepo* asyncRepo(const std::string& path = "");
+
+    // 订阅已提交的变更：每次自动提交、日志合并或恢复后，把变化的文件（按 prefixes 过滤）
+    // 和键级变更交给 handler，handler 在该订阅自己的线程上调用。可以在 start() 之前订阅，
+    // stop() 投递完剩余的事件后结束全部订阅
+    SubscriptionId subscribe(const SubscribeOptions& options, ChangeHandler handler);
+    // 投递完已入队的事件后取消订阅，不能在 handler 中调用
+    bool unsubscribe(SubscriptionId id);
 
 private:
+    // 一个仓库及其提交线程和只读快照
+    struct Shard {
+        std::string name;
+        std::string repoPath;
+        std::string root;    // PerWatchRoot 时负责的监控根目录（绝对路径）
+        std::unique_ptr<GitRepoManager> git;
+        // current 通过 std::atomic_load / atomic_store 读写，发布者之间用 publishMutex 串行。
+        // blobs 声明在 git 之后，先于仓库析构
+        std::shared_ptr<BlobStore> blobs;
+        SnapshotPtr current;
+        std::mutex publishMutex;
+        std::unique_ptr<SnapshotCache> snapshotCache;
+        std::unique_ptr<HistoryReader> history;   // 按时间点读取历史
+        std::unique_ptr<AsyncGitRepo> async;      // asyncRepo 第一次调用时创建
+        std::once_flag asyncOnce;
+        // 日志模式下代替提交线程，位于 .git/configtracker/journal；合并之间用 foldMutex 串行
+        std::unique_ptr<ChangeJournal> journal;
+        std::mutex foldMutex;
+        // 暂存或提交失败的文件，与下一批一起重试；只在提交线程上访问
+        std::vector<std::string> retryPaths;
+        // 最后析构：提交线程使用上面的成员
+        std::unique_ptr<CommitBatcher> batcher;
+    };
+
     TrackConfig config_;
-    std::unique_ptr<GitRepoManager> git_;
+    // watcher_ 的回调会投递到各分片的提交线程，声明在分片之后，先于分片析构
+    std::vector<std::unique_ptr<Shard>> shards_;
     std::unique_ptr<FileWatcher> watcher_;
     std::atomic<bool> running_;
+
+    // 后台保留策略线程：分片执行历史压缩，不阻塞 start()
+    std::thread retentionThread_;
+    std::mutex retentionMutex_;
+    std::condition_variable retentionCv_;
+
+    // 日志模式：定期同步日志并合并为提交
+    std::thread journalThread_;
+    std::mutex journalMutex_;
+    std::condition_variable journalCv_;
+    bool journalStop_ = false;
+
+    // 变更订阅：发布者之间用 subscribersMutex_ 串行，每个订阅者的环形队列只有一个生产者；
+    // pathIds_ 也由它保护，路径 ID 在跟踪器的生命周期内不变。只驻留出现在提交中的文件，
+    // 提交之前就消失的临时文件不占用 ID
+    std::mutex subscribersMutex_;
+    std::vector<std::unique_ptr<Subscription>> subscribers_;
+    std::atomic<size_t> subscriberCount_{0};
+    std::atomic<size_t> keySubscriberCount_{0};
+    SubscriptionId nextSubscription_ = 1;
+    PathTable pathIds_;
+
+    // 定期导出指标
+    std::thread metricsThread_;
+    std::mutex metricsMutex_;
+    std::condition_variable metricsCv_;
+
+    void createShards();
+    Shard& shardFor(const std::string& path) const;
+    // 包含该提交的分片，找不到时返回 nullptr
+    Shard* shardOf(const std::string& hash) const;
+    std::vector<ShardCommit> merge(std::vector<ShardCommit> commits, size_t limit) const;
+    SnapshotPtr currentSnapshot(Shard& shard) const;
+    void publishSnapshot(Shard& shard, bool eager = true) const;
+    void commitBatch(Shard& shard, const std::vector<std::string>& batch);
+    // 有订阅者时返回分片当前的快照，用于判断之后是否真的生成了提交、文件在提交前是否存在
+    SnapshotPtr snapshotForNotify(Shard& shard) const;
+    // 快照已发布且 HEAD 不再是 before 的提交时，把 batchPaths 的变更投递给订阅者。
+    // commit/time 为刚生成的提交，快照正好是它时不必再查提交索引
+    void notifySubscribers(Shard& shard, const SnapshotPtr& before, const std::vector<std::string>& batchPaths,
+                           const std::string& commit, int64_t time);
+    // 读取变更后的文件追加到分片的日志
+    void journalChange(Shard& shard, const std::string& path);
+    // 把日志中尚未合并的变更写成一次提交
+    void foldJournal(Shard& shard);
+    void journalLoop();
+    void retentionLoop();
+    void metricsLoop();
 };
 
 }
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace configtracker {
+
+// 大文件分块存储的参数
+struct ChunkingOptions {
+    size_t threshold = 1 << 20;   // 不小于这个大小的文件按内容分块存储，0 表示关闭
+    size_t minSize = 16 << 10;    // 块的最小、平均（取不超过它的 2 的幂）和最大长度
+    size_t avgSize = 64 << 10;
+    size_t maxSize = 256 << 10;
+};
+
+// 一个块在文件中的位置和 XXH64
+struct ContentChunk {
+    size_t offset = 0;
+    size_t length = 0;
+    uint64_t hash = 0;
+};
+
+// FastCDC 内容定义分块：块边界只由附近的内容决定，文件中间插入或删除数据后，
+// 改动之外的块保持不变。使用归一化分块（平均长度之前用较严的掩码、之后用较宽的掩码）
+// 和每步滚动两个字节的 gear 哈希
+void chunkContent(const char* data, size_t size, const ChunkingOptions& options,
+                  std::vector<ContentChunk>& out);
+
+}
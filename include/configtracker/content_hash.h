@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace configtracker {
+
+// XXH64 内容哈希，用于快速判断文件内容是否变化（非加密用途）
+uint64_t xxhash64(const void* data, size_t len, uint64_t seed = 0);
+
+// 读取文件并计算 XXH64，失败返回 false
+bool hashFile(const std::string& path, uint64_t& hash);
+
+}
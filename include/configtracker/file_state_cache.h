@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "path_table.h"
+
+namespace configtracker {
+
+// 单个文件的指纹：元数据用于快速判断，内容哈希用于排除只改了 mtime 的情况
+struct FileState {
+    uint64_t size = 0;
+    int64_t mtimeNs = 0;
+    uint64_t inode = 0;
+    uint64_t hash = 0;
+    bool pending = false;  // 已检测到但尚未提交，不写入持久化文件
+    bool present = false;  // 文件删除后 ID 仍保留在路径表中
+};
+
+enum class FileChange {
+    Unchanged,
+    Added,
+    Modified,
+    Removed
+};
+
+// 持久化的文件状态缓存，重启后只上报内容真正变化的文件
+class FileStateCache {
+public:
+    // statePath 为空时只在内存中工作
+    explicit FileStateCache(const std::string& statePath = "") : statePath_(statePath) {}
+
+    // 通过 mmap 读取状态文件，文件不存在或损坏时返回 false（缓存为空）
+    bool load();
+    // 写入临时文件后 rename，保证状态文件始终完整
+    bool save();
+    // save() 拆成两步：encode() 在锁内生成文件内容并清除 dirty 标记，
+    // writeImage() 可以在锁外写盘，失败时调用 markDirty() 以便下次重试
+    std::string encode();
+    bool writeImage(const std::string& image) const;
+    void markDirty() { dirty_ = true; }
+
+    // 重新计算文件指纹并与缓存比较，同时更新缓存
+    FileChange refresh(const std::string& path);
+    // 标记这些路径的当前状态已经提交，可以持久化
+    void markCommitted(const std::vector<std::string>& paths);
+
+    size_t size() const { return liveCount_; }
+    bool dirty() const { return dirty_; }
+    size_t memoryUsage() const {
+        return paths_.memoryUsage() + states_.capacity() * sizeof(FileState);
+    }
+
+private:
+    std::string statePath_;
+    // 扁平状态表：以路径 ID 为下标
+    PathTable paths_;
+    std::vector<FileState> states_;
+    size_t liveCount_ = 0;
+    bool dirty_ = false;
+
+    FileState& stateFor(PathId id);
+    void compactIfSparse();
+};
+
+}
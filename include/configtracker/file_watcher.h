@@ -5,27 +5,65 @@
 #include <functional>
 #include <thread>
 #include <atomic>
-#include <map>
-#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <unordered_set>
+
+#include "watch_backend.h"
+#include "file_state_cache.h"
 
 namespace configtracker {
 
+struct WatchOptions {
+    WatchBackendType backend = WatchBackendType::Auto;
+    std::chrono::milliseconds pollInterval = std::chrono::seconds(2);
+    std::string stateFile;  // 文件状态缓存的持久化位置，为空时只在内存中
+    bool recursive = true;                      // 是否监控子目录
+    std::vector<std::string> includePatterns;   // 为空时跟踪全部文件
+    std::vector<std::string> excludePatterns;
+    size_t scanThreads = 1;                     // 轮询扫描的并行线程数
+};
+
 class FileWatcher {
 public:
-    FileWatcher() : running_(false) {}
+    explicit FileWatcher(const WatchOptions& options = WatchOptions())
+        : options_(options), running_(false), stateCache_(options.stateFile) {}
     ~FileWatcher() { stop(); }
-    
+
     void addWatch(const std::string& path);
-    void startWatching(std::function<void(std::string)> onChange);
+    // 每个确认的变更（新增、修改或删除，删除时文件已不存在）调用一次 onChange，参数只在回调期间有效。onChange 在回调锁之外调用，
+    // 多个后端时可能并发，其中可以阻塞或调用 markCommitted/saveState
+    void startWatching(std::function<void(const std::string&)> onChange);
     void stop();
-    
+
+    // 这些路径的变更已经提交，其状态可以持久化
+    void markCommitted(const std::vector<std::string>& paths);
+    // 保存文件状态缓存；非强制时限制写盘频率
+    void saveState(bool force = false);
+    // 本进程自己写入的文件（恢复快照）：写入前调用 suppress，期间这些路径的事件被忽略；
+    // 写入后调用 acknowledge，以文件的新状态作为已提交状态，之后到达的事件不会再上报
+    void suppress(const std::vector<std::string>& paths);
+    void acknowledge(const std::vector<std::string>& paths);
+
 private:
+    WatchOptions options_;
     std::vector<std::string> watchPaths_;
     std::atomic<bool> running_;
-    std::thread watchThread_;
-    std::map<std::string, std::filesystem::file_time_type> fileStates_;
-    
-    void checkForChanges(const std::string& path, const std::function<void(std::string)>& onChange);
+
+    // 每个后端在自己的线程上运行，状态缓存的访问通过 callbackMutex_ 串行化
+    std::vector<std::unique_ptr<WatchBackend>> backends_;
+    std::vector<std::thread> watchThreads_;
+    std::mutex callbackMutex_;
+
+    // 后端上报的只是候选路径，经内容哈希确认后才回调
+    FileStateCache stateCache_;
+    std::chrono::steady_clock::time_point lastSave_;
+    std::mutex saveMutex_;
+    std::unordered_set<std::string> suppressed_;  // 受 callbackMutex_ 保护
+
+    // 把任意形式的路径换成后端上报时使用的形式（监控根目录 + 相对路径）
+    std::string watchedPath(const std::string& path) const;
 };
 
 }
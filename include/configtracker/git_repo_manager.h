@@ -4,27 +4,273 @@
 #include <vector>
 #include <git2.h>
 #include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
 
+#include <sys/stat.h>
+
+#include "commit_index.h"
+#include "config_snapshot.h"
+#include "key_history.h"
+#include "change_journal.h"
+#include "content_chunker.h"
+#include "tree_cache.h"
 
 
 namespace configtracker {
 
+// 被监控文件写入仓库的方式
+enum class IngestMode {
+    Direct,        // mmap 源文件直接写入对象库，索引路径按源文件的目录结构组织（默认）
+    WorkTreeCopy   // 旧方式：复制到仓库工作区根目录（只保留文件名）后再添加
+};
+
+// 恢复时需要改写的一个文件
+struct RestoreAction {
+    std::string path;       // 写回的位置（被监控文件的原路径）
+    std::string repoPath;   // 仓库内路径
+    git_oid blob;           // 目标内容
+    uint32_t mode = 0;      // 目标提交中的文件模式
+    bool remove = false;    // 目标提交中没有这个文件，恢复时删除
+};
+
+// 后台打包维护的预算和触发条件
+struct MaintenanceOptions {
+    std::chrono::milliseconds interval = std::chrono::minutes(10);  // 两轮维护之间的间隔
+    size_t looseThreshold = 1000;       // 松散对象达到这个数量才打包
+    size_t maxObjectsPerPack = 50000;   // 每轮最多打包的松散对象数，限制单轮的工作量
+    size_t maxPacks = 32;               // 包文件超过这个数量时全量重打包
+    int cpuPercent = 10;                // 打包线程最多占用一个核的百分比
+    uint64_t ioBytesPerSec = 8 << 20;   // 写包和删除文件的速率上限，0 表示不限
+    std::chrono::seconds pruneGrace = std::chrono::minutes(5);  // 比这更新的文件不清理
+};
+
+// 一轮维护的结果
+struct MaintenanceStats {
+    size_t looseFound = 0;      // 扫描到的松散对象（最多 maxObjectsPerPack 个）
+    size_t objectsPacked = 0;   // 打包后删除的松散对象
+    size_t packsWritten = 0;
+    bool fullRepack = false;
+    size_t looseRemoved = 0;    // 全量重打包后删除的过期松散对象
+    size_t packsRemoved = 0;    // 全量重打包后删除的旧包
+};
+
 class GitRepoManager {
 public:
-    GitRepoManager(const std::string& repoPath);
+    GitRepoManager(const std::string& repoPath,
+                   std::chrono::milliseconds indexFlushDelay = std::chrono::seconds(1),
+                   IngestMode ingestMode = IngestMode::Direct);
     ~GitRepoManager();
     
     void init();
     void addFile(const std::string& path);
-    void commit(const std::string& message);
+    // 批量暂存文件，整批只读写一次索引。failed 非空时返回读取或写入失败、应稍后重试的文件；
+    // 已被删除的文件从索引中移除，无法放入仓库的文件（非普通文件、路径无法映射）记录日志后跳过
+    void addFiles(const std::vector<std::string>& paths, std::vector<std::string>* failed = nullptr);
+    // 暂存内存中的文件内容（日志模式合并时使用），不读取磁盘上的文件；
+    // 与已暂存内容相同的文件跳过，返回实际变化的文件数。failed 非空时返回未能写入的文件
+    size_t addContents(const std::vector<FileContent>& files, std::vector<std::string>* failed = nullptr);
+    // 生成提交，失败时返回 false，已暂存的内容保留到下一次提交。
+    // hash、time 非空时返回新提交的哈希和提交时间（秒）
+    bool commit(const std::string& message, std::string* hash = nullptr, int64_t* time = nullptr);
+    // 上次提交之后是否暂存过变更（包括提交失败后留下的）
+    bool hasStagedChanges();
+    // 以下查询都走提交索引，结果从新到旧。times 非空时按相同顺序返回各提交的时间（秒），
+    // 与结果来自同一次索引读取，不必再逐个 findCommit
     std::vector<std::string> listCommits();
+    std::vector<std::string> latestCommits(size_t count, std::vector<int64_t>* times = nullptr);
+    std::vector<std::string> commitsBetween(std::chrono::system_clock::time_point from,
+                                            std::chrono::system_clock::time_point to,
+                                            std::vector<int64_t>* times = nullptr);
+    // path 可以是被监控文件的路径，也可以是仓库内的相对路径；limit 为 0 表示不限
+    std::vector<std::string> commitsTouching(const std::string& path, size_t limit = 0,
+                                             std::vector<int64_t>* times = nullptr);
+    // 提交是否在当前分支的历史中，time 返回提交时间（秒）
+    bool findCommit(const std::string& hash, int64_t* time = nullptr);
+    // 时间点 at 时的提交，即提交时间不晚于 at 的最后一个提交；at 早于第一次提交时返回 false。
+    // 查的是最近一次提交、检出或列举提交时发布的时间线，不占用提交锁
+    bool commitAt(std::chrono::system_clock::time_point at, git_oid& out);
+    // 键级变更：.conf/.ini/JSON 等配置文件在提交时逐键比较，结果保存在提交旁的记录中，默认开启
+    void setKeyDiffEnabled(bool enabled);
+    // 大文件按内容分块存储（仅 Direct 模式）：文件路径上保存块清单，变化时只写入改动的块。
+    // readBlob、快照和恢复读到的都是拼接后的完整内容
+    void setChunking(const ChunkingOptions& options);
+    // 某个提交修改了哪些键
+    std::vector<KeyChange> keyChanges(const std::string& hash);
+    // 一个键的变更历史，从新到旧，只读取记录，不重新解析旧版本。path 的含义同 commitsTouching
+    std::vector<KeyChange> keyHistory(const std::string& path, const std::string& key, size_t limit = 0);
     std::string getLatestCommit();
+    // 旧接口：检出整个树到仓库工作区并把 HEAD 移到该提交
     bool checkoutCommit(const std::string& hash);
+    // 比较目标提交与磁盘上的当前文件，列出需要改写的文件。paths 为空时比较整个树，
+    // 否则只比较这些文件或目录（被监控的原路径）。内容相同的文件不会出现在结果中
+    bool planRestore(const std::string& hash, const std::vector<std::string>& paths,
+                     std::vector<RestoreAction>& out);
+    // 逐个文件原子地写回（写临时文件后 rename），然后生成一次恢复提交，历史不会被改写
+    bool applyRestore(const std::string& hash, const std::vector<RestoreAction>& actions,
+                      std::string* commitHash = nullptr, int64_t* commitTime = nullptr);
+    // applyRestore 写文件时使用的临时文件名
+    static std::string restoreTempPath(const std::string& path);
+    // 某个提交（hash 为空时为 HEAD）中的全部普通文件，resolved 返回该提交的完整哈希。
+    // 仓库还没有提交时返回空列表
+    bool listFiles(const std::string& hash, std::vector<TreeFile>& out, std::string* resolved = nullptr);
+    // 从 base 提交（为空表示空树）到 HEAD 之间改动过的文件：HEAD 中仍存在的放入 changed，已删除的放入 removed，
+    // head 返回 HEAD 的完整哈希。只查提交索引和这些路径，不遍历整个树；base 不在 HEAD 的第一父链上
+    // （历史被压缩或改写）或索引落后于分支时返回 false，调用方应退回 listFiles
+    bool changesSince(const std::string& base, std::string& head, std::vector<TreeFile>& changed,
+                      std::vector<std::string>& removed);
+    // 读取对象库中的一个 blob，分块存储的文件返回拼接后的完整内容
+    bool readBlob(const git_oid& oid, std::string& out);
+    // 只读句柄：独立打开的仓库对象，只能在一个线程上使用，用 git_repository_free 释放。
+    // 以下带 handle 参数的重载不持有提交锁，可以与提交以及其他句柄上的读取并发执行；
+    // handle 为 nullptr 时退回加锁的版本
+    git_repository* openReadHandle();
+    bool listFiles(git_repository* handle, const std::string& hash, std::vector<TreeFile>& out,
+                   std::string* resolved = nullptr);
+    bool readBlob(git_repository* handle, const git_oid& oid, std::string& out);
+    // 两个提交之间变化的文件（仓库内路径），哈希为空的一侧视为空树
+    bool diffCommits(git_repository* handle, const std::string& from, const std::string& to,
+                     std::vector<std::string>& out);
+    // 把早于保留期的历史压缩为一个基础提交，阻塞直到完成
     void squashCommitsOlderThan(int days);
+    // 增量压缩：最多执行 budget 时长的工作后返回，进度写入检查点，
+    // 进程重启后可继续。返回 true 表示已没有需要压缩的历史
+    bool compactHistoryStep(int days, std::chrono::milliseconds budget);
+    // 距离下一次保留期检查还要等多久：上次检查的时间记录在检查点中，重启不会提前触发；
+    // 有未完成的压缩或从未检查过时返回 0
+    std::chrono::milliseconds retentionDelay(std::chrono::milliseconds interval);
+    // 立即把内存中的索引写回磁盘（析构时也会调用）
+    void flushIndex();
+    // 启动后台维护线程：按间隔把松散对象增量打包、更新多包索引，
+    // 历史压缩完成或包文件过多时全量重打包并清理不可达对象。维护使用独立的仓库句柄，不占用提交锁
+    void startMaintenance(const MaintenanceOptions& options);
+    void stopMaintenance();
+    // 同步执行一轮维护
+    MaintenanceStats runMaintenance(const MaintenanceOptions& options);
+    // 被监控文件在仓库内的路径，即快照和键级变更中使用的路径
+    std::string repoRelativePath(const std::string& path) const;
+    // repoRelativePath 的逆映射
+    std::string sourcePath(const std::string& repoPath) const;
+    // 块目录下的路径，不是被跟踪的文件
+    static bool isChunkPath(const char* path);
     
 private:
     std::string repoPath_;
+    std::string repoRoot_;   // 仓库的规范化绝对路径，构造时计算一次
+    IngestMode ingestMode_;
     git_repository* repo_;
+    // 常驻内存的索引，暂存只修改内存，提交后由后台线程延迟写盘
+    git_index* index_;
+    bool stagedSinceCommit_ = false;
+    bool indexDirty_ = false;
+    // 与 index_ 同步修改的树层级，提交时只重写变化的目录；失效时退回从索引写树
+    TreeCache tree_;
+    std::vector<std::string> stagedPaths_;  // 本次提交暂存的仓库内路径，写入提交索引
+    std::string readBuffer_;                // 暂存时读取源文件的缓冲区，在提交锁内复用
+    CommitIndex commitIndex_;
+    // commitIndex_ 每次变化后发布的时间线，commitAt 不加锁读取
+    std::shared_ptr<const CommitTimeline> timeline_;
+    // 键级变更记录在第一次使用时才加载，启动时不读取整个记录文件
+    KeyHistory keyHistory_;
+    bool keyHistoryOpened_ = false;
+    bool keyDiffEnabled_ = true;
+    ChunkingOptions chunking_;
+    
+    std::mutex mutex_;
+    std::chrono::milliseconds indexFlushDelay_;
+    std::thread flushThread_;
+    std::condition_variable flushCv_;
+    bool flushStop_ = false;
+    
+    // 历史压缩的进度（持久化在 .git/configtracker/compaction.state）
+    struct CompactionState {
+        bool active = false;
+        std::string branch;     // 被改写的分支，例如 refs/heads/master
+        git_oid origTip;        // 开始压缩时的分支顶端
+        git_oid lastSource;     // 最后一个已改写的原始提交
+        git_oid lastNew;        // 它改写后的新提交
+        git_oid boundary;       // 被压缩为基础提交的原始提交
+    };
+    CompactionState compaction_;
+    bool compactionLoaded_ = false;
+    std::vector<git_oid> compactionQueue_;  // 仍待改写的原始提交，从旧到新
+    bool compactionQueueValid_ = false;
+    
+    // 启动检查点（持久化在 .git/configtracker/checkpoint）
+    struct Checkpoint {
+        bool indexValid = false;    // 磁盘上的索引正是 indexTree，且写盘后未被改动
+        git_oid indexTree;
+        int64_t indexSize = 0;      // 写盘后索引文件的大小和修改时间（纳秒）
+        int64_t indexMtime = 0;
+        int64_t lastRetention = 0;  // 上次完成保留期检查的时间（秒）
+        bool prunePending = false;  // 历史压缩后还没有清理不可达对象
+    };
+    Checkpoint checkpoint_;
+    git_oid committedTree_;         // 最后一次提交的树，未暂存新文件时与内存中的索引一致
+    bool committedTreeKnown_ = false;
+    
+    // 后台打包维护
+    std::thread maintenanceThread_;
+    std::mutex maintenanceMutex_;
+    std::condition_variable maintenanceCv_;
+    bool maintenanceWake_ = false;              // 历史压缩完成后提前唤醒维护线程
+    std::atomic<bool> maintenanceStop_{false};  // 打包过程中的回调据此中止
+    std::mutex passMutex_;                      // 同一时间只执行一轮维护
+    
+    std::string sidecarPath(const std::string& name) const;
+    bool planCompactionLocked(int days);
+    bool rewriteCommitLocked(const git_oid& source, const git_oid& parent, git_oid& out);
+    bool collectCommitsLocked(const git_oid& tip, const git_oid& hide, std::vector<git_oid>& out);
+    bool finishCompactionLocked();
+    void loadCompactionState();
+    void saveCompactionState();
+    void clearCompactionState();
+    bool compactHistoryStepLocked(int days, std::chrono::milliseconds budget);
+    
+    void loadCheckpoint();
+    void saveCheckpoint();
+    bool indexMatchesCheckpoint(const git_oid& tree) const;
+    KeyHistory& keyHistoryLocked();
+    
+    void maintenanceLoop(MaintenanceOptions options);
+    void collectIndexBlobsLocked(std::vector<git_oid>& out);
+    void refreshObjectsLocked();
+    
+    void remapCommitIndexLocked(const git_oid& oldTip);
+    
+    void syncCommitIndexLocked();
+    void publishTimelineLocked();
+    void rebuildCommitIndexLocked(const git_oid& head);
+    static bool diffTrees(git_repository* repo, git_tree* oldTree, git_tree* newTree, std::vector<std::string>& out);
+    static bool listFilesIn(git_repository* repo, const std::string& hash, std::vector<TreeFile>& out,
+                            std::string* resolved);
+    std::vector<std::string> hashesNewestFirst(size_t first, size_t last, size_t limit,
+                                               std::vector<int64_t>* times = nullptr) const;
+    
+    // 只有可重试的失败返回 false
+    bool stageFile(git_index* index, const std::string& path);
+    bool stageEntry(git_index* index, const std::string& indexPath, const struct stat& st,
+                    const git_oid& blob_id);
+    // 把文件内容写入对象库，out 为索引项应指向的 blob；超过阈值时写块和清单并更新索引中的块目录
+    bool writeContentLocked(git_index* index, const std::string& indexPath, const char* data, size_t size,
+                            git_oid& out);
+    // 从索引中移除文件及其块目录，文件不在索引中时返回 false
+    bool removeEntryLocked(git_index* index, const std::string& indexPath);
+    bool readContentLocked(const git_oid& oid, std::string& out);
+    // 读取 blob，块清单展开为完整内容；repo 可以是只读句柄
+    static bool readContent(git_repository* repo, const git_oid& oid, std::string& out);
+    // oid 是块清单时返回完整文件的长度和 XXH64
+    bool chunkedSummaryLocked(const git_oid& oid, uint64_t& size, uint64_t& hash);
+    bool commitLocked(const std::string& message, std::string* hash = nullptr, int64_t* time = nullptr);
+    void recordKeyChangesLocked(const git_oid& commit, const git_oid* parentTree, const git_oid& tree,
+                                const std::vector<std::string>& paths, int64_t time);
+    bool writeRestoredFile(const RestoreAction& action, struct stat& st, std::string& content);
+    bool stageFileCopy(git_index* index, const std::string& path);
+    void writeIndexLocked();
+    void flushLoop();
 };
 
 }
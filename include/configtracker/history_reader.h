@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <git2.h>
+
+#include "config_snapshot.h"
+#include "lru_cache.h"
+
+namespace configtracker {
+
+class GitRepoManager;
+
+enum class FileChangeKind : uint8_t {
+    Added = 1,
+    Removed = 2,
+    Modified = 3
+};
+
+// 两个时间点之间变化的一个文件
+struct FileDiff {
+    std::string shard;      // 所在分片的名称，非分片模式为空
+    std::string path;       // 被监控文件的路径
+    std::string repoPath;   // 仓库内路径
+    FileChangeKind kind = FileChangeKind::Modified;
+    git_oid before;         // Added 时为全零
+    git_oid after;          // Removed 时为全零
+};
+
+// 按时间点读取一个仓库的历史内容，不检出、不移动 HEAD：
+// 时间点经提交索引二分查找到当时的提交，再沿路径逐级查找树，只读取用到的目录和文件。
+// 读过的树（目录列表）、提交对应的根树和文件内容按 oid 放在有容量上限的 LRU 缓存中，
+// 热点路径上的查询不再访问对象库。时间点在已发布的提交时间线上查找，读取对象使用自己的仓库句柄，
+// 都不占用提交锁。线程安全：锁只保护缓存的查找与插入，多个线程的读取并行执行
+class HistoryReader {
+public:
+    // treeCapacity 为缓存的目录数，blobBytes 为缓存的文件内容总字节数
+    HistoryReader(GitRepoManager& git, size_t treeCapacity, size_t blobBytes);
+    ~HistoryReader();
+
+    HistoryReader(const HistoryReader&) = delete;
+    HistoryReader& operator=(const HistoryReader&) = delete;
+
+    // 时间点 at 时文件的内容，即 at 之前（含）最后一个提交中的版本。path 可以是被监控文件的路径，
+    // 也可以是仓库内路径。at 早于第一次提交或文件当时不存在时返回 nullptr；commit 非空时返回所用的提交
+    BlobPtr readAt(const std::string& path, std::chrono::system_clock::time_point at,
+                   std::string* commit = nullptr);
+    // from 时与 to 时的状态之间变化的文件，按仓库内路径排序。只比较 oid 不同的子树
+    bool diffBetween(std::chrono::system_clock::time_point from, std::chrono::system_clock::time_point to,
+                     std::vector<FileDiff>& out);
+
+    // 缓存命中与未命中次数（树、根树与文件内容合计）
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    struct TreeItem {
+        std::string name;
+        git_oid oid;
+        uint32_t mode = 0;
+    };
+    using TreeListing = std::shared_ptr<const std::vector<TreeItem>>;  // 按名字排序
+
+    // 借出的只读句柄：git_repository 同一时间只能被一个线程使用，每次查询从空闲列表取一个，
+    // 没有空闲的就新开，析构时放回
+    class Lease {
+    public:
+        explicit Lease(HistoryReader& reader) : reader_(reader) {}
+        ~Lease();
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        // 第一次调用时借出，只命中缓存的查询不需要句柄
+        git_repository* get();
+
+    private:
+        HistoryReader& reader_;
+        git_repository* handle_ = nullptr;
+    };
+
+    static constexpr size_t kMaxIdleHandles = 8;
+
+    GitRepoManager& git_;
+    std::mutex handlesMutex_;
+    std::vector<git_repository*> idleHandles_;
+    std::mutex cacheMutex_;              // 只保护下面三个缓存
+    OidLruCache<git_oid> roots_;         // 提交 → 根树
+    OidLruCache<TreeListing> trees_;
+    OidLruCache<BlobPtr> blobs_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+
+    // at 时的提交及其根树；at 早于第一次提交时 found 为 false
+    bool rootAt(Lease& lease, std::chrono::system_clock::time_point at, bool& found, git_oid& commit, git_oid& root);
+    bool readTree(Lease& lease, const git_oid& oid, TreeListing& out);
+    BlobPtr readContent(Lease& lease, const git_oid& oid);
+    static const TreeItem* findItem(const std::vector<TreeItem>& items, std::string_view name);
+    bool diffTrees(Lease& lease, const git_oid* before, const git_oid* after, const std::string& prefix,
+                   std::vector<FileDiff>& out);
+    // 一侧不存在的子树：其中的文件全部记为新增或删除
+    bool listAll(Lease& lease, const git_oid& tree, const std::string& prefix, FileChangeKind kind,
+                 std::vector<FileDiff>& out);
+};
+
+}
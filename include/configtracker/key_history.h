@@ -0,0 +1,136 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#include <git2.h>
+
+#include "config_parser.h"
+#include "path_table.h"
+
+namespace configtracker {
+
+enum class KeyChangeKind : uint8_t {
+    Added = 1,
+    Removed = 2,
+    Modified = 3
+};
+
+// 一个键在某次提交中的变化
+struct KeyChange {
+    std::string commit;     // 提交哈希
+    int64_t time = 0;       // 提交时间（秒）
+    std::string path;       // 仓库内路径
+    std::string key;        // INI 为 section.key，JSON 为 a.b[0].c
+    KeyChangeKind kind = KeyChangeKind::Modified;
+    std::string oldValue;   // Added 时为空
+    std::string newValue;   // Removed 时为空
+};
+
+// 一个文件解析后的键：键驻留为整数 ID，值只保留 XXH64 和在内容中的位置，
+// 比较两个版本时只比较 (ID, 哈希)
+struct ParsedConfig {
+    struct Item {
+        PathId key;
+        uint32_t length;
+        uint64_t hash;
+        size_t offset;
+    };
+    git_oid oid;
+    std::string data;          // 文件内容，值的位置指向这里
+    std::vector<Item> items;   // 按键 ID 排序，重复的键只保留最后一次出现
+
+    std::string_view value(const Item& item) const { return std::string_view(data).substr(item.offset, item.length); }
+};
+
+// 两个版本之间的一处差异，值视图指向对应 ParsedConfig 的内容
+struct KeyDelta {
+    PathId key;
+    KeyChangeKind kind;
+    std::string_view oldValue;
+    std::string_view newValue;
+};
+
+// 键级变更记录，保存在 .git/configtracker 下：
+//   keys.names  头部 + 路径和键名（uint32 长度 + 内容），ID 即出现顺序
+//   keys.log    头部 + 每个提交一条记录：提交 oid、时间和该提交的全部键变更（含新旧值）
+// 两个文件都只追加。加载时建立 (路径, 键) → 记录位置的倒排表，查询一个键的历史只读取相关的几条记录，
+// 不再解析旧版本的文件
+class KeyHistory {
+public:
+    using BlobReader = std::function<bool(const git_oid&, std::string&)>;
+
+    // 一个提交中某个文件的前后版本，不存在的一侧 oid 为全零
+    struct FileChange {
+        std::string path;
+        git_oid oldOid;
+        git_oid newOid;
+    };
+
+    KeyHistory() = default;
+    ~KeyHistory();
+    KeyHistory(const KeyHistory&) = delete;
+    KeyHistory& operator=(const KeyHistory&) = delete;
+
+    // 打开 dir 下的记录，末尾不完整的记录（写入时崩溃）会被截掉
+    bool open(const std::string& dir);
+    void close();
+
+    // 解析一个版本，键驻留到本对象的名字表中。格式不支持或解析失败返回 false
+    bool parse(std::string_view path, const git_oid& oid, std::string data, ParsedConfig& out);
+    // 比较两个版本（均按键 ID 排序），按键 ID 顺序输出差异
+    static void diff(const ParsedConfig& before, const ParsedConfig& after, std::vector<KeyDelta>& out);
+
+    // 计算一个提交中各文件的键级变更并追加记录，返回变更的键数。
+    // 每个文件最近一次解析的结果缓存在内存中，通常只需解析新版本
+    size_t record(const git_oid& commit, int64_t time, const std::vector<FileChange>& files,
+                  const BlobReader& read);
+
+    // 某个提交的全部键变更
+    std::vector<KeyChange> changesOf(const git_oid& commit) const;
+    // 一个键的变更历史，从新到旧；limit 为 0 表示不限
+    std::vector<KeyChange> history(std::string_view path, std::string_view key, size_t limit = 0) const;
+    // 有键级变更记录的提交数
+    size_t commitCount() const { return commits_.size(); }
+
+    // 历史被改写后（历史压缩）把记录中的提交换成新的 oid，映射中没有的提交连同其记录一起丢弃
+    bool remap(const std::vector<std::pair<git_oid, git_oid>>& mapping);
+
+private:
+    struct CommitEntry {
+        git_oid oid;
+        int64_t time;
+        uint64_t offset;   // 记录在 keys.log 中的位置
+        uint32_t count;
+    };
+    struct ChangeRef {
+        uint32_t commit;   // commits_ 下标
+        uint64_t offset;   // 变更项在 keys.log 中的位置
+    };
+
+    std::string dir_;
+    int logFd_ = -1;
+    int namesFd_ = -1;
+    uint64_t logSize_ = 0;
+    PathTable names_;            // 路径和键名共用
+    size_t persistedNames_ = 0;  // 已写入 keys.names 的名字数
+    std::vector<CommitEntry> commits_;
+    std::unordered_map<std::string, uint32_t> commitByOid_;     // 20 字节原始 oid → commits_ 下标
+    std::unordered_map<uint64_t, std::vector<ChangeRef>> postings_;  // (路径 ID << 32 | 键 ID)
+    std::unordered_map<std::string, ParsedConfig> cache_;        // 路径 → 最近一次提交的解析结果
+    size_t cacheBytes_ = 0;
+
+    bool load();
+    bool loadNames();
+    bool loadLog();
+    bool reset();
+    bool persistNames();
+    bool readChange(const ChangeRef& ref, KeyChange& out) const;
+    const ParsedConfig* cached(const std::string& path, const git_oid& oid) const;
+    void remember(const std::string& path, ParsedConfig&& parsed);
+};
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "mpsc_queue.h"
+
+namespace configtracker {
+
+enum class LogLevel {
+    Trace,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off
+};
+
+// 分级异步日志：调用线程只格式化消息并放入无锁队列，由后台线程写出。
+// 级别未开启的日志连参数都不会求值；队列满时丢弃并计数，Warn 及以上改为同步写出
+class Logger {
+public:
+    static Logger& instance();
+
+    static bool enabled(LogLevel level) {
+        return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+    }
+    static void setLevel(LogLevel level) {
+        level_.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+    static LogLevel level() { return static_cast<LogLevel>(level_.load(std::memory_order_relaxed)); }
+
+    // 输出到文件（追加）；为空时输出到控制台，Warn 及以上到 stderr
+    bool setFile(const std::string& path);
+
+    void submit(LogLevel level, std::string message);
+    // 返回时此前提交的日志都已写出
+    void flush();
+    // 停止后台线程并写出剩余日志，之后的日志同步写出；进程退出时自动调用
+    void shutdown();
+
+    uint64_t droppedMessages() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Record {
+        LogLevel level = LogLevel::Info;
+        std::chrono::system_clock::time_point time;
+        std::string message;
+    };
+
+    Logger();
+
+    static std::atomic<int> level_;
+
+    MpscQueue<Record> queue_;
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    std::mutex startMutex_;
+    std::thread thread_;
+    std::atomic<bool> started_{false};
+    std::atomic<bool> stopped_{false};
+
+    // 写线程即将休眠时置位，与 CommitBatcher 相同的唤醒方式
+    std::atomic<bool> waiting_{false};
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCv_;
+    std::condition_variable writtenCv_;
+
+    // 串行化实际的输出（后台线程与同步写出）
+    std::mutex writeMutex_;
+    FILE* file_ = nullptr;
+
+    void start();
+    void run();
+    void wake();
+    void drainQueue();
+    void write(const Record& record);
+};
+
+// 一条日志：析构时提交
+class LogLine {
+public:
+    explicit LogLine(LogLevel level) : level_(level) {}
+    ~LogLine() { Logger::instance().submit(level_, stream_.str()); }
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    template <typename T>
+    LogLine& operator<<(const T& value) {
+        stream_ << value;
+        return *this;
+    }
+
+private:
+    LogLevel level_;
+    std::ostringstream stream_;
+};
+
+struct LogVoidify {
+    void operator&(const LogLine&) {}
+};
+
+}
+
+// 用法：CT_LOG(Info) << "[Git] Commit successful";
+#define CT_LOG(level)                                                              \
+    !::configtracker::Logger::enabled(::configtracker::LogLevel::level) ? (void)0 \
+        : ::configtracker::LogVoidify() & ::configtracker::LogLine(::configtracker::LogLevel::level)
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <functional>
+#include <cstring>
+#include <git2.h>
+
+namespace configtracker {
+
+// 按总代价限制容量的 LRU 缓存：每项有一个代价（默认 1，也可以是字节数），
+// 放入新项后从最久未用的一端淘汰，直到总代价不超过容量。不是线程安全的
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity) : capacity_(capacity) {}
+
+    // 命中时移到最近使用的一端；返回的指针在下一次 put 之前有效
+    const Value* get(const Key& key) {
+        auto it = index_.find(key);
+        if (it == index_.end()) return nullptr;
+        items_.splice(items_.begin(), items_, it->second);
+        return &it->second->value;
+    }
+
+    // 代价超过容量的项不缓存
+    void put(const Key& key, Value value, size_t cost = 1) {
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            used_ -= it->second->cost;
+            items_.erase(it->second);
+            index_.erase(it);
+        }
+        if (cost > capacity_) return;
+        items_.push_front(Item{key, std::move(value), cost});
+        index_.emplace(key, items_.begin());
+        used_ += cost;
+        while (used_ > capacity_) {
+            used_ -= items_.back().cost;
+            index_.erase(items_.back().key);
+            items_.pop_back();
+        }
+    }
+
+    size_t size() const { return items_.size(); }
+    // 当前的总代价
+    size_t used() const { return used_; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct Item {
+        Key key;
+        Value value;
+        size_t cost;
+    };
+
+    size_t capacity_;
+    size_t used_ = 0;
+    std::list<Item> items_;   // 最近使用的在前
+    std::unordered_map<Key, typename std::list<Item>::iterator, Hash, Equal> index_;
+};
+
+// 以 git_oid 为键时使用
+struct OidHash {
+    size_t operator()(const git_oid& oid) const {
+        size_t hash;
+        std::memcpy(&hash, oid.id, sizeof(hash));
+        return hash;
+    }
+};
+
+struct OidEqual {
+    bool operator()(const git_oid& a, const git_oid& b) const { return git_oid_equal(&a, &b) != 0; }
+};
+
+template <typename Value>
+using OidLruCache = LruCache<git_oid, Value, OidHash, OidEqual>;
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <sys/stat.h>
+
+namespace configtracker {
+
+// 只读映射整个文件；空文件不做映射，data() 为 nullptr、size() 为 0。
+// 映射期间文件被截断时访问超出新长度的部分会触发 SIGBUS，只用于本进程自己写入的文件，
+// 被监控的文件用 readFile 读取
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 失败时返回 false，errno 保留系统调用的错误码
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    // 打开时的 fstat 结果
+    const struct stat& info() const { return info_; }
+    // 提示内核按顺序预读
+    void adviseSequential() const;
+
+private:
+    char* data_ = nullptr;
+    size_t size_ = 0;
+    struct stat info_{};
+};
+
+// 用 read() 读取整个文件到 out，out 已有的容量会被复用；info 非空时返回打开时的 fstat 结果。
+// 读取期间文件被截断或追加时以实际读到的内容为准。不是普通文件时 out 为空并返回 true；
+// 失败时返回 false，errno 保留系统调用的错误码
+bool readFile(const std::string& path, std::string& out, struct stat* info = nullptr);
+
+// 复用的读取缓冲区超过这个容量后释放，偶尔读到的大文件不会一直占用内存
+constexpr size_t kReadBufferKeepBytes = 1 << 20;
+
+}
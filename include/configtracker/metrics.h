@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace configtracker {
+
+constexpr size_t kMetricShards = 16;
+
+// 当前线程固定使用的计数分片
+size_t metricsShard();
+
+// 按线程分片的计数器：每个线程只写自己的缓存行，读取时求和
+class Counter {
+public:
+    void add(uint64_t n = 1) {
+        shards_[metricsShard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, kMetricShards> shards_;
+};
+
+class Gauge {
+public:
+    void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void add(int64_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+// 直方图快照，数值已换算为导出单位（时间为秒）
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    double sum = 0;
+    double max = 0;
+    double p50 = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double p999 = 0;
+};
+
+// HDR 风格的对数线性直方图：按 2 的幂分段，每段 16 个子桶，相对误差不超过 1/16。
+// 记录时只做几次无锁加法，桶数固定，不随样本增长
+class Histogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    static constexpr size_t kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    // unitScale 把记录的整数值换算为导出单位，默认记录纳秒、导出秒
+    explicit Histogram(double unitScale = 1e-9) : unitScale_(unitScale) {}
+
+    void record(uint64_t value);
+    void recordDuration(std::chrono::steady_clock::duration duration) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        record(ns > 0 ? static_cast<uint64_t>(ns) : 0);
+    }
+    HistogramSnapshot snapshot() const;
+
+    static size_t bucketOf(uint64_t value);
+    // 桶内最大值，用于估计分位数（偏保守）
+    static uint64_t bucketUpperBound(size_t bucket);
+
+private:
+    double unitScale_;
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// 作用域计时：析构时把耗时记入直方图
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram)
+        : histogram_(histogram), begin_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { histogram_.recordDuration(std::chrono::steady_clock::now() - begin_); }
+
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point begin_;
+};
+
+struct MetricsSnapshot {
+    std::map<std::string, uint64_t> counters;
+    std::map<std::string, int64_t> gauges;
+    std::map<std::string, HistogramSnapshot> histograms;
+};
+
+// 进程内的指标注册表。组件在构造时取得指标的引用，之后的更新不经过注册表的锁
+class MetricsRegistry {
+public:
+    static MetricsRegistry& global();
+
+    // 同名指标只创建一次，返回的引用在进程生命周期内有效
+    Counter& counter(const std::string& name, const std::string& help);
+    Gauge& gauge(const std::string& name, const std::string& help);
+    Histogram& histogram(const std::string& name, const std::string& help, double unitScale = 1e-9);
+
+    MetricsSnapshot snapshot() const;
+    // Prometheus 文本格式，直方图以 summary（分位数、_sum、_count）导出
+    std::string prometheusText() const;
+    // target 以 "unix:" 开头时发送到该 Unix 域套接字，否则原子地写入文件
+    bool dumpPrometheus(const std::string& target) const;
+
+private:
+    struct Entry {
+        std::string help;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Entry> entries_;
+};
+
+// ConfigTracker 各组件内置的指标，名称集中在这里定义
+struct CoreMetrics {
+    Histogram& scanDuration;       // 一次完整扫描（轮询周期或 inotify 初始扫描）的耗时
+    Counter& watchCandidates;      // 后端上报的候选路径
+    Counter& eventsDetected;       // 经内容哈希确认的变更
+    Histogram& gitAdd;             // addFiles 暂存一批文件的耗时
+    Histogram& gitTreeWrite;       // 提交时写树的耗时
+    Counter& treesWritten;         // 提交时重写的树对象（目录）数
+    Histogram& gitCommit;          // 一次提交的总耗时
+    Counter& commits;              // 成功的提交
+    Gauge& commitQueueDepth;       // 提交线程取事件时队列中的事件数
+    Histogram& commitBatchSize;    // 每批提交的文件数
+    Counter& eventsCoalesced;      // 队列满时合并到溢出集合的事件
+    Counter& eventsBlocked;        // 队列满时阻塞等待的事件
+    Counter& eventsDropped;        // 队列满时丢弃的事件
+    Histogram& keyDiff;            // 一次提交的键级比较耗时
+    Counter& keyChanges;           // 记录的键级变更
+    Histogram& maintenance;        // 一轮打包维护的耗时（含预算限制下的等待）
+    Counter& objectsPacked;        // 打包后删除的松散对象
+    Counter& objectsPruned;        // 全量重打包后清理的过期松散对象和旧包
+    Histogram& journalAppend;      // 一条变更写入日志的耗时
+    Histogram& journalFold;        // 把日志中的变更合并为一次提交的耗时
+    Counter& subscriberBatches;    // 投递给订阅者的批次
+    Counter& subscriberDrops;      // 订阅者队列满时丢弃的批次
+
+    static CoreMetrics& get();
+};
+
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+namespace configtracker {
+
+// 有界无锁多生产者单消费者队列（基于每个槽位的序号，参考 Vyukov 的有界队列）。
+// 生产者之间只竞争一次 CAS，队列满时 tryPush 立即返回 false，由调用方决定背压策略；
+// tryPop 和 empty 只能在唯一的消费者线程上调用
+template <typename T>
+class MpscQueue {
+public:
+    // 容量向上取整为 2 的幂
+    explicit MpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        cells_.reset(new Cell[size]);
+        mask_ = size - 1;
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // 对每个槽位中的元素调用 init（例如预留容量），只能在还没有生产者和消费者时调用
+    template <typename Init>
+    void initSlots(Init&& init) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            init(cells_[i].value);
+        }
+    }
+
+    // 队列满时返回 false，value 保持不变
+    bool tryPush(T& value) {
+        size_t pos;
+        Cell* cell = claim(pos);
+        if (!cell) return false;
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 复制赋值进槽位：槽位中的元素保留之前的容量，std::string 不超过已有容量时不分配内存。
+    // 与 tryConsume 配合使用
+    bool tryPushCopy(const T& value) {
+        size_t pos;
+        Cell* cell = claim(pos);
+        if (!cell) return false;
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& out) {
+        return tryConsume([&out](T& value) { out = std::move(value); });
+    }
+
+    // 在槽位上调用 visit(T&) 读取队首元素，不移走它，槽位的容量留给之后的 tryPushCopy
+    template <typename Visitor>
+    bool tryConsume(Visitor&& visit) {
+        Cell& cell = cells_[dequeuePos_ & mask_];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(dequeuePos_ + 1) < 0) {
+            return false;
+        }
+        visit(cell.value);
+        cell.sequence.store(dequeuePos_ + mask_ + 1, std::memory_order_release);
+        ++dequeuePos_;
+        return true;
+    }
+
+    // 近似的元素个数（包括正在写入的槽位），只能在消费者线程上调用
+    size_t sizeApprox() const {
+        return enqueuePos_.load(std::memory_order_relaxed) - dequeuePos_;
+    }
+
+    bool empty() const {
+        const Cell& cell = cells_[dequeuePos_ & mask_];
+        return cell.sequence.load(std::memory_order_acquire) != dequeuePos_ + 1;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // 在 pos 处占用一个空槽位，队列满时返回 nullptr
+    Cell* claim(size_t& pos) {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell* cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return cell;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+    // 生产者与消费者的位置放在不同的缓存行，避免伪共享
+    alignas(64) std::atomic<size_t> enqueuePos_{0};
+    alignas(64) size_t dequeuePos_ = 0;
+};
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace configtracker {
+
+// include/exclude glob 过滤器（fnmatch 语法）。
+// 不含 '/' 的模式匹配文件名，含 '/' 的模式匹配相对于监控根目录的路径。
+class PathFilter {
+public:
+    PathFilter() = default;
+    PathFilter(std::vector<std::string> includes, std::vector<std::string> excludes)
+        : includes_(std::move(includes)), excludes_(std::move(excludes)) {}
+
+    // 文件是否需要跟踪：未被排除，且 include 为空或命中任一 include
+    bool acceptFile(std::string_view relativePath) const;
+    // 目录是否需要进入（只检查 exclude，命中时整棵子树被跳过）
+    bool acceptDirectory(std::string_view relativePath) const;
+
+    bool empty() const { return includes_.empty() && excludes_.empty(); }
+
+private:
+    std::vector<std::string> includes_;
+    std::vector<std::string> excludes_;
+
+    static bool matches(const std::vector<std::string>& patterns, std::string_view relativePath);
+};
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace configtracker {
+
+using PathId = uint32_t;
+constexpr PathId kInvalidPathId = UINT32_MAX;
+
+// 以 '/' 开头且不含空段、"." 和 ".." 的路径（lexically_normal 之后不变），
+// 这样的路径可以直接做字符串比较，不必构造 std::filesystem::path
+inline bool isNormalAbsolutePath(std::string_view path) {
+    if (path.empty() || path.front() != '/') return false;
+    if (path.size() == 1) return true;
+    if (path.back() == '/') return false;
+    size_t start = 1;
+    while (start <= path.size()) {
+        size_t end = path.find('/', start);
+        if (end == std::string_view::npos) end = path.size();
+        std::string_view segment = path.substr(start, end - start);
+        if (segment.empty() || segment == "." || segment == "..") return false;
+        start = end + 1;
+    }
+    return true;
+}
+
+// 追加式字符串区：按块分配，返回的 string_view 在 clear() 或 reset() 之前一直有效
+class StringArena {
+public:
+    explicit StringArena(size_t blockSize = 64 * 1024) : blockSize_(blockSize) {}
+
+    std::string_view store(std::string_view str);
+    // 释放全部块
+    void clear();
+    // 丢弃内容但保留已分配的块，之后的 store 依次复用。按批次使用时，
+    // 批次大小稳定后不再分配内存
+    void reset();
+    size_t memoryUsage() const { return allocated_; }
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    size_t blockSize_;
+    std::vector<Block> blocks_;
+    size_t next_ = 0;   // 下一个可复用的块
+    char* cursor_ = nullptr;
+    size_t remaining_ = 0;
+    size_t allocated_ = 0;
+};
+
+// 路径驻留表：把路径映射为连续的整数 ID，路径字符串存放在 StringArena 中，
+// 查找使用开放寻址（线性探测）哈希表，不为每个路径单独分配节点
+class PathTable {
+public:
+    PathTable();
+
+    // 返回路径的 ID，不存在时分配新 ID
+    PathId intern(std::string_view path);
+    // 只查找，不存在时返回 kInvalidPathId
+    PathId find(std::string_view path) const;
+    std::string_view path(PathId id) const { return paths_[id]; }
+
+    size_t size() const { return paths_.size(); }
+    void reserve(size_t count);
+    void clear();
+    // 丢弃全部路径，保留哈希槽和字符串块供之后复用，按批次使用时批次大小稳定后不再分配内存。
+    // 上一轮只用了表的一小部分时改为 clear()，表的大小跟随最近的批次
+    void reset();
+    // 估算占用的堆内存（字节）
+    size_t memoryUsage() const;
+
+private:
+    struct Slot {
+        uint32_t hash;
+        PathId id;  // kInvalidPathId 表示空槽
+    };
+
+    std::vector<Slot> slots_;  // 容量始终为 2 的幂
+    std::vector<std::string_view> paths_;
+    StringArena arena_;
+
+    static uint32_t hashPath(std::string_view path);
+    void rehash(size_t capacity);
+};
+
+}
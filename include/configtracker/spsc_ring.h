@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+namespace configtracker {
+
+// 有界无锁单生产者单消费者环形队列。两端各自缓存对方的位置，只有缓存的位置显示
+// 队列满（或空）时才读取对方的原子变量，正常情况下生产者和消费者不会争用同一缓存行。
+// tryPush 只能在唯一的生产者线程上调用，tryPop 和 empty 只能在唯一的消费者线程上调用
+template <typename T>
+class SpscRing {
+public:
+    // 容量向上取整为 2 的幂
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        slots_.reset(new T[size]);
+        mask_ = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // 队列满时返回 false，value 保持不变
+    bool tryPush(T& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - headCache_ > mask_) {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (tail - headCache_ > mask_) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tailCache_) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head == tailCache_) {
+                return false;
+            }
+        }
+        out = std::move(slots_[head & mask_]);
+        // 槽位立即清空，不让队列继续持有已取出元素的资源
+        slots_[head & mask_] = T();
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+    }
+
+    // 近似的元素个数，任意线程可调用
+    size_t sizeApprox() const {
+        return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::unique_ptr<T[]> slots_;
+    size_t mask_ = 0;
+    // 生产者与消费者的位置放在不同的缓存行，避免伪共享
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t headCache_ = 0;
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t tailCache_ = 0;
+};
+
+}
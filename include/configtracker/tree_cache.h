@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string_view>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <git2.h>
+
+namespace configtracker {
+
+// 常驻内存的树层级，与内存中的索引同步修改。每个目录记录自己的树 oid，
+// 子目录在第一次访问时才从对象库读入，没有访问过的子树只保存 oid。
+// 提交时只重写变更文件到根目录路径上的目录：用 git_treebuilder 以目录原来的树为基础，
+// 只插入或删除变化的项，未变化的子树按 oid 引用。单次提交的开销与 深度 × 变更文件数 成正比，
+// 与仓库中的文件总数无关。
+// 不是线程安全的，由 GitRepoManager 在提交锁内使用
+class TreeCache {
+public:
+    TreeCache();
+    ~TreeCache();
+    TreeCache(const TreeCache&) = delete;
+    TreeCache& operator=(const TreeCache&) = delete;
+
+    // 以对象库中的 root 树为基准，只记录根的 oid
+    void reset(git_repository* repo, const git_oid& root);
+    // 失效：之后的修改被忽略，直到下一次 reset
+    void clear();
+    bool valid() const { return root_ != nullptr; }
+
+    // 以下路径与索引中的路径相同，以 / 分隔。读取树失败时缓存失效，
+    // 下一次提交退回从索引写树
+    void set(std::string_view path, const git_oid& oid, uint32_t mode);
+    // 删除一个文件，删空的目录一并删除；文件不存在时什么也不做
+    void remove(std::string_view path);
+    // 删除目录下的全部文件（对应 git_index_remove_directory）
+    void removeDirectory(std::string_view path);
+
+    // 写出变化的目录，out 返回根树的 oid；没有变化时直接返回当前根的 oid。
+    // 失败时缓存失效
+    bool write(git_oid& out);
+
+    // 上一次 write 写出的树对象数
+    size_t lastWritten() const { return lastWritten_; }
+    // 已读入内存的目录数
+    size_t loadedDirectories() const { return loaded_; }
+
+private:
+    struct Node;
+    struct Entry;
+
+    git_repository* repo_ = nullptr;
+    std::unique_ptr<Node> root_;
+    size_t lastWritten_ = 0;
+    size_t loaded_ = 0;
+    // 最近一次 walk 经过的目录，从根开始；names_[i] 是 path_[i + 1] 在 path_[i] 中的名字
+    std::vector<Node*> path_;
+    std::vector<std::string_view> names_;
+
+    bool load(Node& node);
+    // 找到 path 所在的目录并把路径上的目录依次放入 path_，create 为 true 时创建缺少的目录。
+    // dir 为目录（不存在时为 nullptr），name 为最后一级的名字；读取树失败时返回 false
+    bool walk(std::string_view path, bool create, Node*& dir, std::string_view& name);
+    // path_ 上的目录标记为已修改，删空的目录从父目录中移除
+    void touchPath();
+    bool writeNode(Node& node);
+};
+
+}
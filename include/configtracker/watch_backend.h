@@ -0,0 +1,154 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <filesystem>
+
+#include "path_table.h"
+#include "path_filter.h"
+#include "work_stealing_pool.h"
+
+namespace configtracker {
+
+// 文件变更回调，参数为发生变化的文件路径
+using ChangeCallback = std::function<void(const std::string&)>;
+
+enum class WatchBackendType {
+    Auto,     // 优先使用 inotify，不支持的路径回退到轮询
+    Inotify,
+    Polling
+};
+
+// 后端遍历目录时共用的选项
+struct ScanOptions {
+    bool recursive = false;
+    PathFilter filter;
+    size_t threads = 1;  // 轮询扫描的并行线程数，1 表示串行
+};
+
+// 监控后端接口，FileWatcher 通过它获取文件变更事件
+class WatchBackend {
+public:
+    virtual ~WatchBackend() = default;
+
+    virtual const char* name() const = 0;
+    // 注册监控路径，失败时返回 false，由调用方决定是否回退
+    virtual bool addWatch(const std::string& path) = 0;
+    // 在调用线程上阻塞运行，直到 wakeup() 被调用
+    virtual void run(const ChangeCallback& onChange) = 0;
+    // 让 run() 尽快返回，可从任意线程调用
+    virtual void wakeup() = 0;
+};
+
+// 轮询后端：定期遍历目录比较修改时间，适用于任何文件系统
+class PollingBackend : public WatchBackend {
+public:
+    explicit PollingBackend(std::chrono::milliseconds interval = std::chrono::seconds(2),
+                            ScanOptions scanOptions = ScanOptions())
+        : interval_(interval), scanOptions_(std::move(scanOptions)) {}
+
+    const char* name() const override { return "polling"; }
+    bool addWatch(const std::string& path) override;
+    void run(const ChangeCallback& onChange) override;
+    void wakeup() override;
+
+    // 对所有监控路径做一次完整扫描
+    void scanOnce(const ChangeCallback& onChange);
+    // 已跟踪的文件数与状态表占用的内存
+    size_t trackedFiles() const { return paths_.size(); }
+    size_t memoryUsage() const;
+
+private:
+    std::chrono::milliseconds interval_;
+    ScanOptions scanOptions_;
+    std::vector<std::string> watchPaths_;
+
+    // 扁平状态表：路径驻留为 ID，修改时间按 ID 存放在连续数组中。
+    // 已删除的文件保留 ID，修改时间记为 kMissing
+    static constexpr std::filesystem::file_time_type kMissing = std::filesystem::file_time_type::min();
+    PathTable paths_;
+    std::vector<std::filesystem::file_time_type> mtimes_;
+    // 每个文件最近一次被扫描到的轮次，完整的一轮扫描中没有出现的文件上报为删除
+    std::vector<uint32_t> seenPass_;
+    uint32_t pass_ = 0;
+    std::atomic<bool> passComplete_{true};  // 本轮没有因为读取目录出错而漏掉文件
+
+    // 并行扫描：各工作线程把结果写入自己的缓冲区，扫描结束后统一合并
+    struct ScanResult {
+        std::string path;
+        std::filesystem::file_time_type mtime;
+    };
+    std::unique_ptr<WorkStealingPool> pool_;
+    std::vector<std::vector<ScanResult>> results_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopRequested_ = false;
+
+    void checkForChanges(const std::string& path, const ChangeCallback& onChange);
+    void checkFile(const std::filesystem::path& file, const ChangeCallback& onChange);
+    void parallelScan(const std::string& root, const ChangeCallback& onChange);
+    void scanDirectoryTask(const std::string& dir, size_t rootLength, size_t worker);
+    void mergeResult(const std::string& path, std::filesystem::file_time_type mtime,
+                     const ChangeCallback& onChange);
+    void reportMissing(const ChangeCallback& onChange);
+};
+
+// inotify 后端：基于 epoll 等待内核事件，空闲时不产生任何开销
+class InotifyBackend : public WatchBackend {
+public:
+    explicit InotifyBackend(ScanOptions scanOptions = ScanOptions());
+    ~InotifyBackend() override;
+
+    // inotify/epoll 描述符是否创建成功
+    bool valid() const { return inotifyFd_ >= 0 && epollFd_ >= 0 && wakeFd_ >= 0; }
+    // 路径所在文件系统能否可靠地产生 inotify 事件（网络文件系统等不能）
+    static bool supports(const std::string& path);
+
+    const char* name() const override { return "inotify"; }
+    bool addWatch(const std::string& path) override;
+    void run(const ChangeCallback& onChange) override;
+    void wakeup() override;
+
+private:
+    struct WatchEntry {
+        std::string dir;
+        size_t rootLength = 0;            // 监控根目录的长度，用于计算相对路径
+        bool wholeDir = false;            // 监控整个目录
+        std::unique_ptr<PathTable> files; // 仅监控目录下的这些文件（文件名），只监控单个文件时才创建
+    };
+
+    ScanOptions scanOptions_;
+    int inotifyFd_ = -1;
+    int epollFd_ = -1;
+    int wakeFd_ = -1;
+    std::vector<std::string> watchPaths_;
+    std::unordered_map<int, WatchEntry> watches_;
+    // drainEvents 的批次路径表：同一批中重复的路径只保留一次，每轮 reset 后复用，
+    // 稳定后处理事件不再分配内存
+    PathTable drained_;
+    std::string pathBuffer_;
+
+    bool addDirectoryWatch(const std::string& dir, size_t rootLength);
+    void scanDirectory(const std::string& dir, size_t rootLength, bool addWatches,
+                       const ChangeCallback& onChange);
+    void initialScan(const ChangeCallback& onChange);
+    bool drainEvents(const ChangeCallback& onChange);
+};
+
+// 相对于监控根目录的路径（不含开头的 '/'）
+inline std::string_view relativeToRoot(std::string_view path, size_t rootLength) {
+    if (path.size() <= rootLength) return std::string_view();
+    path.remove_prefix(rootLength);
+    if (!path.empty() && path.front() == '/') path.remove_prefix(1);
+    return path;
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+namespace configtracker {
+
+// 工作窃取线程池：每个工作线程有自己的双端队列，从队尾取自己的任务，
+// 空闲时从其他线程的队首窃取。任务可以继续派生子任务（例如子目录）。
+class WorkStealingPool {
+public:
+    // 参数为执行任务的工作线程序号，可用于访问线程私有的结果缓冲区
+    using Task = std::function<void(size_t worker)>;
+
+    explicit WorkStealingPool(size_t threads);
+    ~WorkStealingPool();
+
+    size_t size() const { return threads_.size(); }
+    // 在工作线程内调用时放入该线程自己的队列，否则轮流分配
+    void submit(Task task);
+    // 等待所有任务（包括任务派生的子任务）执行完毕
+    void wait();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::atomic<size_t> queued_{0};   // 尚未被取走的任务
+    std::atomic<size_t> pending_{0};  // 尚未执行完的任务
+    std::atomic<size_t> nextQueue_{0};
+
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCv_;
+    std::condition_variable doneCv_;
+    bool stopping_ = false;
+
+    bool tryPop(size_t worker, Task& task);
+    void workerLoop(size_t worker);
+};
+
+}
@@ -0,0 +1,143 @@
+#include "configtracker/async_git_repo.h"
+#include "configtracker/logger.h"
+
+using namespace configtracker;
+
+AsyncGitRepo::AsyncGitRepo(GitRepoManager& git, size_t readThreads)
+    : git_(git), handles_(readThreads > 0 ? readThreads : 1, nullptr) {
+    readers_ = std::make_unique<WorkStealingPool>(handles_.size());
+    writer_ = std::thread(&AsyncGitRepo::writeLoop, this);
+    CT_LOG(Debug) << "[Async] Started with " << handles_.size() << " read threads";
+}
+
+AsyncGitRepo::~AsyncGitRepo() {
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        stopping_ = true;
+    }
+    writeCv_.notify_one();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    // 线程池析构时等待剩余的读任务，之后才能释放各线程的句柄
+    readers_.reset();
+    for (git_repository* handle : handles_) {
+        if (handle) {
+            git_repository_free(handle);
+        }
+    }
+}
+
+void AsyncGitRepo::submitRead(ReadJob job) {
+    readers_->submit([this, job = std::move(job)](size_t worker) {
+        git_repository*& handle = handles_[worker];
+        if (!handle) {
+            handle = git_.openReadHandle();
+        }
+        job(git_, handle);
+    });
+}
+
+void AsyncGitRepo::submitWrite(WriteJob job) {
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        writes_.push_back(std::move(job));
+    }
+    writeCv_.notify_one();
+}
+
+void AsyncGitRepo::writeLoop() {
+    std::unique_lock<std::mutex> lock(writeMutex_);
+    while (true) {
+        writeCv_.wait(lock, [this] { return stopping_ || !writes_.empty(); });
+        // 停止前已投递的写操作全部执行完才退出
+        if (writes_.empty()) {
+            break;
+        }
+        WriteJob job = std::move(writes_.front());
+        writes_.pop_front();
+        lock.unlock();
+        job(git_);
+        lock.lock();
+    }
+}
+
+std::future<void> AsyncGitRepo::addFiles(std::vector<std::string> paths) {
+    return write([paths = std::move(paths)](GitRepoManager& git) { git.addFiles(paths); });
+}
+
+std::future<std::string> AsyncGitRepo::commit(std::string message) {
+    return write([message = std::move(message)](GitRepoManager& git) {
+        return git.commit(message) ? git.getLatestCommit() : std::string();
+    });
+}
+
+std::future<bool> AsyncGitRepo::checkoutCommit(std::string hash) {
+    return write([hash = std::move(hash)](GitRepoManager& git) { return git.checkoutCommit(hash); });
+}
+
+std::future<void> AsyncGitRepo::squashCommitsOlderThan(int days) {
+    return write([days](GitRepoManager& git) { git.squashCommitsOlderThan(days); });
+}
+
+std::future<bool> AsyncGitRepo::restore(std::string hash, std::vector<std::string> paths) {
+    return write([hash = std::move(hash), paths = std::move(paths)](GitRepoManager& git) {
+        std::vector<RestoreAction> actions;
+        if (!git.planRestore(hash, paths, actions)) {
+            return false;
+        }
+        return actions.empty() || git.applyRestore(hash, actions);
+    });
+}
+
+std::future<std::vector<std::string>> AsyncGitRepo::listCommits() {
+    return read([](GitRepoManager& git, git_repository*) { return git.listCommits(); });
+}
+
+std::future<std::vector<std::string>> AsyncGitRepo::latestCommits(size_t count) {
+    return read([count](GitRepoManager& git, git_repository*) { return git.latestCommits(count); });
+}
+
+std::future<std::vector<std::string>> AsyncGitRepo::commitsTouching(std::string path, size_t limit) {
+    return read([path = std::move(path), limit](GitRepoManager& git, git_repository*) {
+        return git.commitsTouching(path, limit);
+    });
+}
+
+std::future<std::vector<KeyChange>> AsyncGitRepo::keyHistory(std::string path, std::string key, size_t limit) {
+    return read([path = std::move(path), key = std::move(key), limit](GitRepoManager& git, git_repository*) {
+        return git.keyHistory(path, key, limit);
+    });
+}
+
+std::future<std::optional<std::string>> AsyncGitRepo::readBlob(git_oid oid) {
+    return read([oid](GitRepoManager& git, git_repository* handle) -> std::optional<std::string> {
+        std::string content;
+        if (!git.readBlob(handle, oid, content)) {
+            return std::nullopt;
+        }
+        return content;
+    });
+}
+
+std::future<std::optional<std::vector<TreeFile>>> AsyncGitRepo::listFiles(std::string hash) {
+    return read([hash = std::move(hash)](GitRepoManager& git,
+                                         git_repository* handle) -> std::optional<std::vector<TreeFile>> {
+        std::vector<TreeFile> files;
+        if (!git.listFiles(handle, hash, files)) {
+            return std::nullopt;
+        }
+        return files;
+    });
+}
+
+std::future<std::optional<std::vector<std::string>>> AsyncGitRepo::diffCommits(std::string from, std::string to) {
+    return read([from = std::move(from), to = std::move(to)](
+                    GitRepoManager& git, git_repository* handle) -> std::optional<std::vector<std::string>> {
+        std::vector<std::string> paths;
+        if (!git.diffCommits(handle, from, to, paths)) {
+            return std::nullopt;
+        }
+        return paths;
+    });
+}
@@ -0,0 +1,475 @@
+#include "configtracker/change_journal.h"
+#include "configtracker/content_hash.h"
+#include "configtracker/mapped_file.h"
+#include "configtracker/metrics.h"
+#include "configtracker/logger.h"
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstddef>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+
+using namespace configtracker;
+
+namespace {
+
+constexpr char kSegmentMagic[8] = {'C', 'T', 'J', 'R', 'N', 'L', '0', '1'};
+constexpr uint32_t kRecordMagic = 0x4c52544a;  // "JTRL"
+constexpr uint8_t kFlagDelta = 1;
+constexpr const char* kSegmentPrefix = "journal.";
+
+struct SegmentHeader {
+    char magic[8];
+    uint64_t number;
+};
+
+// 记录头之后依次是路径和数据，整条记录按 8 字节对齐。
+// 增量记录的完整内容 = 上一版本的前 prefix 字节 + 数据 + 上一版本的后 suffix 字节
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t length;        // 含头部和填充
+    uint64_t checksum;      // XXH64，从 sequence 到数据末尾
+    uint64_t sequence;
+    int64_t time;
+    uint32_t pathLength;
+    uint32_t dataLength;
+    uint32_t prefix;
+    uint32_t suffix;
+    uint8_t op;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t reserved2;
+};
+static_assert(sizeof(RecordHeader) == 56, "journal record header must stay 8-byte aligned");
+
+constexpr size_t kChecksumOffset = offsetof(RecordHeader, sequence);
+
+size_t align8(size_t n) {
+    return (n + 7) & ~size_t(7);
+}
+
+size_t roundToPage(size_t n) {
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return (n + page - 1) / page * page;
+}
+
+int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// 解析 journal.<16 位十六进制段号>
+bool parseSegmentName(const std::string& name, uint64_t& number) {
+    size_t prefix = std::strlen(kSegmentPrefix);
+    if (name.size() != prefix + 16 || name.compare(0, prefix, kSegmentPrefix) != 0) return false;
+    char* end = nullptr;
+    number = std::strtoull(name.c_str() + prefix, &end, 16);
+    return end && *end == '\0' && number > 0;
+}
+
+}
+
+ChangeJournal::~ChangeJournal() {
+    close();
+}
+
+bool ChangeJournal::open(const std::string& dir, size_t segmentSize) {
+    close();
+    std::lock_guard<std::mutex> lock(mutex_);
+    dir_ = dir;
+    segmentSize_ = roundToPage(std::max(segmentSize, sizeof(SegmentHeader) + sizeof(RecordHeader)));
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    std::vector<uint64_t> numbers;
+    for (const auto& entry : std::filesystem::directory_iterator(dir_, ec)) {
+        uint64_t number = 0;
+        if (parseSegmentName(entry.path().filename().string(), number)) {
+            numbers.push_back(number);
+        }
+    }
+    std::sort(numbers.begin(), numbers.end());
+
+    if (numbers.empty()) {
+        folded_ = 0;
+        return createSegment(1, 0);
+    }
+
+    // 仍存在的段都还没有确认合并，按顺序回放
+    size_t lastEnd = 0;
+    for (uint64_t number : numbers) {
+        MappedFile file;
+        if (!file.open(segmentPath(number))) {
+            CT_LOG(Error) << "Error: Cannot read journal segment " << segmentPath(number);
+            continue;
+        }
+        lastEnd = load(file.data(), file.size(), number, [this, number](const JournalEntry& entry) {
+            PathState& state = paths_[std::string(entry.path)];
+            state.content.assign(entry.content);
+            state.removed = entry.op == JournalOp::Remove;
+            state.segment = number;
+            sequence_ = std::max(sequence_, entry.sequence);
+        });
+    }
+    folded_ = numbers.front() - 1;
+    sealed_.assign(numbers.begin(), numbers.end() - 1);
+    if (!reopenSegment(numbers.back(), lastEnd)) {
+        return false;
+    }
+    if (!paths_.empty()) {
+        CT_LOG(Info) << "[Journal] Replayed " << paths_.size() << " pending files from " << dir_;
+    }
+    return true;
+}
+
+void ChangeJournal::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closeSegment();
+    sealed_.clear();
+    paths_.clear();
+    sequence_ = 0;
+    folded_ = 0;
+}
+
+std::string ChangeJournal::segmentPath(uint64_t number) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%s%016llx", kSegmentPrefix, static_cast<unsigned long long>(number));
+    return (std::filesystem::path(dir_) / name).string();
+}
+
+bool ChangeJournal::createSegment(uint64_t number, size_t minSize) {
+    std::string path = segmentPath(number);
+    size_t size = roundToPage(std::max(segmentSize_, minSize + sizeof(SegmentHeader)));
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        CT_LOG(Error) << "Error: Cannot create journal segment " << path << ": " << std::strerror(errno);
+        return false;
+    }
+    // 新段是稀疏文件，只有写到的页才占用磁盘
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        CT_LOG(Error) << "Error: Cannot size journal segment " << path << ": " << std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        CT_LOG(Error) << "Error: Cannot map journal segment " << path << ": " << std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    active_.number = number;
+    active_.fd = fd;
+    active_.base = static_cast<char*>(base);
+    active_.size = size;
+    SegmentHeader header;
+    std::memcpy(header.magic, kSegmentMagic, sizeof(header.magic));
+    header.number = number;
+    std::memcpy(active_.base, &header, sizeof(header));
+    active_.used = sizeof(header);
+    return true;
+}
+
+bool ChangeJournal::reopenSegment(uint64_t number, size_t validEnd) {
+    std::string path = segmentPath(number);
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        CT_LOG(Error) << "Error: Cannot open journal segment " << path << ": " << std::strerror(errno);
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    // 截断再扩展，把最后一条有效记录之后的残留清零；
+    // 否则新记录之后可能紧跟着一条崩溃前写到一半、却恰好能通过校验的旧记录
+    size_t size = roundToPage(std::max(static_cast<size_t>(st.st_size), segmentSize_));
+    if (ftruncate(fd, static_cast<off_t>(validEnd)) != 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        CT_LOG(Error) << "Error: Cannot reset journal tail " << path << ": " << std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        CT_LOG(Error) << "Error: Cannot map journal segment " << path << ": " << std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    active_.number = number;
+    active_.fd = fd;
+    active_.base = static_cast<char*>(base);
+    active_.size = size;
+    active_.used = validEnd;
+    if (validEnd < sizeof(SegmentHeader)) {
+        SegmentHeader header;
+        std::memcpy(header.magic, kSegmentMagic, sizeof(header.magic));
+        header.number = number;
+        std::memcpy(active_.base, &header, sizeof(header));
+        active_.used = sizeof(header);
+    }
+    return true;
+}
+
+void ChangeJournal::closeSegment() {
+    if (active_.base) {
+        munmap(active_.base, active_.size);
+    }
+    if (active_.fd >= 0) {
+        ::close(active_.fd);
+    }
+    active_ = Segment();
+}
+
+bool ChangeJournal::rotateLocked(size_t minSize) {
+    uint64_t next = active_.number + 1;
+    if (active_.base) {
+        // 切换出去的段要等合并后才删除，先让它落盘
+        msync(active_.base, active_.used, MS_SYNC);
+        sealed_.push_back(active_.number);
+    }
+    closeSegment();
+    return createSegment(next, minSize);
+}
+
+size_t ChangeJournal::load(const char* base, size_t size, uint64_t segment,
+                           const std::function<void(const JournalEntry&)>& visit) const {
+    SegmentHeader header;
+    if (!base || size < sizeof(header)) return 0;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0 || header.number != segment) {
+        CT_LOG(Warn) << "Ignoring journal segment with bad header: " << segmentPath(segment);
+        return 0;
+    }
+
+    // 增量只引用同一段内的前一条记录，段内单独维护每个路径的内容
+    std::unordered_map<std::string, std::string> contents;
+    uint64_t lastSequence = 0;
+    size_t offset = sizeof(header);
+    size_t records = 0;
+    while (offset + sizeof(RecordHeader) <= size) {
+        RecordHeader record;
+        std::memcpy(&record, base + offset, sizeof(record));
+        if (record.magic != kRecordMagic) break;
+        size_t body = sizeof(record) + size_t(record.pathLength) + record.dataLength;
+        if (record.length != align8(body) || offset + record.length > size) break;
+        if (xxhash64(base + offset + kChecksumOffset, body - kChecksumOffset) != record.checksum) break;
+        if (record.sequence <= lastSequence) break;
+
+        const char* data = base + offset + sizeof(record);
+        std::string path(data, record.pathLength);
+        std::string_view payload(data + record.pathLength, record.dataLength);
+        std::string content;
+        if (record.flags & kFlagDelta) {
+            auto previous = contents.find(path);
+            if (previous == contents.end() ||
+                size_t(record.prefix) + record.suffix > previous->second.size()) {
+                break;
+            }
+            const std::string& old = previous->second;
+            content.reserve(size_t(record.prefix) + payload.size() + record.suffix);
+            content.append(old, 0, record.prefix);
+            content.append(payload);
+            content.append(old, old.size() - record.suffix, record.suffix);
+        } else {
+            content.assign(payload);
+        }
+
+        JournalOp op = record.op == static_cast<uint8_t>(JournalOp::Remove) ? JournalOp::Remove : JournalOp::Write;
+        JournalEntry entry;
+        entry.sequence = record.sequence;
+        entry.time = record.time;
+        entry.path = path;
+        entry.op = op;
+        entry.content = content;
+        visit(entry);
+        if (op == JournalOp::Remove) {
+            contents.erase(path);
+        } else {
+            contents[path] = std::move(content);
+        }
+        lastSequence = record.sequence;
+        offset += record.length;
+        ++records;
+    }
+    if (offset + sizeof(RecordHeader) <= size) {
+        RecordHeader record;
+        std::memcpy(&record, base + offset, sizeof(record));
+        if (record.magic != 0) {
+            CT_LOG(Warn) << "Journal segment " << segmentPath(segment) << " truncated after "
+                         << records << " records";
+        }
+    }
+    return offset;
+}
+
+uint64_t ChangeJournal::append(std::string_view path, std::string_view content, int64_t time) {
+    ScopedTimer timer(CoreMetrics::get().journalAppend);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return appendLocked(path, JournalOp::Write, content, time);
+}
+
+uint64_t ChangeJournal::appendRemove(std::string_view path, int64_t time) {
+    ScopedTimer timer(CoreMetrics::get().journalAppend);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return appendLocked(path, JournalOp::Remove, std::string_view(), time);
+}
+
+uint64_t ChangeJournal::appendLocked(std::string_view path, JournalOp op, std::string_view content, int64_t time) {
+    if (!active_.base) {
+        CT_LOG(Error) << "Error: Journal not open";
+        return 0;
+    }
+    if (path.empty() || path.size() > UINT32_MAX || content.size() > UINT32_MAX) {
+        CT_LOG(Error) << "Error: Journal record too large: " << path;
+        return 0;
+    }
+    // 按完整记录估算空间，放不下时切换到新段，新段内第一条记录总是完整内容
+    size_t full = align8(sizeof(RecordHeader) + path.size() + content.size());
+    if (active_.used + full > active_.size && !rotateLocked(full)) {
+        return 0;
+    }
+
+    // 复用的查找键：已出现过的路径追加时不分配内存
+    keyBuffer_.assign(path);
+    auto it = paths_.find(keyBuffer_);
+    bool delta = op == JournalOp::Write && it != paths_.end() && !it->second.removed &&
+                 it->second.segment == active_.number;
+    uint32_t prefix = 0, suffix = 0;
+    if (delta) {
+        const std::string& old = it->second.content;
+        size_t limit = std::min(old.size(), content.size());
+        size_t p = 0;
+        while (p < limit && old[p] == content[p]) ++p;
+        size_t s = 0;
+        while (s < limit - p && old[old.size() - 1 - s] == content[content.size() - 1 - s]) ++s;
+        prefix = static_cast<uint32_t>(p);
+        suffix = static_cast<uint32_t>(s);
+    }
+    std::string_view data = content.substr(prefix, content.size() - prefix - suffix);
+
+    RecordHeader record;
+    std::memset(&record, 0, sizeof(record));
+    size_t body = sizeof(record) + path.size() + data.size();
+    record.magic = kRecordMagic;
+    record.length = static_cast<uint32_t>(align8(body));
+    record.sequence = sequence_ + 1;
+    record.time = time ? time : nowNanos();
+    record.pathLength = static_cast<uint32_t>(path.size());
+    record.dataLength = static_cast<uint32_t>(data.size());
+    record.prefix = prefix;
+    record.suffix = suffix;
+    record.op = static_cast<uint8_t>(op);
+    record.flags = delta ? kFlagDelta : 0;
+
+    // 先写路径和数据，再写头部和校验；写到一半崩溃的记录在回放时校验失败
+    char* out = active_.base + active_.used;
+    std::memcpy(out + sizeof(record), path.data(), path.size());
+    if (!data.empty()) {
+        std::memcpy(out + sizeof(record) + path.size(), data.data(), data.size());
+    }
+    std::memcpy(out, &record, sizeof(record));
+    record.checksum = xxhash64(out + kChecksumOffset, body - kChecksumOffset);
+    std::memcpy(out + offsetof(RecordHeader, checksum), &record.checksum, sizeof(record.checksum));
+    active_.used += record.length;
+
+    PathState& state = it != paths_.end() ? it->second : paths_[keyBuffer_];
+    if (op == JournalOp::Remove) {
+        state.content.clear();
+    } else {
+        state.content.assign(content);
+    }
+    state.removed = op == JournalOp::Remove;
+    state.segment = active_.number;
+    return ++sequence_;
+}
+
+bool ChangeJournal::sync() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!active_.base) return false;
+    if (msync(active_.base, active_.used, MS_SYNC) != 0) {
+        CT_LOG(Error) << "Error: Journal sync failed: " << std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool ChangeJournal::current(std::string_view path, std::string& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = paths_.find(std::string(path));
+    if (it == paths_.end() || it->second.removed) return false;
+    out = it->second.content;
+    return true;
+}
+
+size_t ChangeJournal::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const auto& item : paths_) {
+        count += item.second.segment > folded_;
+    }
+    return count;
+}
+
+uint64_t ChangeJournal::lastSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sequence_;
+}
+
+bool ChangeJournal::beginFold(std::vector<FileContent>& out, uint64_t& token) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out.clear();
+    if (!active_.base) return false;
+    for (const auto& item : paths_) {
+        if (item.second.segment <= folded_) continue;
+        FileContent file;
+        file.path = item.first;
+        file.removed = item.second.removed;
+        if (!file.removed) file.data = item.second.content;
+        out.push_back(std::move(file));
+    }
+    if (out.empty()) return false;
+    std::sort(out.begin(), out.end(), [](const FileContent& a, const FileContent& b) {
+        return a.path < b.path;
+    });
+    // 之后的变更写入新段，合并确认后整段删除旧段
+    token = active_.number;
+    return rotateLocked(0);
+}
+
+void ChangeJournal::finishFold(uint64_t token) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (token <= folded_) return;
+    folded_ = token;
+    // 合并后没有再变化的路径不再需要保留内容
+    for (auto it = paths_.begin(); it != paths_.end();) {
+        if (it->second.segment <= token) {
+            it = paths_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    auto keep = std::partition(sealed_.begin(), sealed_.end(), [token](uint64_t n) { return n > token; });
+    for (auto it = keep; it != sealed_.end(); ++it) {
+        if (::unlink(segmentPath(*it).c_str()) != 0 && errno != ENOENT) {
+            CT_LOG(Warn) << "Cannot remove journal segment " << segmentPath(*it) << ": " << std::strerror(errno);
+        }
+    }
+    sealed_.erase(keep, sealed_.end());
+}
+
+void ChangeJournal::replay(const std::function<void(const JournalEntry&)>& visit) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint64_t number : sealed_) {
+        MappedFile file;
+        if (file.open(segmentPath(number))) {
+            load(file.data(), file.size(), number, visit);
+        }
+    }
+    if (active_.base) {
+        load(active_.base, active_.used, active_.number, visit);
+    }
+}
@@ -0,0 +1,123 @@
+#include "configtracker/change_subscription.h"
+#include "configtracker/metrics.h"
+#include "configtracker/logger.h"
+
+using namespace configtracker;
+
+Subscription::Subscription(SubscriptionId id, SubscribeOptions options, ChangeHandler handler)
+    : id_(id), options_(std::move(options)), handler_(std::move(handler)), ring_(options_.capacity) {
+    thread_ = std::thread(&Subscription::run, this);
+}
+
+Subscription::~Subscription() {
+    stop();
+}
+
+bool Subscription::matches(std::string_view path) const {
+    if (options_.prefixes.empty()) {
+        return true;
+    }
+    for (const auto& prefix : options_.prefixes) {
+        if (path.compare(0, prefix.size(), prefix) != 0) continue;
+        // 按路径分量匹配：前缀本身、以 '/' 结尾的前缀，或者前缀之后紧跟 '/'
+        if (path.size() == prefix.size() || prefix.empty() || prefix.back() == '/' ||
+            path[prefix.size()] == '/') {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Subscription::offer(const ChangeBatchPtr& batch) {
+    ChangeEvent event;
+    for (size_t i = 0; i < batch->files.size(); ++i) {
+        if (matches(batch->files[i].path)) {
+            event.files.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    if (event.files.empty()) {
+        return true;
+    }
+    event.batch = batch;
+    if (dropsPending_) {
+        // 之前的丢弃随这个事件告知；投递线程可能已经以补投事件告知过，此时计数为 0
+        std::lock_guard<std::mutex> lock(mutex_);
+        event.missed = missed_;
+        missed_ = 0;
+        resync_ = ChangeEvent();
+        dropsPending_ = false;
+    }
+    if (!ring_.tryPush(event)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        CoreMetrics::get().subscriberDrops.add();
+        // 记下最后一个被丢弃的事件，队列排空后没有更新的事件时由投递线程补投
+        std::lock_guard<std::mutex> lock(mutex_);
+        missed_ += event.missed + 1;
+        event.missed = 0;
+        resync_ = std::move(event);
+        dropsPending_ = true;
+        cv_.notify_one();
+        return false;
+    }
+    // 与 run() 中的屏障配对：要么投递线程看到新事件，要么这里看到它在等待
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_one();
+    }
+    return true;
+}
+
+void Subscription::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void Subscription::run() {
+    CoreMetrics& metrics = CoreMetrics::get();
+    ChangeEvent event;
+    auto deliver = [&] {
+        handler_(event);
+        event = ChangeEvent();
+        delivered_.fetch_add(1, std::memory_order_relaxed);
+        metrics.subscriberBatches.add();
+    };
+    while (true) {
+        if (ring_.tryPop(event)) {
+            deliver();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring_.empty()) {
+            // 队列已排空而丢弃还没有告知：补投最后被丢弃的批次，它比已投递的都新，
+            // 真正错过的只有更早被丢弃的那些
+            if (resync_.batch) {
+                event = std::move(resync_);
+                event.missed = missed_ - 1;
+                missed_ = 0;
+                resync_ = ChangeEvent();
+                waiting_.store(false, std::memory_order_relaxed);
+                lock.unlock();
+                deliver();
+                continue;
+            }
+            // 停止前已入队的事件全部投递完才退出
+            if (stopping_) {
+                waiting_.store(false, std::memory_order_relaxed);
+                break;
+            }
+            cv_.wait(lock, [this] { return stopping_ || resync_.batch != nullptr || !ring_.empty(); });
+        }
+        waiting_.store(false, std::memory_order_relaxed);
+    }
+    CT_LOG(Debug) << "[Subscribe] Subscription " << id_ << " stopped after " << delivered()
+                  << " batches, " << dropped() << " dropped";
+}
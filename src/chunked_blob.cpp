@@ -0,0 +1,254 @@
+#include "configtracker/git_repo_manager.h"
+#include "configtracker/content_hash.h"
+#include "configtracker/logger.h"
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <unordered_map>
+
+using namespace configtracker;
+
+namespace {
+
+// 分块文件在自己的路径上保存清单，块作为 blob 保存在 .ctchunks/<路径>/<块哈希> 下，
+// 被树引用，打包和清理不可达对象时与普通文件一样处理
+constexpr char kChunkDir[] = ".ctchunks";
+constexpr char kManifestMagic[] = "configtracker-chunked 1\n";
+
+struct ManifestChunk {
+    git_oid oid;
+    size_t length = 0;
+    uint64_t hash = 0;
+};
+
+struct Manifest {
+    uint64_t size = 0;
+    uint64_t hash = 0;   // 整个文件的 XXH64
+    std::vector<ManifestChunk> chunks;
+};
+
+bool isManifest(const char* data, size_t size) {
+    size_t magic = sizeof(kManifestMagic) - 1;
+    return size >= magic && std::memcmp(data, kManifestMagic, magic) == 0;
+}
+
+// 清单格式：
+//   configtracker-chunked 1
+//   size <文件长度> hash <XXH64>
+//   <块 oid> <长度> <XXH64>   （每块一行，按文件中的顺序）
+bool parseManifest(const char* data, size_t size, Manifest& out) {
+    if (!isManifest(data, size)) return false;
+    std::istringstream in(std::string(data + sizeof(kManifestMagic) - 1, size - (sizeof(kManifestMagic) - 1)));
+    std::string key, hash;
+    if (!(in >> key >> out.size) || key != "size" || !(in >> key >> hash) || key != "hash") return false;
+    out.hash = std::strtoull(hash.c_str(), nullptr, 16);
+    out.chunks.clear();
+    std::string oid;
+    ManifestChunk chunk;
+    uint64_t total = 0;
+    while (in >> oid >> chunk.length >> hash) {
+        if (git_oid_fromstr(&chunk.oid, oid.c_str()) < 0) return false;
+        chunk.hash = std::strtoull(hash.c_str(), nullptr, 16);
+        total += chunk.length;
+        out.chunks.push_back(chunk);
+    }
+    return total == out.size;
+}
+
+std::string hex64(uint64_t value) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+    return text;
+}
+
+std::string oidToString(const git_oid& oid) {
+    char hash[GIT_OID_HEXSZ + 1] = {0};
+    git_oid_fmt(hash, &oid);
+    return std::string(hash);
+}
+
+std::string chunkDirOf(const std::string& indexPath) {
+    return std::string(kChunkDir) + "/" + indexPath;
+}
+
+}
+
+bool GitRepoManager::isChunkPath(const char* path) {
+    size_t len = sizeof(kChunkDir) - 1;
+    return std::strncmp(path, kChunkDir, len) == 0 && (path[len] == '/' || path[len] == '\0');
+}
+
+void GitRepoManager::setChunking(const ChunkingOptions& options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    chunking_ = options;
+}
+
+bool GitRepoManager::writeContentLocked(git_index* index, const std::string& indexPath,
+                                        const char* data, size_t size, git_oid& out) {
+    if (!data) data = "";
+    if (chunking_.threshold == 0 || size < chunking_.threshold || ingestMode_ != IngestMode::Direct) {
+        int error = git_blob_create_from_buffer(&out, repo_, data, size);
+        if (error < 0) {
+            const git_error* e = git_error_last();
+            CT_LOG(Error) << "Error writing blob: " << e->message;
+            return false;
+        }
+        // 文件缩小到阈值以下，之前的块不再需要
+        std::string dir = chunkDirOf(indexPath);
+        git_index_remove_directory(index, dir.c_str(), 0);
+        tree_.removeDirectory(dir);
+        return true;
+    }
+
+    // 上一版本的块按（XXH64, 长度）索引：没有变化的块直接沿用 oid，不再计算 SHA-1，也不写对象库
+    std::unordered_map<uint64_t, ManifestChunk> previous;
+    uint64_t fileHash = xxhash64(data, size);
+    const git_index_entry* existing = git_index_get_bypath(index, indexPath.c_str(), 0);
+    if (existing) {
+        git_blob* blob = nullptr;
+        Manifest manifest;
+        if (git_blob_lookup(&blob, repo_, &existing->id) == 0 &&
+            parseManifest(static_cast<const char*>(git_blob_rawcontent(blob)),
+                          static_cast<size_t>(git_blob_rawsize(blob)), manifest)) {
+            if (manifest.size == size && manifest.hash == fileHash) {
+                // 内容没有变化
+                git_oid_cpy(&out, &existing->id);
+                git_blob_free(blob);
+                return true;
+            }
+            for (const auto& chunk : manifest.chunks) {
+                previous.emplace(chunk.hash ^ chunk.length, chunk);
+            }
+        }
+        git_blob_free(blob);
+    }
+
+    std::vector<ContentChunk> chunks;
+    chunkContent(data, size, chunking_, chunks);
+    std::ostringstream manifest;
+    manifest << kManifestMagic << "size " << size << " hash " << hex64(fileHash) << "\n";
+    std::vector<git_oid> oids;
+    oids.reserve(chunks.size());
+    size_t written = 0;
+    for (const auto& chunk : chunks) {
+        git_oid oid;
+        auto it = previous.find(chunk.hash ^ chunk.length);
+        if (it != previous.end() && it->second.hash == chunk.hash && it->second.length == chunk.length) {
+            git_oid_cpy(&oid, &it->second.oid);
+        } else {
+            int error = git_blob_create_from_buffer(&oid, repo_, data + chunk.offset, chunk.length);
+            if (error < 0) {
+                const git_error* e = git_error_last();
+                CT_LOG(Error) << "Error writing chunk of " << indexPath << ": " << e->message;
+                return false;
+            }
+            ++written;
+        }
+        oids.push_back(oid);
+        manifest << oidToString(oid) << " " << chunk.length << " " << hex64(chunk.hash) << "\n";
+    }
+    std::string text = manifest.str();
+    int error = git_blob_create_from_buffer(&out, repo_, text.data(), text.size());
+    if (error < 0) {
+        const git_error* e = git_error_last();
+        CT_LOG(Error) << "Error writing chunk manifest: " << e->message;
+        return false;
+    }
+
+    // 块目录整体替换为本版本用到的块
+    std::string dir = chunkDirOf(indexPath);
+    git_index_remove_directory(index, dir.c_str(), 0);
+    tree_.removeDirectory(dir);
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        std::string path = dir + "/" + oidToString(oids[i]);
+        git_index_entry entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.mode = GIT_FILEMODE_BLOB;
+        entry.file_size = static_cast<uint32_t>(chunks[i].length);
+        entry.id = oids[i];
+        entry.path = path.c_str();
+        if (git_index_add(index, &entry) < 0) {
+            const git_error* e = git_error_last();
+            CT_LOG(Error) << "Error adding chunk to index: " << e->message;
+            return false;
+        }
+        tree_.set(path, oids[i], GIT_FILEMODE_BLOB);
+    }
+    CT_LOG(Debug) << "[Git] Chunked " << indexPath << ": " << chunks.size() << " chunks, "
+                  << written << " new";
+    return true;
+}
+
+bool GitRepoManager::removeEntryLocked(git_index* index, const std::string& indexPath) {
+    if (!git_index_get_bypath(index, indexPath.c_str(), 0) ||
+        git_index_remove_bypath(index, indexPath.c_str()) != 0) {
+        return false;
+    }
+    tree_.remove(indexPath);
+    std::string dir = chunkDirOf(indexPath);
+    git_index_remove_directory(index, dir.c_str(), 0);
+    tree_.removeDirectory(dir);
+    return true;
+}
+
+bool GitRepoManager::readContentLocked(const git_oid& oid, std::string& out) {
+    return readContent(repo_, oid, out);
+}
+
+bool GitRepoManager::readContent(git_repository* repo, const git_oid& oid, std::string& out) {
+    git_blob* blob = nullptr;
+    if (git_blob_lookup(&blob, repo, &oid) < 0) {
+        const git_error* e = git_error_last();
+        CT_LOG(Error) << "Error reading blob: " << (e ? e->message : "unknown error");
+        return false;
+    }
+    const char* data = static_cast<const char*>(git_blob_rawcontent(blob));
+    size_t size = static_cast<size_t>(git_blob_rawsize(blob));
+    Manifest manifest;
+    if (!isManifest(data, size)) {
+        out.assign(data, size);
+        git_blob_free(blob);
+        return true;
+    }
+    bool ok = parseManifest(data, size, manifest);
+    git_blob_free(blob);
+    if (!ok) {
+        CT_LOG(Error) << "Error: Corrupt chunk manifest " << oidToString(oid);
+        return false;
+    }
+
+    // 按清单顺序拼接各块
+    out.clear();
+    out.reserve(manifest.size);
+    for (const auto& chunk : manifest.chunks) {
+        git_blob* part = nullptr;
+        if (git_blob_lookup(&part, repo, &chunk.oid) < 0) {
+            const git_error* e = git_error_last();
+            CT_LOG(Error) << "Error reading chunk " << oidToString(chunk.oid) << ": "
+                          << (e ? e->message : "unknown error");
+            return false;
+        }
+        out.append(static_cast<const char*>(git_blob_rawcontent(part)), static_cast<size_t>(git_blob_rawsize(part)));
+        git_blob_free(part);
+    }
+    if (out.size() != manifest.size || xxhash64(out.data(), out.size()) != manifest.hash) {
+        CT_LOG(Error) << "Error: Chunked content does not match manifest " << oidToString(oid);
+        return false;
+    }
+    return true;
+}
+
+bool GitRepoManager::chunkedSummaryLocked(const git_oid& oid, uint64_t& size, uint64_t& hash) {
+    git_blob* blob = nullptr;
+    if (git_blob_lookup(&blob, repo_, &oid) < 0) return false;
+    Manifest manifest;
+    bool ok = parseManifest(static_cast<const char*>(git_blob_rawcontent(blob)),
+                            static_cast<size_t>(git_blob_rawsize(blob)), manifest);
+    git_blob_free(blob);
+    if (ok) {
+        size = manifest.size;
+        hash = manifest.hash;
+    }
+    return ok;
+}
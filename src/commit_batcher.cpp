@@ -0,0 +1,211 @@
+#include "configtracker/commit_batcher.h"
+#include "configtracker/metrics.h"
+#include <algorithm>
+
+using namespace configtracker;
+
+namespace {
+
+constexpr size_t kSlotReserve = 128;
+
+}
+
+CommitBatcher::CommitBatcher(std::chrono::milliseconds quietWindow,
+                             std::chrono::milliseconds maxLatency,
+                             FlushCallback onFlush,
+                             size_t queueCapacity,
+                             BackpressurePolicy policy)
+    : quietWindow_(quietWindow), maxLatency_(maxLatency), onFlush_(std::move(onFlush)),
+      policy_(policy), queue_(queueCapacity) {
+    // 常见的配置文件路径放得下，入队时复制进槽位不分配内存；更长的路径在槽位第一次使用时扩容
+    queue_.initSlots([](std::string& slot) { slot.reserve(kSlotReserve); });
+}
+
+CommitBatcher::~CommitBatcher() {
+    stop();
+}
+
+void CommitBatcher::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    stopping_ = false;
+    workerExited_ = false;
+    thread_ = std::thread([this]() { run(); });
+}
+
+void CommitBatcher::enqueue(const std::string& path) {
+    if (!queue_.tryPushCopy(path)) {
+        switch (policy_) {
+        case BackpressurePolicy::Coalesce:
+            coalesced_.fetch_add(1, std::memory_order_relaxed);
+            CoreMetrics::get().eventsCoalesced.add();
+            coalesce(path);
+            break;
+        case BackpressurePolicy::Drop:
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            CoreMetrics::get().eventsDropped.add();
+            return;
+        case BackpressurePolicy::Block:
+            blocked_.fetch_add(1, std::memory_order_relaxed);
+            CoreMetrics::get().eventsBlocked.add();
+            while (!queue_.tryPushCopy(path)) {
+                // 工作线程已退出时不再等待，交给 stop() 的最后一次排空
+                if (workerExited_.load()) {
+                    coalesce(path);
+                    break;
+                }
+                wakeWorker();
+                std::unique_lock<std::mutex> lock(spaceMutex_);
+                spaceCv_.wait_for(lock, std::chrono::milliseconds(1));
+            }
+            break;
+        }
+    }
+    wakeWorker();
+}
+
+void CommitBatcher::wakeWorker() {
+    // 与 run() 中的 waiting_ 置位配对：要么工作线程休眠前能看到新事件，
+    // 要么这里能看到 waiting_ 并加锁唤醒
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_one();
+    }
+}
+
+void CommitBatcher::coalesce(const std::string& path) {
+    std::lock_guard<std::mutex> lock(overflowMutex_);
+    overflow_.insert(path);
+    hasOverflow_.store(true, std::memory_order_release);
+}
+
+void CommitBatcher::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_ || workerExited_) {
+        // 没有工作线程时在调用线程上提交
+        drain();
+        deliver(takeBatch());
+        return;
+    }
+    uint64_t ticket = ++flushRequested_;
+    cv_.notify_one();
+    flushedCv_.wait(lock, [this, ticket] { return flushCompleted_ >= ticket || workerExited_; });
+}
+
+void CommitBatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 工作线程退出前后投递的事件
+    drain();
+    deliver(takeBatch());
+    running_ = false;
+}
+
+void CommitBatcher::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        // 先读取 flush 请求再排空队列，保证请求之前投递的事件都在本批次中
+        uint64_t requested = flushRequested_;
+        lock.unlock();
+        drain();
+        lock.lock();
+
+        bool flushNow = stopping_ || flushRequested_ != flushCompleted_;
+        auto deadline = Clock::time_point::max();
+        if (pending_.size() > 0) {
+            // 静默窗口到期或达到最大延迟，取较早者
+            deadline = std::min(lastEvent_ + quietWindow_, firstEvent_ + maxLatency_);
+            if (flushNow || Clock::now() >= deadline) {
+                std::vector<std::string> batch = takeBatch();
+                lock.unlock();
+                deliver(batch);
+                lock.lock();
+                flushCompleted_ = std::max(flushCompleted_, requested);
+                flushedCv_.notify_all();
+                continue;
+            }
+        } else if (flushNow) {
+            flushCompleted_ = std::max(flushCompleted_, requested);
+            flushedCv_.notify_all();
+            if (stopping_) break;
+            if (flushRequested_ != flushCompleted_) continue;
+        }
+
+        waiting_.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (queue_.empty() && !hasOverflow_.load() && !stopping_ && flushRequested_ == flushCompleted_) {
+            if (deadline == Clock::time_point::max()) {
+                cv_.wait(lock);
+            } else {
+                cv_.wait_until(lock, deadline);
+            }
+        }
+        waiting_.store(false, std::memory_order_relaxed);
+    }
+
+    workerExited_ = true;
+    flushedCv_.notify_all();
+    spaceCv_.notify_all();
+}
+
+void CommitBatcher::drain() {
+    bool wasEmpty = pending_.size() == 0;
+    bool added = false;
+    // 同一批次内重复的路径只保留一次
+    auto add = [this, &added](const std::string& path) {
+        added = true;
+        pending_.intern(path);
+    };
+
+    CoreMetrics::get().commitQueueDepth.set(static_cast<int64_t>(queue_.sizeApprox()));
+    while (queue_.tryConsume(add)) {
+    }
+    if (hasOverflow_.load(std::memory_order_acquire)) {
+        std::unordered_set<std::string> spilled;
+        {
+            std::lock_guard<std::mutex> lock(overflowMutex_);
+            spilled.swap(overflow_);
+            hasOverflow_.store(false, std::memory_order_relaxed);
+        }
+        for (const auto& path : spilled) {
+            add(path);
+        }
+    }
+
+    if (added) {
+        auto now = Clock::now();
+        if (wasEmpty) {
+            firstEvent_ = now;
+        }
+        lastEvent_ = now;
+        if (policy_ == BackpressurePolicy::Block) {
+            spaceCv_.notify_all();
+        }
+    }
+}
+
+std::vector<std::string> CommitBatcher::takeBatch() {
+    std::vector<std::string> batch;
+    batch.reserve(pending_.size());
+    for (PathId id = 0; id < pending_.size(); ++id) {
+        batch.emplace_back(pending_.path(id));
+    }
+    pending_.reset();
+    return batch;
+}
+
+void CommitBatcher::deliver(const std::vector<std::string>& batch) {
+    if (batch.empty()) return;
+    CoreMetrics::get().commitBatchSize.record(batch.size());
+    onFlush_(batch);
+}
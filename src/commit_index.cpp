@@ -0,0 +1,469 @@
+#include "configtracker/commit_index.h"
+#include "configtracker/logger.h"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <climits>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+
+using namespace configtracker;
+
+namespace {
+
+constexpr char kIdxMagic[8] = {'C', 'T', 'C', 'I', 'D', 'X', '0', '1'};
+constexpr char kPathsMagic[8] = {'C', 'T', 'C', 'P', 'T', 'H', '0', '1'};
+constexpr char kNamesMagic[8] = {'C', 'T', 'C', 'N', 'A', 'M', '0', '1'};
+
+// 三个文件共用的头部，generation 不一致说明替换索引时中途崩溃
+struct FileHeader {
+    char magic[8];
+    uint64_t generation;
+};
+
+// 一次提交中同一路径可能出现多次（先修改后删除），保留第一次出现的位置。
+// 大的提交（初次导入几十万个文件）也只是线性时间
+void dedupIds(std::vector<uint32_t>& ids, size_t from) {
+    if (ids.size() - from < 2) return;
+    std::unordered_set<uint32_t> seen;
+    seen.reserve(ids.size() - from);
+    auto out = ids.begin() + static_cast<std::ptrdiff_t>(from);
+    for (auto it = out; it != ids.end(); ++it) {
+        if (seen.insert(*it).second) *out++ = *it;
+    }
+    ids.erase(out, ids.end());
+}
+
+bool writeAll(int fd, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool readHeader(const char* base, size_t size, const char (&magic)[8], uint64_t& generation) {
+    if (!base || size < sizeof(FileHeader)) return false;
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) return false;
+    generation = header.generation;
+    return true;
+}
+
+}
+
+CommitIndex::~CommitIndex() {
+    close();
+}
+
+bool CommitIndex::open(const std::string& dir) {
+    close();
+    dir_ = dir;
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+
+    if (!openFiles()) {
+        close();
+        return false;
+    }
+    bool fresh = idx_.size == 0 && paths_.size == 0 && names_.size == 0;
+    if (!load()) {
+        if (!fresh) {
+            CT_LOG(Warn) << "Ignoring corrupt commit index in " << dir_;
+        }
+        return rewrite({});
+    }
+    return true;
+}
+
+void CommitIndex::close() {
+    for (Mapping* mapping : {&idx_, &paths_, &names_}) {
+        if (mapping->base) munmap(mapping->base, mapping->size);
+        if (mapping->fd >= 0) ::close(mapping->fd);
+        *mapping = Mapping();
+    }
+    records_ = nullptr;
+    count_ = 0;
+    pathIds_ = nullptr;
+    pathIdCount_ = 0;
+    pathNames_.clear();
+    postings_.clear();
+    positions_.clear();
+}
+
+bool CommitIndex::openFiles() {
+    const std::pair<Mapping*, const char*> files[] = {
+        {&idx_, "commits.idx"}, {&paths_, "commits.paths"}, {&names_, "commits.names"}};
+    for (const auto& file : files) {
+        std::string path = (std::filesystem::path(dir_) / file.second).string();
+        file.first->fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (file.first->fd < 0) {
+            CT_LOG(Error) << "Error opening commit index file: " << path;
+            return false;
+        }
+        if (!remap(*file.first)) return false;
+    }
+    return true;
+}
+
+bool CommitIndex::remap(Mapping& mapping) {
+    struct stat st{};
+    if (fstat(mapping.fd, &st) != 0) return false;
+    size_t size = static_cast<size_t>(st.st_size);
+    if (mapping.base && size == mapping.size) return true;
+
+    if (mapping.base) {
+        munmap(mapping.base, mapping.size);
+        mapping.base = nullptr;
+        mapping.size = 0;
+    }
+    if (size == 0) return true;
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, mapping.fd, 0);
+    if (mapped == MAP_FAILED) {
+        CT_LOG(Error) << "Error mapping commit index: " << std::strerror(errno);
+        return false;
+    }
+    mapping.base = static_cast<char*>(mapped);
+    mapping.size = size;
+    return true;
+}
+
+void CommitIndex::updateViews() {
+    records_ = idx_.base ? reinterpret_cast<const CommitRecord*>(idx_.base + sizeof(FileHeader)) : nullptr;
+    pathIds_ = paths_.base ? reinterpret_cast<const uint32_t*>(paths_.base + sizeof(FileHeader)) : nullptr;
+    pathIdCount_ = paths_.size >= sizeof(FileHeader) ? (paths_.size - sizeof(FileHeader)) / sizeof(uint32_t) : 0;
+}
+
+bool CommitIndex::load() {
+    uint64_t idxGen = 0, pathsGen = 0, namesGen = 0;
+    if (!readHeader(idx_.base, idx_.size, kIdxMagic, idxGen) ||
+        !readHeader(paths_.base, paths_.size, kPathsMagic, pathsGen) ||
+        !readHeader(names_.base, names_.size, kNamesMagic, namesGen) ||
+        idxGen != pathsGen || idxGen != namesGen) {
+        return false;
+    }
+    generation_ = idxGen;
+
+    // 路径名：长度 + 内容，末尾不完整的条目是追加时中断留下的，忽略
+    size_t offset = sizeof(FileHeader);
+    while (offset + sizeof(uint32_t) <= names_.size) {
+        uint32_t len;
+        std::memcpy(&len, names_.base + offset, sizeof(len));
+        if (offset + sizeof(len) + len > names_.size) break;
+        pathNames_.intern(std::string_view(names_.base + offset + sizeof(len), len));
+        offset += sizeof(len) + len;
+    }
+    size_t namesEnd = offset;
+
+    updateViews();
+    size_t count = (idx_.size - sizeof(FileHeader)) / sizeof(CommitRecord);
+    postings_.assign(pathNames_.size(), {});
+    positions_.clear();
+    positions_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const CommitRecord& rec = records_[i];
+        bool valid = static_cast<uint64_t>(rec.pathsOffset) + rec.pathsCount <= pathIdCount_;
+        for (uint32_t j = 0; valid && j < rec.pathsCount; ++j) {
+            valid = pathIds_[rec.pathsOffset + j] < pathNames_.size();
+        }
+        if (!valid) {
+            count = i;
+            break;
+        }
+        for (uint32_t j = 0; j < rec.pathsCount; ++j) {
+            postings_[pathIds_[rec.pathsOffset + j]].push_back(static_cast<uint32_t>(i));
+        }
+        positions_[rec.oid] = static_cast<uint32_t>(i);
+    }
+    count_ = count;
+
+    // 截掉不完整的尾部，之后的 O_APPEND 写入才能接在有效数据后面
+    size_t pathsEnd = sizeof(FileHeader) + pathIdCount_ * sizeof(uint32_t);
+    size_t idxEnd = sizeof(FileHeader) + count_ * sizeof(CommitRecord);
+    bool trimmed = false;
+    if (names_.size != namesEnd) {
+        trimmed |= ftruncate(names_.fd, static_cast<off_t>(namesEnd)) == 0;
+    }
+    if (paths_.size != pathsEnd) {
+        trimmed |= ftruncate(paths_.fd, static_cast<off_t>(pathsEnd)) == 0;
+    }
+    if (idx_.size != idxEnd) {
+        trimmed |= ftruncate(idx_.fd, static_cast<off_t>(idxEnd)) == 0;
+    }
+    if (trimmed) {
+        if (!remap(idx_) || !remap(paths_) || !remap(names_)) return false;
+        updateViews();
+    }
+    return true;
+}
+
+std::vector<std::string_view> CommitIndex::pathsOf(size_t pos) const {
+    std::vector<std::string_view> result;
+    const CommitRecord& rec = records_[pos];
+    result.reserve(rec.pathsCount);
+    for (uint32_t j = 0; j < rec.pathsCount; ++j) {
+        result.push_back(pathNames_.path(pathIds_[rec.pathsOffset + j]));
+    }
+    return result;
+}
+
+std::vector<std::string> CommitIndex::pathsUpTo(size_t pos) const {
+    std::vector<std::string> result;
+    std::vector<bool> seen(pathNames_.size(), false);
+    for (size_t i = 0; i <= pos && i < count_; ++i) {
+        const CommitRecord& rec = records_[i];
+        for (uint32_t j = 0; j < rec.pathsCount; ++j) {
+            PathId id = pathIds_[rec.pathsOffset + j];
+            if (!seen[id]) {
+                seen[id] = true;
+                result.emplace_back(pathNames_.path(id));
+            }
+        }
+    }
+    return result;
+}
+
+bool CommitIndex::append(const CommitInfo& info) {
+    if (idx_.fd < 0) return false;
+
+    // 先写路径名和路径 ID，最后写记录：中途崩溃时记录不存在，多出的尾部在加载时忽略
+    std::string newNames;
+    std::vector<uint32_t> ids;
+    ids.reserve(info.paths.size());
+    for (const auto& path : info.paths) {
+        PathId id = pathNames_.find(path);
+        if (id == kInvalidPathId) {
+            id = pathNames_.intern(path);
+            uint32_t len = static_cast<uint32_t>(path.size());
+            newNames.append(reinterpret_cast<const char*>(&len), sizeof(len));
+            newNames += path;
+        }
+        ids.push_back(id);
+    }
+    dedupIds(ids, 0);
+
+    CommitRecord rec{};
+    rec.oid = info.oid;
+    rec.parent = info.parent;
+    rec.time = info.time;
+    rec.orderTime = count_ > 0 ? std::max(info.time, records_[count_ - 1].orderTime) : info.time;
+    rec.pathsOffset = static_cast<uint32_t>(pathIdCount_);
+    rec.pathsCount = static_cast<uint32_t>(ids.size());
+
+    bool ok = (newNames.empty() || writeAll(names_.fd, newNames.data(), newNames.size())) &&
+              writeAll(paths_.fd, ids.data(), ids.size() * sizeof(uint32_t)) &&
+              writeAll(idx_.fd, &rec, sizeof(rec)) &&
+              remap(idx_) && remap(paths_);
+    if (!ok) {
+        CT_LOG(Error) << "Error appending to commit index: " << std::strerror(errno);
+        // 以磁盘上的内容为准重新加载
+        close();
+        if (openFiles()) load();
+        return false;
+    }
+
+    updateViews();
+    postings_.resize(pathNames_.size());
+    for (uint32_t id : ids) {
+        postings_[id].push_back(static_cast<uint32_t>(count_));
+    }
+    positions_[rec.oid] = static_cast<uint32_t>(count_);
+    ++count_;
+    return true;
+}
+
+bool CommitIndex::writeFresh(const std::string& suffix, uint64_t generation,
+                             const std::vector<CommitInfo>& commits) {
+    PathTable names;
+    std::string nameBytes;
+    std::vector<uint32_t> ids;
+    std::vector<CommitRecord> records;
+    records.reserve(commits.size());
+
+    for (const auto& info : commits) {
+        CommitRecord rec{};
+        rec.oid = info.oid;
+        rec.parent = info.parent;
+        rec.time = info.time;
+        rec.orderTime = records.empty() ? info.time : std::max(info.time, records.back().orderTime);
+        rec.pathsOffset = static_cast<uint32_t>(ids.size());
+        for (const auto& path : info.paths) {
+            size_t before = names.size();
+            PathId id = names.intern(path);
+            if (names.size() != before) {
+                uint32_t len = static_cast<uint32_t>(path.size());
+                nameBytes.append(reinterpret_cast<const char*>(&len), sizeof(len));
+                nameBytes += path;
+            }
+            ids.push_back(id);
+        }
+        dedupIds(ids, rec.pathsOffset);
+        rec.pathsCount = static_cast<uint32_t>(ids.size() - rec.pathsOffset);
+        records.push_back(rec);
+    }
+
+    const struct {
+        const char* name;
+        const char (&magic)[8];
+        const void* data;
+        size_t size;
+    } files[] = {
+        {"commits.names", kNamesMagic, nameBytes.data(), nameBytes.size()},
+        {"commits.paths", kPathsMagic, ids.data(), ids.size() * sizeof(uint32_t)},
+        {"commits.idx", kIdxMagic, records.data(), records.size() * sizeof(CommitRecord)},
+    };
+    for (const auto& file : files) {
+        FileHeader header{};
+        std::memcpy(header.magic, file.magic, sizeof(header.magic));
+        header.generation = generation;
+
+        std::string path = (std::filesystem::path(dir_) / file.name).string() + suffix;
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(static_cast<const char*>(file.data), static_cast<std::streamsize>(file.size));
+        if (!out) {
+            CT_LOG(Error) << "Error writing commit index file: " << path;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CommitIndex::rewrite(const std::vector<CommitInfo>& commits) {
+    if (dir_.empty()) return false;
+    uint64_t generation = generation_ + 1;
+    if (!writeFresh(".tmp", generation, commits)) return false;
+
+    close();
+    // 记录文件最后替换，三个文件的 generation 一致才会被加载
+    for (const char* name : {"commits.names", "commits.paths", "commits.idx"}) {
+        std::string path = (std::filesystem::path(dir_) / name).string();
+        std::error_code ec;
+        std::filesystem::rename(path + ".tmp", path, ec);
+        if (ec) {
+            CT_LOG(Error) << "Error replacing commit index file: " << ec.message();
+            return false;
+        }
+    }
+    if (!openFiles() || !load()) {
+        CT_LOG(Error) << "Error reloading commit index in " << dir_;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool CommitIndex::truncate(size_t count) {
+    if (count >= count_) return true;
+
+    size_t pathsEnd = count > 0 ? records_[count - 1].pathsOffset + records_[count - 1].pathsCount : 0;
+    // 截断后被删除的记录不再映射，先取出它们的 oid
+    std::vector<git_oid> dropped;
+    dropped.reserve(count_ - count);
+    for (size_t i = count; i < count_; ++i) {
+        dropped.push_back(records_[i].oid);
+    }
+    if (ftruncate(idx_.fd, static_cast<off_t>(sizeof(FileHeader) + count * sizeof(CommitRecord))) != 0 ||
+        ftruncate(paths_.fd, static_cast<off_t>(sizeof(FileHeader) + pathsEnd * sizeof(uint32_t))) != 0 ||
+        !remap(idx_) || !remap(paths_)) {
+        CT_LOG(Error) << "Error truncating commit index: " << std::strerror(errno);
+        return false;
+    }
+    updateViews();
+    count_ = count;
+    for (const git_oid& oid : dropped) {
+        auto it = positions_.find(oid);
+        if (it != positions_.end() && it->second >= count) positions_.erase(it);
+    }
+    // 倒排表中的位置是递增的，从尾部删除即可
+    for (auto& positions : postings_) {
+        while (!positions.empty() && positions.back() >= count) {
+            positions.pop_back();
+        }
+    }
+    return true;
+}
+
+size_t CommitIndex::find(const git_oid& oid) const {
+    auto it = positions_.find(oid);
+    return it == positions_.end() ? npos : it->second;
+}
+
+std::pair<size_t, size_t> CommitIndex::range(int64_t from, int64_t to) const {
+    const CommitRecord* end = records_ + count_;
+    const CommitRecord* first = std::lower_bound(records_, end, from,
+        [](const CommitRecord& rec, int64_t time) { return rec.orderTime < time; });
+    const CommitRecord* last = std::upper_bound(first, end, to,
+        [](int64_t time, const CommitRecord& rec) { return time < rec.orderTime; });
+    return {static_cast<size_t>(first - records_), static_cast<size_t>(last - records_)};
+}
+
+size_t CommitIndex::lastBefore(int64_t time) const {
+    size_t first = range(time, INT64_MAX).first;
+    return first == 0 ? npos : first - 1;
+}
+
+const std::vector<uint32_t>* CommitIndex::touching(std::string_view path) const {
+    PathId id = pathNames_.find(path);
+    if (id == kInvalidPathId || id >= postings_.size()) return nullptr;
+    return &postings_[id];
+}
+
+std::shared_ptr<const CommitTimeline> CommitTimeline::build(const CommitIndex& index) {
+    auto timeline = std::make_shared<CommitTimeline>();
+    size_t count = index.size();
+    timeline->chunks_.reserve((count + kChunkSize - 1) / kChunkSize);
+    for (size_t first = 0; first < count; first += kChunkSize) {
+        auto chunk = std::make_shared<Chunk>();
+        size_t last = std::min(count, first + kChunkSize);
+        chunk->reserve(last - first);
+        for (size_t pos = first; pos < last; ++pos) {
+            chunk->push_back({index.at(pos).orderTime, index.at(pos).oid});
+        }
+        timeline->chunks_.push_back(std::move(chunk));
+    }
+    timeline->size_ = count;
+    return timeline;
+}
+
+std::shared_ptr<const CommitTimeline> CommitTimeline::append(const CommitRecord& record) const {
+    auto next = std::make_shared<CommitTimeline>(*this);
+    // 只有最后一块需要复制，其余块与旧版本共享
+    auto last = size_ % kChunkSize == 0 ? std::make_shared<Chunk>() : std::make_shared<Chunk>(*chunks_.back());
+    last->push_back({record.orderTime, record.oid});
+    if (size_ % kChunkSize == 0) {
+        next->chunks_.push_back(std::move(last));
+    } else {
+        next->chunks_.back() = std::move(last);
+    }
+    ++next->size_;
+    return next;
+}
+
+size_t CommitTimeline::lastBefore(int64_t time) const {
+    // 第一个 orderTime >= time 的位置
+    size_t low = 0, high = size_;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (entry(mid).orderTime < time) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low == 0 ? npos : low - 1;
+}
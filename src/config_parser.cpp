@@ -0,0 +1,181 @@
+#include "configtracker/config_parser.h"
+
+#include <string>
+
+using namespace configtracker;
+
+namespace {
+
+constexpr int kMaxJsonDepth = 256;
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+std::string_view trim(std::string_view text) {
+    size_t begin = 0;
+    size_t end = text.size();
+    while (begin < end && isSpace(text[begin])) ++begin;
+    while (end > begin && isSpace(text[end - 1])) --end;
+    return text.substr(begin, end - begin);
+}
+
+bool endsWith(std::string_view text, std::string_view suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool parseKeyValue(std::string_view data, const KeyValueSink& sink) {
+    std::string section;
+    std::string key;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t end = data.find('\n', pos);
+        if (end == std::string_view::npos) end = data.size();
+        std::string_view line = trim(data.substr(pos, end - pos));
+        pos = end + 1;
+
+        if (line.empty() || line.front() == '#' || line.front() == ';') continue;
+        if (line.front() == '[' && line.back() == ']') {
+            section.assign(trim(line.substr(1, line.size() - 2)));
+            continue;
+        }
+        size_t sep = line.find('=');
+        if (sep == std::string_view::npos) sep = line.find(':');
+        // 没有分隔符的行（例如开关项）按键处理，值为空
+        std::string_view name = trim(sep == std::string_view::npos ? line : line.substr(0, sep));
+        std::string_view value = sep == std::string_view::npos ? line.substr(line.size()) : trim(line.substr(sep + 1));
+        if (name.empty()) continue;
+        if (section.empty()) {
+            sink(name, value);
+        } else {
+            key.assign(section).append(".").append(name);
+            sink(key, value);
+        }
+    }
+    return true;
+}
+
+// 递归下降，只记录当前键路径，值以原文视图交给回调
+class JsonParser {
+public:
+    JsonParser(std::string_view data, const KeyValueSink& sink) : data_(data), sink_(sink) {}
+
+    bool parse() {
+        skipSpace();
+        if (!parseValue(0)) return false;
+        skipSpace();
+        return pos_ == data_.size();
+    }
+
+private:
+    std::string_view data_;
+    const KeyValueSink& sink_;
+    size_t pos_ = 0;
+    std::string path_;
+
+    void skipSpace() {
+        while (pos_ < data_.size() && isSpace(data_[pos_])) ++pos_;
+    }
+
+    bool peek(char c) {
+        skipSpace();
+        return pos_ < data_.size() && data_[pos_] == c;
+    }
+
+    // 返回引号之间的原文，pos_ 移到结束引号之后
+    bool parseString(std::string_view& out) {
+        if (pos_ >= data_.size() || data_[pos_] != '"') return false;
+        size_t begin = ++pos_;
+        while (pos_ < data_.size() && data_[pos_] != '"') {
+            pos_ += data_[pos_] == '\\' ? 2 : 1;
+        }
+        if (pos_ >= data_.size()) return false;
+        out = data_.substr(begin, pos_ - begin);
+        ++pos_;
+        return true;
+    }
+
+    bool parseValue(int depth) {
+        if (depth > kMaxJsonDepth || pos_ >= data_.size()) return false;
+        char c = data_[pos_];
+        if (c == '{' || c == '[') {
+            return parseContainer(depth, c == '[');
+        }
+        if (c == '"') {
+            std::string_view value;
+            if (!parseString(value)) return false;
+            sink_(path_, value);
+            return true;
+        }
+        // 数字、true、false、null
+        size_t begin = pos_;
+        while (pos_ < data_.size() && !isSpace(data_[pos_]) && data_[pos_] != ',' &&
+               data_[pos_] != '}' && data_[pos_] != ']') {
+            ++pos_;
+        }
+        if (pos_ == begin) return false;
+        sink_(path_, data_.substr(begin, pos_ - begin));
+        return true;
+    }
+
+    bool parseContainer(int depth, bool array) {
+        size_t begin = pos_++;
+        char close = array ? ']' : '}';
+        if (peek(close)) {
+            ++pos_;
+            sink_(path_, data_.substr(begin, pos_ - begin));
+            return true;
+        }
+        size_t base = path_.size();
+        for (size_t index = 0;; ++index) {
+            skipSpace();
+            if (array) {
+                path_.append("[").append(std::to_string(index)).append("]");
+            } else {
+                std::string_view name;
+                if (!parseString(name) || !peek(':')) return false;
+                ++pos_;
+                if (base > 0) path_.push_back('.');
+                path_.append(name);
+            }
+            skipSpace();
+            if (!parseValue(depth + 1)) return false;
+            path_.resize(base);
+            skipSpace();
+            if (pos_ >= data_.size()) return false;
+            if (data_[pos_] == ',') {
+                ++pos_;
+                continue;
+            }
+            if (data_[pos_] != close) return false;
+            ++pos_;
+            return true;
+        }
+    }
+};
+
+}
+
+ConfigFormat configtracker::detectFormat(std::string_view path, std::string_view data) {
+    if (endsWith(path, ".json")) return ConfigFormat::Json;
+    if (endsWith(path, ".ini")) return ConfigFormat::Ini;
+    for (std::string_view ext : {".conf", ".cfg", ".cnf", ".properties", ".env"}) {
+        if (endsWith(path, ext)) return ConfigFormat::KeyValue;
+    }
+    std::string_view head = trim(data.substr(0, 64));
+    if (!head.empty() && head.front() == '{') return ConfigFormat::Json;
+    return ConfigFormat::Unknown;
+}
+
+bool configtracker::parseConfig(ConfigFormat format, std::string_view data, const KeyValueSink& sink) {
+    switch (format) {
+    case ConfigFormat::KeyValue:
+    case ConfigFormat::Ini:
+        return parseKeyValue(data, sink);
+    case ConfigFormat::Json:
+        return JsonParser(data, sink).parse();
+    case ConfigFormat::Unknown:
+        break;
+    }
+    return false;
+}
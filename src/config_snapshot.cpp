@@ -0,0 +1,243 @@
+#include "configtracker/config_snapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+using namespace configtracker;
+
+namespace {
+
+std::string oidKey(const git_oid& oid) {
+    return std::string(reinterpret_cast<const char*>(oid.id), GIT_OID_RAWSZ);
+}
+
+}
+
+BlobStore::BlobStore(Reader reader) : reader_(std::move(reader)) {}
+
+BlobPtr BlobStore::get(const git_oid& oid) {
+    std::string key = oidKey(oid);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = blobs_.find(key);
+    if (it != blobs_.end()) {
+        if (BlobPtr blob = it->second.lock()) return blob;
+    }
+    auto blob = std::make_shared<Blob>();
+    git_oid_cpy(&blob->oid, &oid);
+    if (!reader_ || !reader_(oid, blob->data)) {
+        return nullptr;
+    }
+    blobs_[key] = blob;
+    if (blobs_.size() >= sweepAt_) {
+        sweepLocked();
+    }
+    return blob;
+}
+
+size_t BlobStore::liveCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sweepLocked();
+    return blobs_.size();
+}
+
+void BlobStore::sweepLocked() {
+    // 已没有快照引用的条目清掉，下一次在存活数的两倍时再清理
+    for (auto it = blobs_.begin(); it != blobs_.end();) {
+        if (it->second.expired()) {
+            it = blobs_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    sweepAt_ = std::max<size_t>(1024, blobs_.size() * 2);
+}
+
+ConfigSnapshot::Entry::Entry(const Entry& other)
+    : blob(std::atomic_load(&other.blob)), removed(other.removed) {
+    // 源条目可能正被读者延迟加载，内容指针需要原子读取
+    git_oid_cpy(&oid, &other.oid);
+}
+
+std::shared_ptr<const ConfigSnapshot> ConfigSnapshot::build(std::string commit, const std::vector<TreeFile>& files,
+                                                            const ConfigSnapshot* previous,
+                                                            const std::shared_ptr<BlobStore>& store, bool eager) {
+    std::shared_ptr<ConfigSnapshot> snapshot(new ConfigSnapshot());
+    snapshot->commit_ = std::move(commit);
+    snapshot->store_ = store;
+    auto table = std::make_shared<Table>();
+    table->reserve(files.size());
+    for (const TreeFile& file : files) {
+        Entry entry;
+        git_oid_cpy(&entry.oid, &file.oid);
+        if (previous) {
+            const Entry* old = previous->lookup(file.path);
+            if (old && git_oid_equal(&old->oid, &file.oid)) {
+                entry.blob = std::atomic_load(&old->blob);
+            }
+        }
+        if (!entry.blob && eager && store) {
+            entry.blob = store->get(file.oid);
+        }
+        table->emplace(file.path, std::move(entry));
+    }
+    snapshot->size_ = table->size();
+    snapshot->base_ = std::move(table);
+    return snapshot;
+}
+
+std::shared_ptr<const ConfigSnapshot> ConfigSnapshot::derive(std::string commit, const ConfigSnapshot& previous,
+                                                             const std::vector<TreeFile>& changed,
+                                                             const std::vector<std::string>& removed,
+                                                             const std::shared_ptr<BlobStore>& store, bool eager) {
+    std::shared_ptr<ConfigSnapshot> snapshot(new ConfigSnapshot());
+    snapshot->commit_ = std::move(commit);
+    snapshot->store_ = store;
+    snapshot->base_ = previous.base_;
+    snapshot->overlay_ = Table(previous.overlay_);
+    snapshot->size_ = previous.size_;
+
+    for (const TreeFile& file : changed) {
+        const Entry* old = snapshot->lookup(file.path);
+        Entry entry;
+        git_oid_cpy(&entry.oid, &file.oid);
+        if (old && git_oid_equal(&old->oid, &file.oid)) {
+            entry.blob = std::atomic_load(&old->blob);
+        } else if (eager && store) {
+            entry.blob = store->get(file.oid);
+        }
+        if (!old) ++snapshot->size_;
+        snapshot->overlay_.erase(file.path);
+        snapshot->overlay_.emplace(file.path, std::move(entry));
+    }
+    for (const std::string& path : removed) {
+        if (!snapshot->lookup(path)) continue;
+        --snapshot->size_;
+        snapshot->overlay_.erase(path);
+        if (snapshot->base_ && snapshot->base_->count(path)) {
+            Entry tombstone;
+            std::memset(&tombstone.oid, 0, sizeof(tombstone.oid));
+            tombstone.removed = true;
+            snapshot->overlay_.emplace(path, std::move(tombstone));
+        }
+    }
+
+    size_t baseSize = snapshot->base_ ? snapshot->base_->size() : 0;
+    size_t limit = std::max<size_t>(64, static_cast<size_t>(std::sqrt(static_cast<double>(baseSize))));
+    if (snapshot->overlay_.size() > limit) {
+        snapshot->flatten();
+    }
+    return snapshot;
+}
+
+void ConfigSnapshot::flatten() {
+    auto table = std::make_shared<Table>();
+    table->reserve(size_);
+    if (base_) {
+        for (const auto& item : *base_) {
+            if (!overlay_.count(item.first)) table->emplace(item.first, item.second);
+        }
+    }
+    for (const auto& item : overlay_) {
+        if (!item.second.removed) table->emplace(item.first, item.second);
+    }
+    base_ = std::move(table);
+    overlay_.clear();
+}
+
+const ConfigSnapshot::Entry* ConfigSnapshot::lookup(const std::string& path) const {
+    auto it = overlay_.find(path);
+    if (it != overlay_.end()) {
+        return it->second.removed ? nullptr : &it->second;
+    }
+    if (!base_) return nullptr;
+    auto found = base_->find(path);
+    return found == base_->end() ? nullptr : &found->second;
+}
+
+const ConfigSnapshot::Entry* ConfigSnapshot::find(const std::string& path) const {
+    const Entry* entry = lookup(path);
+    if (!entry && !path.empty() && path.front() == '/') {
+        // Direct 模式下仓库内路径是绝对路径去掉开头的 '/'
+        size_t start = path.find_first_not_of('/');
+        if (start != std::string::npos) {
+            entry = lookup(path.substr(start));
+        }
+    }
+    return entry;
+}
+
+bool ConfigSnapshot::contains(const std::string& path) const {
+    return find(path) != nullptr;
+}
+
+BlobPtr ConfigSnapshot::get(const std::string& path) const {
+    const Entry* entry = find(path);
+    if (!entry) return nullptr;
+    BlobPtr blob = std::atomic_load(&entry->blob);
+    if (blob) return blob;
+
+    // 第一次读取：从对象库加载后发布。并发加载时以先发布的为准，
+    // 已发布的指针不再改变，之前返回的视图一直有效
+    std::shared_ptr<BlobStore> store = store_.lock();
+    if (!store) return nullptr;
+    BlobPtr loaded = store->get(entry->oid);
+    if (!loaded) return nullptr;
+    BlobPtr expected;
+    if (!std::atomic_compare_exchange_strong(&entry->blob, &expected, loaded)) {
+        return expected;
+    }
+    return loaded;
+}
+
+bool ConfigSnapshot::read(const std::string& path, std::string_view& out) const {
+    BlobPtr blob = get(path);
+    if (!blob) return false;
+    // 快照持有这份内容，视图在快照释放前有效
+    out = std::string_view(blob->data);
+    return true;
+}
+
+std::vector<std::string> ConfigSnapshot::paths() const {
+    std::vector<std::string> result;
+    result.reserve(size_);
+    if (base_) {
+        for (const auto& item : *base_) {
+            if (!overlay_.count(item.first)) result.push_back(item.first);
+        }
+    }
+    for (const auto& item : overlay_) {
+        if (!item.second.removed) result.push_back(item.first);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+SnapshotPtr SnapshotCache::get(const std::string& commit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = byCommit_.find(commit);
+    if (it == byCommit_.end()) return nullptr;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return *it->second;
+}
+
+void SnapshotCache::put(const SnapshotPtr& snapshot) {
+    if (!snapshot || capacity_ == 0) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = byCommit_.find(snapshot->commit());
+    if (it != byCommit_.end()) {
+        lru_.erase(it->second);
+    }
+    lru_.push_front(snapshot);
+    byCommit_[snapshot->commit()] = lru_.begin();
+    while (lru_.size() > capacity_) {
+        byCommit_.erase(lru_.back()->commit());
+        lru_.pop_back();
+    }
+}
+
+size_t SnapshotCache::size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lru_.size();
+}
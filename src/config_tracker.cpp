@@ -1,81 +1,869 @@
 #include "configtracker/config_tracker.h"
 #include "configtracker/git_repo_manager.h"  
 #include "configtracker/file_watcher.h"      
+#include "configtracker/content_hash.h"
+#include "configtracker/mapped_file.h"
+#include "configtracker/logger.h"
 
-#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <iomanip>
+#include <cerrno>
+#include <unordered_map>
+#include <unordered_set>
 
 
 using namespace configtracker;
 
+namespace {
+
+std::string absolutePath(const std::string& path) {
+    std::error_code ec;
+    return std::filesystem::absolute(path, ec).lexically_normal().generic_string();
+}
+
+// root 本身或其下的路径
+bool underRoot(std::string_view path, const std::string& root) {
+    if (path.compare(0, root.size(), root) != 0) return false;
+    return path.size() == root.size() || root.back() == '/' || path[root.size()] == '/';
+}
+
+// 分片查询的结果与同一次索引读取得到的提交时间合在一起
+void appendShardCommits(std::vector<ShardCommit>& out, const std::string& shard,
+                        std::vector<std::string>& hashes, const std::vector<int64_t>& times) {
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        out.push_back(ShardCommit{shard, std::move(hashes[i]), times[i]});
+    }
+}
+
+}
+
 ConfigTracker::ConfigTracker(const TrackConfig& config)
     : config_(config), running_(false) {
-    std::cout << "[Init] ConfigTracker initialized.\n";
+    // 先应用日志配置，之后的每一行（包括这一行）都按配置的级别和文件输出
+    Logger::setLevel(config_.logLevel);
+    if (!config_.logFile.empty()) {
+        Logger::instance().setFile(config_.logFile);
+    }
+    CT_LOG(Info) << "[Init] ConfigTracker initialized.";
 }
 
-// src/config_tracker.cpp
 void ConfigTracker::start() {
-    std::cout << "[Start] Monitoring started.\n";
+    CT_LOG(Info) << "[Start] Monitoring started.";
     running_ = true;
-    // 初始化Git仓库管理器
-    git_ = std::make_unique<GitRepoManager>(config_.repoRoot);
-    git_->init();
+    // 初始化各分片的Git仓库管理器，非分片模式只有 repoRoot 一个
+    createShards();
+    for (auto& shard : shards_) {
+        shard->git = std::make_unique<GitRepoManager>(shard->repoPath, std::chrono::seconds(1), config_.ingestMode);
+        shard->git->setKeyDiffEnabled(config_.keyDiff);
+        ChunkingOptions chunking;
+        chunking.threshold = config_.largeFileChunkKB << 10;
+        shard->git->setChunking(chunking);
+        shard->git->init();
+        GitRepoManager* git = shard->git.get();
+        shard->blobs = std::make_shared<BlobStore>([git](const git_oid& oid, std::string& out) {
+            return git->readBlob(oid, out);
+        });
+        shard->snapshotCache = std::make_unique<SnapshotCache>(config_.snapshotCacheSize);
+        shard->history = std::make_unique<HistoryReader>(*git, config_.historyTreeCacheSize,
+                                                         config_.historyBlobCacheMB << 20);
+        // 启动时不列出整个树，第一个快照在第一次读取或第一次提交时生成
+        if (config_.packMaintenance) {
+            MaintenanceOptions maintenance;
+            maintenance.interval = std::chrono::minutes(std::max(config_.maintenanceIntervalMinutes, 1));
+            maintenance.cpuPercent = config_.maintenanceCpuPercent;
+            maintenance.ioBytesPerSec = static_cast<uint64_t>(std::max(config_.maintenanceIoMBps, 0)) << 20;
+            shard->git->startMaintenance(maintenance);
+        }
+    }
     
     // 初始化文件监控器
-    watcher_ = std::make_unique<FileWatcher>();
+    WatchOptions watchOptions;
+    watchOptions.backend = config_.watchBackend;
+    watchOptions.pollInterval = std::chrono::milliseconds(config_.pollIntervalMs);
+    if (!config_.stateFile.empty()) {
+        watchOptions.stateFile = config_.stateFile;
+    } else if (config_.sharding == ShardMode::None) {
+        watchOptions.stateFile = config_.repoRoot + "/.git/configtracker/watcher.state";
+    } else {
+        watchOptions.stateFile = config_.repoRoot + "/watcher.state";
+    }
+    watchOptions.recursive = config_.recursive;
+    watchOptions.includePatterns = config_.includePatterns;
+    watchOptions.excludePatterns = config_.excludePatterns;
+    watchOptions.scanThreads = config_.scanThreads > 0 ? static_cast<size_t>(config_.scanThreads) : 1;
+    watcher_ = std::make_unique<FileWatcher>(watchOptions);
     // 添加所有监控路径
     for (const auto& path : config_.watchPaths) {
         watcher_->addWatch(path);
     }
     
+    // 日志模式：变更在监控线程中直接追加到日志，由后台线程按节奏合并为提交；
+    // 上次退出前未合并的变更在打开日志时回放，第一轮就会提交
+    bool journaling = config_.enableAutoCommit && config_.storage == StorageMode::Journal;
+    if (journaling) {
+        for (auto& shard : shards_) {
+            shard->journal = std::make_unique<ChangeJournal>();
+            if (!shard->journal->open(shard->repoPath + "/.git/configtracker/journal")) {
+                CT_LOG(Error) << "Error: Cannot open change journal for " << shard->repoPath;
+                shard->journal.reset();
+            }
+        }
+        journalStop_ = false;
+        journalThread_ = std::thread(&ConfigTracker::journalLoop, this);
+    }
+    
+    // 变更经无锁队列交给提交线程，合并后一批只生成一次提交，监控线程不等待 git。
+    // 每个分片有自己的提交线程，不同分片的提交并行执行
+    if (config_.enableAutoCommit && !journaling) {
+        for (auto& shard : shards_) {
+            Shard* target = shard.get();
+            shard->batcher = std::make_unique<CommitBatcher>(
+                std::chrono::milliseconds(config_.batchQuietMs),
+                std::chrono::milliseconds(config_.batchMaxLatencyMs),
+                [this, target](const std::vector<std::string>& paths) { commitBatch(*target, paths); },
+                config_.commitQueueCapacity, config_.backpressure);
+            shard->batcher->start();
+        }
+    }
+    
     // 启动监控并设置回调函数
-    watcher_->startWatching([this](std::string changedPath) {
-        if (config_.enableAutoCommit) {
-            git_->addFile(changedPath);
-            git_->commit("Auto commit: " + changedPath + " changed");
+    watcher_->startWatching([this](const std::string& changedPath) {
+        Shard& shard = shardFor(changedPath);
+        if (shard.journal) {
+            journalChange(shard, changedPath);
+        } else if (shard.batcher) {
+            shard.batcher->enqueue(changedPath);
         }
     });
     
-    // 延迟清理旧提交，仅当已有提交时执行
+    // 历史压缩在后台分片执行，启动时不再遍历整个历史；
+    // 上次检查的时间记录在各仓库的检查点中，重启后按剩余间隔等待
     if (config_.retentionDays > 0) {
-        // 检查是否有任何提交
-        auto commits = git_->listCommits();
-        if (!commits.empty()) {
-            cleanOld();
-        } else {
-            std::cout << "[Clean] Skipping cleanup as repository has no commits yet.\n";
+        retentionThread_ = std::thread(&ConfigTracker::retentionLoop, this);
+    }
+    
+    if (!config_.metricsDumpPath.empty()) {
+        metricsThread_ = std::thread(&ConfigTracker::metricsLoop, this);
+    }
+}
+
+void ConfigTracker::createShards() {
+    shards_.clear();
+    auto repoFor = [this](const std::string& name) {
+        return (std::filesystem::path(config_.repoRoot) / "shards" / name).string();
+    };
+    if (config_.sharding == ShardMode::PerWatchRoot && !config_.watchPaths.empty()) {
+        for (const auto& path : config_.watchPaths) {
+            // 目录名加上路径哈希，不同位置的同名目录不会落到同一个仓库
+            std::string root = absolutePath(path);
+            while (root.size() > 1 && root.back() == '/') root.pop_back();
+            std::string base = std::filesystem::path(root).filename().string();
+            if (base.empty()) base = "root";
+            std::ostringstream name;
+            name << base << "-" << std::hex << std::setw(8) << std::setfill('0')
+                 << (xxhash64(root.data(), root.size()) & 0xffffffffULL);
+            auto shard = std::make_unique<Shard>();
+            shard->name = name.str();
+            shard->repoPath = repoFor(shard->name);
+            shard->root = root;
+            shards_.push_back(std::move(shard));
+        }
+        // 较长的根目录优先匹配，嵌套的监控目录归属最近的根
+        std::stable_sort(shards_.begin(), shards_.end(), [](const auto& a, const auto& b) {
+            return a->root.size() > b->root.size();
+        });
+    } else if (config_.sharding == ShardMode::HashBucket) {
+        size_t count = config_.shardCount > 0 ? static_cast<size_t>(config_.shardCount)
+                                              : std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < count; ++i) {
+            auto shard = std::make_unique<Shard>();
+            shard->name = "bucket-" + std::to_string(i);
+            shard->repoPath = repoFor(shard->name);
+            shards_.push_back(std::move(shard));
+        }
+    } else {
+        auto shard = std::make_unique<Shard>();
+        shard->repoPath = config_.repoRoot;
+        shards_.push_back(std::move(shard));
+    }
+    if (shards_.size() > 1) {
+        CT_LOG(Info) << "[Start] " << shards_.size() << " repository shards under " << config_.repoRoot;
+    }
+}
+
+ConfigTracker::Shard& ConfigTracker::shardFor(const std::string& path) const {
+    if (shards_.size() == 1) {
+        return *shards_.front();
+    }
+    // 监控线程上报的通常已是规范化的绝对路径，直接使用，不分配内存
+    std::string absolute;
+    std::string_view view = path;
+    if (!isNormalAbsolutePath(view)) {
+        absolute = absolutePath(path);
+        view = absolute;
+    }
+    if (config_.sharding == ShardMode::HashBucket) {
+        return *shards_[xxhash64(view.data(), view.size()) % shards_.size()];
+    }
+    for (const auto& shard : shards_) {
+        if (underRoot(view, shard->root)) {
+            return *shard;
+        }
+    }
+    return *shards_.back();
+}
+
+ConfigTracker::Shard* ConfigTracker::shardOf(const std::string& hash) const {
+    for (const auto& shard : shards_) {
+        if (shard->git && shard->git->findCommit(hash)) {
+            return shard.get();
+        }
+    }
+    return nullptr;
+}
+
+void ConfigTracker::retentionLoop() {
+    auto slice = std::chrono::milliseconds(std::max(config_.retentionSliceMs, 1));
+    auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::minutes(std::max(config_.retentionIntervalMinutes, 1)));
+    std::unique_lock<std::mutex> lock(retentionMutex_);
+    while (running_) {
+        lock.unlock();
+        // 每个分片各执行一个时间片，全部完成后才进入长间隔；还没到检查时间的分片跳过
+        bool done = true;
+        auto next = interval;
+        for (auto& shard : shards_) {
+            if (!running_) break;
+            auto delay = shard->git->retentionDelay(interval);
+            if (delay.count() > 0) {
+                next = std::min(next, delay);
+                continue;
+            }
+            if (shard->git->compactHistoryStep(config_.retentionDays, slice)) {
+                // 压缩改写了提交哈希，树不变，快照中的内容全部复用
+                publishSnapshot(*shard);
+            } else {
+                done = false;
+            }
+        }
+        lock.lock();
+        // 未完成时短暂让出仓库锁，让提交可以穿插进来；完成后等到最早需要检查的分片
+        auto wait = done ? next : slice;
+        retentionCv_.wait_for(lock, wait, [this] { return !running_; });
+    }
+}
+
+void ConfigTracker::metricsLoop() {
+    auto interval = std::chrono::milliseconds(std::max(config_.metricsDumpIntervalMs, 100));
+    std::unique_lock<std::mutex> lock(metricsMutex_);
+    while (true) {
+        metricsCv_.wait_for(lock, interval, [this] { return !running_; });
+        if (!running_) break;
+        lock.unlock();
+        MetricsRegistry::global().dumpPrometheus(config_.metricsDumpPath);
+        lock.lock();
+    }
+}
+
+MetricsSnapshot ConfigTracker::metrics() const {
+    return MetricsRegistry::global().snapshot();
+}
+
+SnapshotPtr ConfigTracker::snapshot() const {
+    if (shards_.empty()) {
+        return nullptr;
+    }
+    return currentSnapshot(*shards_.front());
+}
+
+SnapshotPtr ConfigTracker::snapshotFor(const std::string& path) const {
+    if (shards_.empty()) {
+        return nullptr;
+    }
+    return currentSnapshot(shardFor(path));
+}
+
+AsyncGitRepo* ConfigTracker::asyncRepo(const std::string& path) {
+    if (shards_.empty()) {
+        return nullptr;
+    }
+    Shard& shard = path.empty() ? *shards_.front() : shardFor(path);
+    std::call_once(shard.asyncOnce, [this, &shard]() {
+        size_t threads = static_cast<size_t>(std::max(config_.asyncReadThreads, 1));
+        shard.async = std::make_unique<AsyncGitRepo>(*shard.git, threads);
+    });
+    return shard.async.get();
+}
+
+SnapshotPtr ConfigTracker::snapshotAt(const std::string& hash) {
+    for (const auto& shard : shards_) {
+        SnapshotPtr current = std::atomic_load(&shard->current);
+        if (current && current->commit() == hash) {
+            return current;
+        }
+        if (SnapshotPtr cached = shard->snapshotCache->get(hash)) {
+            return cached;
+        }
+    }
+    Shard* shard = shardOf(hash);
+    if (!shard) {
+        return nullptr;
+    }
+    std::vector<TreeFile> files;
+    std::string resolved;
+    if (!shard->git->listFiles(hash, files, &resolved)) {
+        return nullptr;
+    }
+    // 与最新快照相同的内容直接共享，其余的延迟加载
+    SnapshotPtr current = std::atomic_load(&shard->current);
+    SnapshotPtr result = ConfigSnapshot::build(resolved, files, current.get(), shard->blobs, false);
+    shard->snapshotCache->put(result);
+    return result;
+}
+
+std::vector<KeyChange> ConfigTracker::keyChanges(const std::string& hash) {
+    Shard* shard = shardOf(hash);
+    return shard ? shard->git->keyChanges(hash) : std::vector<KeyChange>();
+}
+
+std::vector<KeyChange> ConfigTracker::keyHistory(const std::string& path, const std::string& key, size_t limit) {
+    if (shards_.empty()) {
+        return {};
+    }
+    return shardFor(path).git->keyHistory(path, key, limit);
+}
+
+BlobPtr ConfigTracker::readAt(const std::string& path, std::chrono::system_clock::time_point at,
+                              std::string* commit) {
+    if (shards_.empty()) {
+        return nullptr;
+    }
+    return shardFor(path).history->readAt(path, at, commit);
+}
+
+std::vector<FileDiff> ConfigTracker::diffBetween(std::chrono::system_clock::time_point from,
+                                                 std::chrono::system_clock::time_point to) {
+    std::vector<FileDiff> result;
+    for (const auto& shard : shards_) {
+        std::vector<FileDiff> diffs;
+        if (!shard->history->diffBetween(from, to, diffs)) {
+            CT_LOG(Error) << "[History] Failed to diff shard " << shard->name;
+            continue;
+        }
+        for (auto& diff : diffs) {
+            diff.shard = shard->name;
+            result.push_back(std::move(diff));
         }
     }
+    return result;
+}
+
+std::vector<ShardCommit> ConfigTracker::merge(std::vector<ShardCommit> commits, size_t limit) const {
+    // 各分片的结果已经从新到旧，合并后整体按时间排序，同一时间保持分片顺序
+    std::stable_sort(commits.begin(), commits.end(), [](const ShardCommit& a, const ShardCommit& b) {
+        return a.time > b.time;
+    });
+    if (limit > 0 && commits.size() > limit) {
+        commits.resize(limit);
+    }
+    return commits;
+}
+
+std::vector<ShardCommit> ConfigTracker::latestCommits(size_t count) {
+    std::vector<ShardCommit> result;
+    std::vector<int64_t> times;
+    for (const auto& shard : shards_) {
+        std::vector<std::string> hashes = shard->git->latestCommits(count, &times);
+        appendShardCommits(result, shard->name, hashes, times);
+    }
+    return merge(std::move(result), count);
 }
 
+std::vector<ShardCommit> ConfigTracker::commitsBetween(std::chrono::system_clock::time_point from,
+                                                       std::chrono::system_clock::time_point to) {
+    std::vector<ShardCommit> result;
+    std::vector<int64_t> times;
+    for (const auto& shard : shards_) {
+        std::vector<std::string> hashes = shard->git->commitsBetween(from, to, &times);
+        appendShardCommits(result, shard->name, hashes, times);
+    }
+    return merge(std::move(result), 0);
+}
+
+std::vector<ShardCommit> ConfigTracker::commitsTouching(const std::string& path, size_t limit) {
+    std::vector<ShardCommit> result;
+    if (shards_.empty()) {
+        return result;
+    }
+    Shard& shard = shardFor(path);
+    std::vector<int64_t> times;
+    std::vector<std::string> hashes = shard.git->commitsTouching(path, limit, &times);
+    appendShardCommits(result, shard.name, hashes, times);
+    return result;
+}
+
+std::vector<std::string> ConfigTracker::shardRepos() const {
+    std::vector<std::string> result;
+    for (const auto& shard : shards_) {
+        result.push_back(shard->repoPath);
+    }
+    return result;
+}
+
+SnapshotPtr ConfigTracker::currentSnapshot(Shard& shard) const {
+    SnapshotPtr current = std::atomic_load(&shard.current);
+    if (!current) {
+        // 启动后第一次读取：只列出文件，内容在读取时再加载
+        publishSnapshot(shard, false);
+        current = std::atomic_load(&shard.current);
+    }
+    return current;
+}
 
+void ConfigTracker::publishSnapshot(Shard& shard, bool eager) const {
+    std::lock_guard<std::mutex> lock(shard.publishMutex);
+    if (!shard.git) return;
+    SnapshotPtr previous = std::atomic_load(&shard.current);
+    SnapshotPtr next;
+    std::string head;
+    if (previous) {
+        // 通常只隔着刚生成的一次提交：在上一个快照上替换这些提交改动的文件，不列出整个树
+        std::vector<TreeFile> changed;
+        std::vector<std::string> removed;
+        if (shard.git->changesSince(previous->commit(), head, changed, removed)) {
+            if (head == previous->commit()) return;
+            next = ConfigSnapshot::derive(head, *previous, changed, removed, shard.blobs, eager);
+        }
+    }
+    if (!next) {
+        // 还没有快照，或者历史被压缩、改写：列出整个树，未变化的文件沿用上一个快照的内容。
+        // 没有上一个快照时不预先加载，内容在第一次读取时才从对象库读取
+        std::vector<TreeFile> files;
+        if (!shard.git->listFiles("", files, &head)) return;
+        if (previous && previous->commit() == head) return;
+        next = ConfigSnapshot::build(head, files, previous.get(), shard.blobs, eager && previous);
+    }
+    std::atomic_store(&shard.current, next);
+}
 
-// 此处删除重复的 stop 方法定义，保留后面完整的版本
-// src/config_tracker.cpp
 void ConfigTracker::cleanOld() {
-    std::cout << "[Clean] Old commits cleanup triggered.\n";
-    if (git_) {
-        git_->squashCommitsOlderThan(config_.retentionDays);
+    CT_LOG(Info) << "[Clean] Old commits cleanup triggered.";
+    for (auto& shard : shards_) {
+        shard->git->squashCommitsOlderThan(config_.retentionDays);
+        publishSnapshot(*shard);
+    }
+}
+
+void ConfigTracker::commitBatch(Shard& shard, const std::vector<std::string>& batch) {
+    // 上一批失败的文件与这一批一起重试
+    const std::vector<std::string>* pending = &batch;
+    std::vector<std::string> merged;
+    if (!shard.retryPaths.empty()) {
+        merged.swap(shard.retryPaths);
+        std::unordered_set<std::string> seen(merged.begin(), merged.end());
+        for (const auto& path : batch) {
+            if (seen.insert(path).second) merged.push_back(path);
+        }
+        pending = &merged;
+    }
+    const std::vector<std::string>& paths = *pending;
+    
+    SnapshotPtr before = snapshotForNotify(shard);
+    std::vector<std::string> failed;
+    shard.git->addFiles(paths, &failed);
+    // 批次里只有从未提交过的文件被删除（编辑器的临时文件）时没有可提交的内容，不创建空提交
+    if (failed.empty() && !shard.git->hasStagedChanges()) {
+        watcher_->markCommitted(paths);
+        return;
+    }
+    
+    // 提交信息首行概括本批次，正文列出全部文件
+    std::ostringstream message;
+    if (paths.size() == 1) {
+        message << "Auto commit: " << paths.front() << " changed";
+    } else {
+        message << "Auto commit: " << paths.size() << " files changed\n\n";
+        for (const auto& path : paths) {
+            message << path << "\n";
+        }
+    }
+    // 失败时不发布、不通知，也不把文件记为已提交：它们在下一批重试，进程重启后也会重新上报
+    std::string commit;
+    int64_t time = 0;
+    if (!shard.git->commit(message.str(), &commit, &time)) {
+        CT_LOG(Error) << "Error: Auto commit failed, " << paths.size() << " files will be retried";
+        shard.retryPaths = paths;
+        return;
+    }
+    const std::vector<std::string>* done = &paths;
+    std::vector<std::string> committed;
+    if (!failed.empty()) {
+        CT_LOG(Error) << "Error: " << failed.size() << " files could not be staged and will be retried";
+        std::unordered_set<std::string> skip(failed.begin(), failed.end());
+        for (const auto& path : paths) {
+            if (!skip.count(path)) committed.push_back(path);
+        }
+        shard.retryPaths = std::move(failed);
+        done = &committed;
+    }
+    publishSnapshot(shard);
+    notifySubscribers(shard, before, *done, commit, time);
+    
+    // 已提交的文件状态可以持久化，重启后不再重复上报
+    watcher_->markCommitted(*done);
+    watcher_->saveState();
+}
+
+void ConfigTracker::journalChange(Shard& shard, const std::string& path) {
+    // 在监控线程上调用，每个线程复用一个缓冲区
+    thread_local std::string content;
+    if (readFile(path, content)) {
+        shard.journal->append(path, content);
+    } else if (errno == ENOENT) {
+        shard.journal->appendRemove(path);
+    } else {
+        CT_LOG(Error) << "Error: Cannot read changed file: " << path;
+    }
+    if (content.capacity() > kReadBufferKeepBytes) {
+        std::string().swap(content);
+    }
+}
+
+void ConfigTracker::foldJournal(Shard& shard) {
+    if (!shard.journal) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(shard.foldMutex);
+    std::vector<FileContent> files;
+    uint64_t token = 0;
+    if (!shard.journal->beginFold(files, token)) {
+        return;
+    }
+    ScopedTimer timer(CoreMetrics::get().journalFold);
+    SnapshotPtr before = snapshotForNotify(shard);
+    std::vector<std::string> paths;
+    for (const auto& file : files) {
+        paths.push_back(file.path);
+    }
+    
+    // 同一文件在两次合并之间的多次改写只保留最终内容
+    std::vector<std::string> failed;
+    size_t changed = shard.git->addContents(files, &failed);
+    // 上一次合并提交失败时暂存的内容还在索引中，这次没有新变化也要提交
+    if (changed > 0 || shard.git->hasStagedChanges()) {
+        std::ostringstream message;
+        message << "Journal fold: " << (changed > 0 ? changed : files.size()) << " files changed\n\n";
+        for (const auto& file : files) {
+            message << file.path << "\n";
+        }
+        std::string commit;
+        int64_t time = 0;
+        if (!shard.git->commit(message.str(), &commit, &time)) {
+            CT_LOG(Error) << "Error: Journal fold commit failed, keeping segments for the next fold";
+            return;
+        }
+        publishSnapshot(shard);
+        notifySubscribers(shard, before, paths, commit, time);
+    }
+    // 有文件没能写入仓库时保留日志段，下一次合并再次取出这些路径；已提交的文件内容相同，会被跳过
+    if (!failed.empty()) {
+        CT_LOG(Error) << "Error: " << failed.size() << " journaled files could not be staged, keeping segments";
+        return;
+    }
+    // 提交已写入仓库，合并过的日志段可以删除
+    shard.journal->finishFold(token);
+    
+    watcher_->markCommitted(paths);
+    watcher_->saveState();
+}
+
+void ConfigTracker::journalLoop() {
+    auto fold = std::chrono::milliseconds(std::max(config_.journalFoldMs, 1));
+    auto sync = std::chrono::milliseconds(config_.journalSyncMs);
+    auto nextFold = std::chrono::steady_clock::now();
+    auto nextSync = nextFold + sync;
+    std::unique_lock<std::mutex> lock(journalMutex_);
+    while (!journalStop_) {
+        auto now = std::chrono::steady_clock::now();
+        bool doFold = now >= nextFold;
+        bool doSync = sync.count() > 0 && now >= nextSync;
+        lock.unlock();
+        for (auto& shard : shards_) {
+            if (!shard->journal) continue;
+            if (doFold) {
+                foldJournal(*shard);
+            } else if (doSync) {
+                shard->journal->sync();
+            }
+        }
+        lock.lock();
+        now = std::chrono::steady_clock::now();
+        if (doFold) nextFold = now + fold;
+        if (doFold || doSync) nextSync = now + sync;
+        auto wake = sync.count() > 0 ? std::min(nextFold, nextSync) : nextFold;
+        journalCv_.wait_until(lock, wake, [this] { return journalStop_; });
     }
 }
 
 void ConfigTracker::manualCommit() {
-    std::cout << "[Manual] Commit triggered.\n";
-    if (git_) {
-        git_->commit("Manual commit");
+    CT_LOG(Info) << "[Manual] Commit triggered.";
+    for (auto& shard : shards_) {
+        // 先提交尚未到期的自动批次或日志中的变更
+        if (shard->batcher) {
+            shard->batcher->flush();
+        }
+        foldJournal(*shard);
+        shard->git->commit("Manual commit");
+        publishSnapshot(*shard);
     }
 }
 
 void ConfigTracker::stop() {
-    std::cout << "[Stop] Monitoring stopped.\n";
-    running_ = false;
+    CT_LOG(Info) << "[Stop] Monitoring stopped.";
+    {
+        std::lock_guard<std::mutex> lock(retentionMutex_);
+        running_ = false;
+    }
+    retentionCv_.notify_all();
+    if (retentionThread_.joinable()) {
+        retentionThread_.join();
+    }
+    for (auto& shard : shards_) {
+        if (shard->git) {
+            shard->git->stopMaintenance();
+        }
+    }
+    {
+        // 持有锁再通知，避免导出线程在检查 running_ 之后、等待之前错过通知
+        std::lock_guard<std::mutex> lock(metricsMutex_);
+    }
+    metricsCv_.notify_all();
     if (watcher_) {
         watcher_->stop();
     }
+    // 监控停止后把剩余变更提交掉
+    for (auto& shard : shards_) {
+        if (shard->batcher) {
+            shard->batcher->stop();
+        }
+    }
+    if (journalThread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(journalMutex_);
+            journalStop_ = true;
+        }
+        journalCv_.notify_all();
+        journalThread_.join();
+        for (auto& shard : shards_) {
+            foldJournal(*shard);
+        }
+    }
+    if (watcher_) {
+        watcher_->saveState(true);
+    }
+    // 停止时提交的变更也投递给订阅者，然后结束投递线程
+    std::vector<std::unique_ptr<Subscription>> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(subscribersMutex_);
+        subscribers.swap(subscribers_);
+        subscriberCount_ = 0;
+        keySubscriberCount_ = 0;
+    }
+    for (auto& subscriber : subscribers) {
+        subscriber->stop();
+    }
+    // 最后导出一次，包含停止时提交的剩余变更
+    if (metricsThread_.joinable()) {
+        metricsThread_.join();
+        MetricsRegistry::global().dumpPrometheus(config_.metricsDumpPath);
+    }
+    Logger::instance().flush();
 }
 
 void ConfigTracker::restoreTo(const std::string& hash) {
-    std::cout << "[Restore] Checkout to commit: " << hash << "\n";
-    if (git_) {
-        git_->checkoutCommit(hash);
+    restorePaths(hash, {});
+}
+
+bool ConfigTracker::restorePaths(const std::string& hash, const std::vector<std::string>& paths) {
+    CT_LOG(Info) << "[Restore] Restore to commit: " << hash;
+    // 提交只属于一个分片，恢复也只涉及该分片负责的文件
+    Shard* shard = shardOf(hash);
+    if (!shard) {
+        CT_LOG(Error) << "Error: Unknown commit " << hash;
+        return false;
+    }
+    // 先提交尚未到期的变更，恢复前的内容也留在历史中
+    if (shard->batcher) {
+        shard->batcher->flush();
+    }
+    foldJournal(*shard);
+    
+    std::vector<RestoreAction> actions;
+    if (!shard->git->planRestore(hash, paths, actions)) {
+        return false;
+    }
+    if (actions.empty()) {
+        CT_LOG(Info) << "[Restore] Files already match " << hash;
+        return true;
+    }
+    
+    // 恢复写入的文件（以及写入时的临时文件）不应再触发自动提交
+    std::vector<std::string> written;
+    for (const auto& action : actions) {
+        written.push_back(action.path);
+        written.push_back(GitRepoManager::restoreTempPath(action.path));
+    }
+    if (watcher_) {
+        watcher_->suppress(written);
+    }
+    SnapshotPtr before = snapshotForNotify(*shard);
+    std::string commit;
+    int64_t time = 0;
+    bool ok = shard->git->applyRestore(hash, actions, &commit, &time);
+    publishSnapshot(*shard);
+    std::vector<std::string> restored;
+    for (const auto& action : actions) {
+        restored.push_back(action.path);
+    }
+    notifySubscribers(*shard, before, restored, commit, time);
+    if (watcher_) {
+        watcher_->acknowledge(written);
+        watcher_->saveState();
+    }
+    return ok;
+}
+
+SubscriptionId ConfigTracker::subscribe(const SubscribeOptions& options, ChangeHandler handler) {
+    std::lock_guard<std::mutex> lock(subscribersMutex_);
+    SubscriptionId id = nextSubscription_++;
+    subscribers_.push_back(std::make_unique<Subscription>(id, options, std::move(handler)));
+    subscriberCount_ = subscribers_.size();
+    if (options.keyChanges) {
+        ++keySubscriberCount_;
+    }
+    CT_LOG(Info) << "[Subscribe] Subscription " << id << " added, " << options.prefixes.size() << " prefixes";
+    return id;
+}
+
+bool ConfigTracker::unsubscribe(SubscriptionId id) {
+    std::unique_ptr<Subscription> subscriber;
+    {
+        std::lock_guard<std::mutex> lock(subscribersMutex_);
+        auto it = std::find_if(subscribers_.begin(), subscribers_.end(),
+                               [id](const auto& s) { return s->id() == id; });
+        if (it == subscribers_.end()) {
+            return false;
+        }
+        subscriber = std::move(*it);
+        subscribers_.erase(it);
+        subscriberCount_ = subscribers_.size();
+        if (subscriber->wantsKeyChanges()) {
+            --keySubscriberCount_;
+        }
+    }
+    // 在锁外等待投递线程，不阻塞其他分片的发布
+    subscriber->stop();
+    CT_LOG(Info) << "[Subscribe] Subscription " << id << " removed";
+    return true;
+}
+
+SnapshotPtr ConfigTracker::snapshotForNotify(Shard& shard) const {
+    if (subscriberCount_.load() == 0) {
+        return nullptr;
+    }
+    return currentSnapshot(shard);
+}
+
+void ConfigTracker::notifySubscribers(Shard& shard, const SnapshotPtr& before,
+                                      const std::vector<std::string>& batchPaths,
+                                      const std::string& commit, int64_t time) {
+    if (subscriberCount_.load() == 0 || batchPaths.empty()) {
+        return;
+    }
+    SnapshotPtr snapshot = std::atomic_load(&shard.current);
+    if (!snapshot || snapshot->commit().empty() || (before && snapshot->commit() == before->commit())) {
+        return;
+    }
+
+    // 提交前后都不存在的文件（提交之前就被删除的临时文件）不投递，也不驻留路径 ID
+    std::vector<std::string> paths;
+    std::vector<std::string> repoPaths;
+    paths.reserve(batchPaths.size());
+    repoPaths.reserve(batchPaths.size());
+    for (const auto& path : batchPaths) {
+        std::string repoPath = shard.git->repoRelativePath(path);
+        if (!snapshot->contains(repoPath) && !(before && before->contains(repoPath))) {
+            continue;
+        }
+        paths.push_back(path);
+        repoPaths.push_back(std::move(repoPath));
+    }
+    if (paths.empty()) {
+        return;
+    }
+
+    // 批次在锁外构造：路径集中放在一块缓冲区，所有订阅者共享同一个批次
+    auto batch = std::make_shared<ChangeBatch>();
+    batch->shard = shard.name;
+    batch->commit = snapshot->commit();
+    batch->snapshot = snapshot;
+    // 其他线程在这之间又提交过时快照比 commit 新，这种少见的情况才查索引
+    if (batch->commit == commit) {
+        batch->time = time;
+    } else {
+        shard.git->findCommit(batch->commit, &batch->time);
+    }
+    size_t total = 0;
+    for (const auto& path : paths) {
+        total += path.size();
+    }
+    batch->buffer.reserve(total);
+    batch->files.resize(paths.size());
+    std::unordered_map<std::string, uint32_t> fileOf;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        batch->buffer.append(paths[i]);
+        batch->files[i].removed = !snapshot->contains(repoPaths[i]);
+        fileOf.emplace(repoPaths[i], static_cast<uint32_t>(i));
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        batch->files[i].path = std::string_view(batch->buffer).substr(offset, paths[i].size());
+        offset += paths[i].size();
+    }
+
+    // 键级变更按文件分组，每个文件记录自己的区间
+    if (config_.keyDiff && keySubscriberCount_.load() > 0) {
+        std::vector<KeyChange> changes = shard.git->keyChanges(batch->commit);
+        std::vector<uint32_t> owner(changes.size(), UINT32_MAX);
+        for (size_t k = 0; k < changes.size(); ++k) {
+            auto it = fileOf.find(changes[k].path);
+            if (it != fileOf.end()) {
+                owner[k] = it->second;
+                ++batch->files[it->second].keyCount;
+            }
+        }
+        uint32_t first = 0;
+        std::vector<uint32_t> cursor(paths.size());
+        for (size_t i = 0; i < paths.size(); ++i) {
+            batch->files[i].firstKey = cursor[i] = first;
+            first += batch->files[i].keyCount;
+        }
+        batch->keyChanges.resize(first);
+        for (size_t k = 0; k < changes.size(); ++k) {
+            if (owner[k] != UINT32_MAX) {
+                batch->keyChanges[cursor[owner[k]]++] = std::move(changes[k]);
+            }
+        }
+    }
+
+    // 发布者之间串行：每个订阅者的环形队列同一时刻只有一个生产者。offer 从不阻塞
+    std::lock_guard<std::mutex> lock(subscribersMutex_);
+    for (auto& file : batch->files) {
+        file.id = pathIds_.intern(file.path);
+    }
+    ChangeBatchPtr shared = std::move(batch);
+    for (auto& subscriber : subscribers_) {
+        subscriber->offer(shared);
     }
 }
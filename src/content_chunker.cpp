@@ -0,0 +1,95 @@
+#include "configtracker/content_chunker.h"
+#include "configtracker/content_hash.h"
+#include <array>
+#include <algorithm>
+
+using namespace configtracker;
+
+namespace {
+
+// gear 表由固定种子的 splitmix64 生成，改动它会让已有文件的块边界全部变化
+std::array<uint64_t, 256> makeGear() {
+    std::array<uint64_t, 256> table{};
+    uint64_t state = 0x436f6e6669675472ULL;
+    for (auto& value : table) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        value = z ^ (z >> 31);
+    }
+    return table;
+}
+
+const std::array<uint64_t, 256> kGear = makeGear();
+// 预先左移一位，两个字节一步时第一个字节直接加上
+const std::array<uint64_t, 256> kGearShifted = [] {
+    std::array<uint64_t, 256> table{};
+    for (size_t i = 0; i < table.size(); ++i) table[i] = kGear[i] << 1;
+    return table;
+}();
+
+// bits 个连续的 1，放在第 47 位以下：gear 哈希的第 k 位只取决于最近 k+1 个字节，
+// 掩码左移一位后仍在 64 位之内，两字节一步的判断与逐字节完全等价
+uint64_t maskOf(int bits) {
+    bits = std::clamp(bits, 1, 40);
+    return ((uint64_t(1) << bits) - 1) << (47 - bits);
+}
+
+int log2Floor(size_t value) {
+    int bits = 0;
+    while (value > 1) {
+        value >>= 1;
+        ++bits;
+    }
+    return bits;
+}
+
+// 返回从 p 开始的第一个块的长度
+size_t cutPoint(const unsigned char* p, size_t size, size_t minSize, size_t normalSize, size_t maxSize,
+                uint64_t maskS, uint64_t maskL) {
+    if (size <= minSize) return size;
+    size_t end = std::min(size, maxSize);
+    size_t normal = std::min(end, normalSize);
+    uint64_t maskSShifted = maskS << 1;
+    uint64_t maskLShifted = maskL << 1;
+    uint64_t fp = 0;
+    size_t i = minSize;
+    for (; i + 2 <= normal; i += 2) {
+        fp = (fp << 2) + kGearShifted[p[i]];
+        if ((fp & maskSShifted) == 0) return i + 1;
+        fp += kGear[p[i + 1]];
+        if ((fp & maskS) == 0) return i + 2;
+    }
+    for (; i + 2 <= end; i += 2) {
+        fp = (fp << 2) + kGearShifted[p[i]];
+        if ((fp & maskLShifted) == 0) return i + 1;
+        fp += kGear[p[i + 1]];
+        if ((fp & maskL) == 0) return i + 2;
+    }
+    return end;
+}
+
+}
+
+void configtracker::chunkContent(const char* data, size_t size, const ChunkingOptions& options,
+                                 std::vector<ContentChunk>& out) {
+    out.clear();
+    size_t minSize = std::max<size_t>(options.minSize, 64);
+    size_t maxSize = std::max(options.maxSize, minSize);
+    int bits = log2Floor(std::clamp(options.avgSize, minSize, maxSize));
+    size_t normalSize = size_t(1) << bits;
+    uint64_t maskS = maskOf(bits + 2);
+    uint64_t maskL = maskOf(bits - 2);
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    size_t offset = 0;
+    while (offset < size) {
+        size_t length = cutPoint(p + offset, size - offset, minSize, normalSize, maxSize, maskS, maskL);
+        ContentChunk chunk;
+        chunk.offset = offset;
+        chunk.length = length;
+        chunk.hash = xxhash64(data + offset, length);
+        out.push_back(chunk);
+        offset += length;
+    }
+}
@@ -0,0 +1,253 @@
+#include "configtracker/file_state_cache.h"
+#include "configtracker/content_hash.h"
+#include "configtracker/logger.h"
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace configtracker;
+
+namespace {
+
+// 状态文件格式：Header + Record[count] + 路径字符串区
+constexpr char kMagic[8] = {'C', 'T', 'S', 'T', 'A', 'T', 'E', '1'};
+
+struct Header {
+    char magic[8];
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t stringBytes;
+    uint64_t checksum;  // Record 区与字符串区的 XXH64
+};
+
+struct Record {
+    uint64_t size;
+    int64_t mtimeNs;
+    uint64_t inode;
+    uint64_t hash;
+    uint32_t pathOffset;
+    uint32_t pathLen;
+};
+
+}
+
+FileState& FileStateCache::stateFor(PathId id) {
+    if (id >= states_.size()) {
+        states_.resize(id + 1);
+    }
+    return states_[id];
+}
+
+bool FileStateCache::load() {
+    paths_.clear();
+    states_.clear();
+    liveCount_ = 0;
+    dirty_ = false;
+    if (statePath_.empty()) return false;
+
+    int fd = open(statePath_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+
+    size_t fileSize = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+
+    const char* base = static_cast<const char*>(mapped);
+    Header header;
+    std::memcpy(&header, base, sizeof(header));
+
+    size_t recordBytes = static_cast<size_t>(header.count) * sizeof(Record);
+    bool ok = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+              sizeof(Header) + recordBytes + header.stringBytes == fileSize &&
+              xxhash64(base + sizeof(Header), fileSize - sizeof(Header)) == header.checksum;
+
+    if (ok) {
+        const char* records = base + sizeof(Header);
+        const char* strings = records + recordBytes;
+        paths_.reserve(header.count);
+        states_.reserve(header.count);
+        for (uint32_t i = 0; i < header.count; ++i) {
+            Record rec;
+            std::memcpy(&rec, records + i * sizeof(Record), sizeof(rec));
+            if (static_cast<uint64_t>(rec.pathOffset) + rec.pathLen > header.stringBytes) {
+                ok = false;
+                break;
+            }
+            PathId id = paths_.intern(std::string_view(strings + rec.pathOffset, rec.pathLen));
+            FileState& state = stateFor(id);
+            if (!state.present) ++liveCount_;
+            state.present = true;
+            state.size = rec.size;
+            state.mtimeNs = rec.mtimeNs;
+            state.inode = rec.inode;
+            state.hash = rec.hash;
+        }
+    }
+
+    munmap(mapped, fileSize);
+    if (!ok) {
+        CT_LOG(Warn) << "Ignoring corrupt watcher state file: " << statePath_;
+        paths_.clear();
+        states_.clear();
+        liveCount_ = 0;
+    }
+    return ok;
+}
+
+bool FileStateCache::save() {
+    if (statePath_.empty()) return false;
+    if (!writeImage(encode())) {
+        dirty_ = true;
+        return false;
+    }
+    return true;
+}
+
+std::string FileStateCache::encode() {
+    std::vector<Record> records;
+    std::string strings;
+    records.reserve(liveCount_);
+    for (PathId id = 0; id < states_.size(); ++id) {
+        const FileState& state = states_[id];
+        if (!state.present || state.pending) continue;
+        std::string_view path = paths_.path(id);
+        Record rec{};
+        rec.size = state.size;
+        rec.mtimeNs = state.mtimeNs;
+        rec.inode = state.inode;
+        rec.hash = state.hash;
+        rec.pathOffset = static_cast<uint32_t>(strings.size());
+        rec.pathLen = static_cast<uint32_t>(path.size());
+        records.push_back(rec);
+        strings += path;
+    }
+
+    std::string body(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+    body += strings;
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.count = static_cast<uint32_t>(records.size());
+    header.stringBytes = strings.size();
+    header.checksum = xxhash64(body.data(), body.size());
+
+    std::string image(reinterpret_cast<const char*>(&header), sizeof(header));
+    image += body;
+    dirty_ = false;
+    return image;
+}
+
+bool FileStateCache::writeImage(const std::string& image) const {
+    if (statePath_.empty()) return false;
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(statePath_).parent_path(), ec);
+
+    std::string tmpPath = statePath_ + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        out.write(image.data(), static_cast<std::streamsize>(image.size()));
+        if (!out) {
+            CT_LOG(Error) << "Error writing watcher state file: " << tmpPath;
+            return false;
+        }
+    }
+    std::filesystem::rename(tmpPath, statePath_, ec);
+    if (ec) {
+        CT_LOG(Error) << "Error replacing watcher state file: " << ec.message();
+        return false;
+    }
+    return true;
+}
+
+FileChange FileStateCache::refresh(const std::string& path) {
+    struct stat st{};
+    if (stat(path.c_str(), &st) != 0) {
+        // 文件已被删除
+        PathId id = paths_.find(path);
+        if (id != kInvalidPathId && id < states_.size() && states_[id].present) {
+            states_[id] = FileState();
+            --liveCount_;
+            dirty_ = true;
+            compactIfSparse();
+            return FileChange::Removed;
+        }
+        return FileChange::Unchanged;
+    }
+    // 目录等非普通文件不跟踪
+    if (!S_ISREG(st.st_mode)) {
+        return FileChange::Unchanged;
+    }
+
+    int64_t mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    FileState& state = stateFor(paths_.intern(path));
+    bool known = state.present;
+
+    // 元数据完全一致，不需要读取内容
+    if (known && state.size == static_cast<uint64_t>(st.st_size) &&
+        state.mtimeNs == mtimeNs && state.inode == static_cast<uint64_t>(st.st_ino)) {
+        return FileChange::Unchanged;
+    }
+
+    uint64_t hash = 0;
+    if (!hashFile(path, hash)) {
+        return FileChange::Unchanged;
+    }
+
+    if (!known) {
+        state.present = true;
+        ++liveCount_;
+    }
+    bool contentChanged = !known || state.size != static_cast<uint64_t>(st.st_size) || state.hash != hash;
+    state.size = static_cast<uint64_t>(st.st_size);
+    state.mtimeNs = mtimeNs;
+    state.inode = static_cast<uint64_t>(st.st_ino);
+    state.hash = hash;
+    dirty_ = true;
+
+    if (!contentChanged) {
+        // 只有 mtime/inode 变化（touch、编辑器保存未修改的文件）
+        return FileChange::Unchanged;
+    }
+    state.pending = true;
+    return known ? FileChange::Modified : FileChange::Added;
+}
+
+void FileStateCache::compactIfSparse() {
+    // 删除的文件只清空状态，路径仍留在表中；失效的路径多于存活的文件时重建，
+    // 编辑器和 sed -i 的临时文件名不会一直累积
+    if (paths_.size() < 1024 || paths_.size() < liveCount_ * 2) return;
+    PathTable paths;
+    std::vector<FileState> states;
+    paths.reserve(liveCount_);
+    states.reserve(liveCount_);
+    for (PathId id = 0; id < states_.size(); ++id) {
+        if (!states_[id].present) continue;
+        paths.intern(paths_.path(id));
+        states.push_back(states_[id]);
+    }
+    paths_ = std::move(paths);
+    states_ = std::move(states);
+}
+
+void FileStateCache::markCommitted(const std::vector<std::string>& paths) {
+    for (const auto& path : paths) {
+        PathId id = paths_.find(path);
+        if (id != kInvalidPathId && id < states_.size() && states_[id].pending) {
+            states_[id].pending = false;
+            dirty_ = true;
+        }
+    }
+}
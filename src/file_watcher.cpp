@@ -1,81 +1,169 @@
 #include "configtracker/file_watcher.h"
-#include <iostream>
+#include "configtracker/logger.h"
+#include "configtracker/metrics.h"
 #include <algorithm>  // 为std::find添加头文件
+#include <filesystem>
 
 using namespace configtracker;
 
 void FileWatcher::addWatch(const std::string& path) {
-    std::cout << "[Watcher] Watching path: " << path << "\n";
+    CT_LOG(Info) << "[Watcher] Watching path: " << path;
     auto it = std::find(watchPaths_.begin(), watchPaths_.end(), path);
-    
+
     // 如果路径不在监视列表中，添加它
     if (it == watchPaths_.end()) {
         watchPaths_.push_back(path);
     }
 }
 
-
-// src/file_watcher.cpp
-void FileWatcher::startWatching(std::function<void(std::string)> onChange) {
-    std::cout << "[Watcher] Start watching...\n";
+void FileWatcher::startWatching(std::function<void(const std::string&)> onChange) {
+    CT_LOG(Info) << "[Watcher] Start watching...";
     running_ = true;
-    
-    // 创建监控线程
-    watchThread_ = std::thread([this, onChange]() {
-        while (running_) {
-            for (const auto& path : watchPaths_) {
-                checkForChanges(path, onChange);
-            }
-            std::this_thread::sleep_for(std::chrono::seconds(2)); // 每2秒检查一次
+
+    // 加载上次运行保存的文件状态，未变化的文件不会再次上报
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex_);
+        if (stateCache_.load()) {
+            CT_LOG(Info) << "[Watcher] Loaded state for " << stateCache_.size() << " files";
         }
-    });
-}
+        lastSave_ = std::chrono::steady_clock::now();
+    }
 
-void FileWatcher::checkForChanges(const std::string& path, const std::function<void(std::string)>& onChange) {
-    // 实现文件检查逻辑，例如比较文件修改时间或哈希值
-    // 这里简化实现，实际应当保存文件的上一个状态进行比较
-    
-    std::filesystem::path watchPath(path);
-    
-    if (std::filesystem::exists(watchPath)) {
-        if (std::filesystem::is_directory(watchPath)) {
-            for (const auto& entry : std::filesystem::directory_iterator(watchPath)) {
-                std::string filePath = entry.path().string();
-                auto now = std::filesystem::last_write_time(entry.path());
-                
-                auto it = fileStates_.find(filePath);
-                if (it == fileStates_.end()) {
-                    // 新文件
-                    fileStates_[filePath] = now;
-                    onChange(filePath);
-                } else if (it->second != now) {
-                    // 文件已修改
-                    it->second = now;
-                    onChange(filePath);
-                }
-            }
-        } else {
-            // 单个文件的情况
-            auto now = std::filesystem::last_write_time(watchPath);
-            auto it = fileStates_.find(path);
-            if (it == fileStates_.end()) {
-                fileStates_[path] = now;
-                onChange(path);
-            } else if (it->second != now) {
-                it->second = now;
-                onChange(path);
-            }
+    ScanOptions scanOptions;
+    scanOptions.recursive = options_.recursive;
+    scanOptions.filter = PathFilter(options_.includePatterns, options_.excludePatterns);
+    scanOptions.threads = options_.scanThreads;
+
+    std::unique_ptr<InotifyBackend> inotify;
+    std::unique_ptr<PollingBackend> polling;
+
+    if (options_.backend != WatchBackendType::Polling) {
+        inotify = std::make_unique<InotifyBackend>(scanOptions);
+        if (!inotify->valid()) {
+            inotify.reset();
+        }
+    }
+
+    // 为每个路径选择后端，inotify 不可用或不可靠时回退到轮询
+    for (const auto& path : watchPaths_) {
+        bool useInotify = inotify && (options_.backend == WatchBackendType::Inotify ||
+                                      InotifyBackend::supports(path));
+        if (useInotify && inotify->addWatch(path)) {
+            continue;
+        }
+        if (options_.backend == WatchBackendType::Inotify) {
+            CT_LOG(Warn) << "inotify unavailable for " << path << ", falling back to polling";
         }
+        if (!polling) {
+            polling = std::make_unique<PollingBackend>(options_.pollInterval, scanOptions);
+        }
+        polling->addWatch(path);
+    }
+
+    if (inotify) backends_.push_back(std::move(inotify));
+    if (polling) backends_.push_back(std::move(polling));
+
+    // 创建监控线程
+    for (auto& backend : backends_) {
+        CT_LOG(Info) << "[Watcher] Using " << backend->name() << " backend";
+        WatchBackend* raw = backend.get();
+        watchThreads_.emplace_back([this, raw, onChange]() {
+            CoreMetrics& metrics = CoreMetrics::get();
+            raw->run([this, &onChange, &metrics](const std::string& path) {
+                metrics.watchCandidates.add();
+                FileChange change;
+                {
+                    std::lock_guard<std::mutex> lock(callbackMutex_);
+                    if (!running_ || suppressed_.count(path)) return;
+                    // 过滤内容未变化的事件（重启、touch、只改了 mtime）
+                    change = stateCache_.refresh(path);
+                }
+                // 回调在锁外执行：Block 策略下 onChange 会等待提交线程腾出队列空间，
+                // 而提交线程在 markCommitted/saveState 中也要获取 callbackMutex_。
+                // 删除同样上报：缓存中的状态已经清除，之后不会再有机会发现这个文件不见了
+                if (change != FileChange::Unchanged) {
+                    metrics.eventsDetected.add();
+                    onChange(path);
+                }
+            });
+        });
     }
 }
 
 
 void FileWatcher::stop() {
-    std::cout << "[Watcher] Stop watching.\n";
+    CT_LOG(Info) << "[Watcher] Stop watching.";
     running_ = false;
-    
+
+    for (auto& backend : backends_) {
+        backend->wakeup();
+    }
+
     // 等待监视线程结束
-    if (watchThread_.joinable()) {
-        watchThread_.join();
+    for (auto& thread : watchThreads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    watchThreads_.clear();
+    backends_.clear();
+}
+
+void FileWatcher::markCommitted(const std::vector<std::string>& paths) {
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    stateCache_.markCommitted(paths);
+}
+
+void FileWatcher::saveState(bool force) {
+    // saveMutex_ 保证状态文件按生成顺序写入
+    std::lock_guard<std::mutex> saveLock(saveMutex_);
+    std::string image;
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex_);
+        auto now = std::chrono::steady_clock::now();
+        if (!stateCache_.dirty() || (!force && now - lastSave_ < std::chrono::seconds(10))) {
+            return;
+        }
+        image = stateCache_.encode();
+        lastSave_ = now;
+    }
+    // 写盘不占用回调锁，提交线程保存状态时不会拖慢事件检测
+    if (!stateCache_.writeImage(image)) {
+        std::lock_guard<std::mutex> lock(callbackMutex_);
+        stateCache_.markDirty();
+    }
+}
+
+std::string FileWatcher::watchedPath(const std::string& path) const {
+    std::error_code ec;
+    std::filesystem::path absolute = std::filesystem::absolute(path, ec).lexically_normal();
+    for (const auto& root : watchPaths_) {
+        std::filesystem::path rootAbs = std::filesystem::absolute(root, ec).lexically_normal();
+        std::filesystem::path relative = absolute.lexically_relative(rootAbs);
+        if (relative.empty() || *relative.begin() == "..") continue;
+        if (relative == ".") return root;
+        std::string base = root;
+        while (base.size() > 1 && base.back() == '/') base.pop_back();
+        return base + "/" + relative.generic_string();
+    }
+    return path;
+}
+
+void FileWatcher::suppress(const std::vector<std::string>& paths) {
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    for (const auto& path : paths) {
+        suppressed_.insert(watchedPath(path));
+    }
+}
+
+void FileWatcher::acknowledge(const std::vector<std::string>& paths) {
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    std::vector<std::string> watched;
+    watched.reserve(paths.size());
+    for (const auto& path : paths) {
+        watched.push_back(watchedPath(path));
+        stateCache_.refresh(watched.back());
+        suppressed_.erase(watched.back());
     }
+    stateCache_.markCommitted(watched);
 }
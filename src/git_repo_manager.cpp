@@ -1,13 +1,40 @@
 #include "configtracker/git_repo_manager.h"
-#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <unordered_set>
+#include "configtracker/mapped_file.h"
+#include "configtracker/logger.h"
+#include "configtracker/metrics.h"
 
 using namespace configtracker;
 
-GitRepoManager::GitRepoManager(const std::string& repoPath) : repoPath_(repoPath), repo_(nullptr) {
-    std::cout << "[GitRepoManager] Created for path: " << repoPath << "\n";
+GitRepoManager::GitRepoManager(const std::string& repoPath, std::chrono::milliseconds indexFlushDelay,
+                               IngestMode ingestMode)
+    : repoPath_(repoPath), ingestMode_(ingestMode), repo_(nullptr), index_(nullptr),
+      indexFlushDelay_(indexFlushDelay) {
+    std::error_code ec;
+    repoRoot_ = std::filesystem::absolute(repoPath_, ec).lexically_normal().generic_string();
+    while (repoRoot_.size() > 1 && repoRoot_.back() == '/') repoRoot_.pop_back();
+    CT_LOG(Debug) << "[GitRepoManager] Created for path: " << repoPath;
 }
 
 GitRepoManager::~GitRepoManager() {
+    stopMaintenance();
+    // 停止后台刷盘线程，退出前把索引写回磁盘
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flushStop_ = true;
+    }
+    flushCv_.notify_all();
+    if (flushThread_.joinable()) {
+        flushThread_.join();
+    }
+    flushIndex();
+    
+    if (index_) {
+        git_index_free(index_);
+        index_ = nullptr;
+    }
     if (repo_) {
         git_repository_free(repo_);
         repo_ = nullptr;
@@ -15,9 +42,8 @@ GitRepoManager::~GitRepoManager() {
     git_libgit2_shutdown();
 }
 
-// src/git_repo_manager.cpp
 void GitRepoManager::init() {
-    std::cout << "[Git] Initialized repository.\n";
+    CT_LOG(Info) << "[Git] Initialized repository.";
     
     // 检查仓库是否已存在
     if (!std::filesystem::exists(repoPath_)) {
@@ -34,37 +60,223 @@ void GitRepoManager::init() {
         error = git_repository_init(&repo, repoPath_.c_str(), 0);
         if (error < 0) {
             const git_error* e = git_error_last();
-            std::cerr << "Error initializing repository: " << e->message << std::endl;
+            CT_LOG(Error) << "Error initializing repository: " << e->message;
             return;
         }
     } else {
         error = git_repository_open(&repo, repoPath_.c_str());
         if (error < 0) {
             const git_error* e = git_error_last();
-            std::cerr << "Error opening repository: " << e->message << std::endl;
+            CT_LOG(Error) << "Error opening repository: " << e->message;
             return;
         }
     }
     
     repo_ = repo;
+    
+    // 打开一次索引并在整个生命周期内保持在内存中
+    error = git_repository_index(&index_, repo_);
+    if (error < 0) {
+        const git_error* e = git_error_last();
+        CT_LOG(Error) << "Error getting index: " << e->message;
+        return;
+    }
+    
+    // 索引是异步刷盘的，上次异常退出时磁盘上的索引可能落后于 HEAD，
+    // 这里以最后一次提交的树为准，避免下一次提交丢失文件。
+    // 检查点记录了上次写盘时索引对应的树，一致时跳过读取整个树
+    loadCheckpoint();
+    git_oid head_id;
+    if (git_reference_name_to_id(&head_id, repo_, "HEAD") == 0) {
+        git_commit* head = nullptr;
+        git_tree* head_tree = nullptr;
+        if (git_commit_lookup(&head, repo_, &head_id) == 0) {
+            git_oid_cpy(&committedTree_, git_commit_tree_id(head));
+            committedTreeKnown_ = true;
+            // 此时索引与 HEAD 的树一致，树缓存以它为基准
+            tree_.reset(repo_, committedTree_);
+            if (indexMatchesCheckpoint(committedTree_)) {
+                CT_LOG(Debug) << "[Git] Index matches checkpoint, skip reading HEAD tree";
+            } else if (git_commit_tree(&head_tree, head) == 0) {
+                git_index_read_tree(index_, head_tree);
+                // 尽快写回磁盘并记录检查点，下次启动不必再读
+                indexDirty_ = true;
+            }
+        }
+        git_tree_free(head_tree);
+        git_commit_free(head);
+    }
+    
+    // 提交索引与分支不一致时（首次使用、外部修改过历史）在这里重建
+    if (commitIndex_.open(sidecarPath(""))) {
+        syncCommitIndexLocked();
+    }
+    
+    flushThread_ = std::thread([this]() { flushLoop(); });
 }
 
 void GitRepoManager::addFile(const std::string& path) {
-    std::cout << "[Git] Add file: " << path << "\n";
+    addFiles({path});
+}
+
+void GitRepoManager::addFiles(const std::vector<std::string>& paths, std::vector<std::string>* failed) {
+    for (const auto& path : paths) {
+        CT_LOG(Debug) << "[Git] Add file: " << path;
+    }
     
-    if (!repo_) {
-        std::cerr << "Error: Repository not initialized" << std::endl;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!repo_ || !index_) {
+        CT_LOG(Error) << "Error: Repository not initialized";
+        if (failed) failed->insert(failed->end(), paths.begin(), paths.end());
         return;
     }
+    ScopedTimer timer(CoreMetrics::get().gitAdd);
+    
+    // 只更新内存中的索引，写树和刷盘留到提交时
+    for (const auto& path : paths) {
+        if (!stageFile(index_, path) && failed) {
+            failed->push_back(path);
+        }
+    }
+    if (!stagedPaths_.empty()) {
+        stagedSinceCommit_ = true;
+    }
+}
+
+size_t GitRepoManager::addContents(const std::vector<FileContent>& files, std::vector<std::string>* failed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!repo_ || !index_) {
+        CT_LOG(Error) << "Error: Repository not initialized";
+        if (failed) {
+            for (const auto& file : files) failed->push_back(file.path);
+        }
+        return 0;
+    }
+    ScopedTimer timer(CoreMetrics::get().gitAdd);
+    
+    size_t changed = 0;
+    auto fail = [failed](const std::string& path) {
+        if (failed) failed->push_back(path);
+    };
+    for (const auto& file : files) {
+        std::string indexPath = repoRelativePath(file.path);
+        if (indexPath.empty()) {
+            CT_LOG(Error) << "Error: Cannot map file into repository: " << file.path;
+            fail(file.path);
+            continue;
+        }
+        if (file.removed) {
+            if (removeEntryLocked(index_, indexPath)) {
+                stagedPaths_.push_back(indexPath);
+                ++changed;
+            }
+            continue;
+        }
+        
+        git_oid blob_id;
+        if (!writeContentLocked(index_, indexPath, file.data.data(), file.data.size(), blob_id)) {
+            fail(file.path);
+            continue;
+        }
+        // 多次改写后又回到已提交的内容，不产生变更
+        const git_index_entry* existing = git_index_get_bypath(index_, indexPath.c_str(), 0);
+        if (existing && git_oid_equal(&existing->id, &blob_id)) {
+            continue;
+        }
+        // 文件模式和属主沿用磁盘上的文件，文件已不存在时按普通文件记录
+        struct stat st;
+        if (stat(file.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            std::memset(&st, 0, sizeof(st));
+            st.st_mode = S_IFREG | 0644;
+        }
+        st.st_size = static_cast<off_t>(file.data.size());
+        if (stageEntry(index_, indexPath, st, blob_id)) {
+            ++changed;
+        } else {
+            fail(file.path);
+        }
+    }
+    if (changed > 0) {
+        stagedSinceCommit_ = true;
+    }
+    return changed;
+}
+
+bool GitRepoManager::stageFile(git_index* index, const std::string& path) {
+    if (ingestMode_ == IngestMode::WorkTreeCopy) {
+        return stageFileCopy(index, path);
+    }
+    
+    std::string indexPath = repoRelativePath(path);
+    if (indexPath.empty()) {
+        CT_LOG(Error) << "Error: Cannot map file into repository: " << path;
+        return true;
+    }
+    
+    // 源文件只读一次：读入复用的缓冲区后直接写入对象库，不经过工作区。
+    // 不使用 mmap：其他进程在映射期间截断文件时，访问截断的部分会触发 SIGBUS
+    struct stat st;
+    if (!readFile(path, readBuffer_, &st)) {
+        // 文件在变更事件与提交之间被删除（包括编辑器和 sed -i 的临时文件），从索引中移除
+        if (errno == ENOENT) {
+            if (removeEntryLocked(index, indexPath)) {
+                stagedPaths_.push_back(indexPath);
+            }
+            return true;
+        }
+        CT_LOG(Error) << "Error: Cannot read file: " << path << ": " << std::strerror(errno);
+        return false;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        CT_LOG(Warn) << "Skipping non-regular file: " << path;
+        return true;
+    }
+    // 读取期间文件长度变化时，索引项记录实际写入的长度
+    st.st_size = static_cast<off_t>(readBuffer_.size());
+    
+    git_oid blob_id;
+    bool written = writeContentLocked(index, indexPath, readBuffer_.data(), readBuffer_.size(), blob_id);
+    if (readBuffer_.capacity() > kReadBufferKeepBytes) {
+        std::string().swap(readBuffer_);
+    }
+    if (!written) {
+        return false;
+    }
     
-    git_index* index = nullptr;
-    int error = git_repository_index(&index, repo_);
+    return stageEntry(index, indexPath, st, blob_id);
+}
+
+// 用文件的 stat 信息和已写入对象库的 blob 生成索引项
+bool GitRepoManager::stageEntry(git_index* index, const std::string& indexPath, const struct stat& st,
+                                const git_oid& blob_id) {
+    git_index_entry entry;
+    std::memset(&entry, 0, sizeof(entry));
+    entry.ctime.seconds = static_cast<int32_t>(st.st_ctim.tv_sec);
+    entry.ctime.nanoseconds = static_cast<uint32_t>(st.st_ctim.tv_nsec);
+    entry.mtime.seconds = static_cast<int32_t>(st.st_mtim.tv_sec);
+    entry.mtime.nanoseconds = static_cast<uint32_t>(st.st_mtim.tv_nsec);
+    entry.dev = static_cast<uint32_t>(st.st_dev);
+    entry.ino = static_cast<uint32_t>(st.st_ino);
+    entry.mode = (st.st_mode & S_IXUSR) ? GIT_FILEMODE_BLOB_EXECUTABLE : GIT_FILEMODE_BLOB;
+    entry.uid = st.st_uid;
+    entry.gid = st.st_gid;
+    entry.file_size = static_cast<uint32_t>(st.st_size);
+    entry.id = blob_id;
+    entry.path = indexPath.c_str();
+    
+    int error = git_index_add(index, &entry);
     if (error < 0) {
         const git_error* e = git_error_last();
-        std::cerr << "Error getting index: " << e->message << std::endl;
-        return;
+        CT_LOG(Error) << "Error adding file to index: " << e->message;
+        return false;
     }
-    
+    tree_.set(indexPath, blob_id, entry.mode);
+    stagedPaths_.push_back(indexPath);
+    return true;
+}
+
+// 旧的导入方式：先复制到工作区，再由 libgit2 从工作区读取
+bool GitRepoManager::stageFileCopy(git_index* index, const std::string& path) {
     std::filesystem::path filePath(path);
     // 计算相对于仓库的路径
     std::string relativePath;
@@ -74,11 +286,10 @@ void GitRepoManager::addFile(const std::string& path) {
         std::filesystem::path repoAbsPath = std::filesystem::absolute(repoPath_);
         std::filesystem::path fileAbsPath = std::filesystem::absolute(filePath);
         
-        // 检查文件是否存在
+        // 检查文件是否存在；已被删除的文件没有可以暂存的内容，不算失败
         if (!std::filesystem::exists(fileAbsPath)) {
-            std::cerr << "Error: File does not exist: " << fileAbsPath << std::endl;
-            git_index_free(index);
-            return;
+            CT_LOG(Warn) << "File no longer exists: " << fileAbsPath;
+            return true;
         }
         
         // 如果文件在仓库目录外，复制到仓库内的相应位置
@@ -94,48 +305,77 @@ void GitRepoManager::addFile(const std::string& path) {
         }
         
         // 添加到索引
-        error = git_index_add_bypath(index, relativePath.c_str());
+        int error = git_index_add_bypath(index, relativePath.c_str());
         if (error < 0) {
             const git_error* e = git_error_last();
-            std::cerr << "Error adding file to index: " << e->message << std::endl;
-        } else {
-            // 写入索引
-            error = git_index_write(index);
-            if (error < 0) {
-                const git_error* e = git_error_last();
-                std::cerr << "Error writing index: " << e->message << std::endl;
-            }
+            CT_LOG(Error) << "Error adding file to index: " << e->message;
+            return false;
         }
+        if (const git_index_entry* entry = git_index_get_bypath(index, relativePath.c_str(), 0)) {
+            tree_.set(relativePath, entry->id, entry->mode);
+        }
+        stagedPaths_.push_back(relativePath);
     } catch (const std::exception& e) {
-        std::cerr << "Exception while adding file: " << e.what() << std::endl;
+        CT_LOG(Error) << "Exception while adding file: " << e.what();
+        return false;
     }
     
-    git_index_free(index);
+    return true;
 }
 
-// src/git_repo_manager.cpp
-void GitRepoManager::commit(const std::string& message) {
-    std::cout << "[Git] Commit with message: " << message << "\n";
+bool GitRepoManager::commit(const std::string& message, std::string* hash, int64_t* time) {
+    CT_LOG(Debug) << "[Git] Commit with message: " << message;
     
+    std::lock_guard<std::mutex> lock(mutex_);
     // 检查仓库是否初始化
-    if (!repo_) {
-        std::cerr << "Error: Repository not initialized" << std::endl;
-        return;
+    if (!repo_ || !index_) {
+        CT_LOG(Error) << "Error: Repository not initialized";
+        return false;
     }
+    return commitLocked(message, hash, time);
+}
+
+bool GitRepoManager::hasStagedChanges() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stagedSinceCommit_;
+}
+
+bool GitRepoManager::commitLocked(const std::string& message, std::string* hash, int64_t* time) {
+    CoreMetrics& metrics = CoreMetrics::get();
+    ScopedTimer timer(metrics.gitCommit);
     
-    git_index* index = nullptr;
     git_oid commit_id, tree_id;
     git_tree* tree = nullptr;
     git_signature* signature = nullptr;
     git_commit* parent = nullptr;
+    git_oid parent_id;
+    git_oid parent_tree_id;
+    git_time_t commit_time = 0;
+    bool has_parent = git_reference_name_to_id(&parent_id, repo_, "HEAD") == 0;
+    int error = 0;
     
-    // 获取索引
-    int error = git_repository_index(&index, repo_);
-    if (error < 0) goto cleanup;
+    if (has_parent) {
+        error = git_commit_lookup(&parent, repo_, &parent_id);
+        if (error < 0) goto cleanup;
+        git_oid_cpy(&parent_tree_id, git_commit_tree_id(parent));
+    }
     
-    // 写入索引到树
-    error = git_index_write_tree(&tree_id, index);
-    if (error < 0) goto cleanup;
+    if (stagedSinceCommit_ || !parent) {
+        auto write_begin = std::chrono::steady_clock::now();
+        if (tree_.write(tree_id)) {
+            // 只重写了变更文件路径上的目录
+            metrics.treesWritten.add(tree_.lastWritten());
+        } else {
+            // 树缓存失效（首次提交、检出之后）时从内存索引生成整个树，并以结果作为新的基准
+            error = git_index_write_tree(&tree_id, index_);
+            if (error == 0) tree_.reset(repo_, tree_id);
+        }
+        metrics.gitTreeWrite.recordDuration(std::chrono::steady_clock::now() - write_begin);
+        if (error < 0) goto cleanup;
+    } else {
+        // 上次提交后没有暂存任何文件，直接复用父提交的树
+        git_oid_cpy(&tree_id, git_commit_tree_id(parent));
+    }
     
     // 创建树对象
     error = git_tree_lookup(&tree, repo_, &tree_id);
@@ -148,13 +388,11 @@ void GitRepoManager::commit(const std::string& message) {
         error = git_signature_now(&signature, "ConfigTracker", "configtracker@example.com");
         if (error < 0) goto cleanup;
     }
+    commit_time = signature->when.time;
     
     // 创建提交
-    git_oid parent_id;
-    
-    if (git_reference_name_to_id(&parent_id, repo_, "HEAD") == 0) {
+    if (parent) {
         // 有上一个提交
-        git_commit_lookup(&parent, repo_, &parent_id);
         git_commit* parents[] = {parent};
         error = git_commit_create(&commit_id, repo_, "HEAD", signature, signature, 
                                "UTF-8", message.c_str(), tree, 1, (const git_commit**)parents);
@@ -166,140 +404,462 @@ void GitRepoManager::commit(const std::string& message) {
     
 cleanup:
     if (parent) git_commit_free(parent);
-    git_index_free(index);
     git_tree_free(tree);
     git_signature_free(signature);
     
     if (error < 0) {
         const git_error* e = git_error_last();
-        std::cerr << "Error creating commit: " << e->message << std::endl;
+        CT_LOG(Error) << "Error creating commit: " << e->message;
     } else if (error == 0) {
-        std::cout << "[Git] Commit successful" << std::endl;
+        CT_LOG(Info) << "[Git] Commit successful";
+        metrics.commits.add();
+        stagedSinceCommit_ = false;
+        git_oid_cpy(&committedTree_, &tree_id);
+        committedTreeKnown_ = true;
+        if (hash) {
+            char hex[GIT_OID_HEXSZ + 1] = {0};
+            git_oid_fmt(hex, &commit_id);
+            hash->assign(hex);
+        }
+        if (time) *time = commit_time;
+        
+        if (keyDiffEnabled_ && !stagedPaths_.empty()) {
+            recordKeyChangesLocked(commit_id, has_parent ? &parent_tree_id : nullptr, tree_id,
+                                   stagedPaths_, commit_time);
+        }
+        
+        // 追加到提交索引；索引落后于分支时整体重建（会包含这次提交）
+        CommitInfo info;
+        info.oid = commit_id;
+        std::memset(&info.parent, 0, sizeof(info.parent));
+        if (has_parent) info.parent = parent_id;
+        info.time = commit_time;
+        info.paths = std::move(stagedPaths_);
+        stagedPaths_.clear();
+        bool in_sync = commitIndex_.empty()
+            ? !has_parent
+            : has_parent && git_oid_equal(&commitIndex_.at(commitIndex_.size() - 1).oid, &parent_id);
+        if (!in_sync || !commitIndex_.append(info)) {
+            syncCommitIndexLocked();
+        } else {
+            publishTimelineLocked();
+        }
+        
+        // 索引交给后台线程延迟写盘
+        indexDirty_ = true;
+        flushCv_.notify_one();
+    }
+    return error == 0;
+}
+
+void GitRepoManager::flushIndex() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writeIndexLocked();
+}
+
+void GitRepoManager::flushLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!flushStop_) {
+        flushCv_.wait(lock, [this] { return flushStop_ || indexDirty_; });
+        if (flushStop_) break;
+        // 延迟一段时间再写盘，连续的提交只刷一次
+        flushCv_.wait_for(lock, indexFlushDelay_, [this] { return flushStop_; });
+        writeIndexLocked();
     }
 }
 
 
 std::vector<std::string> GitRepoManager::listCommits() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!repo_) {
+        CT_LOG(Error) << "Error: Repository not initialized";
+        return {};
+    }
+    syncCommitIndexLocked();
+    return hashesNewestFirst(0, commitIndex_.size(), 0);
+}
+
+std::vector<std::string> GitRepoManager::latestCommits(size_t count, std::vector<int64_t>* times) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!repo_) {
+        CT_LOG(Error) << "Error: Repository not initialized";
+        return {};
+    }
+    if (count == 0) return {};
+    syncCommitIndexLocked();
+    return hashesNewestFirst(0, commitIndex_.size(), count, times);
+}
+
+std::vector<std::string> GitRepoManager::commitsBetween(std::chrono::system_clock::time_point from,
+                                                        std::chrono::system_clock::time_point to,
+                                                        std::vector<int64_t>* times) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!repo_) {
+        CT_LOG(Error) << "Error: Repository not initialized";
+        return {};
+    }
+    syncCommitIndexLocked();
+    auto range = commitIndex_.range(std::chrono::system_clock::to_time_t(from),
+                                     std::chrono::system_clock::to_time_t(to));
+    return hashesNewestFirst(range.first, range.second, 0, times);
+}
+
+std::vector<std::string> GitRepoManager::commitsTouching(const std::string& path, size_t limit,
+                                                         std::vector<int64_t>* times) {
     std::vector<std::string> result;
-    
+    if (times) times->clear();
+    std::lock_guard<std::mutex> lock(mutex_);
     if (!repo_) {
-        std::cerr << "Error: Repository not initialized" << std::endl;
+        CT_LOG(Error) << "Error: Repository not initialized";
         return result;
     }
+    syncCommitIndexLocked();
     
-    git_revwalk* walker = nullptr;
-    int error = git_revwalk_new(&walker, repo_);
-    if (error < 0) {
-        const git_error* e = git_error_last();
-        std::cerr << "Error creating revision walker: " << e->message << std::endl;
-        return result;
+    const std::vector<uint32_t>* positions = commitIndex_.touching(path);
+    if (!positions) {
+        positions = commitIndex_.touching(repoRelativePath(path));
     }
+    if (!positions) return result;
     
-    // 设置遍历方向为时间顺序
-    git_revwalk_sorting(walker, GIT_SORT_TIME);
-    
-    // 从HEAD开始遍历
-    error = git_revwalk_push_head(walker);
-    if (error < 0) {
-        const git_error* e = git_error_last();
-        std::cerr << "Error pushing HEAD to revision walker: " << e->message << std::endl;
-        git_revwalk_free(walker);
-        return result;
+    for (auto it = positions->rbegin(); it != positions->rend(); ++it) {
+        if (limit && result.size() >= limit) break;
+        char hash[GIT_OID_HEXSZ + 1] = {0};
+        git_oid_fmt(hash, &commitIndex_.at(*it).oid);
+        result.push_back(std::string(hash));
+        if (times) times->push_back(commitIndex_.at(*it).time);
     }
-    
-    // 遍历所有提交
-    git_oid oid;
-    while (git_revwalk_next(&oid, walker) == 0) {
-        git_commit* commit = nullptr;
-        error = git_commit_lookup(&commit, repo_, &oid);
-        
-        if (error < 0) {
-            const git_error* e = git_error_last();
-            std::cerr << "Error looking up commit: " << e->message << std::endl;
-            continue;
-        }
-        
-        // 获取提交的哈希值
+    return result;
+}
+
+std::vector<std::string> GitRepoManager::hashesNewestFirst(size_t first, size_t last, size_t limit,
+                                                           std::vector<int64_t>* times) const {
+    std::vector<std::string> result;
+    if (times) times->clear();
+    for (size_t i = last; i > first; --i) {
+        if (limit && result.size() >= limit) break;
         char hash[GIT_OID_HEXSZ + 1] = {0};
-        git_oid_fmt(hash, &oid);
+        git_oid_fmt(hash, &commitIndex_.at(i - 1).oid);
         result.push_back(std::string(hash));
-        
-        // 释放提交对象
-        git_commit_free(commit);
+        if (times) times->push_back(commitIndex_.at(i - 1).time);
     }
-    
-    git_revwalk_free(walker);
     return result;
 }
 
-void GitRepoManager::squashCommitsOlderThan(int days) {
-    std::cout << "[Git] Squash commits older than " << days << " days\n";
-    if (!repo_) {
-        std::cerr << "Error: Repository not initialized" << std::endl;
+bool GitRepoManager::findCommit(const std::string& hash, int64_t* time) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    git_oid oid;
+    if (!repo_ || git_oid_fromstr(&oid, hash.c_str()) < 0) {
+        return false;
+    }
+    syncCommitIndexLocked();
+    size_t pos = commitIndex_.find(oid);
+    if (pos == CommitIndex::npos) return false;
+    if (time) *time = commitIndex_.at(pos).time;
+    return true;
+}
+
+bool GitRepoManager::commitAt(std::chrono::system_clock::time_point at, git_oid& out) {
+    // 时间线是不可变的副本，读取方与提交线程之间只有一次原子加载
+    std::shared_ptr<const CommitTimeline> timeline = std::atomic_load(&timeline_);
+    if (!timeline) return false;
+    // 提交时间精确到秒，at 所在的这一秒内的提交也算在内
+    size_t pos = timeline->lastBefore(std::chrono::system_clock::to_time_t(at) + 1);
+    if (pos == CommitTimeline::npos) return false;
+    git_oid_cpy(&out, &timeline->oid(pos));
+    return true;
+}
+
+void GitRepoManager::setKeyDiffEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    keyDiffEnabled_ = enabled;
+}
+
+void GitRepoManager::recordKeyChangesLocked(const git_oid& commit, const git_oid* parentTree,
+                                            const git_oid& tree, const std::vector<std::string>& paths,
+                                            int64_t time) {
+    CoreMetrics& metrics = CoreMetrics::get();
+    ScopedTimer timer(metrics.keyDiff);
+    
+    git_tree* old_tree = nullptr;
+    git_tree* new_tree = nullptr;
+    if ((parentTree && git_tree_lookup(&old_tree, repo_, parentTree) < 0) ||
+        git_tree_lookup(&new_tree, repo_, &tree) < 0) {
+        git_tree_free(old_tree);
         return;
     }
     
-    // 获取当前时间
-    auto now = std::chrono::system_clock::now();
-    auto cutoff_time = now - std::chrono::hours(24 * days);
-    time_t cutoff_time_t = std::chrono::system_clock::to_time_t(cutoff_time);
-    std::cout << "Squashing commits older than: " << std::ctime(&cutoff_time_t);
-    
-    // 声明变量，将其移到goto之前
-    git_revwalk* walker = nullptr;
-    std::vector<git_oid> old_commits;
-    bool has_old_commits = false;
+    // 每个文件在父提交和本次提交中的 blob，不存在的一侧为全零
+    std::vector<KeyHistory::FileChange> files;
+    std::unordered_set<std::string> seen;
+    for (const auto& path : paths) {
+        if (!seen.insert(path).second) continue;
+        KeyHistory::FileChange file;
+        file.path = path;
+        std::memset(&file.oldOid, 0, sizeof(file.oldOid));
+        std::memset(&file.newOid, 0, sizeof(file.newOid));
+        git_tree_entry* entry = nullptr;
+        if (old_tree && git_tree_entry_bypath(&entry, old_tree, path.c_str()) == 0) {
+            git_oid_cpy(&file.oldOid, git_tree_entry_id(entry));
+            git_tree_entry_free(entry);
+        }
+        if (git_tree_entry_bypath(&entry, new_tree, path.c_str()) == 0) {
+            git_oid_cpy(&file.newOid, git_tree_entry_id(entry));
+            git_tree_entry_free(entry);
+        }
+        if (!git_oid_equal(&file.oldOid, &file.newOid)) {
+            files.push_back(std::move(file));
+        }
+    }
+    git_tree_free(old_tree);
+    git_tree_free(new_tree);
+    if (files.empty()) return;
+    
+    size_t changed = keyHistoryLocked().record(commit, time, files, [this](const git_oid& oid, std::string& out) {
+        return readContentLocked(oid, out);
+    });
+    metrics.keyChanges.add(changed);
+    CT_LOG(Debug) << "[Keys] " << changed << " keys changed in " << files.size() << " files";
+}
+
+std::vector<KeyChange> GitRepoManager::keyChanges(const std::string& hash) {
+    std::lock_guard<std::mutex> lock(mutex_);
     git_oid oid;
-    int error = 0;
+    if (git_oid_fromstr(&oid, hash.c_str()) < 0) {
+        CT_LOG(Error) << "Error: Invalid commit hash " << hash;
+        return {};
+    }
+    return keyHistoryLocked().changesOf(oid);
+}
+
+std::vector<KeyChange> GitRepoManager::keyHistory(const std::string& path, const std::string& key, size_t limit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!repo_) {
+        CT_LOG(Error) << "Error: Repository not initialized";
+        return {};
+    }
+    std::vector<KeyChange> result = keyHistoryLocked().history(path, key, limit);
+    if (result.empty()) {
+        result = keyHistoryLocked().history(repoRelativePath(path), key, limit);
+    }
+    return result;
+}
+
+std::string GitRepoManager::sidecarPath(const std::string& name) const {
+    // git_repository_path 返回以 '/' 结尾的 .git 目录
+    return std::string(git_repository_path(repo_)) + "configtracker/" + name;
+}
+
+std::string GitRepoManager::repoRelativePath(const std::string& path) const {
+    // 规范化的绝对路径只做字符串运算，不构造 std::filesystem::path
+    if (isNormalAbsolutePath(path) && repoRoot_.size() > 1) {
+        if (path.size() > repoRoot_.size() + 1 && path.compare(0, repoRoot_.size(), repoRoot_) == 0 &&
+            path[repoRoot_.size()] == '/') {
+            return path.substr(repoRoot_.size() + 1);
+        }
+        if (path != repoRoot_) {
+            if (ingestMode_ == IngestMode::Direct) {
+                return path.substr(1);
+            }
+            return path.substr(path.rfind('/') + 1);
+        }
+    }
+    std::error_code ec;
+    std::filesystem::path repoAbsPath = std::filesystem::absolute(repoPath_, ec).lexically_normal();
+    std::filesystem::path fileAbsPath = std::filesystem::absolute(path, ec).lexically_normal();
     
-    // 获取所有提交
-    error = git_revwalk_new(&walker, repo_);
-    if (error < 0) goto cleanup;
-    git_revwalk_sorting(walker, GIT_SORT_TIME);
-    error = git_revwalk_push_head(walker);
-    if (error < 0) goto cleanup;
+    std::filesystem::path relative = fileAbsPath.lexically_relative(repoAbsPath);
+    if (!relative.empty() && *relative.begin() != "..") {
+        return relative.generic_string();
+    }
+    // 仓库外的文件：直接写入时按绝对路径的目录结构存放（去掉开头的 '/'），
+    // 旧的复制方式只保留文件名
+    if (ingestMode_ == IngestMode::Direct) {
+        return fileAbsPath.relative_path().generic_string();
+    }
+    return fileAbsPath.filename().string();
+}
+
+void GitRepoManager::syncCommitIndexLocked() {
+    git_oid head;
+    size_t pos = CommitIndex::npos;
+    if (git_reference_name_to_id(&head, repo_, "HEAD") < 0) {
+        // 还没有任何提交
+        commitIndex_.truncate(0);
+    } else if (commitIndex_.size() > 0 && git_oid_equal(&commitIndex_.at(commitIndex_.size() - 1).oid, &head)) {
+        // 已经一致
+    } else if ((pos = commitIndex_.find(head)) != CommitIndex::npos) {
+        // 分支被回退到索引中的某个提交（例如 checkoutCommit），丢弃其后的记录即可
+        commitIndex_.truncate(pos + 1);
+    } else {
+        rebuildCommitIndexLocked(head);
+    }
+    publishTimelineLocked();
+}
+
+void GitRepoManager::publishTimelineLocked() {
+    std::shared_ptr<const CommitTimeline> current = std::atomic_load(&timeline_);
+    size_t count = commitIndex_.size();
+    size_t known = current ? current->size() : 0;
+    auto sameAt = [&](size_t pos) { return git_oid_equal(&current->oid(pos), &commitIndex_.at(pos).oid); };
+    if (current && count == known && (count == 0 || sameAt(count - 1))) {
+        return;
+    }
+    // 常见情况是在末尾追加了一个提交；截断、重建和压缩改写后整体重新生成
+    std::shared_ptr<const CommitTimeline> next;
+    if (current && count == known + 1 && (known == 0 || sameAt(known - 1))) {
+        next = current->append(commitIndex_.at(known));
+    } else {
+        next = CommitTimeline::build(commitIndex_);
+    }
+    std::atomic_store(&timeline_, next);
+}
+
+void GitRepoManager::rebuildCommitIndexLocked(const git_oid& head) {
+    CT_LOG(Info) << "[Git] Rebuilding commit index";
     
-    // 收集旧提交
+    git_revwalk* walker = nullptr;
+    if (git_revwalk_new(&walker, repo_) < 0) {
+        const git_error* e = git_error_last();
+        CT_LOG(Error) << "Error creating revision walker: " << e->message;
+        return;
+    }
+    // 沿第一父提交从旧到新遍历，相邻提交的树直接复用
+    git_revwalk_sorting(walker, GIT_SORT_TOPOLOGICAL | GIT_SORT_REVERSE);
+    git_revwalk_simplify_first_parent(walker);
+    git_revwalk_push(walker, &head);
+    
+    std::vector<CommitInfo> commits;
+    git_oid prev_id;
+    git_tree* prev_tree = nullptr;
+    git_oid oid;
     while (git_revwalk_next(&oid, walker) == 0) {
         git_commit* commit = nullptr;
-        int commit_error = git_commit_lookup(&commit, repo_, &oid);
+        git_tree* tree = nullptr;
+        if (git_commit_lookup(&commit, repo_, &oid) < 0 || git_commit_tree(&tree, commit) < 0) {
+            const git_error* e = git_error_last();
+            CT_LOG(Error) << "Error reading commit: " << e->message;
+            git_commit_free(commit);
+            continue;
+        }
+        
+        CommitInfo info;
+        info.oid = oid;
+        std::memset(&info.parent, 0, sizeof(info.parent));
+        info.time = git_commit_time(commit);
         
-        if (commit_error == 0) {
-            git_time_t commit_time = git_commit_time(commit);
-            time_t time_t_commit = static_cast<time_t>(commit_time);
-            
-            if (time_t_commit < cutoff_time_t) {
-                // 保存旧提交
-                old_commits.push_back(oid);
-                has_old_commits = true;
+        git_tree* parent_tree = nullptr;
+        bool own_parent_tree = false;
+        if (git_commit_parentcount(commit) > 0) {
+            info.parent = *git_commit_parent_id(commit, 0);
+            if (prev_tree && git_oid_equal(&info.parent, &prev_id)) {
+                parent_tree = prev_tree;
+            } else {
+                git_commit* parent = nullptr;
+                if (git_commit_lookup(&parent, repo_, &info.parent) == 0) {
+                    git_commit_tree(&parent_tree, parent);
+                    own_parent_tree = true;
+                }
+                git_commit_free(parent);
             }
-            
-            git_commit_free(commit);
         }
+        diffTrees(repo_, parent_tree, tree, info.paths);
+        
+        if (own_parent_tree) git_tree_free(parent_tree);
+        git_tree_free(prev_tree);
+        prev_tree = tree;
+        prev_id = oid;
+        git_commit_free(commit);
+        commits.push_back(std::move(info));
     }
+    git_tree_free(prev_tree);
+    git_revwalk_free(walker);
     
-    // 如果有旧提交，创建一个合并提交
-    if (has_old_commits) {
-        // 实际项目中这里可以实现真正的压缩合并逻辑
-        std::cout << "Found " << old_commits.size() << " old commits that could be squashed.\n";
-        std::cout << "In a full implementation, these would be combined into a single historical commit.\n";
-    } else {
-        std::cout << "No commits found older than specified days.\n";
+    commitIndex_.rewrite(commits);
+    publishTimelineLocked();
+}
+
+bool GitRepoManager::diffTrees(git_repository* repo, git_tree* oldTree, git_tree* newTree,
+                               std::vector<std::string>& out) {
+    git_diff* diff = nullptr;
+    if (git_diff_tree_to_tree(&diff, repo, oldTree, newTree, nullptr) < 0) {
+        const git_error* e = git_error_last();
+        CT_LOG(Error) << "Error diffing trees: " << e->message;
+        return false;
     }
-    
-cleanup:
-    if (walker) git_revwalk_free(walker);
-    if (error < 0) {
+    size_t deltas = git_diff_num_deltas(diff);
+    for (size_t i = 0; i < deltas; ++i) {
+        const git_diff_delta* delta = git_diff_get_delta(diff, i);
+        const char* path = delta->status == GIT_DELTA_DELETED ? delta->old_file.path : delta->new_file.path;
+        if (!isChunkPath(path)) {
+            out.push_back(path);
+        }
+    }
+    git_diff_free(diff);
+    return true;
+}
+
+git_repository* GitRepoManager::openReadHandle() {
+    std::string gitDir;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!repo_) {
+            CT_LOG(Error) << "Error: Repository not initialized";
+            return nullptr;
+        }
+        gitDir = git_repository_path(repo_);
+    }
+    git_repository* handle = nullptr;
+    if (git_repository_open(&handle, gitDir.c_str()) < 0) {
         const git_error* e = git_error_last();
-        std::cerr << "Error during squash operation: " << e->message << std::endl;
+        CT_LOG(Error) << "Error opening read handle: " << (e ? e->message : "unknown error");
+        return nullptr;
+    }
+    return handle;
+}
+
+bool GitRepoManager::diffCommits(git_repository* handle, const std::string& from, const std::string& to,
+                                 std::vector<std::string>& out) {
+    out.clear();
+    // 没有只读句柄时使用主仓库对象，需要持有提交锁
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    git_repository* repo = handle;
+    if (!repo) {
+        lock.lock();
+        repo = repo_;
+        if (!repo) {
+            CT_LOG(Error) << "Error: Repository not initialized";
+            return false;
+        }
+    }
+
+    // from 为空时 trees[0] 保持为空树
+    git_tree* trees[2] = {nullptr, nullptr};
+    const std::string* hashes[2] = {&from, &to};
+    bool ok = true;
+    for (int i = 0; i < 2 && ok; ++i) {
+        if (hashes[i]->empty()) continue;
+        git_oid oid;
+        git_commit* commit = nullptr;
+        ok = git_oid_fromstr(&oid, hashes[i]->c_str()) == 0 && git_commit_lookup(&commit, repo, &oid) == 0 &&
+             git_commit_tree(&trees[i], commit) == 0;
+        git_commit_free(commit);
+        if (!ok) {
+            const git_error* e = git_error_last();
+            CT_LOG(Error) << "Error looking up commit " << *hashes[i] << ": " << (e ? e->message : "unknown error");
+        }
     }
+    ok = ok && diffTrees(repo, trees[0], trees[1], out);
+    git_tree_free(trees[0]);
+    git_tree_free(trees[1]);
+    return ok;
 }
 
 bool GitRepoManager::checkoutCommit(const std::string& hash) {
-    std::cout << "[Git] Checkout commit: " << hash << "\n";
+    CT_LOG(Info) << "[Git] Checkout commit: " << hash;
+    std::lock_guard<std::mutex> lock(mutex_);
     
     if (!repo_) {
-        std::cerr << "Error: Repository not initialized" << std::endl;
+        CT_LOG(Error) << "Error: Repository not initialized";
         return false;
     }
     
@@ -308,7 +868,7 @@ bool GitRepoManager::checkoutCommit(const std::string& hash) {
     int error = git_oid_fromstr(&oid, hash.c_str());
     if (error < 0) {
         const git_error* e = git_error_last();
-        std::cerr << "Error parsing commit hash: " << e->message << std::endl;
+        CT_LOG(Error) << "Error parsing commit hash: " << e->message;
         return false;
     }
     
@@ -317,7 +877,7 @@ bool GitRepoManager::checkoutCommit(const std::string& hash) {
     error = git_commit_lookup(&commit, repo_, &oid);
     if (error < 0) {
         const git_error* e = git_error_last();
-        std::cerr << "Error looking up commit: " << e->message << std::endl;
+        CT_LOG(Error) << "Error looking up commit: " << e->message;
         return false;
     }
     
@@ -326,7 +886,7 @@ bool GitRepoManager::checkoutCommit(const std::string& hash) {
     error = git_commit_tree(&tree, commit);
     if (error < 0) {
         const git_error* e = git_error_last();
-        std::cerr << "Error getting commit tree: " << e->message << std::endl;
+        CT_LOG(Error) << "Error getting commit tree: " << e->message;
         git_commit_free(commit);
         return false;
     }
@@ -339,26 +899,32 @@ bool GitRepoManager::checkoutCommit(const std::string& hash) {
     error = git_checkout_tree(repo_, (git_object*)tree, &opts);
     if (error < 0) {
         const git_error* e = git_error_last();
-        std::cerr << "Error checking out tree: " << e->message << std::endl;
+        CT_LOG(Error) << "Error checking out tree: " << e->message;
         git_tree_free(tree);
         git_commit_free(commit);
         return false;
     }
+    // 检出会改动索引，之后写盘的索引不再等同于某个已知的提交树，树缓存也不再与索引一致
+    committedTreeKnown_ = false;
+    tree_.clear();
     
     // 更新HEAD引用为当前提交
     git_reference* head_ref = nullptr;
     error = git_repository_head(&head_ref, repo_);
     if (error < 0) {
-        std::cerr << "Warning: Could not update HEAD reference" << std::endl;
+        CT_LOG(Warn) << "Could not update HEAD reference";
     } else {
-        const char* head_name = git_reference_name(head_ref);
-        error = git_reference_set_target(NULL, head_ref, &oid, "checkout: moving to commit");
+        git_reference* updated = nullptr;
+        error = git_reference_set_target(&updated, head_ref, &oid, "checkout: moving to commit");
         if (error < 0) {
             const git_error* e = git_error_last();
-            std::cerr << "Error updating HEAD reference: " << e->message << std::endl;
+            CT_LOG(Error) << "Error updating HEAD reference: " << e->message;
         }
+        git_reference_free(updated);
         git_reference_free(head_ref);
     }
+    // 分支回退后按时间查询的结果随之变化
+    syncCommitIndexLocked();
     
     git_tree_free(tree);
     git_commit_free(commit);
@@ -367,8 +933,9 @@ bool GitRepoManager::checkoutCommit(const std::string& hash) {
 }
 
 std::string GitRepoManager::getLatestCommit() {
+    std::lock_guard<std::mutex> lock(mutex_);
     if (!repo_) {
-        std::cerr << "Error: Repository not initialized" << std::endl;
+        CT_LOG(Error) << "Error: Repository not initialized";
         return "";
     }
     
@@ -376,7 +943,7 @@ std::string GitRepoManager::getLatestCommit() {
     int error = git_reference_name_to_id(&oid, repo_, "HEAD");
     if (error < 0) {
         const git_error* e = git_error_last();
-        std::cerr << "Error getting HEAD reference: " << e->message << std::endl;
+        CT_LOG(Error) << "Error getting HEAD reference: " << e->message;
         return "";
     }
     
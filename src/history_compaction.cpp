@@ -0,0 +1,403 @@
+#include "configtracker/git_repo_manager.h"
+#include "configtracker/logger.h"
+#include <git2/sys/commit.h>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+
+using namespace configtracker;
+
+namespace {
+
+std::string oidToString(const git_oid& oid) {
+    char hash[GIT_OID_HEXSZ + 1] = {0};
+    git_oid_fmt(hash, &oid);
+    return std::string(hash);
+}
+
+void printGitError(const char* what) {
+    const git_error* e = git_error_last();
+    CT_LOG(Error) << what << ": " << (e ? e->message : "unknown error");
+}
+
+// 改写过程中用来保护新提交不被清理的引用
+constexpr const char* kCompactionRef = "refs/configtracker/compaction";
+
+}
+
+void GitRepoManager::squashCommitsOlderThan(int days) {
+    CT_LOG(Info) << "[Git] Squash commits older than " << days << " days";
+    while (!compactHistoryStep(days, std::chrono::seconds(1))) {
+    }
+}
+
+bool GitRepoManager::compactHistoryStep(int days, std::chrono::milliseconds budget) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!repo_) {
+        CT_LOG(Error) << "Error: Repository not initialized";
+        return true;
+    }
+    if (!compactHistoryStepLocked(days, budget)) {
+        return false;
+    }
+    // 本轮检查完成，记录时间，重启后按间隔继续而不是立即再查一遍
+    checkpoint_.lastRetention = static_cast<int64_t>(
+        std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    saveCheckpoint();
+    return true;
+}
+
+bool GitRepoManager::compactHistoryStepLocked(int days, std::chrono::milliseconds budget) {
+    auto deadline = std::chrono::steady_clock::now() + budget;
+
+    if (!compactionLoaded_) {
+        loadCompactionState();
+    }
+    if (!compaction_.active) {
+        if (!planCompactionLocked(days)) {
+            return true;
+        }
+    }
+
+    // 从检查点恢复时重新计算待改写的提交（只遍历尚未改写的部分）
+    if (!compactionQueueValid_) {
+        compactionQueue_.clear();
+        if (!collectCommitsLocked(compaction_.origTip, compaction_.lastSource, compactionQueue_)) {
+            clearCompactionState();
+            return true;
+        }
+        compactionQueueValid_ = true;
+    }
+
+    // 把较新的提交逐个挂到新的基础提交之上，树对象直接按 oid 复用；
+    // 每个分片至少改写一个提交，保证预算再小也能推进
+    size_t done = 0;
+    while (done < compactionQueue_.size()) {
+        if (done > 0 && std::chrono::steady_clock::now() >= deadline) {
+            compactionQueue_.erase(compactionQueue_.begin(), compactionQueue_.begin() + done);
+            saveCompactionState();
+            return false;
+        }
+        git_oid rewritten;
+        if (!rewriteCommitLocked(compactionQueue_[done], compaction_.lastNew, rewritten)) {
+            clearCompactionState();
+            return true;
+        }
+        compaction_.lastSource = compactionQueue_[done];
+        compaction_.lastNew = rewritten;
+        ++done;
+    }
+    compactionQueue_.clear();
+
+    return finishCompactionLocked();
+}
+
+bool GitRepoManager::planCompactionLocked(int days) {
+    git_reference* head = nullptr;
+    if (git_repository_head(&head, repo_) < 0) {
+        // 还没有任何提交
+        return false;
+    }
+    std::string branch = git_reference_name(head);
+    git_oid tip = *git_reference_target(head);
+    git_reference_free(head);
+
+    auto cutoff = std::chrono::system_clock::now() - std::chrono::hours(24 * days);
+    git_time_t cutoffTime = static_cast<git_time_t>(std::chrono::system_clock::to_time_t(cutoff));
+
+    std::vector<git_oid> newer;
+    git_oid boundary;
+    bool found = false;
+    
+    syncCommitIndexLocked();
+    size_t count = commitIndex_.size();
+    if (count > 0 && git_oid_equal(&commitIndex_.at(count - 1).oid, &tip)) {
+        // 在提交索引上二分找到保留期之前的最后一个提交，不需要遍历历史
+        size_t pos = commitIndex_.lastBefore(cutoffTime);
+        if (pos != CommitIndex::npos) {
+            boundary = commitIndex_.at(pos).oid;
+            found = true;
+            for (size_t i = count; i > pos + 1; --i) {
+                newer.push_back(commitIndex_.at(i - 1).oid);
+            }
+        }
+    } else {
+        // 索引不可用时从 HEAD 向旧的方向遍历，找到第一个早于保留期的提交即停止
+        git_revwalk* walker = nullptr;
+        if (git_revwalk_new(&walker, repo_) < 0) {
+            printGitError("Error creating revision walker");
+            return false;
+        }
+        git_revwalk_sorting(walker, GIT_SORT_TIME);
+        git_revwalk_push(walker, &tip);
+        
+        git_oid oid;
+        while (git_revwalk_next(&oid, walker) == 0) {
+            git_commit* commit = nullptr;
+            if (git_commit_lookup(&commit, repo_, &oid) < 0) continue;
+            git_time_t time = git_commit_time(commit);
+            git_commit_free(commit);
+            if (time < cutoffTime) {
+                boundary = oid;
+                found = true;
+                break;
+            }
+            newer.push_back(oid);
+        }
+        git_revwalk_free(walker);
+    }
+
+    if (!found) {
+        CT_LOG(Info) << "No commits found older than specified days.";
+        return false;
+    }
+
+    git_commit* boundaryCommit = nullptr;
+    if (git_commit_lookup(&boundaryCommit, repo_, &boundary) < 0) {
+        printGitError("Error looking up commit");
+        return false;
+    }
+    if (git_commit_parentcount(boundaryCommit) == 0) {
+        // 保留期之前只剩一个根提交，已经压缩过了
+        git_commit_free(boundaryCommit);
+        return false;
+    }
+
+    // 基础提交直接使用边界提交的树，作为新的根提交
+    time_t cutoffTimeT = static_cast<time_t>(cutoffTime);
+    std::ostringstream message;
+    message << "Squashed history before "
+            << std::put_time(std::localtime(&cutoffTimeT), "%Y-%m-%d %H:%M:%S")
+            << "\n\nBase snapshot of " << oidToString(boundary) << "\n";
+
+    git_oid base;
+    int error = git_commit_create_from_ids(&base, repo_, nullptr,
+                                           git_commit_author(boundaryCommit),
+                                           git_commit_committer(boundaryCommit),
+                                           "UTF-8", message.str().c_str(),
+                                           git_commit_tree_id(boundaryCommit), 0, nullptr);
+    git_commit_free(boundaryCommit);
+    if (error < 0) {
+        printGitError("Error creating base commit");
+        return false;
+    }
+
+    std::reverse(newer.begin(), newer.end());
+    compaction_.active = true;
+    compaction_.branch = branch;
+    compaction_.origTip = tip;
+    compaction_.lastSource = boundary;
+    compaction_.lastNew = base;
+    compaction_.boundary = boundary;
+    compactionQueue_ = std::move(newer);
+    compactionQueueValid_ = true;
+    saveCompactionState();
+
+    CT_LOG(Info) << "[Git] Compacting history older than " << days << " days, "
+                 << compactionQueue_.size() << " newer commits to re-parent";
+    return true;
+}
+
+bool GitRepoManager::rewriteCommitLocked(const git_oid& source, const git_oid& parent, git_oid& out) {
+    git_commit* commit = nullptr;
+    if (git_commit_lookup(&commit, repo_, &source) < 0) {
+        printGitError("Error looking up commit");
+        return false;
+    }
+    const git_oid* parents[] = {&parent};
+    int error = git_commit_create_from_ids(&out, repo_, nullptr,
+                                           git_commit_author(commit),
+                                           git_commit_committer(commit),
+                                           git_commit_message_encoding(commit),
+                                           git_commit_message(commit),
+                                           git_commit_tree_id(commit), 1, parents);
+    git_commit_free(commit);
+    if (error < 0) {
+        printGitError("Error rewriting commit");
+        return false;
+    }
+    return true;
+}
+
+bool GitRepoManager::collectCommitsLocked(const git_oid& tip, const git_oid& hide, std::vector<git_oid>& out) {
+    git_revwalk* walker = nullptr;
+    if (git_revwalk_new(&walker, repo_) < 0) {
+        printGitError("Error creating revision walker");
+        return false;
+    }
+    git_revwalk_sorting(walker, GIT_SORT_TOPOLOGICAL | GIT_SORT_REVERSE);
+    if (git_revwalk_push(walker, &tip) < 0 || git_revwalk_hide(walker, &hide) < 0) {
+        printGitError("Error preparing revision walker");
+        git_revwalk_free(walker);
+        return false;
+    }
+    git_oid oid;
+    while (git_revwalk_next(&oid, walker) == 0) {
+        out.push_back(oid);
+    }
+    git_revwalk_free(walker);
+    return true;
+}
+
+bool GitRepoManager::finishCompactionLocked() {
+    git_oid current;
+    if (git_reference_name_to_id(&current, repo_, compaction_.branch.c_str()) < 0) {
+        printGitError("Error resolving branch");
+        clearCompactionState();
+        return true;
+    }
+
+    // 压缩期间又有新的提交，同样挂到改写后的历史上
+    if (!git_oid_equal(&current, &compaction_.origTip)) {
+        std::vector<git_oid> extra;
+        if (!collectCommitsLocked(current, compaction_.origTip, extra)) {
+            clearCompactionState();
+            return true;
+        }
+        for (const auto& source : extra) {
+            git_oid rewritten;
+            if (!rewriteCommitLocked(source, compaction_.lastNew, rewritten)) {
+                clearCompactionState();
+                return true;
+            }
+            compaction_.lastNew = rewritten;
+        }
+    }
+
+    git_reference* ref = nullptr;
+    int error = git_reference_create_matching(&ref, repo_, compaction_.branch.c_str(),
+                                              &compaction_.lastNew, 1, &current,
+                                              "configtracker: compact history");
+    git_reference_free(ref);
+    if (error < 0) {
+        printGitError("Error updating branch after compaction");
+    } else {
+        CT_LOG(Info) << "[Git] History compaction finished, new head "
+                     << oidToString(compaction_.lastNew);
+        remapCommitIndexLocked(current);
+        // 旧历史已不可达，提前唤醒维护线程清理
+        checkpoint_.prunePending = true;
+        saveCheckpoint();
+        {
+            std::lock_guard<std::mutex> lock(maintenanceMutex_);
+            maintenanceWake_ = true;
+        }
+        maintenanceCv_.notify_all();
+    }
+    clearCompactionState();
+    return true;
+}
+
+void GitRepoManager::remapCommitIndexLocked(const git_oid& oldTip) {
+    // 压缩后的历史 = 基础提交 + 边界之后的提交逐个改写，提交时间和变更路径都不变，
+    // 只需把索引里的 oid 换成新历史中对应的提交
+    size_t count = commitIndex_.size();
+    size_t pos = commitIndex_.find(compaction_.boundary);
+    bool usable = count > 0 && pos != CommitIndex::npos &&
+                  git_oid_equal(&commitIndex_.at(count - 1).oid, &oldTip);
+
+    std::vector<git_oid> chain;
+    git_oid oid = compaction_.lastNew;
+    while (usable) {
+        chain.push_back(oid);
+        git_commit* commit = nullptr;
+        if (git_commit_lookup(&commit, repo_, &oid) < 0 || chain.size() > count - pos) {
+            git_commit_free(commit);
+            usable = false;
+            break;
+        }
+        bool root = git_commit_parentcount(commit) == 0;
+        if (!root) oid = *git_commit_parent_id(commit, 0);
+        git_commit_free(commit);
+        if (root) break;
+    }
+    if (!usable || chain.size() != count - pos) {
+        rebuildCommitIndexLocked(compaction_.lastNew);
+        return;
+    }
+    std::reverse(chain.begin(), chain.end());
+
+    std::vector<CommitInfo> commits(chain.size());
+    commits[0].oid = chain[0];
+    std::memset(&commits[0].parent, 0, sizeof(git_oid));
+    commits[0].time = commitIndex_.at(pos).time;
+    commits[0].paths = commitIndex_.pathsUpTo(pos);
+    for (size_t i = 1; i < chain.size(); ++i) {
+        commits[i].oid = chain[i];
+        commits[i].parent = chain[i - 1];
+        commits[i].time = commitIndex_.at(pos + i).time;
+        for (auto path : commitIndex_.pathsOf(pos + i)) {
+            commits[i].paths.emplace_back(path);
+        }
+    }
+    // 键级变更记录跟着换成新的提交，边界之前的记录随历史一起丢弃
+    std::vector<std::pair<git_oid, git_oid>> mapping;
+    for (size_t i = 0; i < chain.size(); ++i) {
+        mapping.emplace_back(commitIndex_.at(pos + i).oid, chain[i]);
+    }
+    commitIndex_.rewrite(commits);
+    publishTimelineLocked();
+    keyHistoryLocked().remap(mapping);
+}
+
+void GitRepoManager::loadCompactionState() {
+    compactionLoaded_ = true;
+    compaction_ = CompactionState();
+    compactionQueueValid_ = false;
+
+    std::ifstream in(sidecarPath("compaction.state"));
+    if (!in) return;
+
+    std::string key, value;
+    std::string origTip, lastSource, lastNew, boundary;
+    while (in >> key >> value) {
+        if (key == "branch") compaction_.branch = value;
+        else if (key == "orig_tip") origTip = value;
+        else if (key == "last_source") lastSource = value;
+        else if (key == "last_new") lastNew = value;
+        else if (key == "boundary") boundary = value;
+    }
+
+    compaction_.active = !compaction_.branch.empty() &&
+                         git_oid_fromstr(&compaction_.origTip, origTip.c_str()) == 0 &&
+                         git_oid_fromstr(&compaction_.lastSource, lastSource.c_str()) == 0 &&
+                         git_oid_fromstr(&compaction_.lastNew, lastNew.c_str()) == 0 &&
+                         git_oid_fromstr(&compaction_.boundary, boundary.c_str()) == 0;
+    if (compaction_.active) {
+        CT_LOG(Info) << "[Git] Resuming history compaction from checkpoint";
+    }
+}
+
+void GitRepoManager::saveCompactionState() {
+    std::string path = sidecarPath("compaction.state");
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    {
+        std::ofstream out(path + ".tmp", std::ios::trunc);
+        out << "branch " << compaction_.branch << "\n"
+            << "orig_tip " << oidToString(compaction_.origTip) << "\n"
+            << "last_source " << oidToString(compaction_.lastSource) << "\n"
+            << "last_new " << oidToString(compaction_.lastNew) << "\n"
+            << "boundary " << oidToString(compaction_.boundary) << "\n";
+    }
+    std::filesystem::rename(path + ".tmp", path, ec);
+
+    // 引用新历史的顶端，避免尚未接入分支的提交被当作不可达对象清理
+    git_reference* ref = nullptr;
+    if (git_reference_create(&ref, repo_, kCompactionRef, &compaction_.lastNew, 1,
+                             "configtracker: compaction checkpoint") == 0) {
+        git_reference_free(ref);
+    }
+}
+
+void GitRepoManager::clearCompactionState() {
+    compaction_ = CompactionState();
+    compactionQueue_.clear();
+    compactionQueueValid_ = false;
+
+    std::error_code ec;
+    std::filesystem::remove(sidecarPath("compaction.state"), ec);
+    git_reference_remove(repo_, kCompactionRef);
+}
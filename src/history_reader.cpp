@@ -0,0 +1,297 @@
+#include "configtracker/history_reader.h"
+#include "configtracker/git_repo_manager.h"
+#include "configtracker/logger.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace configtracker;
+
+namespace {
+
+const char* lastError() {
+    const git_error* e = git_error_last();
+    return e ? e->message : "unknown error";
+}
+
+bool isTree(uint32_t mode) {
+    return mode == GIT_FILEMODE_TREE;
+}
+
+FileDiff makeDiff(std::string path, std::string repoPath, FileChangeKind kind, const git_oid* before,
+                  const git_oid* after) {
+    FileDiff diff;
+    diff.path = std::move(path);
+    diff.repoPath = std::move(repoPath);
+    diff.kind = kind;
+    std::memset(&diff.before, 0, sizeof(diff.before));
+    std::memset(&diff.after, 0, sizeof(diff.after));
+    if (before) git_oid_cpy(&diff.before, before);
+    if (after) git_oid_cpy(&diff.after, after);
+    return diff;
+}
+
+}
+
+HistoryReader::HistoryReader(GitRepoManager& git, size_t treeCapacity, size_t blobBytes)
+    : git_(git), roots_(treeCapacity), trees_(treeCapacity), blobs_(blobBytes) {}
+
+HistoryReader::~HistoryReader() {
+    for (git_repository* handle : idleHandles_) {
+        git_repository_free(handle);
+    }
+}
+
+HistoryReader::Lease::~Lease() {
+    if (!handle_) return;
+    {
+        std::lock_guard<std::mutex> lock(reader_.handlesMutex_);
+        if (reader_.idleHandles_.size() < kMaxIdleHandles) {
+            reader_.idleHandles_.push_back(handle_);
+            return;
+        }
+    }
+    git_repository_free(handle_);
+}
+
+git_repository* HistoryReader::Lease::get() {
+    if (handle_) return handle_;
+    {
+        std::lock_guard<std::mutex> lock(reader_.handlesMutex_);
+        if (!reader_.idleHandles_.empty()) {
+            handle_ = reader_.idleHandles_.back();
+            reader_.idleHandles_.pop_back();
+            return handle_;
+        }
+    }
+    handle_ = reader_.git_.openReadHandle();
+    return handle_;
+}
+
+bool HistoryReader::rootAt(Lease& lease, std::chrono::system_clock::time_point at, bool& found, git_oid& commit,
+                           git_oid& root) {
+    found = git_.commitAt(at, commit);
+    if (!found) return true;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        if (const git_oid* cached = roots_.get(commit)) {
+            ++hits_;
+            git_oid_cpy(&root, cached);
+            return true;
+        }
+    }
+    ++misses_;
+    git_repository* handle = lease.get();
+    if (!handle) return false;
+    git_commit* object = nullptr;
+    if (git_commit_lookup(&object, handle, &commit) < 0) {
+        CT_LOG(Error) << "[History] Error looking up commit: " << lastError();
+        return false;
+    }
+    git_oid_cpy(&root, git_commit_tree_id(object));
+    git_commit_free(object);
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    roots_.put(commit, root);
+    return true;
+}
+
+bool HistoryReader::readTree(Lease& lease, const git_oid& oid, TreeListing& out) {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        if (const TreeListing* cached = trees_.get(oid)) {
+            ++hits_;
+            out = *cached;
+            return true;
+        }
+    }
+    ++misses_;
+    // 未命中时在锁外读取对象库，两个线程同时未命中同一个 oid 时各读一次，结果相同
+    git_repository* handle = lease.get();
+    if (!handle) return false;
+    git_tree* tree = nullptr;
+    if (git_tree_lookup(&tree, handle, &oid) < 0) {
+        CT_LOG(Error) << "[History] Error reading tree: " << lastError();
+        return false;
+    }
+    auto items = std::make_shared<std::vector<TreeItem>>();
+    size_t count = git_tree_entrycount(tree);
+    items->reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const git_tree_entry* entry = git_tree_entry_byindex(tree, i);
+        TreeItem item;
+        item.name = git_tree_entry_name(entry);
+        git_oid_cpy(&item.oid, git_tree_entry_id(entry));
+        item.mode = static_cast<uint32_t>(git_tree_entry_filemode(entry));
+        items->push_back(std::move(item));
+    }
+    git_tree_free(tree);
+    // git 按“目录名加 /”排序，这里改为按名字排序以便二分查找
+    std::sort(items->begin(), items->end(), [](const TreeItem& a, const TreeItem& b) { return a.name < b.name; });
+    out = std::move(items);
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    trees_.put(oid, out);
+    return true;
+}
+
+BlobPtr HistoryReader::readContent(Lease& lease, const git_oid& oid) {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        if (const BlobPtr* cached = blobs_.get(oid)) {
+            ++hits_;
+            return *cached;
+        }
+    }
+    ++misses_;
+    git_repository* handle = lease.get();
+    if (!handle) return nullptr;
+    auto blob = std::make_shared<Blob>();
+    git_oid_cpy(&blob->oid, &oid);
+    // 分块存储的文件读到的是拼接后的完整内容
+    if (!git_.readBlob(handle, oid, blob->data)) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    blobs_.put(oid, blob, blob->data.size() + sizeof(Blob));
+    return blob;
+}
+
+const HistoryReader::TreeItem* HistoryReader::findItem(const std::vector<TreeItem>& items, std::string_view name) {
+    auto it = std::lower_bound(items.begin(), items.end(), name,
+                               [](const TreeItem& item, std::string_view key) { return item.name < key; });
+    return it != items.end() && it->name == name ? &*it : nullptr;
+}
+
+BlobPtr HistoryReader::readAt(const std::string& path, std::chrono::system_clock::time_point at,
+                              std::string* commit) {
+    std::string repoPath = !path.empty() && path.front() == '/' ? git_.repoRelativePath(path) : path;
+    if (repoPath.empty()) return nullptr;
+
+    Lease lease(*this);
+    bool found = false;
+    git_oid commitId, root;
+    if (!rootAt(lease, at, found, commitId, root) || !found) {
+        return nullptr;
+    }
+    if (commit) {
+        char hash[GIT_OID_HEXSZ + 1] = {0};
+        git_oid_fmt(hash, &commitId);
+        *commit = hash;
+    }
+
+    // 沿路径逐级查找，只读取路径上的目录
+    git_oid current;
+    git_oid_cpy(&current, &root);
+    size_t begin = 0;
+    while (true) {
+        TreeListing tree;
+        if (!readTree(lease, current, tree)) return nullptr;
+        size_t slash = repoPath.find('/', begin);
+        std::string_view name = std::string_view(repoPath).substr(
+            begin, slash == std::string::npos ? std::string::npos : slash - begin);
+        const TreeItem* item = findItem(*tree, name);
+        if (!item) return nullptr;
+        if (slash == std::string::npos) {
+            return isTree(item->mode) ? nullptr : readContent(lease, item->oid);
+        }
+        if (!isTree(item->mode)) return nullptr;
+        git_oid_cpy(&current, &item->oid);
+        begin = slash + 1;
+    }
+}
+
+bool HistoryReader::diffBetween(std::chrono::system_clock::time_point from, std::chrono::system_clock::time_point to,
+                                std::vector<FileDiff>& out) {
+    out.clear();
+    Lease lease(*this);
+    bool hasBefore = false, hasAfter = false;
+    git_oid beforeCommit, afterCommit, beforeRoot, afterRoot;
+    if (!rootAt(lease, from, hasBefore, beforeCommit, beforeRoot) ||
+        !rootAt(lease, to, hasAfter, afterCommit, afterRoot)) {
+        return false;
+    }
+    // 早于第一次提交的一侧视为空树
+    if (!diffTrees(lease, hasBefore ? &beforeRoot : nullptr, hasAfter ? &afterRoot : nullptr, "", out)) {
+        out.clear();
+        return false;
+    }
+    // 逐级归并时目录排在同名前缀的文件之前，这里按完整路径重新排序
+    std::sort(out.begin(), out.end(), [](const FileDiff& a, const FileDiff& b) { return a.repoPath < b.repoPath; });
+    return true;
+}
+
+bool HistoryReader::diffTrees(Lease& lease, const git_oid* before, const git_oid* after, const std::string& prefix,
+                              std::vector<FileDiff>& out) {
+    if (before && after && git_oid_equal(before, after)) return true;
+    if (!before) return !after || listAll(lease, *after, prefix, FileChangeKind::Added, out);
+    if (!after) return listAll(lease, *before, prefix, FileChangeKind::Removed, out);
+
+    TreeListing oldTree, newTree;
+    if (!readTree(lease, *before, oldTree) || !readTree(lease, *after, newTree)) return false;
+
+    // 两个列表都按名字排序，归并比较
+    auto oldIt = oldTree->begin();
+    auto newIt = newTree->begin();
+    while (oldIt != oldTree->end() || newIt != newTree->end()) {
+        const TreeItem* oldItem = nullptr;
+        const TreeItem* newItem = nullptr;
+        if (newIt == newTree->end() || (oldIt != oldTree->end() && oldIt->name < newIt->name)) {
+            oldItem = &*oldIt++;
+        } else if (oldIt == oldTree->end() || newIt->name < oldIt->name) {
+            newItem = &*newIt++;
+        } else {
+            oldItem = &*oldIt++;
+            newItem = &*newIt++;
+        }
+        const std::string& name = oldItem ? oldItem->name : newItem->name;
+        std::string path = prefix + name;
+        // 分块存储的块目录不是被跟踪的文件，块的变化体现在文件清单的 oid 上
+        if (prefix.empty() && GitRepoManager::isChunkPath(path.c_str())) continue;
+
+        if (oldItem && newItem && oldItem->mode == newItem->mode && git_oid_equal(&oldItem->oid, &newItem->oid)) {
+            continue;
+        }
+        bool oldDir = oldItem && isTree(oldItem->mode);
+        bool newDir = newItem && isTree(newItem->mode);
+        if (oldDir || newDir) {
+            if (!diffTrees(lease, oldDir ? &oldItem->oid : nullptr, newDir ? &newItem->oid : nullptr, path + "/", out)) {
+                return false;
+            }
+        }
+        // 文件与目录互相替换时，文件一侧单独记为删除或新增
+        const TreeItem* oldFile = oldItem && !oldDir ? oldItem : nullptr;
+        const TreeItem* newFile = newItem && !newDir ? newItem : nullptr;
+        if (oldFile && newFile) {
+            out.push_back(makeDiff(git_.sourcePath(path), path, FileChangeKind::Modified, &oldFile->oid, &newFile->oid));
+        } else if (oldFile) {
+            out.push_back(makeDiff(git_.sourcePath(path), path, FileChangeKind::Removed, &oldFile->oid, nullptr));
+        } else if (newFile) {
+            out.push_back(makeDiff(git_.sourcePath(path), path, FileChangeKind::Added, nullptr, &newFile->oid));
+        }
+    }
+    return true;
+}
+
+bool HistoryReader::listAll(Lease& lease, const git_oid& tree, const std::string& prefix, FileChangeKind kind,
+                            std::vector<FileDiff>& out) {
+    TreeListing items;
+    if (!readTree(lease, tree, items)) return false;
+    for (const TreeItem& item : *items) {
+        std::string path = prefix + item.name;
+        if (prefix.empty() && GitRepoManager::isChunkPath(path.c_str())) continue;
+        if (isTree(item.mode)) {
+            if (!listAll(lease, item.oid, path + "/", kind, out)) return false;
+            continue;
+        }
+        bool added = kind == FileChangeKind::Added;
+        out.push_back(makeDiff(git_.sourcePath(path), path, kind, added ? nullptr : &item.oid,
+                               added ? &item.oid : nullptr));
+    }
+    return true;
+}
+
+uint64_t HistoryReader::hits() const {
+    return hits_.load();
+}
+
+uint64_t HistoryReader::misses() const {
+    return misses_.load();
+}
@@ -0,0 +1,303 @@
+#include "configtracker/watch_backend.h"
+#include "configtracker/logger.h"
+#include "configtracker/metrics.h"
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+#endif
+
+using namespace configtracker;
+
+#ifdef __linux__
+
+namespace {
+
+// 只关心写完关闭、移入（编辑器的原子替换）以及删除和移出，避免每次 write() 都产生事件
+constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM;
+// 递归监控时还需要知道新建的子目录
+constexpr uint32_t kRecursiveMask = kWatchMask | IN_CREATE;
+
+// 这些文件系统上的修改可能来自其他主机，inotify 无法感知
+bool isRemoteFilesystem(long type) {
+    switch (static_cast<unsigned long>(type)) {
+        case 0x6969:      // NFS
+        case 0x517B:      // SMB
+        case 0xFF534D42:  // CIFS
+        case 0xFE534D42:  // SMB2
+        case 0x65735546:  // FUSE
+        case 0x01021997:  // 9P
+        case 0x00C36400:  // Ceph
+            return true;
+        default:
+            return false;
+    }
+}
+
+}
+
+InotifyBackend::InotifyBackend(ScanOptions scanOptions) : scanOptions_(std::move(scanOptions)) {
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (!valid()) {
+        CT_LOG(Error) << "Error creating inotify backend: " << std::strerror(errno);
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = inotifyFd_;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, inotifyFd_, &ev);
+    ev.data.fd = wakeFd_;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &ev);
+}
+
+InotifyBackend::~InotifyBackend() {
+    if (inotifyFd_ >= 0) close(inotifyFd_);
+    if (epollFd_ >= 0) close(epollFd_);
+    if (wakeFd_ >= 0) close(wakeFd_);
+}
+
+bool InotifyBackend::supports(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::path target(path);
+    // 单个文件按其所在目录判断
+    if (!std::filesystem::is_directory(target, ec)) {
+        target = target.parent_path();
+        if (target.empty()) target = ".";
+    }
+
+    struct statfs fs{};
+    if (statfs(target.c_str(), &fs) != 0) {
+        return false;
+    }
+    return !isRemoteFilesystem(fs.f_type);
+}
+
+bool InotifyBackend::addWatch(const std::string& path) {
+    if (!valid()) {
+        return false;
+    }
+
+    std::error_code ec;
+    if (std::filesystem::is_directory(path, ec)) {
+        // 子目录的监控在 initialScan 中遍历时添加
+        if (!addDirectoryWatch(path, path.size())) {
+            return false;
+        }
+        watchPaths_.push_back(path);
+        return true;
+    }
+
+    // 单个文件监控其父目录，这样原子替换（rename）后依然有效
+    std::string dir = std::filesystem::path(path).parent_path().string();
+    if (dir.empty()) dir = ".";
+
+    int wd = inotify_add_watch(inotifyFd_, dir.c_str(), kWatchMask | IN_MASK_ADD);
+    if (wd < 0) {
+        CT_LOG(Error) << "Error adding inotify watch for " << path << ": " << std::strerror(errno);
+        return false;
+    }
+
+    WatchEntry& entry = watches_[wd];
+    if (entry.dir.empty()) {
+        entry.dir = dir;
+        entry.rootLength = dir.size();
+    }
+    if (!entry.files) {
+        entry.files = std::make_unique<PathTable>();
+    }
+    entry.files->intern(std::filesystem::path(path).filename().native());
+    watchPaths_.push_back(path);
+    return true;
+}
+
+bool InotifyBackend::addDirectoryWatch(const std::string& dir, size_t rootLength) {
+    uint32_t mask = scanOptions_.recursive ? kRecursiveMask : kWatchMask;
+    int wd = inotify_add_watch(inotifyFd_, dir.c_str(), mask | IN_MASK_ADD);
+    if (wd < 0) {
+        CT_LOG(Error) << "Error adding inotify watch for " << dir << ": " << std::strerror(errno);
+        return false;
+    }
+
+    WatchEntry& entry = watches_[wd];
+    if (entry.dir.empty()) {
+        entry.dir = dir;
+        entry.rootLength = rootLength;
+    }
+    entry.wholeDir = true;
+    return true;
+}
+
+void InotifyBackend::run(const ChangeCallback& onChange) {
+    // 与轮询后端保持一致：启动时先上报已存在的文件
+    initialScan(onChange);
+
+    epoll_event events[2];
+    while (true) {
+        int n = epoll_wait(epollFd_, events, 2, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            CT_LOG(Error) << "Error waiting for inotify events: " << std::strerror(errno);
+            return;
+        }
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd == wakeFd_) {
+                return;
+            }
+        }
+        if (!drainEvents(onChange)) {
+            // 事件队列溢出，重新扫描一遍以免遗漏
+            initialScan(onChange);
+        }
+    }
+}
+
+void InotifyBackend::wakeup() {
+    if (wakeFd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd_, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void InotifyBackend::initialScan(const ChangeCallback& onChange) {
+    ScopedTimer timer(CoreMetrics::get().scanDuration);
+    for (const auto& path : watchPaths_) {
+        std::error_code ec;
+        if (std::filesystem::is_directory(path, ec)) {
+            scanDirectory(path, path.size(), scanOptions_.recursive, onChange);
+        } else if (std::filesystem::exists(path, ec)) {
+            onChange(path);
+        }
+    }
+}
+
+void InotifyBackend::scanDirectory(const std::string& dir, size_t rootLength, bool addWatches,
+                                   const ChangeCallback& onChange) {
+    const PathFilter& filter = scanOptions_.filter;
+    std::error_code ec;
+
+    if (!scanOptions_.recursive) {
+        for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+            std::error_code entryEc;
+            std::string_view relative = relativeToRoot(entry.path().native(), rootLength);
+            if (entry.is_regular_file(entryEc) && filter.acceptFile(relative)) {
+                onChange(entry.path().native());
+            }
+        }
+        return;
+    }
+
+    auto options = std::filesystem::directory_options::skip_permission_denied;
+    std::filesystem::recursive_directory_iterator it(dir, options, ec), end;
+    for (; !ec && it != end; it.increment(ec)) {
+        const auto& entry = *it;
+        std::error_code entryEc;
+        const std::string& entryPath = entry.path().native();
+        std::string_view relative = relativeToRoot(entryPath, rootLength);
+        if (entry.is_directory(entryEc)) {
+            if (!filter.acceptDirectory(relative)) {
+                it.disable_recursion_pending();
+            } else if (addWatches && !entry.is_symlink(entryEc)) {
+                // 迭代器不进入指向目录的符号链接，也不监控它指向的目录
+                addDirectoryWatch(entryPath, rootLength);
+            }
+            continue;
+        }
+        if (entry.is_regular_file(entryEc) && filter.acceptFile(relative)) {
+            onChange(entryPath);
+        }
+    }
+}
+
+bool InotifyBackend::drainEvents(const ChangeCallback& onChange) {
+    alignas(inotify_event) char buffer[16 * 1024];
+    bool overflow = false;
+    drained_.reset();
+    // 同一批事件里重复的路径只上报一次，按首次出现的顺序
+    auto add = [this](std::string_view path) { drained_.intern(path); };
+
+    while (true) {
+        ssize_t len = read(inotifyFd_, buffer, sizeof(buffer));
+        if (len <= 0) break;  // EAGAIN：已读完
+
+        for (char* p = buffer; p < buffer + len;) {
+            auto* ev = reinterpret_cast<inotify_event*>(p);
+            p += sizeof(inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+            if (ev->mask & IN_IGNORED) {
+                // 目录被删除或移走，内核已自动移除监控
+                watches_.erase(ev->wd);
+                continue;
+            }
+            if (ev->len == 0) continue;
+
+            auto it = watches_.find(ev->wd);
+            if (it == watches_.end()) continue;
+
+            const WatchEntry& entry = it->second;
+            std::string_view name(ev->name);
+            // 在复用的缓冲区中拼接路径，不构造临时的 std::string / std::filesystem::path
+            pathBuffer_.assign(entry.dir);
+            if (pathBuffer_.empty() || pathBuffer_.back() != '/') pathBuffer_ += '/';
+            pathBuffer_.append(name);
+
+            if (ev->mask & IN_ISDIR) {
+                // 子目录删除前其中的文件已各自产生 IN_DELETE，目录本身的监控由内核移除（IN_IGNORED）
+                if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) continue;
+                // 递归模式下新出现的子目录：添加监控并上报其中已有的文件
+                if (scanOptions_.recursive && entry.wholeDir &&
+                    scanOptions_.filter.acceptDirectory(relativeToRoot(pathBuffer_, entry.rootLength))) {
+                    std::string dir = pathBuffer_;
+                    size_t rootLength = entry.rootLength;
+                    addDirectoryWatch(dir, rootLength);
+                    scanDirectory(dir, rootLength, true, [&add](const std::string& path) { add(path); });
+                }
+                continue;
+            }
+            // 新建文件等 close_write 再处理；删除和移出照常上报，由调用方发现文件已不存在
+            if (ev->mask & IN_CREATE) continue;
+
+            if (entry.wholeDir) {
+                if (!scanOptions_.filter.acceptFile(relativeToRoot(pathBuffer_, entry.rootLength))) {
+                    continue;
+                }
+            } else if (!entry.files || entry.files->find(name) == kInvalidPathId) {
+                continue;
+            }
+            add(pathBuffer_);
+        }
+    }
+
+    for (PathId id = 0; id < drained_.size(); ++id) {
+        pathBuffer_.assign(drained_.path(id));
+        onChange(pathBuffer_);
+    }
+    return !overflow;
+}
+
+#else
+
+InotifyBackend::InotifyBackend(ScanOptions scanOptions) : scanOptions_(std::move(scanOptions)) {}
+InotifyBackend::~InotifyBackend() {}
+bool InotifyBackend::supports(const std::string&) { return false; }
+bool InotifyBackend::addWatch(const std::string&) { return false; }
+void InotifyBackend::run(const ChangeCallback&) {}
+void InotifyBackend::wakeup() {}
+bool InotifyBackend::addDirectoryWatch(const std::string&, size_t) { return false; }
+void InotifyBackend::scanDirectory(const std::string&, size_t, bool, const ChangeCallback&) {}
+void InotifyBackend::initialScan(const ChangeCallback&) {}
+bool InotifyBackend::drainEvents(const ChangeCallback&) { return true; }
+
+#endif
@@ -0,0 +1,509 @@
+#include "configtracker/key_history.h"
+#include "configtracker/content_hash.h"
+#include "configtracker/mapped_file.h"
+#include "configtracker/logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+using namespace configtracker;
+
+namespace {
+
+constexpr char kNamesMagic[8] = {'C', 'T', 'K', 'N', 'A', 'M', '0', '1'};
+constexpr char kLogMagic[8] = {'C', 'T', 'K', 'L', 'O', 'G', '0', '1'};
+constexpr uint32_t kRecordMagic = 0x4b434831;  // "KCH1"
+// 解析缓存的上限，超过后清空，下一次提交再从对象库读取旧版本
+constexpr size_t kMaxCacheBytes = 64 * 1024 * 1024;
+
+// 两个文件共用的头部，generation 不一致说明重置记录时中途崩溃
+struct FileHeader {
+    char magic[8];
+    uint64_t generation;
+};
+
+// 一个提交的记录头，后面紧跟 bytes 字节的变更项
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t count;
+    int64_t time;
+    git_oid commit;
+    uint32_t bytes;
+};
+static_assert(sizeof(RecordHeader) == 40, "RecordHeader is stored as-is on disk");
+
+// 变更项头，后面紧跟旧值和新值
+struct EntryHeader {
+    uint32_t path;
+    uint32_t key;
+    uint32_t oldLength;
+    uint32_t newLength;
+    uint8_t kind;
+    uint8_t reserved[3];
+};
+static_assert(sizeof(EntryHeader) == 20, "EntryHeader is stored as-is on disk");
+
+bool writeAll(int fd, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool readAt(int fd, uint64_t offset, void* data, size_t len) {
+    char* p = static_cast<char*>(data);
+    while (len > 0) {
+        ssize_t n = ::pread(fd, p, len, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        offset += static_cast<uint64_t>(n);
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool readHeader(const MappedFile& file, const char (&magic)[8], uint64_t& generation) {
+    if (file.size() < sizeof(FileHeader)) return false;
+    FileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) return false;
+    generation = header.generation;
+    return true;
+}
+
+std::string oidKey(const git_oid& oid) {
+    return std::string(reinterpret_cast<const char*>(oid.id), GIT_OID_RAWSZ);
+}
+
+bool isZero(const git_oid& oid) {
+    static const git_oid zero{};
+    return std::memcmp(oid.id, zero.id, GIT_OID_RAWSZ) == 0;
+}
+
+std::string hexOf(const git_oid& oid) {
+    char hash[GIT_OID_HEXSZ + 1] = {0};
+    git_oid_fmt(hash, &oid);
+    return std::string(hash);
+}
+
+uint64_t postingKey(PathId path, PathId key) {
+    return (static_cast<uint64_t>(path) << 32) | key;
+}
+
+}
+
+KeyHistory::~KeyHistory() {
+    close();
+}
+
+bool KeyHistory::open(const std::string& dir) {
+    close();
+    dir_ = dir;
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+
+    std::string namesPath = (std::filesystem::path(dir_) / "keys.names").string();
+    std::string logPath = (std::filesystem::path(dir_) / "keys.log").string();
+    namesFd_ = ::open(namesPath.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    logFd_ = ::open(logPath.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (namesFd_ < 0 || logFd_ < 0) {
+        CT_LOG(Error) << "Error opening key history in " << dir_ << ": " << std::strerror(errno);
+        close();
+        return false;
+    }
+    if (!load()) {
+        struct stat st{};
+        if (fstat(namesFd_, &st) == 0 && st.st_size > 0) {
+            CT_LOG(Warn) << "Ignoring corrupt key history in " << dir_;
+        }
+        return reset();
+    }
+    return true;
+}
+
+void KeyHistory::close() {
+    if (logFd_ >= 0) ::close(logFd_);
+    if (namesFd_ >= 0) ::close(namesFd_);
+    logFd_ = -1;
+    namesFd_ = -1;
+    logSize_ = 0;
+    names_.clear();
+    persistedNames_ = 0;
+    commits_.clear();
+    commitByOid_.clear();
+    postings_.clear();
+    cache_.clear();
+    cacheBytes_ = 0;
+}
+
+bool KeyHistory::reset() {
+    names_.clear();
+    persistedNames_ = 0;
+    commits_.clear();
+    commitByOid_.clear();
+    postings_.clear();
+
+    FileHeader header{};
+    header.generation = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    std::memcpy(header.magic, kNamesMagic, sizeof(kNamesMagic));
+    if (ftruncate(namesFd_, 0) != 0 || !writeAll(namesFd_, &header, sizeof(header))) return false;
+    std::memcpy(header.magic, kLogMagic, sizeof(kLogMagic));
+    if (ftruncate(logFd_, 0) != 0 || !writeAll(logFd_, &header, sizeof(header))) return false;
+    logSize_ = sizeof(header);
+    return true;
+}
+
+bool KeyHistory::load() {
+    MappedFile names;
+    MappedFile log;
+    uint64_t namesGen = 0, logGen = 0;
+    std::string base = (std::filesystem::path(dir_) / "keys.").string();
+    if (!names.open(base + "names") || !log.open(base + "log") ||
+        !readHeader(names, kNamesMagic, namesGen) || !readHeader(log, kLogMagic, logGen) ||
+        namesGen != logGen) {
+        return false;
+    }
+
+    // 名字表：末尾不完整的名字截掉
+    size_t pos = sizeof(FileHeader);
+    while (pos + sizeof(uint32_t) <= names.size()) {
+        uint32_t length;
+        std::memcpy(&length, names.data() + pos, sizeof(length));
+        if (pos + sizeof(length) + length > names.size()) break;
+        names_.intern(std::string_view(names.data() + pos + sizeof(length), length));
+        pos += sizeof(length) + length;
+    }
+    persistedNames_ = names_.size();
+    if (pos != names.size() && ftruncate(namesFd_, static_cast<off_t>(pos)) != 0) return false;
+
+    // 提交记录：记录头或变更项不完整、引用了不存在的名字时，从该记录起截掉
+    pos = sizeof(FileHeader);
+    while (pos + sizeof(RecordHeader) <= log.size()) {
+        RecordHeader record;
+        std::memcpy(&record, log.data() + pos, sizeof(record));
+        size_t end = pos + sizeof(record) + record.bytes;
+        if (record.magic != kRecordMagic || end > log.size()) break;
+
+        std::vector<std::pair<uint64_t, uint64_t>> refs;
+        size_t entry = pos + sizeof(record);
+        bool valid = true;
+        for (uint32_t i = 0; i < record.count && valid; ++i) {
+            EntryHeader header;
+            valid = entry + sizeof(header) <= end;
+            if (!valid) break;
+            std::memcpy(&header, log.data() + entry, sizeof(header));
+            valid = header.path < names_.size() && header.key < names_.size();
+            refs.emplace_back(postingKey(header.path, header.key), entry);
+            entry += sizeof(header) + header.oldLength + header.newLength;
+        }
+        if (!valid || entry != end) break;
+
+        uint32_t index = static_cast<uint32_t>(commits_.size());
+        commits_.push_back(CommitEntry{record.commit, record.time, pos, record.count});
+        commitByOid_[oidKey(record.commit)] = index;
+        for (const auto& ref : refs) {
+            postings_[ref.first].push_back(ChangeRef{index, ref.second});
+        }
+        pos = end;
+    }
+    if (pos != log.size()) {
+        CT_LOG(Warn) << "Truncating incomplete key history record in " << dir_;
+        if (ftruncate(logFd_, static_cast<off_t>(pos)) != 0) return false;
+    }
+    logSize_ = pos;
+    return true;
+}
+
+bool KeyHistory::persistNames() {
+    if (persistedNames_ == names_.size()) return true;
+    std::string buffer;
+    for (size_t id = persistedNames_; id < names_.size(); ++id) {
+        std::string_view name = names_.path(static_cast<PathId>(id));
+        uint32_t length = static_cast<uint32_t>(name.size());
+        buffer.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        buffer.append(name);
+    }
+    if (!writeAll(namesFd_, buffer.data(), buffer.size())) {
+        CT_LOG(Error) << "Error writing key names: " << std::strerror(errno);
+        return false;
+    }
+    persistedNames_ = names_.size();
+    return true;
+}
+
+bool KeyHistory::parse(std::string_view path, const git_oid& oid, std::string data, ParsedConfig& out) {
+    ConfigFormat format = detectFormat(path, data);
+    if (format == ConfigFormat::Unknown) return false;
+
+    git_oid_cpy(&out.oid, &oid);
+    out.data = std::move(data);
+    out.items.clear();
+    const char* base = out.data.data();
+    bool ok = parseConfig(format, out.data, [&](std::string_view key, std::string_view value) {
+        out.items.push_back(ParsedConfig::Item{names_.intern(key), static_cast<uint32_t>(value.size()),
+                                               xxhash64(value.data(), value.size()),
+                                               static_cast<size_t>(value.data() - base)});
+    });
+    if (!ok) {
+        CT_LOG(Debug) << "[Keys] Cannot parse " << path << " as a config file";
+        out.items.clear();
+        return false;
+    }
+
+    // 同一个键出现多次时以最后一次为准（stable_sort 保持出现顺序）
+    std::stable_sort(out.items.begin(), out.items.end(),
+                     [](const ParsedConfig::Item& a, const ParsedConfig::Item& b) { return a.key < b.key; });
+    size_t kept = 0;
+    for (size_t i = 0; i < out.items.size(); ++i) {
+        if (i + 1 < out.items.size() && out.items[i + 1].key == out.items[i].key) continue;
+        out.items[kept++] = out.items[i];
+    }
+    out.items.resize(kept);
+    return true;
+}
+
+void KeyHistory::diff(const ParsedConfig& before, const ParsedConfig& after, std::vector<KeyDelta>& out) {
+    out.clear();
+    auto a = before.items.begin();
+    auto b = after.items.begin();
+    while (a != before.items.end() || b != after.items.end()) {
+        if (b == after.items.end() || (a != before.items.end() && a->key < b->key)) {
+            out.push_back(KeyDelta{a->key, KeyChangeKind::Removed, before.value(*a), {}});
+            ++a;
+        } else if (a == before.items.end() || b->key < a->key) {
+            out.push_back(KeyDelta{b->key, KeyChangeKind::Added, {}, after.value(*b)});
+            ++b;
+        } else {
+            // 只比较哈希和长度，不比较值的内容
+            if (a->hash != b->hash || a->length != b->length) {
+                out.push_back(KeyDelta{a->key, KeyChangeKind::Modified, before.value(*a), after.value(*b)});
+            }
+            ++a;
+            ++b;
+        }
+    }
+}
+
+const ParsedConfig* KeyHistory::cached(const std::string& path, const git_oid& oid) const {
+    auto it = cache_.find(path);
+    if (it == cache_.end() || !git_oid_equal(&it->second.oid, &oid)) return nullptr;
+    return &it->second;
+}
+
+void KeyHistory::remember(const std::string& path, ParsedConfig&& parsed) {
+    auto it = cache_.find(path);
+    if (it != cache_.end()) {
+        cacheBytes_ -= it->second.data.size();
+        cache_.erase(it);
+    }
+    if (cacheBytes_ + parsed.data.size() > kMaxCacheBytes) {
+        cache_.clear();
+        cacheBytes_ = 0;
+    }
+    cacheBytes_ += parsed.data.size();
+    cache_.emplace(path, std::move(parsed));
+}
+
+size_t KeyHistory::record(const git_oid& commit, int64_t time, const std::vector<FileChange>& files,
+                          const BlobReader& read) {
+    if (logFd_ < 0) return 0;
+
+    std::string buffer(sizeof(RecordHeader), '\0');
+    std::vector<std::pair<uint64_t, uint64_t>> refs;  // (倒排键, 变更项相对记录头的位置)
+    std::vector<KeyDelta> deltas;
+    const ParsedConfig empty{};
+    uint32_t count = 0;
+
+    for (const FileChange& file : files) {
+        ParsedConfig before;
+        ParsedConfig after;
+        const ParsedConfig* old = &empty;
+        bool hasNew = false;
+        if (!isZero(file.oldOid)) {
+            // 上一次提交时已解析过的版本直接复用，不再读取旧内容
+            old = cached(file.path, file.oldOid);
+            std::string data;
+            if (!old) {
+                old = read(file.oldOid, data) && parse(file.path, file.oldOid, std::move(data), before)
+                    ? &before : &empty;
+            }
+        }
+        if (!isZero(file.newOid)) {
+            std::string data;
+            hasNew = read(file.newOid, data) && parse(file.path, file.newOid, std::move(data), after);
+            // 新版本无法解析（例如编辑到一半的 JSON）时不记录，避免把全部键记为删除
+            if (!hasNew) old = &empty;
+        }
+        if (old == &empty && !hasNew) {
+            auto it = cache_.find(file.path);
+            if (it != cache_.end()) {
+                cacheBytes_ -= it->second.data.size();
+                cache_.erase(it);
+            }
+            continue;
+        }
+
+        diff(*old, after, deltas);
+        PathId path = names_.intern(file.path);
+        for (const KeyDelta& delta : deltas) {
+            EntryHeader header{};
+            header.path = path;
+            header.key = delta.key;
+            header.oldLength = static_cast<uint32_t>(delta.oldValue.size());
+            header.newLength = static_cast<uint32_t>(delta.newValue.size());
+            header.kind = static_cast<uint8_t>(delta.kind);
+            refs.emplace_back(postingKey(path, delta.key), buffer.size());
+            buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+            buffer.append(delta.oldValue);
+            buffer.append(delta.newValue);
+            ++count;
+        }
+
+        if (hasNew) {
+            remember(file.path, std::move(after));
+        } else {
+            auto it = cache_.find(file.path);
+            if (it != cache_.end()) {
+                cacheBytes_ -= it->second.data.size();
+                cache_.erase(it);
+            }
+        }
+    }
+    if (count == 0) return 0;
+
+    RecordHeader record{};
+    record.magic = kRecordMagic;
+    record.count = count;
+    record.time = time;
+    git_oid_cpy(&record.commit, &commit);
+    record.bytes = static_cast<uint32_t>(buffer.size() - sizeof(RecordHeader));
+    std::memcpy(&buffer[0], &record, sizeof(record));
+
+    // 名字先落盘，记录中引用的 ID 在重新加载时一定存在
+    if (!persistNames()) return 0;
+    if (!writeAll(logFd_, buffer.data(), buffer.size())) {
+        CT_LOG(Error) << "Error writing key history: " << std::strerror(errno);
+        int ignored = ftruncate(logFd_, static_cast<off_t>(logSize_));
+        (void)ignored;
+        return 0;
+    }
+
+    uint32_t index = static_cast<uint32_t>(commits_.size());
+    commits_.push_back(CommitEntry{commit, time, logSize_, count});
+    commitByOid_[oidKey(commit)] = index;
+    for (const auto& ref : refs) {
+        postings_[ref.first].push_back(ChangeRef{index, logSize_ + ref.second});
+    }
+    logSize_ += buffer.size();
+    return count;
+}
+
+bool KeyHistory::readChange(const ChangeRef& ref, KeyChange& out) const {
+    EntryHeader header;
+    if (!readAt(logFd_, ref.offset, &header, sizeof(header))) return false;
+    const CommitEntry& commit = commits_[ref.commit];
+    out.commit = hexOf(commit.oid);
+    out.time = commit.time;
+    out.path = std::string(names_.path(header.path));
+    out.key = std::string(names_.path(header.key));
+    out.kind = static_cast<KeyChangeKind>(header.kind);
+    out.oldValue.resize(header.oldLength);
+    out.newValue.resize(header.newLength);
+    uint64_t offset = ref.offset + sizeof(header);
+    return (header.oldLength == 0 || readAt(logFd_, offset, &out.oldValue[0], header.oldLength)) &&
+           (header.newLength == 0 || readAt(logFd_, offset + header.oldLength, &out.newValue[0], header.newLength));
+}
+
+std::vector<KeyChange> KeyHistory::changesOf(const git_oid& commit) const {
+    std::vector<KeyChange> result;
+    auto it = commitByOid_.find(oidKey(commit));
+    if (it == commitByOid_.end()) return result;
+    const CommitEntry& entry = commits_[it->second];
+    ChangeRef ref{it->second, entry.offset + sizeof(RecordHeader)};
+    for (uint32_t i = 0; i < entry.count; ++i) {
+        KeyChange change;
+        if (!readChange(ref, change)) break;
+        ref.offset += sizeof(EntryHeader) + change.oldValue.size() + change.newValue.size();
+        result.push_back(std::move(change));
+    }
+    return result;
+}
+
+std::vector<KeyChange> KeyHistory::history(std::string_view path, std::string_view key, size_t limit) const {
+    std::vector<KeyChange> result;
+    PathId pathId = names_.find(path);
+    PathId keyId = names_.find(key);
+    if (pathId == kInvalidPathId || keyId == kInvalidPathId) return result;
+    auto it = postings_.find(postingKey(pathId, keyId));
+    if (it == postings_.end()) return result;
+    for (auto ref = it->second.rbegin(); ref != it->second.rend(); ++ref) {
+        if (limit > 0 && result.size() >= limit) break;
+        KeyChange change;
+        if (readChange(*ref, change)) result.push_back(std::move(change));
+    }
+    return result;
+}
+
+bool KeyHistory::remap(const std::vector<std::pair<git_oid, git_oid>>& mapping) {
+    // 缓存中的键 ID 可能还没有写入名字表，先落盘，重新加载后 ID 不变
+    if (logFd_ < 0 || !persistNames()) return false;
+    std::unordered_map<std::string, git_oid> newOid;
+    for (const auto& item : mapping) {
+        newOid[oidKey(item.first)] = item.second;
+    }
+
+    // 写出新的记录文件后整体替换
+    std::string logPath = (std::filesystem::path(dir_) / "keys.log").string();
+    std::string tmpPath = logPath + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        CT_LOG(Error) << "Error rewriting key history: " << std::strerror(errno);
+        return false;
+    }
+    FileHeader header;
+    bool ok = readAt(logFd_, 0, &header, sizeof(header)) && writeAll(fd, &header, sizeof(header));
+    std::string buffer;
+    for (const CommitEntry& commit : commits_) {
+        if (!ok) break;
+        auto it = newOid.find(oidKey(commit.oid));
+        if (it == newOid.end()) continue;
+        RecordHeader record;
+        ok = readAt(logFd_, commit.offset, &record, sizeof(record));
+        if (!ok) break;
+        buffer.resize(sizeof(record) + record.bytes);
+        ok = readAt(logFd_, commit.offset, &buffer[0], buffer.size());
+        git_oid_cpy(&record.commit, &it->second);
+        std::memcpy(&buffer[0], &record, sizeof(record));
+        ok = ok && writeAll(fd, buffer.data(), buffer.size());
+    }
+    ok = ok && fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || rename(tmpPath.c_str(), logPath.c_str()) != 0) {
+        CT_LOG(Error) << "Error rewriting key history: " << std::strerror(errno);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    // 重新加载，解析缓存按内容 oid 保存，与提交无关，可以保留
+    auto cache = std::move(cache_);
+    size_t cacheBytes = cacheBytes_;
+    std::string dir = dir_;
+    if (!open(dir)) return false;
+    cache_ = std::move(cache);
+    cacheBytes_ = cacheBytes;
+    return true;
+}
@@ -0,0 +1,172 @@
+#include "configtracker/logger.h"
+#include "configtracker/metrics.h"
+
+#include <cstdlib>
+#include <ctime>
+
+using namespace configtracker;
+
+namespace {
+
+const char* levelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Trace: return "TRACE";
+    case LogLevel::Debug: return "DEBUG";
+    case LogLevel::Info:  return "INFO ";
+    case LogLevel::Warn:  return "WARN ";
+    case LogLevel::Error: return "ERROR";
+    default:              return "";
+    }
+}
+
+Counter& droppedCounter() {
+    static Counter& counter = MetricsRegistry::global().counter(
+        "configtracker_log_dropped_total", "Log messages dropped because the log queue was full");
+    return counter;
+}
+
+}
+
+std::atomic<int> Logger::level_{static_cast<int>(LogLevel::Info)};
+
+Logger::Logger() : queue_(8192) {}
+
+Logger& Logger::instance() {
+    // 不析构：退出时由 atexit 写出剩余日志，之后仍可安全调用
+    static Logger* logger = [] {
+        Logger* created = new Logger();
+        std::atexit([] { Logger::instance().shutdown(); });
+        return created;
+    }();
+    return *logger;
+}
+
+bool Logger::setFile(const std::string& path) {
+    FILE* file = nullptr;
+    if (!path.empty()) {
+        file = std::fopen(path.c_str(), "a");
+        if (!file) {
+            CT_LOG(Error) << "Error opening log file: " << path;
+            return false;
+        }
+    }
+    flush();
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    if (file_) std::fclose(file_);
+    file_ = file;
+    return true;
+}
+
+void Logger::submit(LogLevel level, std::string message) {
+    Record record;
+    record.level = level;
+    record.time = std::chrono::system_clock::now();
+    record.message = std::move(message);
+
+    if (stopped_.load()) {
+        write(record);
+        return;
+    }
+    if (!started_.load(std::memory_order_acquire)) {
+        start();
+    }
+    if (!queue_.tryPush(record)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        droppedCounter().add();
+        // 警告和错误不能丢
+        if (level >= LogLevel::Warn) {
+            write(record);
+        }
+        return;
+    }
+    submitted_.fetch_add(1);
+    wake();
+}
+
+void Logger::start() {
+    std::lock_guard<std::mutex> lock(startMutex_);
+    if (started_.load() || stopped_.load()) return;
+    thread_ = std::thread([this]() { run(); });
+    started_.store(true, std::memory_order_release);
+}
+
+void Logger::wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load()) {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        wakeCv_.notify_one();
+    }
+}
+
+void Logger::run() {
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    while (!stopped_.load()) {
+        lock.unlock();
+        drainQueue();
+        lock.lock();
+        writtenCv_.notify_all();
+
+        waiting_.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (queue_.empty() && !stopped_.load()) {
+            wakeCv_.wait(lock);
+        }
+        waiting_.store(false, std::memory_order_relaxed);
+    }
+}
+
+void Logger::drainQueue() {
+    Record record;
+    bool any = false;
+    while (queue_.tryPop(record)) {
+        write(record);
+        written_.fetch_add(1);
+        any = true;
+    }
+    if (any) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        std::fflush(file_ ? file_ : stdout);
+    }
+}
+
+void Logger::flush() {
+    if (!started_.load() || stopped_.load()) return;
+    uint64_t target = submitted_.load();
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    wakeCv_.notify_one();
+    writtenCv_.wait(lock, [this, target] { return written_.load() >= target || stopped_.load(); });
+}
+
+void Logger::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(startMutex_);
+        if (stopped_.exchange(true)) return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        wakeCv_.notify_all();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    // 后台线程已退出，由这里作为唯一的消费者写出剩余日志
+    drainQueue();
+    writtenCv_.notify_all();
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    if (file_) std::fflush(file_);
+}
+
+void Logger::write(const Record& record) {
+    auto seconds = std::chrono::system_clock::to_time_t(record.time);
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(
+        record.time.time_since_epoch()).count() % 1000;
+    std::tm tm{};
+    localtime_r(&seconds, &tm);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    FILE* out = file_ ? file_ : (record.level >= LogLevel::Warn ? stderr : stdout);
+    std::fprintf(out, "%s.%03d %s %s\n", stamp, static_cast<int>(millis), levelName(record.level),
+                 record.message.c_str());
+}
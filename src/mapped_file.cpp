@@ -0,0 +1,94 @@
+#include "configtracker/mapped_file.h"
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace configtracker;
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    if (fstat(fd, &info_) != 0) {
+        int saved = errno;
+        ::close(fd);
+        errno = saved;
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(info_.st_size);
+    if (size == 0 || !S_ISREG(info_.st_mode)) {
+        ::close(fd);
+        return true;
+    }
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int saved = errno;
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        errno = saved;
+        return false;
+    }
+    data_ = static_cast<char*>(mapped);
+    size_ = size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) {
+        munmap(data_, size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+void MappedFile::adviseSequential() const {
+    if (data_) {
+        madvise(data_, size_, MADV_SEQUENTIAL);
+    }
+}
+
+bool configtracker::readFile(const std::string& path, std::string& out, struct stat* info) {
+    out.clear();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int saved = errno;
+        ::close(fd);
+        errno = saved;
+        return false;
+    }
+    if (info) *info = st;
+    if (!S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return true;
+    }
+
+    // 按 fstat 的长度读取，读满后再试一次，文件在此期间变长时继续读到末尾
+    size_t length = 0;
+    out.resize(static_cast<size_t>(st.st_size) + 1);
+    while (true) {
+        if (length == out.size()) {
+            out.resize(out.size() * 2);
+        }
+        ssize_t n = ::read(fd, &out[length], out.size() - length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            int saved = errno;
+            ::close(fd);
+            out.clear();
+            errno = saved;
+            return false;
+        }
+        if (n == 0) break;
+        length += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    out.resize(length);
+    return true;
+}
@@ -0,0 +1,252 @@
+#include "configtracker/metrics.h"
+#include "configtracker/logger.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace configtracker;
+
+size_t configtracker::metricsShard() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t Histogram::bucketOf(uint64_t value) {
+    if (value < kSubBuckets) {
+        return static_cast<size_t>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    size_t mantissa = static_cast<size_t>(value >> (msb - kSubBucketBits));
+    return static_cast<size_t>(msb - kSubBucketBits + 1) * kSubBuckets + (mantissa - kSubBuckets);
+}
+
+uint64_t Histogram::bucketUpperBound(size_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    int shift = static_cast<int>(bucket / kSubBuckets) - 1;
+    uint64_t mantissa = bucket % kSubBuckets + kSubBuckets;
+    uint64_t upper = ((mantissa + 1) << shift) - 1;
+    // 最后一个桶的上界会溢出
+    return upper < (mantissa << shift) ? UINT64_MAX : upper;
+}
+
+void Histogram::record(uint64_t value) {
+    counts_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot snapshot;
+    std::vector<uint64_t> counts(kBuckets);
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        counts[i] = counts_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    snapshot.count = total;
+    snapshot.sum = static_cast<double>(sum_.load(std::memory_order_relaxed)) * unitScale_;
+    snapshot.max = static_cast<double>(max) * unitScale_;
+    if (total == 0) return snapshot;
+
+    // 分位数取所在桶的上界，但不超过记录到的最大值
+    auto percentile = [&](double q) {
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total) + 0.5);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return static_cast<double>(std::min(bucketUpperBound(i), max)) * unitScale_;
+            }
+        }
+        return snapshot.max;
+    };
+    snapshot.p50 = percentile(0.50);
+    snapshot.p90 = percentile(0.90);
+    snapshot.p99 = percentile(0.99);
+    snapshot.p999 = percentile(0.999);
+    return snapshot;
+}
+
+MetricsRegistry& MetricsRegistry::global() {
+    // 不析构：退出阶段的后台线程仍可能更新指标
+    static MetricsRegistry* registry = new MetricsRegistry();
+    return *registry;
+}
+
+CoreMetrics& CoreMetrics::get() {
+    static CoreMetrics* metrics = [] {
+        MetricsRegistry& r = MetricsRegistry::global();
+        return new CoreMetrics{
+            r.histogram("configtracker_scan_duration_seconds", "Duration of a full scan of the watched paths"),
+            r.counter("configtracker_watch_candidates_total", "Paths reported by the watch backends"),
+            r.counter("configtracker_events_detected_total", "File changes confirmed by content hash"),
+            r.histogram("configtracker_git_add_seconds", "Time to stage a batch of files"),
+            r.histogram("configtracker_git_tree_write_seconds", "Time to write the tree of a commit"),
+            r.counter("configtracker_git_trees_written_total", "Tree objects (directories) rewritten by commits"),
+            r.histogram("configtracker_git_commit_seconds", "Time to create a commit"),
+            r.counter("configtracker_commits_total", "Commits created"),
+            r.gauge("configtracker_commit_queue_depth", "Events waiting in the commit queue"),
+            r.histogram("configtracker_commit_batch_files", "Files per auto commit batch", 1.0),
+            r.counter("configtracker_events_coalesced_total", "Events coalesced because the commit queue was full"),
+            r.counter("configtracker_events_blocked_total", "Events that waited because the commit queue was full"),
+            r.counter("configtracker_events_dropped_total", "Events dropped because the commit queue was full"),
+            r.histogram("configtracker_key_diff_seconds", "Time to diff the keys of the files in a commit"),
+            r.counter("configtracker_key_changes_total", "Key-level changes recorded"),
+            r.histogram("configtracker_maintenance_seconds", "Duration of a pack maintenance pass"),
+            r.counter("configtracker_objects_packed_total", "Loose objects moved into packs"),
+            r.counter("configtracker_objects_pruned_total", "Stale loose objects and packs removed after a full repack"),
+            r.histogram("configtracker_journal_append_seconds", "Time to append a change to the journal"),
+            r.histogram("configtracker_journal_fold_seconds", "Time to fold journaled changes into a commit"),
+            r.counter("configtracker_subscriber_batches_total", "Change batches delivered to subscribers"),
+            r.counter("configtracker_subscriber_drops_total", "Change batches dropped because a subscriber queue was full"),
+        };
+    }();
+    return *metrics;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& entry = entries_[name];
+    if (!entry.counter) {
+        entry.help = help;
+        entry.counter = std::make_unique<Counter>();
+    }
+    return *entry.counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& entry = entries_[name];
+    if (!entry.gauge) {
+        entry.help = help;
+        entry.gauge = std::make_unique<Gauge>();
+    }
+    return *entry.gauge;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, double unitScale) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& entry = entries_[name];
+    if (!entry.histogram) {
+        entry.help = help;
+        entry.histogram = std::make_unique<Histogram>(unitScale);
+    }
+    return *entry.histogram;
+}
+
+MetricsSnapshot MetricsRegistry::snapshot() const {
+    MetricsSnapshot snapshot;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& item : entries_) {
+        const Entry& entry = item.second;
+        if (entry.counter) snapshot.counters[item.first] = entry.counter->value();
+        if (entry.gauge) snapshot.gauges[item.first] = entry.gauge->value();
+        if (entry.histogram) snapshot.histograms[item.first] = entry.histogram->snapshot();
+    }
+    return snapshot;
+}
+
+std::string MetricsRegistry::prometheusText() const {
+    std::ostringstream out;
+    out.precision(9);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& item : entries_) {
+        const std::string& name = item.first;
+        const Entry& entry = item.second;
+        out << "# HELP " << name << " " << entry.help << "\n";
+        if (entry.counter) {
+            out << "# TYPE " << name << " counter\n";
+            out << name << " " << entry.counter->value() << "\n";
+        } else if (entry.gauge) {
+            out << "# TYPE " << name << " gauge\n";
+            out << name << " " << entry.gauge->value() << "\n";
+        } else if (entry.histogram) {
+            HistogramSnapshot h = entry.histogram->snapshot();
+            out << "# TYPE " << name << " summary\n";
+            out << name << "{quantile=\"0.5\"} " << h.p50 << "\n";
+            out << name << "{quantile=\"0.9\"} " << h.p90 << "\n";
+            out << name << "{quantile=\"0.99\"} " << h.p99 << "\n";
+            out << name << "{quantile=\"0.999\"} " << h.p999 << "\n";
+            out << name << "_sum " << h.sum << "\n";
+            out << name << "_count " << h.count << "\n";
+        }
+    }
+    return out.str();
+}
+
+bool MetricsRegistry::dumpPrometheus(const std::string& target) const {
+    std::string text = prometheusText();
+
+    if (target.rfind("unix:", 0) == 0) {
+        std::string socketPath = target.substr(5);
+        sockaddr_un addr{};
+        if (socketPath.size() >= sizeof(addr.sun_path)) {
+            CT_LOG(Error) << "Metrics socket path too long: " << socketPath;
+            return false;
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            CT_LOG(Error) << "Error connecting to metrics socket " << socketPath << ": " << std::strerror(errno);
+            if (fd >= 0) close(fd);
+            return false;
+        }
+        size_t written = 0;
+        while (written < text.size()) {
+            ssize_t n = send(fd, text.data() + written, text.size() - written, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                CT_LOG(Error) << "Error writing metrics socket " << socketPath << ": " << std::strerror(errno);
+                close(fd);
+                return false;
+            }
+            written += static_cast<size_t>(n);
+        }
+        close(fd);
+        return true;
+    }
+
+    // 先写临时文件再改名，采集端不会读到写了一半的内容
+    std::string tmpPath = target + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::trunc);
+        out << text;
+        if (!out) {
+            CT_LOG(Error) << "Error writing metrics file: " << tmpPath;
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, target, ec);
+    if (ec) {
+        CT_LOG(Error) << "Error replacing metrics file: " << ec.message();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,386 @@
+#include "configtracker/git_repo_manager.h"
+#include "configtracker/logger.h"
+#include "configtracker/metrics.h"
+#include <git2/sys/midx.h>
+#include <algorithm>
+#include <functional>
+
+#include <unistd.h>
+
+using namespace configtracker;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 删除一个文件按一个块计入 I/O 预算
+constexpr uint64_t kUnlinkCost = 4096;
+
+void printGitError(const char* what) {
+    const git_error* e = git_error_last();
+    CT_LOG(Error) << what << ": " << (e ? e->message : "unknown error");
+}
+
+int64_t mtimeOf(const struct stat& st) {
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+// CPU 和 I/O 预算：忙碌一段时间后按比例休息，写入和删除的字节数按平均速率摊开。
+// 等待期间检查停止标志，返回 false 表示需要中止
+class Budget {
+public:
+    Budget(const MaintenanceOptions& options, const std::atomic<bool>& stop)
+        : cpuShare_(std::clamp(options.cpuPercent, 1, 100) / 100.0),
+          ioRate_(options.ioBytesPerSec),
+          stop_(stop),
+          busySince_(Clock::now()),
+          ioStart_(Clock::now()) {}
+
+    bool pause() {
+        auto busy = Clock::now() - busySince_;
+        if (cpuShare_ < 1.0 && busy >= std::chrono::milliseconds(10)) {
+            sleepFor(std::chrono::duration_cast<Clock::duration>(busy * ((1.0 - cpuShare_) / cpuShare_)));
+            busySince_ = Clock::now();
+        }
+        return !stop_;
+    }
+
+    bool consume(uint64_t bytes) {
+        if (ioRate_ > 0) {
+            ioBytes_ += bytes;
+            auto due = ioStart_ + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(static_cast<double>(ioBytes_) / static_cast<double>(ioRate_)));
+            auto now = Clock::now();
+            if (due > now) {
+                sleepFor(due - now);
+            }
+        }
+        return pause();
+    }
+
+private:
+    double cpuShare_;
+    uint64_t ioRate_;
+    uint64_t ioBytes_ = 0;
+    const std::atomic<bool>& stop_;
+    Clock::time_point busySince_;
+    Clock::time_point ioStart_;
+
+    // 分段睡眠，停止时尽快返回；睡眠的时间不计入忙碌时间
+    void sleepFor(Clock::duration duration) {
+        auto begin = Clock::now();
+        auto until = begin + duration;
+        while (!stop_) {
+            auto now = Clock::now();
+            if (now >= until) break;
+            std::this_thread::sleep_for(std::min<Clock::duration>(until - now, std::chrono::milliseconds(50)));
+        }
+        busySince_ += Clock::now() - begin;
+    }
+};
+
+int packProgress(int, uint32_t, uint32_t, void* payload) {
+    return static_cast<Budget*>(payload)->pause() ? 0 : -1;
+}
+
+int indexerProgress(const git_indexer_progress*, void* payload) {
+    return static_cast<Budget*>(payload)->pause() ? 0 : -1;
+}
+
+struct LooseObject {
+    git_oid oid;
+    std::string path;
+    int64_t mtime = 0;
+};
+
+// 按扇出目录扫描松散对象，最多 limit 个
+void scanLoose(const std::string& objectsDir, size_t limit, std::vector<LooseObject>& out) {
+    static const char hex[] = "0123456789abcdef";
+    for (int i = 0; i < 256 && out.size() < limit; ++i) {
+        std::string prefix = {hex[i >> 4], hex[i & 15]};
+        std::error_code ec;
+        std::filesystem::directory_iterator it(objectsDir + prefix, ec);
+        for (std::filesystem::directory_iterator end; !ec && it != end && out.size() < limit; it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            // 写了一半的临时文件名字长度不同，跳过
+            if (name.size() != GIT_OID_HEXSZ - 2) continue;
+            LooseObject object;
+            struct stat st;
+            if (git_oid_fromstr(&object.oid, (prefix + name).c_str()) < 0 ||
+                stat(it->path().c_str(), &st) != 0) {
+                continue;
+            }
+            object.path = it->path().string();
+            object.mtime = mtimeOf(st);
+            out.push_back(std::move(object));
+        }
+    }
+}
+
+struct PackFile {
+    std::string base;   // 去掉 .pack 后缀的完整路径
+    int64_t mtime = 0;
+    bool keep = false;
+};
+
+void listPacks(const std::string& packDir, std::vector<PackFile>& out) {
+    std::error_code ec;
+    std::filesystem::directory_iterator it(packDir, ec);
+    for (std::filesystem::directory_iterator end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != ".pack") continue;
+        PackFile pack;
+        struct stat st;
+        if (stat(it->path().c_str(), &st) != 0) continue;
+        pack.base = (it->path().parent_path() / it->path().stem()).string();
+        pack.mtime = mtimeOf(st);
+        pack.keep = std::filesystem::exists(pack.base + ".keep", ec);
+        out.push_back(std::move(pack));
+    }
+}
+
+// 先删 .idx，新打开的读者不会再找到这个包
+void removePack(const PackFile& pack) {
+    for (const char* ext : {".idx", ".pack", ".rev", ".bitmap", ".mtimes"}) {
+        ::unlink((pack.base + ext).c_str());
+    }
+}
+
+// 单线程打包并按预算写盘，返回新包的名字（pack-<hash>）
+bool writePack(git_repository* repo, Budget& budget, const std::function<bool(git_packbuilder*)>& fill,
+               std::string& name) {
+    git_packbuilder* pb = nullptr;
+    if (git_packbuilder_new(&pb, repo) < 0) {
+        printGitError("Error creating pack builder");
+        return false;
+    }
+    git_packbuilder_set_threads(pb, 1);
+    git_packbuilder_set_callbacks(pb, packProgress, &budget);
+
+    bool ok = fill(pb);
+    if (ok && git_packbuilder_object_count(pb) == 0) {
+        ok = false;
+    } else if (ok) {
+        if (git_packbuilder_write(pb, nullptr, 0, indexerProgress, &budget) < 0) {
+            printGitError("Error writing pack");
+            ok = false;
+        } else {
+            char hash[GIT_OID_HEXSZ + 1] = {0};
+            git_oid_fmt(hash, git_packbuilder_hash(pb));
+            name = std::string("pack-") + hash;
+            // 写包过程中拿不到准确的字节数，写完后按文件大小计入预算，后续操作相应推迟
+            std::string base = std::string(git_repository_path(repo)) + "objects/pack/" + name;
+            std::error_code ec;
+            for (const char* ext : {".pack", ".idx"}) {
+                uintmax_t size = std::filesystem::file_size(base + ext, ec);
+                if (!ec) budget.consume(size);
+            }
+        }
+    }
+    git_packbuilder_free(pb);
+    return ok;
+}
+
+// 多包索引覆盖目录中的全部包；只剩一个包时删除
+void updateMultiPackIndex(const std::string& packDir) {
+    std::string midx = packDir + "multi-pack-index";
+    std::vector<PackFile> packs;
+    listPacks(packDir, packs);
+    if (packs.size() < 2) {
+        ::unlink(midx.c_str());
+        return;
+    }
+    git_midx_writer* writer = nullptr;
+    if (git_midx_writer_new(&writer, packDir.c_str()) < 0) {
+        printGitError("Error creating multi-pack index writer");
+        return;
+    }
+    bool ok = true;
+    for (const auto& pack : packs) {
+        if (git_midx_writer_add(writer, (pack.base + ".idx").c_str()) < 0) {
+            ok = false;
+            break;
+        }
+    }
+    if (!ok || git_midx_writer_commit(writer) < 0) {
+        printGitError("Error writing multi-pack index");
+        ::unlink(midx.c_str());
+    }
+    git_midx_writer_free(writer);
+}
+
+}
+
+void GitRepoManager::startMaintenance(const MaintenanceOptions& options) {
+    stopMaintenance();
+    maintenanceStop_ = false;
+    maintenanceThread_ = std::thread(&GitRepoManager::maintenanceLoop, this, options);
+}
+
+void GitRepoManager::stopMaintenance() {
+    {
+        std::lock_guard<std::mutex> lock(maintenanceMutex_);
+        maintenanceStop_ = true;
+    }
+    maintenanceCv_.notify_all();
+    if (maintenanceThread_.joinable()) {
+        maintenanceThread_.join();
+    }
+}
+
+void GitRepoManager::maintenanceLoop(MaintenanceOptions options) {
+    std::unique_lock<std::mutex> lock(maintenanceMutex_);
+    while (!maintenanceStop_) {
+        maintenanceCv_.wait_for(lock, options.interval, [this] { return maintenanceStop_ || maintenanceWake_; });
+        if (maintenanceStop_) break;
+        maintenanceWake_ = false;
+        lock.unlock();
+        runMaintenance(options);
+        lock.lock();
+    }
+}
+
+MaintenanceStats GitRepoManager::runMaintenance(const MaintenanceOptions& options) {
+    std::lock_guard<std::mutex> pass(passMutex_);
+    MaintenanceStats stats;
+    std::string gitDir;
+    bool prune = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!repo_) {
+            CT_LOG(Error) << "Error: Repository not initialized";
+            return stats;
+        }
+        gitDir = git_repository_path(repo_);
+        prune = checkpoint_.prunePending;
+    }
+    CoreMetrics& metrics = CoreMetrics::get();
+    ScopedTimer timer(metrics.maintenance);
+
+    // 维护使用独立的仓库句柄，打包和写盘期间不占用提交路径的锁
+    git_repository* repo = nullptr;
+    if (git_repository_open(&repo, gitDir.c_str()) < 0) {
+        printGitError("Error opening repository for maintenance");
+        return stats;
+    }
+    std::string objectsDir = gitDir + "objects/";
+    std::string packDir = objectsDir + "pack/";
+    Budget budget(options, maintenanceStop_);
+
+    // 增量：把一批松散对象写成一个包，然后删除松散副本
+    std::vector<LooseObject> loose;
+    scanLoose(objectsDir, std::max<size_t>(options.maxObjectsPerPack, 1), loose);
+    stats.looseFound = loose.size();
+    std::string name;
+    if (loose.size() >= std::max<size_t>(options.looseThreshold, 1) &&
+        writePack(repo, budget, [&loose](git_packbuilder* pb) {
+            for (const auto& object : loose) {
+                if (git_packbuilder_insert(pb, &object.oid, nullptr) < 0) {
+                    printGitError("Error adding object to pack");
+                    return false;
+                }
+            }
+            return true;
+        }, name)) {
+        ++stats.packsWritten;
+        for (const auto& object : loose) {
+            if (!budget.consume(kUnlinkCost)) break;
+            if (::unlink(object.path.c_str()) == 0) ++stats.objectsPacked;
+        }
+        metrics.objectsPacked.add(stats.objectsPacked);
+    }
+
+    // 全量：历史压缩后或包太多时，把可达对象重新写成一个包，删除旧包和过期的松散对象。
+    // 根为全部引用加上内存索引中暂存的 blob；在记录根之前以及之后被写入或刷新过（mtime 更新）的文件都保留
+    std::vector<PackFile> packs;
+    listPacks(packDir, packs);
+    if (!maintenanceStop_ && (prune || packs.size() > options.maxPacks)) {
+        auto expire = std::chrono::system_clock::now() - options.pruneGrace;
+        int64_t cutoff = std::chrono::duration_cast<std::chrono::nanoseconds>(expire.time_since_epoch()).count();
+        std::vector<git_oid> staged;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            collectIndexBlobsLocked(staged);
+        }
+        git_revwalk* walker = nullptr;
+        bool written = false;
+        if (git_revwalk_new(&walker, repo) < 0) {
+            printGitError("Error creating revision walker");
+        } else {
+            git_revwalk_push_glob(walker, "refs/*");
+            git_revwalk_push_head(walker);
+            written = writePack(repo, budget, [walker, &staged](git_packbuilder* pb) {
+                if (git_packbuilder_insert_walk(pb, walker) < 0) {
+                    printGitError("Error adding history to pack");
+                    return false;
+                }
+                for (const auto& blob : staged) {
+                    git_packbuilder_insert(pb, &blob, nullptr);
+                }
+                return true;
+            }, name);
+        }
+        git_revwalk_free(walker);
+
+        if (written && !maintenanceStop_) {
+            ++stats.packsWritten;
+            stats.fullRepack = true;
+            ::unlink((packDir + "multi-pack-index").c_str());
+            for (const auto& pack : packs) {
+                if (pack.keep || pack.mtime >= cutoff ||
+                    std::filesystem::path(pack.base).filename() == name) {
+                    continue;
+                }
+                if (!budget.consume(kUnlinkCost)) break;
+                removePack(pack);
+                ++stats.packsRemoved;
+            }
+            loose.clear();
+            scanLoose(objectsDir, std::max<size_t>(options.maxObjectsPerPack, 1), loose);
+            for (const auto& object : loose) {
+                if (object.mtime >= cutoff) continue;
+                if (!budget.consume(kUnlinkCost)) break;
+                if (::unlink(object.path.c_str()) == 0) ++stats.looseRemoved;
+            }
+            metrics.objectsPruned.add(stats.packsRemoved + stats.looseRemoved);
+        }
+    }
+
+    if (stats.packsWritten > 0) {
+        updateMultiPackIndex(packDir);
+    }
+    git_repository_free(repo);
+
+    if (stats.packsWritten > 0 || stats.fullRepack) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refreshObjectsLocked();
+        if (stats.fullRepack && prune) {
+            checkpoint_.prunePending = false;
+            saveCheckpoint();
+        }
+    }
+    if (stats.packsWritten > 0) {
+        CT_LOG(Info) << "[Git] Maintenance packed " << stats.objectsPacked << " loose objects"
+                     << (stats.fullRepack ? ", full repack" : "") << ", removed "
+                     << stats.packsRemoved << " packs and " << stats.looseRemoved << " stale objects";
+    }
+    return stats;
+}
+
+void GitRepoManager::collectIndexBlobsLocked(std::vector<git_oid>& out) {
+    if (!index_) return;
+    size_t count = git_index_entrycount(index_);
+    out.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const git_index_entry* entry = git_index_get_byindex(index_, i);
+        if (entry) out.push_back(entry->id);
+    }
+}
+
+void GitRepoManager::refreshObjectsLocked() {
+    // 提交路径的句柄重新扫描包目录，找到新写入的包
+    git_odb* odb = nullptr;
+    if (repo_ && git_repository_odb(&odb, repo_) == 0) {
+        git_odb_refresh(odb);
+        git_odb_free(odb);
+    }
+}
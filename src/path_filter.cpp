@@ -0,0 +1,30 @@
+#include "configtracker/path_filter.h"
+#include <fnmatch.h>
+
+using namespace configtracker;
+
+bool PathFilter::matches(const std::vector<std::string>& patterns, std::string_view relativePath) {
+    if (patterns.empty()) return false;
+
+    // fnmatch 需要以 '\0' 结尾的字符串
+    std::string path(relativePath);
+    size_t slash = path.find_last_of('/');
+    const char* name = slash == std::string::npos ? path.c_str() : path.c_str() + slash + 1;
+
+    for (const auto& pattern : patterns) {
+        const char* subject = pattern.find('/') == std::string::npos ? name : path.c_str();
+        if (fnmatch(pattern.c_str(), subject, 0) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PathFilter::acceptFile(std::string_view relativePath) const {
+    if (matches(excludes_, relativePath)) return false;
+    return includes_.empty() || matches(includes_, relativePath);
+}
+
+bool PathFilter::acceptDirectory(std::string_view relativePath) const {
+    return !matches(excludes_, relativePath);
+}
@@ -0,0 +1,144 @@
+#include "configtracker/path_table.h"
+#include "configtracker/content_hash.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace configtracker;
+
+namespace {
+
+constexpr size_t kInitialCapacity = 1024;
+
+}
+
+std::string_view StringArena::store(std::string_view str) {
+    if (str.empty()) return std::string_view();
+    if (str.size() > remaining_) {
+        // reset 之后先复用放得下的旧块
+        while (next_ < blocks_.size() && blocks_[next_].size < str.size()) {
+            ++next_;
+        }
+        if (next_ < blocks_.size()) {
+            cursor_ = blocks_[next_].data.get();
+            remaining_ = blocks_[next_].size;
+        } else {
+            // 超过块大小的字符串按自身长度分配一块
+            size_t size = std::max(str.size(), blockSize_);
+            blocks_.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+            allocated_ += size;
+            cursor_ = blocks_.back().data.get();
+            remaining_ = size;
+        }
+        ++next_;
+    }
+    std::memcpy(cursor_, str.data(), str.size());
+    std::string_view stored(cursor_, str.size());
+    cursor_ += str.size();
+    remaining_ -= str.size();
+    return stored;
+}
+
+void StringArena::clear() {
+    blocks_.clear();
+    next_ = 0;
+    cursor_ = nullptr;
+    remaining_ = 0;
+    allocated_ = 0;
+}
+
+void StringArena::reset() {
+    next_ = 0;
+    cursor_ = nullptr;
+    remaining_ = 0;
+}
+
+PathTable::PathTable() {
+    slots_.assign(kInitialCapacity, Slot{0, kInvalidPathId});
+}
+
+uint32_t PathTable::hashPath(std::string_view path) {
+    return static_cast<uint32_t>(xxhash64(path.data(), path.size()));
+}
+
+PathId PathTable::intern(std::string_view path) {
+    uint32_t hash = hashPath(path);
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        Slot& slot = slots_[i];
+        if (slot.id == kInvalidPathId) {
+            PathId id = static_cast<PathId>(paths_.size());
+            paths_.push_back(arena_.store(path));
+            slot.hash = hash;
+            slot.id = id;
+            // 负载因子超过 0.7 时扩容
+            if (paths_.size() * 10 > slots_.size() * 7) {
+                rehash(slots_.size() * 2);
+            }
+            return id;
+        }
+        if (slot.hash == hash && paths_[slot.id] == path) {
+            return slot.id;
+        }
+    }
+}
+
+PathId PathTable::find(std::string_view path) const {
+    uint32_t hash = hashPath(path);
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots_[i];
+        if (slot.id == kInvalidPathId) {
+            return kInvalidPathId;
+        }
+        if (slot.hash == hash && paths_[slot.id] == path) {
+            return slot.id;
+        }
+    }
+}
+
+void PathTable::reserve(size_t count) {
+    paths_.reserve(count);
+    size_t capacity = slots_.size();
+    while (count * 10 > capacity * 7) {
+        capacity *= 2;
+    }
+    if (capacity != slots_.size()) {
+        rehash(capacity);
+    }
+}
+
+void PathTable::clear() {
+    slots_.assign(kInitialCapacity, Slot{0, kInvalidPathId});
+    paths_.clear();
+    arena_.clear();
+}
+
+void PathTable::reset() {
+    if (slots_.size() > kInitialCapacity && paths_.size() * 8 < slots_.size()) {
+        clear();
+        return;
+    }
+    std::fill(slots_.begin(), slots_.end(), Slot{0, kInvalidPathId});
+    paths_.clear();
+    arena_.reset();
+}
+
+size_t PathTable::memoryUsage() const {
+    return slots_.capacity() * sizeof(Slot) +
+           paths_.capacity() * sizeof(std::string_view) +
+           arena_.memoryUsage();
+}
+
+void PathTable::rehash(size_t capacity) {
+    std::vector<Slot> slots(capacity, Slot{0, kInvalidPathId});
+    size_t mask = capacity - 1;
+    for (const Slot& slot : slots_) {
+        if (slot.id == kInvalidPathId) continue;
+        size_t i = slot.hash & mask;
+        while (slots[i].id != kInvalidPathId) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+    slots_.swap(slots);
+}
@@ -0,0 +1,195 @@
+#include "configtracker/watch_backend.h"
+#include "configtracker/metrics.h"
+#include <algorithm>
+
+using namespace configtracker;
+
+bool PollingBackend::addWatch(const std::string& path) {
+    if (std::find(watchPaths_.begin(), watchPaths_.end(), path) == watchPaths_.end()) {
+        watchPaths_.push_back(path);
+    }
+    return true;
+}
+
+void PollingBackend::run(const ChangeCallback& onChange) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopRequested_) {
+        lock.unlock();
+        scanOnce(onChange);
+        lock.lock();
+        // 等待下一个轮询周期，stop 时可被提前唤醒
+        cv_.wait_for(lock, interval_, [this] { return stopRequested_; });
+    }
+}
+
+void PollingBackend::wakeup() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+    }
+    cv_.notify_all();
+}
+
+void PollingBackend::scanOnce(const ChangeCallback& onChange) {
+    ScopedTimer timer(CoreMetrics::get().scanDuration);
+    ++pass_;
+    passComplete_ = true;
+    for (const auto& path : watchPaths_) {
+        checkForChanges(path, onChange);
+    }
+    // 目录读取出错时无法区分文件是被删除还是没有扫描到，等下一轮完整扫描再判断
+    if (passComplete_) {
+        reportMissing(onChange);
+    }
+}
+
+size_t PollingBackend::memoryUsage() const {
+    return paths_.memoryUsage() + mtimes_.capacity() * sizeof(std::filesystem::file_time_type) +
+           seenPass_.capacity() * sizeof(uint32_t);
+}
+
+void PollingBackend::checkForChanges(const std::string& path, const ChangeCallback& onChange) {
+    // 比较文件的上一次修改时间，发现新文件或修改时回调
+    std::filesystem::path watchPath(path);
+    std::error_code ec;
+
+    if (!std::filesystem::exists(watchPath, ec)) {
+        // 监控路径本身不存在时其下的文件都已删除；无法判断时不上报
+        if (ec) passComplete_ = false;
+        return;
+    }
+    if (!std::filesystem::is_directory(watchPath, ec)) {
+        // 单个文件的情况
+        checkFile(watchPath, onChange);
+        return;
+    }
+
+    if (scanOptions_.threads > 1) {
+        parallelScan(path, onChange);
+        return;
+    }
+
+    const PathFilter& filter = scanOptions_.filter;
+    size_t rootLength = path.size();
+
+    if (scanOptions_.recursive) {
+        auto options = std::filesystem::directory_options::skip_permission_denied;
+        std::filesystem::recursive_directory_iterator it(watchPath, options, ec), end;
+        for (; !ec && it != end; it.increment(ec)) {
+            const auto& entry = *it;
+            std::error_code entryEc;
+            std::string_view relative = relativeToRoot(entry.path().native(), rootLength);
+            if (entry.is_directory(entryEc)) {
+                // 被排除的目录整棵子树都不进入
+                if (!filter.acceptDirectory(relative)) {
+                    it.disable_recursion_pending();
+                }
+                continue;
+            }
+            if (entry.is_regular_file(entryEc) && filter.acceptFile(relative)) {
+                checkFile(entry.path(), onChange);
+            }
+        }
+    } else {
+        for (const auto& entry : std::filesystem::directory_iterator(watchPath, ec)) {
+            std::error_code entryEc;
+            std::string_view relative = relativeToRoot(entry.path().native(), rootLength);
+            if (entry.is_regular_file(entryEc) && filter.acceptFile(relative)) {
+                checkFile(entry.path(), onChange);
+            }
+        }
+    }
+    if (ec) passComplete_ = false;
+}
+
+void PollingBackend::checkFile(const std::filesystem::path& file, const ChangeCallback& onChange) {
+    std::error_code ec;
+    auto now = std::filesystem::last_write_time(file, ec);
+    if (ec) return;  // 扫描期间被删除
+
+    mergeResult(file.native(), now, onChange);
+}
+
+void PollingBackend::mergeResult(const std::string& path, std::filesystem::file_time_type mtime,
+                                 const ChangeCallback& onChange) {
+    PathId id = paths_.intern(path);
+    if (id == mtimes_.size()) {
+        // 新文件
+        mtimes_.push_back(mtime);
+        seenPass_.push_back(pass_);
+        onChange(path);
+        return;
+    }
+    seenPass_[id] = pass_;
+    if (mtimes_[id] != mtime) {
+        // 文件已修改，或删除后重新出现
+        mtimes_[id] = mtime;
+        onChange(path);
+    }
+}
+
+void PollingBackend::reportMissing(const ChangeCallback& onChange) {
+    for (PathId id = 0; id < mtimes_.size(); ++id) {
+        if (mtimes_[id] == kMissing || seenPass_[id] == pass_) continue;
+        // 上一轮还在、这一轮没有扫描到：文件被删除或移走
+        mtimes_[id] = kMissing;
+        onChange(std::string(paths_.path(id)));
+    }
+}
+
+void PollingBackend::parallelScan(const std::string& root, const ChangeCallback& onChange) {
+    if (!pool_) {
+        pool_ = std::make_unique<WorkStealingPool>(scanOptions_.threads);
+        results_.resize(pool_->size());
+    }
+
+    // 遍历与 stat 分散到线程池，每个目录是一个任务，子目录派生新任务
+    size_t rootLength = root.size();
+    pool_->submit([this, root, rootLength](size_t worker) {
+        scanDirectoryTask(root, rootLength, worker);
+    });
+    pool_->wait();
+
+    // 在扫描线程上合并，状态表本身不需要加锁
+    for (auto& results : results_) {
+        for (const auto& result : results) {
+            mergeResult(result.path, result.mtime, onChange);
+        }
+        results.clear();
+    }
+}
+
+void PollingBackend::scanDirectoryTask(const std::string& dir, size_t rootLength, size_t worker) {
+    const PathFilter& filter = scanOptions_.filter;
+    std::vector<ScanResult>& results = results_[worker];
+    std::error_code ec;
+    std::filesystem::directory_iterator it(dir, ec);
+    if (ec) {
+        passComplete_ = false;
+        return;
+    }
+
+    for (const auto& entry : it) {
+        std::error_code entryEc;
+        const std::string& entryPath = entry.path().native();
+        std::string_view relative = relativeToRoot(entryPath, rootLength);
+
+        if (entry.is_directory(entryEc)) {
+            // 与串行扫描的 recursive_directory_iterator 一致，不进入指向目录的符号链接（可能成环）
+            if (scanOptions_.recursive && !entry.is_symlink(entryEc) && filter.acceptDirectory(relative)) {
+                pool_->submit([this, entryPath, rootLength](size_t w) {
+                    scanDirectoryTask(entryPath, rootLength, w);
+                });
+            }
+            continue;
+        }
+        if (!entry.is_regular_file(entryEc) || !filter.acceptFile(relative)) {
+            continue;
+        }
+
+        auto mtime = std::filesystem::last_write_time(entry.path(), entryEc);
+        if (!entryEc) {
+            results.push_back(ScanResult{entryPath, mtime});
+        }
+    }
+}
@@ -0,0 +1,473 @@
+#include "configtracker/git_repo_manager.h"
+#include "configtracker/mapped_file.h"
+#include "configtracker/content_hash.h"
+#include "configtracker/logger.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace configtracker;
+
+namespace {
+
+struct WalkPayload {
+    std::string base;  // 被遍历子树在仓库内的路径前缀（含结尾的 '/'）
+    std::vector<TreeFile>* out;
+    bool (*skip)(const char*) = nullptr;  // 返回 true 的顶层目录不进入
+};
+
+int collectBlob(const char* root, const git_tree_entry* entry, void* payload) {
+    auto* walk = static_cast<WalkPayload*>(payload);
+    git_filemode_t mode = git_tree_entry_filemode(entry);
+    if (mode == GIT_FILEMODE_TREE && walk->skip && walk->base.empty() && root[0] == '\0' &&
+        walk->skip(git_tree_entry_name(entry))) {
+        return 1;
+    }
+    // 只处理普通文件，符号链接和子模块跳过
+    if (mode != GIT_FILEMODE_BLOB && mode != GIT_FILEMODE_BLOB_EXECUTABLE) return 0;
+    TreeFile file;
+    file.path = walk->base + root + git_tree_entry_name(entry);
+    git_oid_cpy(&file.oid, git_tree_entry_id(entry));
+    file.mode = static_cast<uint32_t>(mode);
+    walk->out->push_back(std::move(file));
+    return 0;
+}
+
+// prefix 为空表示整个树，否则匹配该文件本身或该目录下的文件
+bool underPrefix(const std::string& path, const std::string& prefix) {
+    if (prefix.empty() || path == prefix) return true;
+    return path.size() > prefix.size() && path.compare(0, prefix.size(), prefix) == 0 &&
+           path[prefix.size()] == '/';
+}
+
+// 与索引项记录的 stat 信息一致时认为文件未被修改，不必读取内容
+bool statMatches(const git_index_entry* entry, const struct stat& st) {
+    return entry->file_size == static_cast<uint32_t>(st.st_size) &&
+           entry->mtime.seconds == static_cast<int32_t>(st.st_mtim.tv_sec) &&
+           entry->mtime.nanoseconds == static_cast<uint32_t>(st.st_mtim.tv_nsec) &&
+           entry->ino == static_cast<uint32_t>(st.st_ino);
+}
+
+std::string shortHash(const std::string& hash) {
+    return hash.substr(0, 10);
+}
+
+}
+
+std::string GitRepoManager::restoreTempPath(const std::string& path) {
+    std::filesystem::path target(path);
+    return (target.parent_path() / ("." + target.filename().string() + ".ctrestore")).string();
+}
+
+std::string GitRepoManager::sourcePath(const std::string& repoPath) const {
+    // 直接写入时仓库内路径是源文件去掉开头 '/' 的绝对路径；
+    // 旧的复制方式只保留了文件名，只能写回仓库工作区
+    if (ingestMode_ == IngestMode::Direct) {
+        return "/" + repoPath;
+    }
+    return (std::filesystem::path(repoPath_) / repoPath).string();
+}
+
+bool GitRepoManager::planRestore(const std::string& hash, const std::vector<std::string>& paths,
+                                 std::vector<RestoreAction>& out) {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!repo_ || !index_) {
+        CT_LOG(Error) << "Error: Repository not initialized";
+        return false;
+    }
+
+    git_oid oid;
+    git_commit* commit = nullptr;
+    git_tree* tree = nullptr;
+    if (git_oid_fromstr(&oid, hash.c_str()) < 0 || git_commit_lookup(&commit, repo_, &oid) < 0 ||
+        git_commit_tree(&tree, commit) < 0) {
+        const git_error* e = git_error_last();
+        CT_LOG(Error) << "Error looking up commit " << hash << ": " << (e ? e->message : "unknown error");
+        git_commit_free(commit);
+        return false;
+    }
+
+    // 每个要恢复的范围：仓库内前缀，以及该前缀对应的源路径
+    struct Scope {
+        std::string prefix;
+        std::string source;
+    };
+    std::vector<Scope> scopes;
+    if (paths.empty()) {
+        scopes.push_back(Scope{"", ""});
+    } else {
+        for (const auto& path : paths) {
+            std::string source = path;
+            while (source.size() > 1 && source.back() == '/') source.pop_back();
+            std::string prefix = repoRelativePath(source);
+            if (prefix.empty()) {
+                CT_LOG(Error) << "Error: Cannot map file into repository: " << path;
+                continue;
+            }
+            scopes.push_back(Scope{prefix, source});
+        }
+    }
+
+    std::unordered_set<std::string> planned;
+    for (const Scope& scope : scopes) {
+        auto sourceFor = [this, &scope](const std::string& repoPath) {
+            return scope.prefix.empty() ? sourcePath(repoPath)
+                                        : scope.source + repoPath.substr(scope.prefix.size());
+        };
+
+        // 目标提交中位于该范围内的文件
+        std::vector<TreeFile> blobs;
+        if (scope.prefix.empty()) {
+            WalkPayload walk{"", &blobs, isChunkPath};
+            git_tree_walk(tree, GIT_TREEWALK_PRE, collectBlob, &walk);
+        } else {
+            git_tree_entry* entry = nullptr;
+            if (git_tree_entry_bypath(&entry, tree, scope.prefix.c_str()) == 0) {
+                if (git_tree_entry_type(entry) == GIT_OBJECT_TREE) {
+                    git_tree* subtree = nullptr;
+                    if (git_tree_lookup(&subtree, repo_, git_tree_entry_id(entry)) == 0) {
+                        WalkPayload walk{scope.prefix + "/", &blobs};
+                        git_tree_walk(subtree, GIT_TREEWALK_PRE, collectBlob, &walk);
+                        git_tree_free(subtree);
+                    }
+                } else {
+                    WalkPayload walk{"", &blobs};
+                    collectBlob("", entry, &walk);
+                    if (!blobs.empty()) blobs.back().path = scope.prefix;
+                }
+                git_tree_entry_free(entry);
+            }
+        }
+
+        std::unordered_set<std::string> inTarget;
+        for (const TreeFile& blob : blobs) {
+            inTarget.insert(blob.path);
+            if (!planned.insert(blob.path).second) continue;
+
+            RestoreAction action;
+            action.path = sourceFor(blob.path);
+            action.repoPath = blob.path;
+            action.blob = blob.oid;
+            action.mode = blob.mode;
+
+            struct stat st{};
+            if (stat(action.path.c_str(), &st) != 0) {
+                if (errno == ENOENT) out.push_back(std::move(action));
+                continue;
+            }
+            if (!S_ISREG(st.st_mode)) {
+                CT_LOG(Warn) << "Not restoring " << action.path << ": not a regular file";
+                continue;
+            }
+            // 索引中的内容与目标相同且文件自暂存后未被改动，跳过
+            const git_index_entry* indexed = git_index_get_bypath(index_, blob.path.c_str(), 0);
+            if (indexed && git_oid_equal(&indexed->id, &blob.oid) && statMatches(indexed, st)) {
+                continue;
+            }
+            // 否则按内容判断，分块存储的文件与清单记录的长度和 XXH64 比较
+            std::string content;
+            git_oid current;
+            if (readFile(action.path, content)) {
+                if (git_odb_hash(&current, content.data(), content.size(), GIT_OBJECT_BLOB) == 0 &&
+                    git_oid_equal(&current, &blob.oid)) {
+                    continue;
+                }
+                uint64_t size = 0, hash = 0;
+                if (chunkedSummaryLocked(blob.oid, size, hash) && size == content.size() &&
+                    xxhash64(content.data(), content.size()) == hash) {
+                    continue;
+                }
+            }
+            out.push_back(std::move(action));
+        }
+
+        // 当前跟踪、但目标提交中不存在的文件
+        size_t count = git_index_entrycount(index_);
+        for (size_t i = 0; i < count; ++i) {
+            const git_index_entry* entry = git_index_get_byindex(index_, i);
+            if (!entry || isChunkPath(entry->path) || !underPrefix(entry->path, scope.prefix) ||
+                inTarget.count(entry->path)) {
+                continue;
+            }
+            if (!planned.insert(entry->path).second) continue;
+            RestoreAction action;
+            action.path = sourceFor(entry->path);
+            action.repoPath = entry->path;
+            std::memset(&action.blob, 0, sizeof(action.blob));
+            action.remove = true;
+            struct stat st{};
+            if (lstat(action.path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+                out.push_back(std::move(action));
+            }
+        }
+    }
+
+    git_tree_free(tree);
+    git_commit_free(commit);
+    return !scopes.empty();
+}
+
+bool GitRepoManager::applyRestore(const std::string& hash, const std::vector<RestoreAction>& actions,
+                                  std::string* commitHash, int64_t* commitTime) {
+    if (actions.empty()) return true;
+    CT_LOG(Info) << "[Git] Restoring " << actions.size() << " files from " << hash;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!repo_ || !index_) {
+        CT_LOG(Error) << "Error: Repository not initialized";
+        return false;
+    }
+
+    bool ok = true;
+    std::vector<std::string> restored;
+    for (const RestoreAction& action : actions) {
+        if (action.remove) {
+            if (unlink(action.path.c_str()) != 0 && errno != ENOENT) {
+                CT_LOG(Error) << "Error removing " << action.path << ": " << std::strerror(errno);
+                ok = false;
+                continue;
+            }
+            if (removeEntryLocked(index_, action.repoPath)) {
+                stagedPaths_.push_back(action.repoPath);
+                stagedSinceCommit_ = true;
+            }
+            restored.push_back(action.path);
+            continue;
+        }
+
+        struct stat st{};
+        std::string content;
+        if (!writeRestoredFile(action, st, content)) {
+            ok = false;
+            continue;
+        }
+        // 按当前的分块设置重新生成索引项（内容已在对象库中，只计算哈希），分块存储的文件同时恢复块目录
+        git_oid blob_id;
+        if (!writeContentLocked(index_, action.repoPath, content.data(), content.size(), blob_id)) {
+            ok = false;
+            continue;
+        }
+        if (stageEntry(index_, action.repoPath, st, blob_id)) {
+            stagedSinceCommit_ = true;
+        }
+        restored.push_back(action.path);
+    }
+
+    if (!restored.empty()) {
+        // 恢复作为一次新的提交记录下来，之前的历史保持不变
+        std::ostringstream message;
+        if (restored.size() == 1) {
+            message << "Restore " << restored.front() << " to " << shortHash(hash);
+        } else {
+            message << "Restore " << restored.size() << " files to " << shortHash(hash) << "\n\n";
+            for (const auto& path : restored) {
+                message << path << "\n";
+            }
+        }
+        if (!commitLocked(message.str(), commitHash, commitTime)) {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool GitRepoManager::writeRestoredFile(const RestoreAction& action, struct stat& st, std::string& content) {
+    if (!readContentLocked(action.blob, content)) {
+        CT_LOG(Error) << "Error reading content for " << action.path;
+        return false;
+    }
+    const char* data = content.data();
+    size_t size = content.size();
+
+    // 符号链接指向的配置文件写到链接目标，链接本身保留
+    std::error_code ec;
+    std::string target = action.path;
+    struct stat link{};
+    if (lstat(target.c_str(), &link) == 0 && S_ISLNK(link.st_mode)) {
+        target = std::filesystem::canonical(target, ec).string();
+        if (ec) target = action.path;
+    }
+
+    // 已存在的文件保留原来的权限和属主，新文件按提交中的模式创建
+    struct stat existing{};
+    bool exists = stat(target.c_str(), &existing) == 0;
+    mode_t mode = exists ? (existing.st_mode & 07777)
+                         : (action.mode == GIT_FILEMODE_BLOB_EXECUTABLE ? 0755 : 0644);
+    std::filesystem::create_directories(std::filesystem::path(target).parent_path(), ec);
+
+    std::string tmpPath = restoreTempPath(target);
+    unlink(tmpPath.c_str());
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW, 0600);
+    bool ok = fd >= 0;
+    size_t written = 0;
+    while (ok && written < size) {
+        ssize_t n = write(fd, data + written, size - written);
+        if (n < 0 && errno == EINTR) continue;
+        ok = n > 0;
+        if (ok) written += static_cast<size_t>(n);
+    }
+    if (ok) {
+        ok = fchmod(fd, mode) == 0;
+        if (exists && geteuid() == 0) {
+            int ignored = fchown(fd, existing.st_uid, existing.st_gid);
+            (void)ignored;
+        }
+    }
+    ok = ok && fsync(fd) == 0;
+    if (fd >= 0) close(fd);
+    ok = ok && rename(tmpPath.c_str(), target.c_str()) == 0;
+    if (!ok) {
+        CT_LOG(Error) << "Error restoring " << action.path << ": " << std::strerror(errno);
+        unlink(tmpPath.c_str());
+    }
+    return ok && stat(target.c_str(), &st) == 0;
+}
+
+bool GitRepoManager::listFiles(const std::string& hash, std::vector<TreeFile>& out, std::string* resolved) {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!repo_) {
+        CT_LOG(Error) << "Error: Repository not initialized";
+        return false;
+    }
+    return listFilesIn(repo_, hash, out, resolved);
+}
+
+bool GitRepoManager::listFiles(git_repository* handle, const std::string& hash, std::vector<TreeFile>& out,
+                               std::string* resolved) {
+    if (!handle) {
+        return listFiles(hash, out, resolved);
+    }
+    out.clear();
+    return listFilesIn(handle, hash, out, resolved);
+}
+
+bool GitRepoManager::listFilesIn(git_repository* repo, const std::string& hash, std::vector<TreeFile>& out,
+                                 std::string* resolved) {
+    git_oid oid;
+    if (hash.empty()) {
+        if (git_reference_name_to_id(&oid, repo, "HEAD") < 0) {
+            // 还没有任何提交，视为空树
+            if (resolved) resolved->clear();
+            return true;
+        }
+    } else if (git_oid_fromstr(&oid, hash.c_str()) < 0) {
+        CT_LOG(Error) << "Error: Invalid commit hash " << hash;
+        return false;
+    }
+
+    git_commit* commit = nullptr;
+    git_tree* tree = nullptr;
+    if (git_commit_lookup(&commit, repo, &oid) < 0 || git_commit_tree(&tree, commit) < 0) {
+        const git_error* e = git_error_last();
+        CT_LOG(Error) << "Error looking up commit " << hash << ": " << (e ? e->message : "unknown error");
+        git_commit_free(commit);
+        return false;
+    }
+    WalkPayload walk{"", &out, isChunkPath};
+    git_tree_walk(tree, GIT_TREEWALK_PRE, collectBlob, &walk);
+    if (resolved) {
+        char text[GIT_OID_HEXSZ + 1] = {0};
+        git_oid_fmt(text, &oid);
+        *resolved = text;
+    }
+    git_tree_free(tree);
+    git_commit_free(commit);
+    return true;
+}
+
+bool GitRepoManager::changesSince(const std::string& base, std::string& head, std::vector<TreeFile>& changed,
+                                  std::vector<std::string>& removed) {
+    changed.clear();
+    removed.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!repo_) {
+        CT_LOG(Error) << "Error: Repository not initialized";
+        return false;
+    }
+    git_oid head_id;
+    if (git_reference_name_to_id(&head_id, repo_, "HEAD") < 0) {
+        head.clear();
+        return base.empty();
+    }
+    char text[GIT_OID_HEXSZ + 1] = {0};
+    git_oid_fmt(text, &head_id);
+    head = text;
+    if (head == base) return true;
+    if (commitIndex_.empty() || !git_oid_equal(&commitIndex_.at(commitIndex_.size() - 1).oid, &head_id)) {
+        return false;
+    }
+
+    // 沿第一父链从 HEAD 往回走到 base，收集途经提交改动的路径
+    git_oid base_id;
+    if (!base.empty() && git_oid_fromstr(&base_id, base.c_str()) < 0) return false;
+    std::vector<std::string> paths;
+    std::unordered_set<std::string_view> seen;
+    size_t pos = commitIndex_.size() - 1;
+    while (true) {
+        const CommitRecord& record = commitIndex_.at(pos);
+        if (!base.empty() && git_oid_equal(&record.oid, &base_id)) break;
+        for (std::string_view path : commitIndex_.pathsOf(pos)) {
+            if (seen.insert(path).second) paths.emplace_back(path);
+        }
+        if (git_oid_is_zero(&record.parent)) {
+            if (base.empty()) break;
+            return false;
+        }
+        if (pos == 0 || !git_oid_equal(&commitIndex_.at(pos - 1).oid, &record.parent)) return false;
+        --pos;
+    }
+
+    git_commit* commit = nullptr;
+    git_tree* tree = nullptr;
+    if (git_commit_lookup(&commit, repo_, &head_id) < 0 || git_commit_tree(&tree, commit) < 0) {
+        const git_error* e = git_error_last();
+        CT_LOG(Error) << "Error looking up commit " << head << ": " << (e ? e->message : "unknown error");
+        git_commit_free(commit);
+        return false;
+    }
+    for (const auto& path : paths) {
+        if (isChunkPath(path.c_str())) continue;
+        git_tree_entry* entry = nullptr;
+        if (git_tree_entry_bypath(&entry, tree, path.c_str()) < 0) {
+            removed.push_back(path);
+            continue;
+        }
+        git_filemode_t mode = git_tree_entry_filemode(entry);
+        if (mode == GIT_FILEMODE_BLOB || mode == GIT_FILEMODE_BLOB_EXECUTABLE) {
+            TreeFile file;
+            file.path = path;
+            git_oid_cpy(&file.oid, git_tree_entry_id(entry));
+            file.mode = static_cast<uint32_t>(mode);
+            changed.push_back(std::move(file));
+        } else {
+            removed.push_back(path);
+        }
+        git_tree_entry_free(entry);
+    }
+    git_tree_free(tree);
+    git_commit_free(commit);
+    return true;
+}
+
+bool GitRepoManager::readBlob(const git_oid& oid, std::string& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!repo_) {
+        CT_LOG(Error) << "Error: Repository not initialized";
+        return false;
+    }
+    return readContentLocked(oid, out);
+}
+
+bool GitRepoManager::readBlob(git_repository* handle, const git_oid& oid, std::string& out) {
+    if (!handle) {
+        return readBlob(oid, out);
+    }
+    return readContent(handle, oid, out);
+}
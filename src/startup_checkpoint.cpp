@@ -0,0 +1,118 @@
+#include "configtracker/git_repo_manager.h"
+#include "configtracker/logger.h"
+#include <fstream>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace configtracker;
+
+namespace {
+
+std::string oidToString(const git_oid& oid) {
+    char hash[GIT_OID_HEXSZ + 1] = {0};
+    git_oid_fmt(hash, &oid);
+    return std::string(hash);
+}
+
+bool statIndex(const char* path, int64_t& size, int64_t& mtime) {
+    struct stat st;
+    if (!path || stat(path, &st) != 0) return false;
+    size = static_cast<int64_t>(st.st_size);
+    mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+}
+
+void GitRepoManager::loadCheckpoint() {
+    checkpoint_ = Checkpoint();
+
+    std::ifstream in(sidecarPath("checkpoint"));
+    if (!in) return;
+
+    std::string key, value;
+    std::string indexTree;
+    while (in >> key >> value) {
+        if (key == "index_tree") indexTree = value;
+        else if (key == "index_size") checkpoint_.indexSize = std::strtoll(value.c_str(), nullptr, 10);
+        else if (key == "index_mtime") checkpoint_.indexMtime = std::strtoll(value.c_str(), nullptr, 10);
+        else if (key == "last_retention") checkpoint_.lastRetention = std::strtoll(value.c_str(), nullptr, 10);
+        else if (key == "prune_pending") checkpoint_.prunePending = value == "1";
+    }
+    checkpoint_.indexValid = git_oid_fromstr(&checkpoint_.indexTree, indexTree.c_str()) == 0;
+}
+
+void GitRepoManager::saveCheckpoint() {
+    std::string path = sidecarPath("checkpoint");
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    {
+        std::ofstream out(path + ".tmp", std::ios::trunc);
+        out << "index_tree " << (checkpoint_.indexValid ? oidToString(checkpoint_.indexTree) : "-") << "\n"
+            << "index_size " << checkpoint_.indexSize << "\n"
+            << "index_mtime " << checkpoint_.indexMtime << "\n"
+            << "last_retention " << checkpoint_.lastRetention << "\n"
+            << "prune_pending " << (checkpoint_.prunePending ? 1 : 0) << "\n";
+    }
+    std::filesystem::rename(path + ".tmp", path, ec);
+}
+
+bool GitRepoManager::indexMatchesCheckpoint(const git_oid& tree) const {
+    if (!checkpoint_.indexValid || !git_oid_equal(&checkpoint_.indexTree, &tree)) {
+        return false;
+    }
+    // 索引文件在写盘后被替换或修改过（例如在仓库里直接执行 git 命令）时不能信任
+    int64_t size = 0, mtime = 0;
+    return statIndex(git_index_path(index_), size, mtime) &&
+           size == checkpoint_.indexSize && mtime == checkpoint_.indexMtime;
+}
+
+void GitRepoManager::writeIndexLocked() {
+    if (!index_ || !indexDirty_) return;
+
+    // 索引里有尚未提交的文件时先让检查点失效，再写盘；
+    // 与最后一次提交一致时写盘成功后再记录，任何时刻崩溃都只会多读一次树
+    bool clean = committedTreeKnown_ && !stagedSinceCommit_;
+    if (!clean && checkpoint_.indexValid) {
+        checkpoint_.indexValid = false;
+        saveCheckpoint();
+    }
+
+    int error = git_index_write(index_);
+    if (error < 0) {
+        const git_error* e = git_error_last();
+        CT_LOG(Error) << "Error writing index: " << e->message;
+        return;
+    }
+    indexDirty_ = false;
+
+    if (clean && statIndex(git_index_path(index_), checkpoint_.indexSize, checkpoint_.indexMtime)) {
+        checkpoint_.indexValid = true;
+        git_oid_cpy(&checkpoint_.indexTree, &committedTree_);
+        saveCheckpoint();
+    }
+}
+
+std::chrono::milliseconds GitRepoManager::retentionDelay(std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!repo_) {
+        return interval;
+    }
+    if (!compactionLoaded_) {
+        loadCompactionState();
+    }
+    if (compaction_.active || checkpoint_.lastRetention == 0) {
+        return std::chrono::milliseconds(0);
+    }
+    auto last = std::chrono::system_clock::from_time_t(static_cast<time_t>(checkpoint_.lastRetention));
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - last);
+    return std::max(interval - elapsed, std::chrono::milliseconds(0));
+}
+
+KeyHistory& GitRepoManager::keyHistoryLocked() {
+    if (!keyHistoryOpened_) {
+        keyHistoryOpened_ = true;
+        keyHistory_.open(sidecarPath(""));
+    }
+    return keyHistory_;
+}
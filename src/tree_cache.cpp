@@ -0,0 +1,252 @@
+#include "configtracker/tree_cache.h"
+#include "configtracker/logger.h"
+#include <cstring>
+#include <map>
+#include <string>
+
+using namespace configtracker;
+
+// 目录中的一项：文件、或者子目录（读入内存后 dir 非空）
+struct TreeCache::Entry {
+    git_oid oid;
+    uint32_t mode = 0;
+    bool changed = false;          // 与目录上一次写出的树相比有变化
+    std::unique_ptr<Node> dir;
+};
+
+struct TreeCache::Node {
+    git_oid oid;
+    bool based = false;            // oid 是对象库中这个目录上一次写出（或读入）的树
+    bool loaded = false;
+    bool dirty = false;
+    std::map<std::string, Entry, std::less<>> entries;
+    std::vector<std::string> removed;   // 上一次写出后删除的项
+};
+
+namespace {
+
+const char* lastError() {
+    const git_error* e = git_error_last();
+    return e ? e->message : "unknown error";
+}
+
+}
+
+TreeCache::TreeCache() = default;
+
+TreeCache::~TreeCache() = default;
+
+void TreeCache::reset(git_repository* repo, const git_oid& root) {
+    repo_ = repo;
+    root_ = std::make_unique<Node>();
+    git_oid_cpy(&root_->oid, &root);
+    root_->based = true;
+    loaded_ = 0;
+    lastWritten_ = 0;
+}
+
+void TreeCache::clear() {
+    root_.reset();
+    loaded_ = 0;
+}
+
+bool TreeCache::load(Node& node) {
+    if (node.loaded) return true;
+    if (!node.based) {
+        node.loaded = true;
+        return true;
+    }
+    git_tree* tree = nullptr;
+    if (git_tree_lookup(&tree, repo_, &node.oid) < 0) {
+        CT_LOG(Error) << "[Git] Error reading tree for cache: " << lastError();
+        return false;
+    }
+    size_t count = git_tree_entrycount(tree);
+    for (size_t i = 0; i < count; ++i) {
+        const git_tree_entry* item = git_tree_entry_byindex(tree, i);
+        Entry& entry = node.entries[git_tree_entry_name(item)];
+        git_oid_cpy(&entry.oid, git_tree_entry_id(item));
+        entry.mode = static_cast<uint32_t>(git_tree_entry_filemode(item));
+    }
+    git_tree_free(tree);
+    node.loaded = true;
+    ++loaded_;
+    return true;
+}
+
+bool TreeCache::walk(std::string_view path, bool create, Node*& dir, std::string_view& name) {
+    path_.clear();
+    names_.clear();
+    dir = nullptr;
+    Node* node = root_.get();
+    if (!load(*node)) return false;
+    path_.push_back(node);
+
+    size_t begin = 0;
+    size_t slash;
+    while ((slash = path.find('/', begin)) != std::string_view::npos) {
+        std::string_view part = path.substr(begin, slash - begin);
+        begin = slash + 1;
+        auto it = node->entries.find(part);
+        if (it == node->entries.end() || it->second.mode != GIT_FILEMODE_TREE) {
+            if (!create) return true;
+            // 缺少的目录，或者被同名目录取代的文件
+            if (it == node->entries.end()) {
+                it = node->entries.emplace(std::string(part), Entry()).first;
+            }
+            Entry& entry = it->second;
+            std::memset(&entry.oid, 0, sizeof(entry.oid));
+            entry.mode = GIT_FILEMODE_TREE;
+            entry.changed = true;
+            entry.dir = std::make_unique<Node>();
+            entry.dir->loaded = true;
+        }
+        Entry& entry = it->second;
+        if (!entry.dir) {
+            entry.dir = std::make_unique<Node>();
+            git_oid_cpy(&entry.dir->oid, &entry.oid);
+            entry.dir->based = true;
+        }
+        node = entry.dir.get();
+        if (!load(*node)) return false;
+        path_.push_back(node);
+        names_.push_back(it->first);
+    }
+    dir = node;
+    name = path.substr(begin);
+    return true;
+}
+
+void TreeCache::touchPath() {
+    for (size_t i = path_.size(); i-- > 0;) {
+        Node* node = path_[i];
+        node->dirty = true;
+        // 树中不保存空目录
+        if (i > 0 && node->entries.empty()) {
+            Node* parent = path_[i - 1];
+            std::string name(names_[i - 1]);
+            parent->entries.erase(name);
+            parent->removed.push_back(std::move(name));
+        }
+    }
+}
+
+void TreeCache::set(std::string_view path, const git_oid& oid, uint32_t mode) {
+    if (!root_) return;
+    Node* dir = nullptr;
+    std::string_view name;
+    if (!walk(path, true, dir, name)) {
+        clear();
+        return;
+    }
+    auto it = dir->entries.find(name);
+    if (it != dir->entries.end() && it->second.mode == mode && !it->second.dir &&
+        git_oid_equal(&it->second.oid, &oid)) {
+        return;
+    }
+    if (it == dir->entries.end()) {
+        it = dir->entries.emplace(std::string(name), Entry()).first;
+    }
+    Entry& entry = it->second;
+    git_oid_cpy(&entry.oid, &oid);
+    entry.mode = mode;
+    entry.changed = true;
+    entry.dir.reset();
+    touchPath();
+}
+
+void TreeCache::remove(std::string_view path) {
+    if (!root_) return;
+    Node* dir = nullptr;
+    std::string_view name;
+    if (!walk(path, false, dir, name)) {
+        clear();
+        return;
+    }
+    if (!dir) return;
+    auto it = dir->entries.find(name);
+    if (it == dir->entries.end() || it->second.mode == GIT_FILEMODE_TREE) return;
+    dir->removed.push_back(it->first);
+    dir->entries.erase(it);
+    touchPath();
+}
+
+void TreeCache::removeDirectory(std::string_view path) {
+    if (!root_) return;
+    Node* dir = nullptr;
+    std::string_view name;
+    if (!walk(path, false, dir, name)) {
+        clear();
+        return;
+    }
+    if (!dir) return;
+    auto it = dir->entries.find(name);
+    if (it == dir->entries.end() || it->second.mode != GIT_FILEMODE_TREE) return;
+    dir->removed.push_back(it->first);
+    dir->entries.erase(it);
+    touchPath();
+}
+
+bool TreeCache::write(git_oid& out) {
+    if (!root_) return false;
+    lastWritten_ = 0;
+    if (root_->dirty && !writeNode(*root_)) {
+        clear();
+        return false;
+    }
+    git_oid_cpy(&out, &root_->oid);
+    return true;
+}
+
+bool TreeCache::writeNode(Node& node) {
+    // 先写出变化的子目录，得到它们的新 oid
+    for (auto& item : node.entries) {
+        Entry& entry = item.second;
+        if (entry.dir && entry.dir->dirty) {
+            if (!writeNode(*entry.dir)) return false;
+            git_oid_cpy(&entry.oid, &entry.dir->oid);
+            entry.changed = true;
+        }
+    }
+
+    // 以目录原来的树为基础，只改动变化的项；原有的项直接复制，不再逐个校验对象
+    git_tree* source = nullptr;
+    if (node.based && git_tree_lookup(&source, repo_, &node.oid) < 0) {
+        CT_LOG(Error) << "[Git] Error reading tree: " << lastError();
+        return false;
+    }
+    git_treebuilder* builder = nullptr;
+    int error = git_treebuilder_new(&builder, repo_, source);
+    git_tree_free(source);
+    if (error < 0) {
+        CT_LOG(Error) << "[Git] Error creating tree builder: " << lastError();
+        return false;
+    }
+    // 删除后又加回的项在下面重新插入，不在原树中的项删除失败可以忽略
+    for (const auto& name : node.removed) {
+        git_treebuilder_remove(builder, name.c_str());
+    }
+    for (auto& item : node.entries) {
+        Entry& entry = item.second;
+        if (!entry.changed) continue;
+        error = git_treebuilder_insert(nullptr, builder, item.first.c_str(), &entry.oid,
+                                       static_cast<git_filemode_t>(entry.mode));
+        if (error < 0) {
+            CT_LOG(Error) << "[Git] Error adding " << item.first << " to tree: " << lastError();
+            git_treebuilder_free(builder);
+            return false;
+        }
+        entry.changed = false;
+    }
+    error = git_treebuilder_write(&node.oid, builder);
+    git_treebuilder_free(builder);
+    if (error < 0) {
+        CT_LOG(Error) << "[Git] Error writing tree: " << lastError();
+        return false;
+    }
+    node.based = true;
+    node.dirty = false;
+    node.removed.clear();
+    ++lastWritten_;
+    return true;
+}
@@ -0,0 +1,104 @@
+#include "configtracker/work_stealing_pool.h"
+
+using namespace configtracker;
+
+namespace {
+
+// 当前线程所属的线程池及其工作线程序号
+thread_local const WorkStealingPool* tlsPool = nullptr;
+thread_local size_t tlsWorker = 0;
+
+}
+
+WorkStealingPool::WorkStealingPool(size_t threads) {
+    if (threads == 0) threads = 1;
+    for (size_t i = 0; i < threads; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+    }
+    sleepCv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    size_t target = tlsPool == this ? tlsWorker
+                                    : nextQueue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    // 先计数再入队，保证取走任务时计数不会变成负数
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    queued_.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+        queues_[target]->tasks.push_back(std::move(task));
+    }
+
+    // 在 sleepMutex_ 下通知，避免与正准备休眠的线程错过唤醒
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    sleepCv_.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    doneCv_.wait(lock, [this] { return pending_.load(std::memory_order_acquire) == 0; });
+}
+
+bool WorkStealingPool::tryPop(size_t worker, Task& task) {
+    // 先从自己的队尾取（刚派生的子任务，缓存更热）
+    {
+        Queue& own = *queues_[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    // 再从其他线程的队首窃取
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        Queue& victim = *queues_[(worker + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t worker) {
+    tlsPool = this;
+    tlsWorker = worker;
+
+    while (true) {
+        Task task;
+        if (tryPop(worker, task)) {
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            task(worker);
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(sleepMutex_);
+                doneCv_.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepCv_.wait(lock, [this] {
+            return stopping_ || queued_.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping_ && queued_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
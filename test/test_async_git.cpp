@@ -0,0 +1,237 @@
+#include "configtracker/async_git_repo.h"
+#include "configtracker/config_tracker.h"
+#include "test_util.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+
+namespace {
+
+template <typename T>
+bool ready(const std::future<T>& future) {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+}
+
+void test_async_writes_and_reads() {
+    fs::path base = fs::temp_directory_path() / "ct_async_git_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path a = base / "etc" / "a.conf";
+    fs::path b = base / "etc" / "b.conf";
+    writeFile(a, "a=1\n");
+    writeFile(b, "b=1\n");
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        AsyncGitRepo async(git, 3);
+        CHECK(async.readThreads() == 3);
+
+        // 写操作按投递顺序执行，调用方不等待
+        auto added1 = async.addFiles({a.string()});
+        auto first = async.commit("add a");
+        auto added2 = async.addFiles({b.string()});
+        auto second = async.commit("add b");
+        added1.get();
+        added2.get();
+        std::string c1 = first.get();
+        std::string c2 = second.get();
+        CHECK(!c1.empty() && !c2.empty() && c1 != c2);
+
+        // 读操作使用各线程自己的句柄
+        std::vector<std::string> commits = async.listCommits().get();
+        CHECK(commits.size() == 2 && commits[0] == c2 && commits[1] == c1);
+        auto files = async.listFiles(c2).get();
+        CHECK(files && files->size() == 2);
+        auto diff = async.diffCommits(c1, c2).get();
+        CHECK(diff && diff->size() == 1 && diff->front() == git.repoRelativePath(b.string()));
+        auto all = async.diffCommits("", c1).get();
+        CHECK(all && all->size() == 1);
+        for (const auto& file : *files) {
+            auto content = async.readBlob(file.oid).get();
+            CHECK(content && (*content == "a=1\n" || *content == "b=1\n"));
+        }
+        std::vector<std::string> touching = async.commitsTouching(a.string()).get();
+        CHECK(touching.size() == 1);
+        auto unknown = async.listFiles("0123456789012345678901234567890123456789").get();
+        CHECK(!unknown);
+        auto handle = async.read([](GitRepoManager&, git_repository* repo) { return repo != nullptr; });
+        bool hasHandle = handle.get();
+        CHECK(hasHandle);
+
+        // 恢复同样在写线程上执行
+        writeFile(a, "a=2\n");
+        async.addFiles({a.string()});
+        std::string c3 = async.commit("edit a").get();
+        bool restored = async.restore(c1, {a.string()}).get();
+        CHECK(restored);
+        std::ifstream in(a);
+        std::string line;
+        std::getline(in, line);
+        CHECK(line == "a=1");
+        std::vector<std::string> latest = async.latestCommits(10).get();
+        CHECK(latest.size() == 4);
+        commits = async.listCommits().get();
+        CHECK(commits[1] == c3);
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Async writes and reads test completed.\n";
+}
+
+void test_reads_run_concurrently() {
+    fs::path base = fs::temp_directory_path() / "ct_async_git_concurrent_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path conf = base / "etc" / "app.conf";
+    writeFile(conf, "rev=0\n");
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        git.addFile(conf.string());
+        git.commit("initial");
+        AsyncGitRepo async(git, 4);
+
+        // 两个读任务互相等待：只有在不同线程上同时执行时才能都完成
+        std::atomic<int> arrived{0};
+        auto meet = [&arrived](GitRepoManager&, git_repository* handle) {
+            ++arrived;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (arrived.load() < 2 && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+            return arrived.load() >= 2 && handle != nullptr;
+        };
+        auto left = async.read(meet);
+        auto right = async.read(meet);
+        bool leftMet = left.get();
+        bool rightMet = right.get();
+        CHECK(leftMet && rightMet);
+
+        // 长时间的写操作不阻塞读取
+        std::atomic<bool> release{false};
+        auto slow = async.write([&release](GitRepoManager&) {
+            while (!release.load()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        auto queued = async.commit("queued behind the slow write");
+        auto files = async.listFiles("");
+        std::future_status status = files.wait_for(std::chrono::seconds(5));
+        CHECK(status == std::future_status::ready);
+        auto listed = files.get();
+        CHECK(listed);
+        CHECK(!ready(slow) && !ready(queued));
+        release = true;
+        slow.get();
+        queued.get();
+
+        // 读写交错：提交期间的读取总能看到完整的某个版本
+        std::vector<std::future<std::optional<std::vector<TreeFile>>>> reads;
+        std::vector<std::future<std::string>> writes;
+        for (int i = 1; i <= 20; ++i) {
+            writeFile(conf, "rev=" + std::to_string(i) + "\n");
+            async.addFiles({conf.string()}).get();
+            writes.push_back(async.commit("rev " + std::to_string(i)));
+            for (int j = 0; j < 5; ++j) {
+                reads.push_back(async.listFiles(""));
+            }
+        }
+        for (auto& write : writes) {
+            std::string hash = write.get();
+            CHECK(!hash.empty());
+        }
+        for (auto& read : reads) {
+            auto result = read.get();
+            CHECK(result && result->size() == 1);
+            auto content = async.readBlob(result->front().oid).get();
+            CHECK(content && content->rfind("rev=", 0) == 0);
+        }
+        std::vector<std::string> commits = async.listCommits().get();
+        CHECK(commits.size() == 22);
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Concurrent async reads test completed.\n";
+}
+
+void test_tracker_async_repo() {
+    fs::path base = fs::temp_directory_path() / "ct_async_git_tracker_test";
+    fs::remove_all(base);
+    fs::path watchDir = base / "watch";
+    const int count = 12;
+    for (int i = 0; i < count; ++i) {
+        writeFile(watchDir / ("app" + std::to_string(i) + ".conf"), "id=" + std::to_string(i) + "\n");
+    }
+
+    TrackConfig config;
+    config.repoRoot = (base / "repo").string();
+    config.watchPaths = {watchDir.string()};
+    config.retentionDays = 0;
+    config.batchQuietMs = 50;
+    config.batchMaxLatencyMs = 200;
+    config.logLevel = LogLevel::Warn;
+    config.sharding = ShardMode::HashBucket;
+    config.shardCount = 3;
+    config.asyncReadThreads = 1;
+
+    git_libgit2_init();
+    {
+        ConfigTracker tracker(config);
+        tracker.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(800));
+
+        // 每个文件都能在自己分片的异步接口中读到，同一分片总是同一个对象
+        std::set<AsyncGitRepo*> handles;
+        for (int i = 0; i < count; ++i) {
+            std::string path = (watchDir / ("app" + std::to_string(i) + ".conf")).string();
+            AsyncGitRepo* async = tracker.asyncRepo(path);
+            AsyncGitRepo* again = tracker.asyncRepo(path);
+            CHECK(async && async == again && async->readThreads() == 1);
+            handles.insert(async);
+
+            auto files = async->listFiles("").get();
+            CHECK(files);
+            bool found = false;
+            for (const auto& file : *files) {
+                auto content = async->readBlob(file.oid).get();
+                found = found || (content && *content == "id=" + std::to_string(i) + "\n");
+            }
+            CHECK(found);
+        }
+        CHECK(handles.size() > 1 && handles.size() <= tracker.shardRepos().size());
+        AsyncGitRepo* first = tracker.asyncRepo();
+        CHECK(first);
+        std::vector<std::string> commits = first->listCommits().get();
+        CHECK(!commits.empty());
+        tracker.stop();
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Tracker async repo test completed.\n";
+}
+
+int main() {
+    test_async_writes_and_reads();
+    test_reads_run_concurrently();
+    test_tracker_async_repo();
+    return 0;
+}
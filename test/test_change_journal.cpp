@@ -0,0 +1,371 @@
+#include "configtracker/change_journal.h"
+#include "configtracker/config_tracker.h"
+#include "test_util.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+
+namespace {
+
+std::vector<fs::path> segments(const fs::path& dir) {
+    std::vector<fs::path> result;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.path().filename().string().rfind("journal.", 0) == 0) {
+            result.push_back(entry.path());
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// 段文件中最后一个非零字节的位置，即最后一条记录的末尾附近
+size_t lastNonZero(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::string data(fs::file_size(path), '\0');
+    in.read(&data[0], static_cast<std::streamsize>(data.size()));
+    size_t end = data.find_last_not_of('\0');
+    CHECK(end != std::string::npos);
+    return end;
+}
+
+void patchByte(const fs::path& path, size_t offset, char value) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.put(value);
+}
+
+std::string configText(int revision) {
+    std::string text;
+    for (int i = 0; i < 40; ++i) {
+        text += "key" + std::to_string(i) + "=value" + std::to_string(i) + "\n";
+    }
+    text += "revision=" + std::to_string(revision) + "\n";
+    return text;
+}
+
+}
+
+void test_append_and_delta() {
+    fs::path dir = fs::temp_directory_path() / "ct_journal_append_test";
+    fs::remove_all(dir);
+
+    const int count = 20000;
+    std::vector<std::string> texts;
+    for (int i = 0; i < count; ++i) {
+        texts.push_back(configText(i));
+    }
+    {
+        ChangeJournal journal;
+        bool opened = journal.open(dir.string());
+        CHECK(opened);
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i) {
+            uint64_t seq = journal.append("/etc/app.conf", texts[i]);
+            CHECK(seq == static_cast<uint64_t>(i + 1));
+        }
+        auto elapsed = std::chrono::steady_clock::now() - begin;
+        double us = std::chrono::duration<double, std::micro>(elapsed).count() / count;
+        std::cout << "Journal append: " << us << " us per record\n";
+        CHECK(us < 100);
+
+        std::string content;
+        CHECK(journal.current("/etc/app.conf", content) && content == configText(count - 1));
+        CHECK(journal.pending() == 1 && journal.lastSequence() == static_cast<uint64_t>(count));
+
+        uint64_t seq = journal.appendRemove("/etc/app.conf");
+        CHECK(seq > 0);
+        CHECK(!journal.current("/etc/app.conf", content));
+        seq = journal.append("/etc/app.conf", "fresh\n");
+        CHECK(seq > 0);
+        CHECK(journal.current("/etc/app.conf", content) && content == "fresh\n");
+    }
+
+    // 每条记录只保存变化的部分，远小于完整内容
+    std::vector<fs::path> files = segments(dir);
+    CHECK(files.size() == 1);
+    size_t used = lastNonZero(files[0]) + 1;
+    std::cout << "Journal bytes for " << count << " revisions of " << configText(0).size()
+              << " bytes: " << used << "\n";
+    CHECK(used < static_cast<size_t>(count) * configText(0).size() / 4);
+
+    // 重新打开后按记录重建每个版本
+    {
+        ChangeJournal journal;
+        bool opened = journal.open(dir.string());
+        CHECK(opened);
+        int seen = 0;
+        journal.replay([&](const JournalEntry& entry) {
+            if (seen < count) {
+                CHECK(entry.op == JournalOp::Write && entry.content == configText(seen));
+            }
+            ++seen;
+        });
+        CHECK(seen == count + 2);
+        std::string content;
+        CHECK(journal.current("/etc/app.conf", content) && content == "fresh\n");
+        CHECK(journal.lastSequence() == static_cast<uint64_t>(count + 2));
+    }
+
+    fs::remove_all(dir);
+    std::cout << "Journal append and delta test completed.\n";
+}
+
+void test_crash_replay() {
+    fs::path dir = fs::temp_directory_path() / "ct_journal_crash_test";
+    fs::remove_all(dir);
+
+    {
+        ChangeJournal journal;
+        bool opened = journal.open(dir.string());
+        CHECK(opened);
+        journal.append("/etc/a.conf", "a=1\n");
+        journal.append("/etc/b.conf", "b=1\n");
+        journal.append("/etc/a.conf", "a=2\n");
+        // 不调用 sync，模拟进程直接退出：映射中的数据由内核写回
+    }
+    fs::path segment = segments(dir).front();
+
+    // 最后一条记录写到一半：回放停在它之前
+    patchByte(segment, lastNonZero(segment), 'X');
+    {
+        ChangeJournal journal;
+        bool opened = journal.open(dir.string());
+        CHECK(opened);
+        std::string content;
+        CHECK(journal.current("/etc/a.conf", content) && content == "a=1\n");
+        CHECK(journal.current("/etc/b.conf", content) && content == "b=1\n");
+        CHECK(journal.lastSequence() == 2);
+        // 新记录覆盖损坏的尾部
+        uint64_t seq = journal.append("/etc/a.conf", "a=3\n");
+        CHECK(seq == 3);
+    }
+
+    // 有效记录之后的残留数据被忽略，也不会在后续追加后重新出现
+    size_t tail = (lastNonZero(segment) + 8) & ~size_t(7);
+    for (size_t i = 0; i < 64; ++i) {
+        patchByte(segment, tail + i, static_cast<char>(0x5a + i));
+    }
+    {
+        ChangeJournal journal;
+        bool opened = journal.open(dir.string());
+        CHECK(opened);
+        CHECK(journal.lastSequence() == 3);
+        journal.append("/etc/c.conf", "c=1\n");
+    }
+    {
+        ChangeJournal journal;
+        bool opened = journal.open(dir.string());
+        CHECK(opened);
+        CHECK(journal.lastSequence() == 4 && journal.pending() == 3);
+        std::string content;
+        CHECK(journal.current("/etc/a.conf", content) && content == "a=3\n");
+        CHECK(journal.current("/etc/c.conf", content) && content == "c=1\n");
+    }
+
+    fs::remove_all(dir);
+    std::cout << "Journal crash replay test completed.\n";
+}
+
+void test_fold_into_git() {
+    fs::path base = fs::temp_directory_path() / "ct_journal_fold_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path dir = repoPath / ".git" / "configtracker" / "journal";
+    fs::path a = base / "etc" / "a.conf";
+    fs::path b = base / "etc" / "b.conf";
+    writeFile(a, "a=0\n");
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        ChangeJournal journal;
+        bool opened = journal.open(dir.string(), 4096);
+        CHECK(opened);
+        for (int i = 1; i <= 50; ++i) {
+            journal.append(a.string(), "a=" + std::to_string(i) + "\n");
+        }
+        journal.append(b.string(), "b=1\n");
+
+        // 写满后切换新段，两次合并之间的多次改写只产生一次提交
+        std::vector<FileContent> files;
+        uint64_t token = 0;
+        bool folding = journal.beginFold(files, token);
+        CHECK(folding);
+        CHECK(files.size() == 2 && files[0].data == "a=50\n" && files[1].data == "b=1\n");
+        journal.append(b.string(), "b=2\n");
+        size_t staged = git.addContents(files);
+        CHECK(staged == 2);
+        git.commit("fold 1");
+        journal.finishFold(token);
+        CHECK(segments(dir).size() == 1);
+        CHECK(journal.pending() == 1);
+
+        std::vector<TreeFile> tree;
+        CHECK(git.listFiles("", tree) && tree.size() == 2);
+        std::string content;
+        for (const auto& file : tree) {
+            CHECK(git.readBlob(file.oid, content));
+            CHECK(content == "a=50\n" || content == "b=1\n");
+        }
+
+        // 提交失败（不调用 finishFold）时变更保留到下一次合并
+        folding = journal.beginFold(files, token);
+        CHECK(folding);
+        CHECK(files.size() == 1 && files[0].data == "b=2\n");
+        journal.appendRemove(a.string());
+        folding = journal.beginFold(files, token);
+        CHECK(folding);
+        CHECK(files.size() == 2 && files[0].removed && files[1].data == "b=2\n");
+        staged = git.addContents(files);
+        CHECK(staged == 2);
+        git.commit("fold 2");
+        journal.finishFold(token);
+        CHECK(journal.pending() == 0 && segments(dir).size() == 1);
+        CHECK(git.listFiles("", tree) && tree.size() == 1);
+
+        // 内容与已提交的相同时不产生变更
+        journal.append(b.string(), "b=2\n");
+        folding = journal.beginFold(files, token);
+        CHECK(folding);
+        staged = git.addContents(files);
+        CHECK(staged == 0);
+        journal.finishFold(token);
+        CHECK(git.listCommits().size() == 2);
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Journal fold test completed.\n";
+}
+
+void test_tracker_journal_mode() {
+    fs::path base = fs::temp_directory_path() / "ct_journal_tracker_test";
+    fs::remove_all(base);
+    fs::path watchDir = base / "watch";
+    fs::path conf = watchDir / "app.conf";
+    fs::path journalDir = base / "repo" / ".git" / "configtracker" / "journal";
+    writeFile(conf, "rev=0\n");
+
+    TrackConfig config;
+    config.repoRoot = (base / "repo").string();
+    config.watchPaths = {watchDir.string()};
+    config.retentionDays = 0;
+    config.storage = StorageMode::Journal;
+    config.journalFoldMs = 300;
+    config.journalSyncMs = 50;
+    config.pollIntervalMs = 20;
+    config.watchBackend = WatchBackendType::Polling;
+    config.logLevel = LogLevel::Warn;
+
+    git_libgit2_init();
+    {
+        ConfigTracker tracker(config);
+        tracker.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        CHECK(contentOf(tracker.snapshot(), conf.string()) == "rev=0\n");
+        size_t before = tracker.latestCommits(100).size();
+
+        // 频繁改写在一次合并内只生成一次提交
+        for (int i = 1; i <= 10; ++i) {
+            writeFile(conf, "rev=" + std::to_string(i) + "\n");
+            std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(800));
+        CHECK(contentOf(tracker.snapshot(), conf.string()) == "rev=10\n");
+        size_t after = tracker.latestCommits(100).size();
+        std::cout << "Journal mode: " << (after - before) << " commits for 10 writes\n";
+        CHECK(after > before && after - before <= 4);
+
+        // 停止时合并剩余的变更
+        writeFile(conf, "rev=final\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        tracker.stop();
+        CHECK(contentOf(tracker.snapshot(), conf.string()) == "rev=final\n");
+    }
+
+    // 合并前退出的变更在重启后从日志中回放并提交
+    {
+        ChangeJournal journal;
+        bool opened = journal.open(journalDir.string());
+        CHECK(opened);
+        journal.append(conf.string(), "rev=crashed\n");
+    }
+    {
+        ConfigTracker tracker(config);
+        tracker.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        CHECK(contentOf(tracker.snapshot(), conf.string()) == "rev=crashed\n");
+        tracker.stop();
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Tracker journal mode test completed.\n";
+}
+
+// 合并失败（对象库不可写）时日志段保留，恢复后的下一次合并提交这些变更
+void test_fold_failure_keeps_journal() {
+    fs::path base = fs::temp_directory_path() / "ct_journal_failure_test";
+    fs::remove_all(base);
+    fs::path watchDir = base / "watch";
+    fs::path conf = watchDir / "app.conf";
+    fs::path objects = base / "repo" / ".git" / "objects";
+    fs::path moved = base / "objects.saved";
+    writeFile(conf, "rev=0\n");
+
+    TrackConfig config;
+    config.repoRoot = (base / "repo").string();
+    config.watchPaths = {watchDir.string()};
+    config.retentionDays = 0;
+    config.storage = StorageMode::Journal;
+    config.journalFoldMs = 60000;
+    config.pollIntervalMs = 20;
+    config.watchBackend = WatchBackendType::Polling;
+    config.packMaintenance = false;
+    config.logLevel = LogLevel::Off;
+
+    git_libgit2_init();
+    {
+        ConfigTracker tracker(config);
+        tracker.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        tracker.manualCommit();
+        CHECK(contentOf(tracker.snapshot(), conf.string()) == "rev=0\n");
+
+        writeFile(conf, "rev=1\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        fs::rename(objects, moved);
+        writeFile(objects, "");
+        tracker.manualCommit();
+        CHECK(contentOf(tracker.snapshot(), conf.string()) == "rev=0\n");
+
+        fs::remove(objects);
+        fs::rename(moved, objects);
+        tracker.manualCommit();
+        CHECK(contentOf(tracker.snapshot(), conf.string()) == "rev=1\n");
+        tracker.stop();
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Fold failure keeps journal test completed.\n";
+}
+
+int main() {
+    test_append_and_delta();
+    test_crash_replay();
+    test_fold_into_git();
+    test_tracker_journal_mode();
+    test_fold_failure_keeps_journal();
+    return 0;
+}
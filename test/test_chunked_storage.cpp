@@ -0,0 +1,229 @@
+#include "configtracker/git_repo_manager.h"
+#include "configtracker/content_chunker.h"
+#include "test_util.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <set>
+#include <string>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+
+namespace {
+
+// 生成的路由表：每行内容各不相同
+std::string routingTable(size_t lines, uint64_t seed) {
+    std::string text;
+    uint64_t state = seed;
+    for (size_t i = 0; i < lines; ++i) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        text += "route 10." + std::to_string((state >> 16) & 255) + "." + std::to_string((state >> 24) & 255) +
+                ".0/24 via 192.168." + std::to_string(i % 256) + "." + std::to_string((state >> 32) & 255) +
+                " metric " + std::to_string(i) + "\n";
+    }
+    return text;
+}
+
+size_t countLoose(const fs::path& repoPath) {
+    size_t count = 0;
+    for (const auto& dir : fs::directory_iterator(repoPath / ".git" / "objects")) {
+        std::string name = dir.path().filename().string();
+        if (name.size() != 2 || !dir.is_directory()) continue;
+        for (const auto& file : fs::directory_iterator(dir.path())) {
+            (void)file;
+            ++count;
+        }
+    }
+    return count;
+}
+
+std::set<std::pair<uint64_t, size_t>> chunkSet(const std::string& data, const ChunkingOptions& options) {
+    std::vector<ContentChunk> chunks;
+    chunkContent(data.data(), data.size(), options, chunks);
+    std::set<std::pair<uint64_t, size_t>> result;
+    for (const auto& chunk : chunks) {
+        result.insert({chunk.hash, chunk.length});
+    }
+    return result;
+}
+
+}
+
+void test_content_defined_chunking() {
+    ChunkingOptions options;
+    std::string data = routingTable(60000, 1);
+    std::vector<ContentChunk> chunks;
+    chunkContent(data.data(), data.size(), options, chunks);
+
+    // 块首尾相接覆盖整个文件，长度在上下限之间
+    size_t offset = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        CHECK(chunks[i].offset == offset);
+        CHECK(chunks[i].length <= options.maxSize);
+        CHECK(i + 1 == chunks.size() || chunks[i].length >= options.minSize);
+        offset += chunks[i].length;
+    }
+    CHECK(offset == data.size());
+    std::cout << data.size() << " bytes in " << chunks.size() << " chunks\n";
+    CHECK(chunks.size() > data.size() / options.maxSize);
+    CHECK(chunks.size() < data.size() / options.minSize);
+
+    // 中间插入一行后只有附近的块变化
+    std::string edited = data;
+    edited.insert(data.size() / 2, "route 0.0.0.0/0 via 192.168.0.1 metric 0\n");
+    auto before = chunkSet(data, options);
+    auto after = chunkSet(edited, options);
+    size_t changed = 0;
+    for (const auto& chunk : after) {
+        changed += before.count(chunk) == 0;
+    }
+    std::cout << "Chunks changed by an insertion: " << changed << " of " << after.size() << "\n";
+    CHECK(changed >= 1 && changed <= 3);
+
+    // 小于最小块长的内容是一个块
+    chunkContent("abc", 3, options, chunks);
+    CHECK(chunks.size() == 1 && chunks[0].length == 3);
+    std::cout << "Content defined chunking test completed.\n";
+}
+
+void test_chunked_commits() {
+    fs::path base = fs::temp_directory_path() / "ct_chunked_commit_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path routes = base / "etc" / "routes.conf";
+    fs::path small = base / "etc" / "small.conf";
+    std::string v1 = routingTable(80000, 7);
+    std::string v2 = v1;
+    v2.replace(v2.size() / 3, 20, "route 172.16.0.0/12 ");
+    writeFile(routes, v1);
+    writeFile(small, "a=1\n");
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        git.addFiles({routes.string(), small.string()});
+        git.commit("v1");
+        std::string first = git.getLatestCommit();
+
+        // 快照只看到被跟踪的文件，读到的是完整内容
+        std::vector<TreeFile> files;
+        CHECK(git.listFiles("", files) && files.size() == 2);
+        for (const auto& file : files) {
+            std::string content;
+            CHECK(git.readBlob(file.oid, content));
+            CHECK(content == (file.path.find("routes.conf") != std::string::npos ? v1 : "a=1\n"));
+        }
+
+        // 修改一处只写入改动的块、新清单以及受影响的树和提交
+        size_t loose = countLoose(repoPath);
+        writeFile(routes, v2);
+        git.addFile(routes.string());
+        git.commit("v2");
+        size_t added = countLoose(repoPath) - loose;
+        std::cout << v1.size() << " byte file changed: " << added << " new objects\n";
+        CHECK(added < 16);
+        CHECK(git.commitsTouching(routes.string()).size() == 2);
+        CHECK(git.commitsTouching(small.string()).size() == 1);
+
+        // 恢复到旧版本：按内容比较，写回完整文件
+        std::vector<RestoreAction> actions;
+        bool planned = git.planRestore(first, {}, actions);
+        CHECK(planned);
+        CHECK(actions.size() == 1 && actions[0].path == routes.string());
+        bool applied = git.applyRestore(first, actions);
+        CHECK(applied);
+        CHECK(readFile(routes) == v1);
+        planned = git.planRestore(first, {}, actions);
+        CHECK(planned && actions.empty());
+        CHECK(git.listFiles("", files) && files.size() == 2);
+
+        // 缩小到阈值以下后按普通文件存储，块目录随之删除
+        writeFile(routes, "route default\n");
+        git.addFile(routes.string());
+        git.commit("v3");
+        CHECK(git.listFiles("", files) && files.size() == 2);
+        git_repository* repo = nullptr;
+        git_commit* head = nullptr;
+        git_tree* tree = nullptr;
+        git_oid oid;
+        int error = git_repository_open(&repo, repoPath.string().c_str());
+        CHECK(error == 0);
+        error = git_reference_name_to_id(&oid, repo, "HEAD");
+        CHECK(error == 0);
+        error = git_commit_lookup(&head, repo, &oid);
+        CHECK(error == 0);
+        error = git_commit_tree(&tree, head);
+        CHECK(error == 0);
+        git_tree_entry* entry = nullptr;
+        error = git_tree_entry_bypath(&entry, tree, ".ctchunks");
+        CHECK(error != 0);
+        git_tree_free(tree);
+        git_commit_free(head);
+        git_repository_free(repo);
+
+        // 删除文件
+        fs::remove(routes);
+        git.addFile(routes.string());
+        git.commit("v4");
+        CHECK(git.listFiles("", files) && files.size() == 1);
+    }
+    // 重新打开后可以读取历史版本
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        std::vector<std::string> commits = git.listCommits();
+        CHECK(commits.size() == 5);
+        std::vector<TreeFile> files;
+        CHECK(git.listFiles(commits.back(), files) && files.size() == 2);
+        for (const auto& file : files) {
+            std::string content;
+            CHECK(git.readBlob(file.oid, content));
+            CHECK(content == v1 || content == "a=1\n");
+        }
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Chunked commit test completed.\n";
+}
+
+void test_chunking_disabled() {
+    fs::path base = fs::temp_directory_path() / "ct_chunked_disabled_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path routes = base / "etc" / "routes.conf";
+    std::string v1 = routingTable(40000, 3);
+    writeFile(routes, v1);
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        ChunkingOptions options;
+        options.threshold = 0;
+        git.setChunking(options);
+        git.init();
+        size_t loose = countLoose(repoPath);
+        git.addFile(routes.string());
+        git.commit("v1");
+        // 整个文件一个 blob，加上树和提交
+        CHECK(countLoose(repoPath) - loose <= 3 + 4);
+        std::vector<TreeFile> files;
+        CHECK(git.listFiles("", files) && files.size() == 1);
+        std::string content;
+        CHECK(git.readBlob(files[0].oid, content) && content == v1);
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Chunking disabled test completed.\n";
+}
+
+int main() {
+    test_content_defined_chunking();
+    test_chunked_commits();
+    test_chunking_disabled();
+    return 0;
+}
@@ -0,0 +1,360 @@
+#include "configtracker/commit_batcher.h"
+#include "configtracker/config_tracker.h"
+#include "test_util.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <future>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <set>
+#include <atomic>
+
+using namespace configtracker;
+
+namespace {
+
+struct BatchLog {
+    std::mutex mutex;
+    std::vector<std::vector<std::string>> batches;
+
+    size_t count() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return batches.size();
+    }
+};
+
+}
+
+void test_coalesce_burst() {
+    BatchLog log;
+    CommitBatcher batcher(std::chrono::milliseconds(50), std::chrono::seconds(5),
+        [&log](const std::vector<std::string>& paths) {
+            std::lock_guard<std::mutex> lock(log.mutex);
+            log.batches.push_back(paths);
+        });
+    batcher.start();
+
+    // 一次部署改写 500 个文件，其中每个文件被写两次
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < 500; ++i) {
+            batcher.enqueue("./config/file" + std::to_string(i) + ".conf");
+        }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CHECK(log.count() == 1);
+    CHECK(log.batches[0].size() == 500);
+    CHECK(log.batches[0].front() == "./config/file0.conf");
+
+    batcher.stop();
+    std::cout << "Burst coalescing test completed." << std::endl;
+}
+
+void test_max_latency() {
+    BatchLog log;
+    CommitBatcher batcher(std::chrono::milliseconds(100), std::chrono::milliseconds(250),
+        [&log](const std::vector<std::string>& paths) {
+            std::lock_guard<std::mutex> lock(log.mutex);
+            log.batches.push_back(paths);
+        });
+    batcher.start();
+
+    // 持续不断的变更不会让批次无限推迟
+    auto begin = std::chrono::steady_clock::now();
+    while (log.count() == 0 && std::chrono::steady_clock::now() - begin < std::chrono::seconds(2)) {
+        batcher.enqueue("./config/busy.conf");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    CHECK(log.count() >= 1);
+    CHECK(std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(600));
+
+    batcher.stop();
+    std::cout << "Max latency test completed." << std::endl;
+}
+
+void test_stop_flushes_pending() {
+    BatchLog log;
+    CommitBatcher batcher(std::chrono::seconds(10), std::chrono::seconds(10),
+        [&log](const std::vector<std::string>& paths) {
+            std::lock_guard<std::mutex> lock(log.mutex);
+            log.batches.push_back(paths);
+        });
+    batcher.start();
+    batcher.enqueue("./config/a.conf");
+    batcher.enqueue("./config/b.conf");
+    batcher.stop();
+
+    CHECK(log.count() == 1);
+    CHECK(log.batches[0].size() == 2);
+    std::cout << "Stop flush test completed." << std::endl;
+}
+
+void test_enqueue_does_not_wait_for_git() {
+    BatchLog log;
+    std::atomic<bool> inCommit{false};
+    CommitBatcher batcher(std::chrono::milliseconds(1), std::chrono::milliseconds(1),
+        [&](const std::vector<std::string>& paths) {
+            inCommit = true;
+            // 模拟缓慢的 fsync / 大树写入
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            std::lock_guard<std::mutex> lock(log.mutex);
+            log.batches.push_back(paths);
+        }, 16, BackpressurePolicy::Coalesce);
+    batcher.start();
+
+    batcher.enqueue("./config/first.conf");
+    while (!inCommit) std::this_thread::yield();
+
+    // 提交线程忙时投递远超队列容量的事件，监控线程不应被阻塞
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        batcher.enqueue("./config/file" + std::to_string(i % 200) + ".conf");
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    CHECK(elapsed < std::chrono::milliseconds(100));
+    CHECK(batcher.coalescedEvents() > 0);
+
+    batcher.stop();
+    std::set<std::string> delivered;
+    for (const auto& batch : log.batches) {
+        delivered.insert(batch.begin(), batch.end());
+    }
+    // 溢出的事件被合并而不是丢弃
+    CHECK(delivered.size() == 201);
+    std::cout << "Non-blocking enqueue test completed." << std::endl;
+}
+
+void test_backpressure_block_and_drop() {
+    std::mutex gate;
+    std::unique_lock<std::mutex> hold(gate);
+    std::atomic<bool> inCommit{false};
+    std::atomic<size_t> deliveredCount{0};
+    auto slowCommit = [&](const std::vector<std::string>& paths) {
+        inCommit = true;
+        std::lock_guard<std::mutex> wait(gate);
+        deliveredCount += paths.size();
+    };
+
+    {
+        CommitBatcher dropping(std::chrono::milliseconds(1), std::chrono::milliseconds(1),
+                               slowCommit, 8, BackpressurePolicy::Drop);
+        dropping.start();
+        dropping.enqueue("./config/first.conf");
+        while (!inCommit) std::this_thread::yield();
+        for (int i = 0; i < 20; ++i) {
+            dropping.enqueue("./config/file" + std::to_string(i) + ".conf");
+        }
+        CHECK(dropping.droppedEvents() == 12);
+        hold.unlock();
+        dropping.stop();
+        CHECK(deliveredCount == 9);
+    }
+
+    hold.lock();
+    inCommit = false;
+    deliveredCount = 0;
+    {
+        CommitBatcher blocking(std::chrono::milliseconds(1), std::chrono::milliseconds(1),
+                               slowCommit, 8, BackpressurePolicy::Block);
+        blocking.start();
+        blocking.enqueue("./config/first.conf");
+        while (!inCommit) std::this_thread::yield();
+
+        std::atomic<bool> producerDone{false};
+        std::thread producer([&]() {
+            for (int i = 0; i < 20; ++i) {
+                blocking.enqueue("./config/file" + std::to_string(i) + ".conf");
+            }
+            producerDone = true;
+        });
+        // 队列满后生产者等待提交线程腾出空间
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        CHECK(!producerDone);
+        hold.unlock();
+        producer.join();
+        blocking.stop();
+        CHECK(blocking.blockedEvents() > 0);
+        CHECK(deliveredCount == 21);
+    }
+    std::cout << "Backpressure policy test completed." << std::endl;
+}
+
+void test_concurrent_producers() {
+    std::mutex mutex;
+    std::set<std::string> delivered;
+    size_t total = 0;
+    CommitBatcher batcher(std::chrono::milliseconds(5), std::chrono::milliseconds(20),
+        [&](const std::vector<std::string>& paths) {
+            std::lock_guard<std::mutex> lock(mutex);
+            delivered.insert(paths.begin(), paths.end());
+            total += paths.size();
+        }, 64);
+    batcher.start();
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; ++t) {
+        producers.emplace_back([&batcher, t]() {
+            for (int i = 0; i < 5000; ++i) {
+                batcher.enqueue("./config/t" + std::to_string(t) + "/file" + std::to_string(i) + ".conf");
+            }
+        });
+    }
+    for (auto& producer : producers) producer.join();
+    batcher.flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(delivered.size() == 20000);
+    }
+    batcher.stop();
+    std::cout << "Concurrent producer test completed." << std::endl;
+}
+
+// 监控线程在 Block 策略下等待队列空间时不能持有回调锁，否则提交线程在 markCommitted 中等锁而死锁
+void test_tracker_block_policy() {
+    namespace fs = std::filesystem;
+    fs::path base = fs::temp_directory_path() / "ct_batcher_block_test";
+    fs::remove_all(base);
+    fs::path watchDir = base / "watch";
+    fs::create_directories(watchDir);
+
+    TrackConfig config;
+    config.repoRoot = (base / "repo").string();
+    config.watchPaths = {watchDir.string()};
+    config.retentionDays = 0;
+    config.batchQuietMs = 0;
+    config.batchMaxLatencyMs = 0;
+    config.commitQueueCapacity = 2;
+    config.backpressure = BackpressurePolicy::Block;
+    config.packMaintenance = false;
+    config.logLevel = LogLevel::Warn;
+
+    const int files = 400;
+    git_libgit2_init();
+    {
+        ConfigTracker tracker(config);
+        tracker.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        for (int i = 0; i < files; ++i) {
+            std::ofstream out(watchDir / ("f" + std::to_string(i) + ".conf"));
+            out << "id=" << i << "\n";
+        }
+        // 死锁时提交停滞，快照不会包含全部文件
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (std::chrono::steady_clock::now() < deadline) {
+            SnapshotPtr snapshot = tracker.snapshot();
+            if (snapshot && snapshot->size() == static_cast<size_t>(files)) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+
+        std::future<void> stopped = std::async(std::launch::async, [&tracker] { tracker.stop(); });
+        bool finished = stopped.wait_for(std::chrono::seconds(60)) == std::future_status::ready;
+        CHECK(finished);
+        (void)finished;
+
+        SnapshotPtr snapshot = tracker.snapshot();
+        CHECK(snapshot && snapshot->size() == static_cast<size_t>(files));
+        for (int i = 0; i < files; ++i) {
+            CHECK(snapshot->contains((watchDir / ("f" + std::to_string(i) + ".conf")).string()));
+        }
+    }
+    git_libgit2_shutdown();
+    fs::remove_all(base);
+    std::cout << "Tracker block policy test completed." << std::endl;
+}
+
+void test_tracker_retries_failed_commit() {
+    namespace fs = std::filesystem;
+    fs::path base = fs::temp_directory_path() / "ct_batcher_retry_test";
+    fs::remove_all(base);
+    fs::path watchDir = base / "watch";
+    fs::path first = watchDir / "a.conf";
+    fs::path second = watchDir / "b.conf";
+    fs::path objects = base / "repo" / ".git" / "objects";
+    fs::path moved = base / "objects.saved";
+    fs::create_directories(watchDir);
+    auto write = [](const fs::path& path, const std::string& content) {
+        std::ofstream out(path, std::ios::trunc);
+        out << content;
+    };
+    auto contentOf = [](const SnapshotPtr& snapshot, const fs::path& path) -> std::string {
+        std::string_view view;
+        if (!snapshot || !snapshot->read(path.string(), view)) return "<missing>";
+        return std::string(view);
+    };
+    // 对象库换成普通文件后写对象失败，以 root 运行时 chmod 不起作用
+    auto breakObjects = [&] {
+        fs::rename(objects, moved);
+        write(objects, "");
+    };
+    auto restoreObjects = [&] {
+        fs::remove(objects);
+        fs::rename(moved, objects);
+    };
+    write(first, "rev=0\n");
+
+    TrackConfig config;
+    config.repoRoot = (base / "repo").string();
+    config.watchPaths = {watchDir.string()};
+    config.retentionDays = 0;
+    config.batchQuietMs = 50;
+    config.batchMaxLatencyMs = 200;
+    config.pollIntervalMs = 20;
+    config.watchBackend = WatchBackendType::Polling;
+    config.packMaintenance = false;
+    config.logLevel = LogLevel::Off;
+
+    git_libgit2_init();
+    {
+        ConfigTracker tracker(config);
+        tracker.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        CHECK(contentOf(tracker.snapshot(), first) == "rev=0\n");
+
+        // 提交失败时快照不变
+        breakObjects();
+        write(first, "rev=1\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        CHECK(contentOf(tracker.snapshot(), first) == "rev=0\n");
+
+        // 恢复后失败的文件随下一批一起提交，尽管它没有再次变化
+        restoreObjects();
+        write(second, "rev=0\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        CHECK(contentOf(tracker.snapshot(), first) == "rev=1\n");
+        CHECK(contentOf(tracker.snapshot(), second) == "rev=0\n");
+
+        // 停止前的最后一批也失败：文件状态不持久化
+        breakObjects();
+        write(first, "rev=2\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        tracker.stop();
+        restoreObjects();
+    }
+    {
+        // 重启后重新上报并提交
+        ConfigTracker tracker(config);
+        tracker.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        CHECK(contentOf(tracker.snapshot(), first) == "rev=2\n");
+        tracker.stop();
+    }
+    git_libgit2_shutdown();
+    fs::remove_all(base);
+    std::cout << "Tracker retries failed commit test completed." << std::endl;
+}
+
+int main() {
+    test_coalesce_burst();
+    test_max_latency();
+    test_stop_flushes_pending();
+    test_enqueue_does_not_wait_for_git();
+    test_backpressure_block_and_drop();
+    test_concurrent_producers();
+    test_tracker_block_policy();
+    test_tracker_retries_failed_commit();
+    return 0;
+}
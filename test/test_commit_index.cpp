@@ -0,0 +1,141 @@
+#include "configtracker/commit_index.h"
+#include "test_util.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace configtracker;
+
+namespace {
+
+git_oid makeOid(uint32_t n) {
+    git_oid oid{};
+    for (int i = 0; i < 4; ++i) {
+        oid.id[i] = static_cast<unsigned char>(n >> (8 * i));
+    }
+    oid.id[19] = 1;
+    return oid;
+}
+
+CommitInfo makeInfo(uint32_t n, int64_t time, std::vector<std::string> paths) {
+    CommitInfo info;
+    info.oid = makeOid(n);
+    info.parent = n > 0 ? makeOid(n - 1) : git_oid{};
+    info.time = time;
+    info.paths = std::move(paths);
+    return info;
+}
+
+std::string freshDir(const char* name) {
+    auto dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+}
+
+void test_append_and_query() {
+    std::string dir = freshDir("ct_commit_index_test");
+    {
+        CommitIndex index;
+        bool opened = index.open(dir);
+        CHECK(opened);
+        CHECK(index.empty());
+        for (uint32_t i = 0; i < 1000; ++i) {
+            std::vector<std::string> paths = {"etc/file" + std::to_string(i % 10) + ".conf"};
+            if (i % 100 == 0) paths.push_back("etc/rare.conf");
+            bool appended = index.append(makeInfo(i, 1000 + i * 10, paths));
+            CHECK(appended);
+        }
+    }
+
+    // 重新打开后直接从 mmap 的文件中查询
+    CommitIndex index;
+    bool opened = index.open(dir);
+    CHECK(opened);
+    CHECK(index.size() == 1000);
+    git_oid last = makeOid(999);
+    CHECK(git_oid_equal(&index.at(999).oid, &last));
+    CHECK(index.find(makeOid(500)) == 500);
+
+    auto range = index.range(1000 + 100 * 10, 1000 + 199 * 10);
+    CHECK(range.first == 100 && range.second == 200);
+    CHECK(index.lastBefore(1000 + 50 * 10) == 49);
+    CHECK(index.lastBefore(1000) == CommitIndex::npos);
+
+    const std::vector<uint32_t>* rare = index.touching("etc/rare.conf");
+    CHECK(rare && rare->size() == 10 && rare->front() == 0 && rare->back() == 900);
+    CHECK(index.touching("etc/file3.conf")->size() == 100);
+    CHECK(index.touching("etc/missing.conf") == nullptr);
+    CHECK(index.pathsOf(100).size() == 2);
+
+    // 分支回退：只保留前 300 条
+    bool truncated = index.truncate(300);
+    CHECK(truncated);
+    CHECK(index.size() == 300);
+    CHECK(index.touching("etc/rare.conf")->size() == 3);
+    CHECK(index.find(makeOid(299)) == 299);
+    CHECK(index.find(makeOid(500)) == CommitIndex::npos);
+    bool appended = index.append(makeInfo(500, 5000, {"etc/new.conf"}));
+    CHECK(appended);
+    CHECK(index.touching("etc/new.conf")->front() == 300);
+    CHECK(index.find(makeOid(500)) == 300);
+
+    std::filesystem::remove_all(dir);
+    std::cout << "Commit index query test completed.\n";
+}
+
+void test_clock_skew_and_torn_tail() {
+    std::string dir = freshDir("ct_commit_index_skew_test");
+    {
+        CommitIndex index;
+        bool opened = index.open(dir);
+        CHECK(opened);
+        bool appended = index.append(makeInfo(0, 100, {"a"}));
+        CHECK(appended);
+        // 时钟回拨：排序键保持单调，二分查找仍然成立
+        appended = index.append(makeInfo(1, 50, {"b"}));
+        CHECK(appended);
+        appended = index.append(makeInfo(2, 200, {"a", "a", "b"}));
+        CHECK(appended);
+        CHECK(index.at(1).time == 50 && index.at(1).orderTime == 100);
+        CHECK(index.pathsOf(2).size() == 2);
+    }
+
+    // 模拟追加记录时崩溃：记录文件尾部只写了一半
+    {
+        std::ofstream out(dir + "/commits.idx", std::ios::binary | std::ios::app);
+        out.write("partial", 7);
+    }
+    {
+        CommitIndex index;
+        bool opened = index.open(dir);
+        CHECK(opened);
+        CHECK(index.size() == 3);
+        bool appended = index.append(makeInfo(3, 300, {"c"}));
+        CHECK(appended);
+        CHECK(index.size() == 4);
+    }
+    CommitIndex index;
+    bool opened = index.open(dir);
+    CHECK(opened);
+    CHECK(index.size() == 4);
+    CHECK(index.touching("c")->front() == 3);
+
+    // 整体替换
+    bool rewritten = index.rewrite({makeInfo(7, 10, {"x"})});
+    CHECK(rewritten);
+    CHECK(index.size() == 1 && index.touching("a") == nullptr);
+    CHECK(index.find(makeOid(7)) == 0 && index.find(makeOid(3)) == CommitIndex::npos);
+
+    std::filesystem::remove_all(dir);
+    std::cout << "Commit index recovery test completed.\n";
+}
+
+int main() {
+    test_append_and_query();
+    test_clock_skew_and_torn_tail();
+    return 0;
+}
@@ -0,0 +1,304 @@
+#include "configtracker/config_snapshot.h"
+#include "configtracker/git_repo_manager.h"
+#include "configtracker/config_tracker.h"
+#include "test_util.h"
+#include <atomic>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <map>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+
+void test_snapshot_shares_blobs() {
+    fs::path base = fs::temp_directory_path() / "ct_snapshot_test";
+    fs::remove_all(base);
+    fs::path a = base / "etc" / "a.conf";
+    fs::path b = base / "etc" / "b.conf";
+    writeFile(a, "a=1\n");
+    writeFile(b, "b=1\n");
+
+    git_libgit2_init();
+    {
+        GitRepoManager git((base / "repo").string());
+        git.init();
+        git.addFiles({a.string(), b.string()});
+        git.commit("v1");
+        std::string v1 = git.getLatestCommit();
+        writeFile(a, "a=2\n");
+        git.addFile(a.string());
+        git.commit("v2");
+        std::string v2 = git.getLatestCommit();
+
+        int reads = 0;
+        auto store = std::make_shared<BlobStore>([&git, &reads](const git_oid& oid, std::string& out) {
+            ++reads;
+            return git.readBlob(oid, out);
+        });
+
+        // 延迟加载：构造时不读取内容
+        std::vector<TreeFile> files;
+        std::string resolved;
+        CHECK(git.listFiles(v1, files, &resolved) && resolved == v1 && files.size() == 2);
+        SnapshotPtr s1 = ConfigSnapshot::build(resolved, files, nullptr, store, false);
+        CHECK(reads == 0);
+        CHECK(s1->size() == 2 && s1->contains(a.string()));
+        CHECK(contentOf(s1, a.string()) == "a=1\n");
+        CHECK(contentOf(s1, b.string()) == "b=1\n");
+        CHECK(reads == 2);
+        // 已加载的内容不会重复读取，仓库内路径同样可以查找
+        CHECK(contentOf(s1, a.relative_path().generic_string()) == "a=1\n");
+        CHECK(reads == 2);
+        CHECK(!s1->get((base / "missing.conf").string()));
+
+        // 新版本只读取改动的文件，未改动的内容与旧快照共享
+        CHECK(git.listFiles("", files, &resolved) && resolved == v2);
+        SnapshotPtr s2 = ConfigSnapshot::build(resolved, files, s1.get(), store, true);
+        CHECK(reads == 3);
+        CHECK(s2->get(b.string()) == s1->get(b.string()));
+        CHECK(contentOf(s2, a.string()) == "a=2\n");
+        CHECK(contentOf(s1, a.string()) == "a=1\n");
+
+        // 还有快照持有的内容按 oid 去重
+        SnapshotPtr again = ConfigSnapshot::build(v1, files, nullptr, store, true);
+        CHECK(reads == 3);
+        CHECK(again->get(b.string()) == s1->get(b.string()));
+        again.reset();
+        s1.reset();
+        s2.reset();
+        CHECK(store->liveCount() == 0);
+
+        // 仓库释放后，尚未加载的内容返回空
+        CHECK(git.listFiles(v1, files));
+        SnapshotPtr orphan = ConfigSnapshot::build(v1, files, nullptr, store, false);
+        store.reset();
+        CHECK(orphan->size() == 2 && !orphan->get(a.string()));
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Snapshot blob sharing test completed.\n";
+}
+
+void test_snapshot_derive() {
+    fs::path base = fs::temp_directory_path() / "ct_snapshot_derive_test";
+    fs::remove_all(base);
+    fs::path a = base / "etc" / "a.conf";
+    fs::path b = base / "etc" / "b.conf";
+    fs::path c = base / "etc" / "sub" / "c.conf";
+    writeFile(a, "a=1\n");
+    writeFile(b, "b=1\n");
+
+    git_libgit2_init();
+    {
+        GitRepoManager git((base / "repo").string());
+        git.init();
+        git.addFiles({a.string(), b.string()});
+        git.commit("v1");
+        std::string v1 = git.getLatestCommit();
+        writeFile(a, "a=2\n");
+        writeFile(c, "c=1\n");
+        fs::remove(b);
+        git.addFiles({a.string(), b.string(), c.string()});
+        git.commit("v2");
+        std::string v2 = git.getLatestCommit();
+
+        int reads = 0;
+        auto store = std::make_shared<BlobStore>([&git, &reads](const git_oid& oid, std::string& out) {
+            ++reads;
+            return git.readBlob(oid, out);
+        });
+        std::vector<TreeFile> files;
+        bool listed = git.listFiles(v1, files);
+        CHECK(listed);
+        SnapshotPtr s1 = ConfigSnapshot::build(v1, files, nullptr, store, false);
+        CHECK(contentOf(s1, a.string()) == "a=1\n");
+
+        // 只取两次提交之间改动的路径
+        std::string head;
+        std::vector<TreeFile> changed;
+        std::vector<std::string> removed;
+        bool found = git.changesSince(v1, head, changed, removed);
+        CHECK(found && head == v2);
+        CHECK(changed.size() == 2 && removed.size() == 1);
+        CHECK(removed[0] == b.relative_path().generic_string());
+
+        reads = 0;
+        SnapshotPtr s2 = ConfigSnapshot::derive(head, *s1, changed, removed, store, false);
+        CHECK(reads == 0);
+        listed = git.listFiles(v2, files);
+        CHECK(listed);
+        SnapshotPtr full = ConfigSnapshot::build(v2, files, nullptr, store, false);
+        CHECK(s2->commit() == v2 && s2->size() == 2 && s2->paths() == full->paths());
+        CHECK(contentOf(s2, a.string()) == "a=2\n");
+        CHECK(contentOf(s2, c.string()) == "c=1\n");
+        CHECK(!s2->contains(b.string()));
+        // 旧快照不变
+        CHECK(s1->size() == 2 && contentOf(s1, b.string()) == "b=1\n");
+
+        // 空的 base 表示从第一次提交开始，不认识的提交退回完整列表
+        found = git.changesSince("", head, changed, removed);
+        CHECK(found && changed.size() == 2 && removed.size() == 1);
+        found = git.changesSince(std::string(GIT_OID_HEXSZ, '1'), head, changed, removed);
+        CHECK(!found);
+        found = git.changesSince(v2, head, changed, removed);
+        CHECK(found && head == v2 && changed.empty() && removed.empty());
+    }
+    git_libgit2_shutdown();
+    fs::remove_all(base);
+
+    // 连续派生的版本与完整构造的结果一致，改动积累到一定程度后合并
+    auto oidOf = [](int value) {
+        char hex[GIT_OID_HEXSZ + 1];
+        std::snprintf(hex, sizeof(hex), "%040x", value);
+        git_oid oid;
+        git_oid_fromstr(&oid, hex);
+        return oid;
+    };
+    auto store = std::make_shared<BlobStore>(nullptr);
+    std::map<std::string, int> model;
+    std::vector<TreeFile> files;
+    for (int i = 0; i < 500; ++i) {
+        model["f" + std::to_string(i)] = i;
+        files.push_back({"f" + std::to_string(i), oidOf(i), GIT_FILEMODE_BLOB});
+    }
+    SnapshotPtr current = ConfigSnapshot::build("0", files, nullptr, store, false);
+    for (int round = 1; round <= 400; ++round) {
+        std::vector<TreeFile> changed;
+        std::vector<std::string> removed;
+        std::string modified = "f" + std::to_string(round * 7 % 600);
+        changed.push_back({modified, oidOf(1000 + round), GIT_FILEMODE_BLOB});
+        model[modified] = 1000 + round;
+        if (round % 3 == 0) {
+            std::string gone = "f" + std::to_string(round * 11 % 600);
+            if (gone != modified) {
+                removed.push_back(gone);
+                model.erase(gone);
+            }
+        }
+        SnapshotPtr next = ConfigSnapshot::derive(std::to_string(round), *current, changed, removed, store, false);
+        CHECK(next->size() == model.size());
+        current = next;
+    }
+    std::vector<std::string> expected;
+    for (const auto& item : model) expected.push_back(item.first);
+    CHECK(current->paths() == expected);
+    for (const auto& item : model) {
+        CHECK(current->contains(item.first));
+    }
+    std::cout << "Snapshot derive test completed.\n";
+}
+
+void test_snapshot_cache_lru() {
+    SnapshotCache cache(2);
+    auto store = std::make_shared<BlobStore>(nullptr);
+    SnapshotPtr s1 = ConfigSnapshot::build("1", {}, nullptr, store, false);
+    SnapshotPtr s2 = ConfigSnapshot::build("2", {}, nullptr, store, false);
+    SnapshotPtr s3 = ConfigSnapshot::build("3", {}, nullptr, store, false);
+    cache.put(s1);
+    cache.put(s2);
+    SnapshotPtr hit = cache.get("1");
+    CHECK(hit == s1);
+    // 2 最久未使用，被淘汰
+    cache.put(s3);
+    CHECK(cache.size() == 2);
+    SnapshotPtr evicted = cache.get("2");
+    CHECK(!evicted);
+    SnapshotPtr kept = cache.get("1");
+    SnapshotPtr added = cache.get("3");
+    CHECK(kept == s1 && added == s3);
+    std::cout << "Snapshot cache test completed.\n";
+}
+
+void test_tracker_publishes_snapshots() {
+    fs::path base = fs::temp_directory_path() / "ct_snapshot_tracker_test";
+    fs::remove_all(base);
+    fs::path watchDir = base / "watch";
+    fs::path file = watchDir / "app.conf";
+    fs::path other = watchDir / "other.conf";
+    writeFile(file, "version=1\n");
+    writeFile(other, "stable\n");
+
+    TrackConfig config;
+    config.watchPaths = {watchDir.string()};
+    config.repoRoot = (base / "repo").string();
+    config.retentionDays = 0;
+    config.batchQuietMs = 50;
+    config.batchMaxLatencyMs = 200;
+    config.logLevel = LogLevel::Warn;
+
+    git_libgit2_init();
+    {
+        ConfigTracker tracker(config);
+        tracker.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        SnapshotPtr first = tracker.snapshot();
+        CHECK(first && !first->commit().empty());
+        CHECK(contentOf(first, file.string()) == "version=1\n");
+
+        // 读者线程在提交过程中持续读取，看到的始终是某个完整版本
+        std::atomic<bool> done{false};
+        std::atomic<size_t> reads{0};
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 8; ++t) {
+            readers.emplace_back([&] {
+                while (!done) {
+                    SnapshotPtr current = tracker.snapshot();
+                    std::string value = contentOf(current, file.string());
+                    CHECK(value.rfind("version=", 0) == 0);
+                    CHECK(contentOf(current, other.string()) == "stable\n");
+                    ++reads;
+                }
+            });
+        }
+        std::vector<std::string> commits;
+        for (int i = 2; i <= 4; ++i) {
+            writeFile(file, "version=" + std::to_string(i) + "\n");
+            std::this_thread::sleep_for(std::chrono::milliseconds(400));
+            commits.push_back(tracker.snapshot()->commit());
+        }
+        done = true;
+        for (auto& reader : readers) reader.join();
+        CHECK(reads > 0);
+
+        SnapshotPtr latest = tracker.snapshot();
+        CHECK(latest->commit() != first->commit());
+        CHECK(contentOf(latest, file.string()) == "version=4\n");
+        // 旧快照不受后续提交影响，未改动的文件共享同一份内容
+        CHECK(contentOf(first, file.string()) == "version=1\n");
+        CHECK(latest->get(other.string()) == first->get(other.string()));
+
+        // 历史快照：按需加载，缓存命中时返回同一个对象
+        SnapshotPtr old = tracker.snapshotAt(first->commit());
+        CHECK(old && old->commit() == first->commit());
+        CHECK(contentOf(old, file.string()) == "version=1\n");
+        SnapshotPtr cached = tracker.snapshotAt(first->commit());
+        CHECK(cached == old);
+        SnapshotPtr at = tracker.snapshotAt(commits[0]);
+        CHECK(contentOf(at, file.string()) == "version=2\n");
+        CHECK(at->get(other.string()) == latest->get(other.string()));
+        SnapshotPtr current = tracker.snapshotAt(latest->commit());
+        CHECK(current == latest);
+        SnapshotPtr missing = tracker.snapshotAt("not-a-commit");
+        CHECK(!missing);
+        tracker.stop();
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Tracker snapshot test completed.\n";
+}
+
+int main() {
+    test_snapshot_shares_blobs();
+    test_snapshot_derive();
+    test_snapshot_cache_lru();
+    test_tracker_publishes_snapshots();
+    return 0;
+}
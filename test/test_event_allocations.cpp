@@ -0,0 +1,233 @@
+#include "configtracker/config_tracker.h"
+#include "configtracker/path_table.h"
+#include "configtracker/commit_batcher.h"
+#include "test_util.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+
+// 计数分配器：统计测量期间除主线程以外的全部堆分配。
+// 主线程负责写文件和等待，其分配不属于事件处理
+namespace {
+
+std::atomic<bool> g_counting{false};
+std::atomic<uint64_t> g_allocations{0};
+thread_local bool t_excluded = false;
+
+void* countedAlloc(std::size_t size, std::size_t alignment) {
+    if (g_counting.load(std::memory_order_relaxed) && !t_excluded) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (size == 0) size = 1;
+    void* p = alignment > alignof(std::max_align_t)
+                  ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                  : std::malloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+}
+
+void* operator new(std::size_t size) { return countedAlloc(size, 0); }
+void* operator new[](std::size_t size) { return countedAlloc(size, 0); }
+void* operator new(std::size_t size, std::align_val_t align) { return countedAlloc(size, static_cast<std::size_t>(align)); }
+void* operator new[](std::size_t size, std::align_val_t align) { return countedAlloc(size, static_cast<std::size_t>(align)); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+
+// 等待事件计数达到 target
+bool waitForEvents(uint64_t target, int timeoutMs = 5000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (CoreMetrics::get().eventsDetected.value() >= target) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+}
+
+void test_arena_reset() {
+    StringArena arena(256);
+    std::string longPath(300, 'x');
+    arena.store("/etc/nginx/nginx.conf");
+    arena.store(longPath);
+    size_t used = arena.memoryUsage();
+    // reset 后复用已有的块，同样的内容不再分配
+    g_counting = true;
+    uint64_t before = g_allocations.load();
+    for (int round = 0; round < 100; ++round) {
+        arena.reset();
+        CHECK(arena.store("/etc/nginx/nginx.conf") == "/etc/nginx/nginx.conf");
+        CHECK(arena.store(longPath) == longPath);
+    }
+    uint64_t allocations = g_allocations.load() - before;
+    g_counting = false;
+    CHECK(allocations == 0 && arena.memoryUsage() == used);
+    arena.clear();
+    CHECK(arena.memoryUsage() == 0);
+    std::cout << "Arena reset test completed.\n";
+}
+
+void test_producer_enqueue() {
+    // 直接测量生产者路径：多个线程并发投递已出现过的路径，生产者和工作线程都不应分配内存
+    std::vector<std::string> paths;
+    for (int i = 0; i < 8; ++i) {
+        paths.push_back("/etc/configtracker/service-" + std::to_string(i) + "/settings.conf");
+    }
+    std::atomic<size_t> delivered{0};
+    CommitBatcher batcher(std::chrono::seconds(60), std::chrono::seconds(60),
+        [&delivered](const std::vector<std::string>& batch) { delivered += batch.size(); },
+        256, BackpressurePolicy::Block);
+    batcher.start();
+    // 预热：工作线程的批次表达到稳定大小
+    for (const auto& path : paths) {
+        batcher.enqueue(path);
+    }
+    batcher.flush();
+    CHECK(delivered == paths.size());
+
+    const int producers = 4;
+    const int rounds = 2000;
+    // 只统计生产者线程和工作线程，主线程创建线程的分配不计入
+    std::vector<std::thread> threads;
+    threads.reserve(producers);
+    t_excluded = true;
+    g_allocations = 0;
+    g_counting = true;
+    for (int t = 0; t < producers; ++t) {
+        threads.emplace_back([&batcher, &paths] {
+            for (int round = 0; round < rounds; ++round) {
+                batcher.enqueue(paths[round % paths.size()]);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    g_counting = false;
+    t_excluded = false;
+    uint64_t allocations = g_allocations.load();
+    std::cout << "Heap allocations for " << producers * rounds << " enqueues: " << allocations << "\n";
+    CHECK(allocations == 0);
+
+    batcher.flush();
+    // 工作线程与生产者并发排空，flush 之前的事件可能分在多个批次中
+    CHECK(delivered >= paths.size() * 2);
+    batcher.stop();
+    std::cout << "Producer enqueue allocation test completed.\n";
+}
+
+// 启动跟踪器并预热后，统计 rounds 轮改写全部文件期间的堆分配次数
+uint64_t steadyStateAllocations(StorageMode storage) {
+    t_excluded = true;
+    fs::path base = fs::temp_directory_path() / "ct_event_alloc_test";
+    fs::remove_all(base);
+    fs::path watchDir = base / "watch";
+    const int fileCount = 8;
+    std::vector<fs::path> files;
+    for (int i = 0; i < fileCount; ++i) {
+        files.push_back(watchDir / ("service-" + std::to_string(i)) / "settings.conf");
+        writeFile(files.back(), "rev=0\n");
+    }
+
+    TrackConfig config;
+    config.repoRoot = (base / "repo").string();
+    config.watchPaths = {watchDir.string()};
+    config.retentionDays = 0;
+    config.packMaintenance = false;
+    config.watchBackend = WatchBackendType::Inotify;
+    config.storage = storage;
+    // 测量期间不提交：事件只进入队列（或日志），在批次中去重
+    config.batchQuietMs = 60000;
+    config.batchMaxLatencyMs = 60000;
+    config.journalFoldMs = 60000;
+    config.logLevel = LogLevel::Warn;
+
+    uint64_t allocations = 0;
+    git_libgit2_init();
+    {
+        ConfigTracker tracker(config);
+        tracker.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        // 预热：每个文件的路径驻留、状态表和各级缓冲区达到稳定大小
+        int revision = 1;
+        uint64_t events = CoreMetrics::get().eventsDetected.value();
+        for (int round = 0; round < 3; ++round, ++revision) {
+            for (const auto& file : files) {
+                writeFile(file, "rev=" + std::to_string(revision) + "\n");
+            }
+            events += fileCount;
+            bool arrived = waitForEvents(events);
+            CHECK(arrived);
+        }
+
+        const int rounds = 50;
+        std::vector<std::string> contents;
+        for (int round = 0; round < rounds; ++round) {
+            contents.push_back("rev=" + std::to_string(revision + round) + "\n");
+        }
+        g_allocations = 0;
+        g_counting = true;
+        for (int round = 0; round < rounds; ++round) {
+            for (const auto& file : files) {
+                writeFile(file, contents[round]);
+            }
+            events += fileCount;
+            // 逐轮等待，同一文件的两次写入不会合并成一个事件
+            bool arrived = waitForEvents(events);
+            CHECK(arrived);
+        }
+        g_counting = false;
+        allocations = g_allocations.load();
+        std::cout << "Heap allocations for " << rounds * fileCount << " steady-state events: " << allocations << "\n";
+
+        // 停止时仍然提交全部变更
+        tracker.stop();
+        std::string_view content;
+        CHECK(tracker.snapshot()->read(files[0].string(), content) && content == contents.back());
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    t_excluded = false;
+    return allocations;
+}
+
+void test_steady_state_events() {
+    CHECK(steadyStateAllocations(StorageMode::Git) == 0);
+    std::cout << "Steady state event allocation test completed.\n";
+}
+
+void test_steady_state_journal() {
+    CHECK(steadyStateAllocations(StorageMode::Journal) == 0);
+    std::cout << "Steady state journal allocation test completed.\n";
+}
+
+int main() {
+    test_arena_reset();
+    test_producer_enqueue();
+    test_steady_state_events();
+    test_steady_state_journal();
+    return 0;
+}
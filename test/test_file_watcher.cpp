@@ -0,0 +1,344 @@
+#include "configtracker/file_watcher.h"
+#include "configtracker/content_hash.h"
+#include "test_util.h"
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <set>
+
+using namespace configtracker;
+
+namespace {
+
+struct ChangeLog {
+    std::mutex mutex;
+    std::set<std::string> paths;
+
+    void add(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        paths.insert(std::filesystem::path(path).filename().string());
+    }
+    bool has(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return paths.count(name) > 0;
+    }
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        paths.clear();
+    }
+};
+
+// 在超时前等待某个文件名出现在变更记录中
+bool waitFor(ChangeLog& log, const std::string& name, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (log.has(name)) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return log.has(name);
+}
+
+void writeFile(const std::string& path, const std::string& content) {
+    std::ofstream file(path);
+    file << content << std::endl;
+}
+
+}
+
+void test_inotify_backend() {
+    std::filesystem::create_directories("./test_watch_inotify");
+    writeFile("./test_watch_inotify/existing.conf", "a=1");
+
+    ChangeLog log;
+    WatchOptions options;
+    options.backend = WatchBackendType::Inotify;
+    FileWatcher watcher(options);
+    watcher.addWatch("./test_watch_inotify");
+    watcher.startWatching([&log](std::string path) { log.add(path); });
+
+    // 启动时上报已存在的文件
+    bool arrived = waitFor(log, "existing.conf", std::chrono::milliseconds(500));
+    CHECK(arrived);
+
+    // 事件驱动：远小于轮询间隔即可收到
+    auto begin = std::chrono::steady_clock::now();
+    writeFile("./test_watch_inotify/new.conf", "b=2");
+    arrived = waitFor(log, "new.conf", std::chrono::milliseconds(500));
+    CHECK(arrived);
+    auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - begin);
+    std::cout << "inotify detection latency: " << latency.count() << " ms" << std::endl;
+
+    // 原子替换（写临时文件再 rename）同样能检测到
+    log.clear();
+    writeFile("./test_watch_inotify/.tmp", "a=3");
+    std::filesystem::rename("./test_watch_inotify/.tmp", "./test_watch_inotify/existing.conf");
+    arrived = waitFor(log, "existing.conf", std::chrono::milliseconds(500));
+    CHECK(arrived);
+
+    // stop 不需要等待轮询周期
+    begin = std::chrono::steady_clock::now();
+    watcher.stop();
+    CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(1));
+
+    std::filesystem::remove_all("./test_watch_inotify");
+    std::cout << "Inotify backend test completed." << std::endl;
+}
+
+void test_polling_backend() {
+    std::filesystem::create_directories("./test_watch_polling");
+    writeFile("./test_watch_polling/single.conf", "a=1");
+
+    ChangeLog log;
+    WatchOptions options;
+    options.backend = WatchBackendType::Polling;
+    options.pollInterval = std::chrono::milliseconds(50);
+    FileWatcher watcher(options);
+    watcher.addWatch("./test_watch_polling/single.conf");
+    watcher.startWatching([&log](std::string path) { log.add(path); });
+
+    bool arrived = waitFor(log, "single.conf", std::chrono::milliseconds(500));
+    CHECK(arrived);
+
+    // 内容变化后应再次上报
+    log.clear();
+    writeFile("./test_watch_polling/single.conf", "a=2");
+    arrived = waitFor(log, "single.conf", std::chrono::milliseconds(500));
+    CHECK(arrived);
+
+    // 只修改 mtime 不上报
+    log.clear();
+    std::filesystem::last_write_time("./test_watch_polling/single.conf",
+        std::filesystem::file_time_type::clock::now() + std::chrono::seconds(5));
+    arrived = waitFor(log, "single.conf", std::chrono::milliseconds(300));
+    CHECK(!arrived);
+
+    watcher.stop();
+    std::filesystem::remove_all("./test_watch_polling");
+    std::cout << "Polling backend test completed." << std::endl;
+}
+
+void test_persistent_state() {
+    // XXH64 标准测试向量
+    CHECK(xxhash64("", 0) == 0xEF46DB3751D8E999ULL);
+
+    std::filesystem::create_directories("./test_watch_state");
+    writeFile("./test_watch_state/a.conf", "a=1");
+    writeFile("./test_watch_state/b.conf", "b=1");
+
+    WatchOptions options;
+    options.backend = WatchBackendType::Polling;
+    options.pollInterval = std::chrono::milliseconds(50);
+    options.stateFile = "./test_watch_state.state";
+
+    {
+        ChangeLog log;
+        FileWatcher watcher(options);
+        watcher.addWatch("./test_watch_state");
+        watcher.startWatching([&log](std::string path) { log.add(path); });
+        bool arrived = waitFor(log, "a.conf", std::chrono::milliseconds(500));
+        CHECK(arrived);
+        arrived = waitFor(log, "b.conf", std::chrono::milliseconds(500));
+        CHECK(arrived);
+        watcher.stop();
+        watcher.markCommitted({"./test_watch_state/a.conf", "./test_watch_state/b.conf"});
+        watcher.saveState(true);
+    }
+
+    // 停止期间：a 只被 touch，b 的内容被修改
+    std::filesystem::last_write_time("./test_watch_state/a.conf",
+        std::filesystem::file_time_type::clock::now() + std::chrono::seconds(5));
+    writeFile("./test_watch_state/b.conf", "b=2");
+
+    {
+        ChangeLog log;
+        FileWatcher watcher(options);
+        watcher.addWatch("./test_watch_state");
+        watcher.startWatching([&log](std::string path) { log.add(path); });
+        bool arrived = waitFor(log, "b.conf", std::chrono::milliseconds(500));
+        CHECK(arrived);
+        CHECK(!log.has("a.conf"));
+        watcher.stop();
+    }
+
+    std::filesystem::remove_all("./test_watch_state");
+    std::filesystem::remove("./test_watch_state.state");
+    std::cout << "Persistent state test completed." << std::endl;
+}
+
+void test_recursive_filters() {
+    PathTable table;
+    for (int i = 0; i < 5000; ++i) {
+        PathId id = table.intern("./dir/file" + std::to_string(i));
+        CHECK(id == static_cast<PathId>(i));
+    }
+    CHECK(table.find("./dir/file4999") == 4999);
+    CHECK(table.find("./dir/missing") == kInvalidPathId);
+    CHECK(table.path(42) == "./dir/file42");
+    // reset 后 ID 从头分配；上一轮只用了一小部分的大表被释放
+    size_t large = table.memoryUsage();
+    table.reset();
+    CHECK(table.size() == 0 && table.find("./dir/file1") == kInvalidPathId);
+    PathId b = table.intern("./dir/b");
+    PathId a = table.intern("./dir/a");
+    PathId again = table.intern("./dir/b");
+    CHECK(b == 0 && a == 1 && again == 0 && table.memoryUsage() == large);
+    table.reset();
+    CHECK(table.size() == 0 && table.memoryUsage() < large);
+
+    std::filesystem::create_directories("./test_watch_tree/nested/deep");
+    std::filesystem::create_directories("./test_watch_tree/skip");
+    writeFile("./test_watch_tree/nested/deep/db.conf", "a=1");
+    writeFile("./test_watch_tree/nested/notes.txt", "ignored");
+    writeFile("./test_watch_tree/skip/other.conf", "ignored");
+
+    for (WatchBackendType type : {WatchBackendType::Inotify, WatchBackendType::Polling}) {
+        WatchOptions options;
+        options.backend = type;
+        options.pollInterval = std::chrono::milliseconds(50);
+        options.recursive = true;
+        options.includePatterns = {"*.conf"};
+        options.excludePatterns = {"skip"};
+
+        ChangeLog log;
+        FileWatcher watcher(options);
+        watcher.addWatch("./test_watch_tree");
+        watcher.startWatching([&log](std::string path) { log.add(path); });
+
+        bool arrived = waitFor(log, "db.conf", std::chrono::milliseconds(500));
+        CHECK(arrived);
+
+        // 运行中新建的子目录同样被监控
+        std::filesystem::create_directories("./test_watch_tree/nested/later");
+        writeFile("./test_watch_tree/nested/later/new.conf", "b=1");
+        arrived = waitFor(log, "new.conf", std::chrono::milliseconds(500));
+        CHECK(arrived);
+
+        CHECK(!log.has("notes.txt"));
+        CHECK(!log.has("other.conf"));
+        watcher.stop();
+        std::filesystem::remove_all("./test_watch_tree/nested/later");
+    }
+
+    std::filesystem::remove_all("./test_watch_tree");
+    std::cout << "Recursive filter test completed." << std::endl;
+}
+
+void test_parallel_scan() {
+    for (int i = 0; i < 40; ++i) {
+        std::string dir = "./test_watch_parallel/d" + std::to_string(i % 7) + "/e" + std::to_string(i % 3);
+        std::filesystem::create_directories(dir);
+        writeFile(dir + "/f" + std::to_string(i) + ".conf", "k=" + std::to_string(i));
+    }
+
+    // 指向目录的符号链接不进入，包括指回根目录的环
+    std::filesystem::create_directory_symlink("d0", "./test_watch_parallel/link");
+    std::filesystem::create_directory_symlink("..", "./test_watch_parallel/d1/loop");
+
+    // 并行扫描必须与串行扫描产生完全相同的事件
+    auto collect = [](size_t threads) {
+        ScanOptions options;
+        options.recursive = true;
+        options.threads = threads;
+        PollingBackend backend(std::chrono::seconds(2), options);
+        backend.addWatch("./test_watch_parallel");
+        std::set<std::string> events;
+        backend.scanOnce([&events](const std::string& path) { events.insert(path); });
+        return events;
+    };
+    std::set<std::string> serial = collect(1);
+    CHECK(serial.size() == 40);
+    CHECK(collect(4) == serial);
+
+    std::filesystem::remove_all("./test_watch_parallel");
+    std::cout << "Parallel scan test completed." << std::endl;
+}
+
+void test_state_cache_temp_files() {
+    // 创建后很快删除的临时文件：状态表不随出现过的文件名一直增长
+    std::filesystem::create_directories("./test_watch_temp");
+    writeFile("./test_watch_temp/app.conf", "a=1");
+    FileStateCache cache;
+    FileChange first = cache.refresh("./test_watch_temp/app.conf");
+    CHECK(first == FileChange::Added);
+    PathTable names;
+    for (int i = 0; i < 5000; ++i) {
+        std::string temp = "./test_watch_temp/.app.conf." + std::to_string(i) + ".swp";
+        names.intern(temp);
+        writeFile(temp, "tmp");
+        FileChange added = cache.refresh(temp);
+        std::filesystem::remove(temp);
+        FileChange removed = cache.refresh(temp);
+        CHECK(added == FileChange::Added && removed == FileChange::Removed);
+    }
+    CHECK(cache.size() == 1);
+    CHECK(cache.memoryUsage() < names.memoryUsage());
+    FileChange stable = cache.refresh("./test_watch_temp/app.conf");
+    CHECK(stable == FileChange::Unchanged);
+    std::filesystem::remove_all("./test_watch_temp");
+    std::cout << "State cache temp files test completed." << std::endl;
+}
+
+void test_backend_removals() {
+    std::filesystem::create_directories("./test_watch_removed");
+    writeFile("./test_watch_removed/a.conf", "a=1");
+    writeFile("./test_watch_removed/b.conf", "b=1");
+
+    // 轮询：完整的一轮扫描中消失的文件上报一次，重新出现时再次上报
+    PollingBackend polling;
+    polling.addWatch("./test_watch_removed");
+    std::set<std::string> events;
+    auto collect = [&events](const std::string& path) {
+        events.insert(std::filesystem::path(path).filename().string());
+    };
+    polling.scanOnce(collect);
+    CHECK(events == std::set<std::string>({"a.conf", "b.conf"}));
+    events.clear();
+    std::filesystem::remove("./test_watch_removed/b.conf");
+    std::filesystem::rename("./test_watch_removed/a.conf", "./test_watch_removed/c.conf");
+    polling.scanOnce(collect);
+    CHECK(events == std::set<std::string>({"a.conf", "b.conf", "c.conf"}));
+    events.clear();
+    polling.scanOnce(collect);
+    CHECK(events.empty());
+    writeFile("./test_watch_removed/b.conf", "b=2");
+    polling.scanOnce(collect);
+    CHECK(events == std::set<std::string>({"b.conf"}));
+
+    // inotify：删除和移出同样产生事件
+    ChangeLog log;
+    InotifyBackend inotify;
+    bool added = inotify.addWatch("./test_watch_removed");
+    CHECK(added);
+    std::thread runner([&inotify, &log] {
+        inotify.run([&log](const std::string& path) { log.add(path); });
+    });
+    bool arrived = waitFor(log, "c.conf", std::chrono::milliseconds(500));
+    CHECK(arrived);
+    log.clear();
+    std::filesystem::remove("./test_watch_removed/b.conf");
+    std::filesystem::rename("./test_watch_removed/c.conf", "./test_watch_removed/d.conf");
+    arrived = waitFor(log, "b.conf", std::chrono::milliseconds(500));
+    CHECK(arrived);
+    arrived = waitFor(log, "c.conf", std::chrono::milliseconds(500));
+    CHECK(arrived);
+    inotify.wakeup();
+    runner.join();
+
+    std::filesystem::remove_all("./test_watch_removed");
+    std::cout << "Backend removals test completed." << std::endl;
+}
+
+int main() {
+    test_inotify_backend();
+    test_polling_backend();
+    test_persistent_state();
+    test_recursive_filters();
+    test_parallel_scan();
+    test_state_cache_temp_files();
+    test_backend_removals();
+    return 0;
+}
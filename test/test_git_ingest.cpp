@@ -0,0 +1,166 @@
+#include "configtracker/git_repo_manager.h"
+#include "test_util.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+
+namespace {
+
+// 读取 HEAD 树中某个路径的内容，不存在时返回 false
+bool readHeadFile(const std::string& repoPath, const std::string& path, std::string& content) {
+    git_repository* repo = nullptr;
+    int error = git_repository_open(&repo, repoPath.c_str());
+    CHECK(error == 0);
+    git_oid head;
+    git_commit* commit = nullptr;
+    git_tree* tree = nullptr;
+    git_tree_entry* entry = nullptr;
+    git_blob* blob = nullptr;
+    bool found = git_reference_name_to_id(&head, repo, "HEAD") == 0 &&
+                 git_commit_lookup(&commit, repo, &head) == 0 &&
+                 git_commit_tree(&tree, commit) == 0 &&
+                 git_tree_entry_bypath(&entry, tree, path.c_str()) == 0 &&
+                 git_blob_lookup(&blob, repo, git_tree_entry_id(entry)) == 0;
+    if (found) {
+        content.assign(static_cast<const char*>(git_blob_rawcontent(blob)),
+                       static_cast<size_t>(git_blob_rawsize(blob)));
+    }
+    git_blob_free(blob);
+    git_tree_entry_free(entry);
+    git_tree_free(tree);
+    git_commit_free(commit);
+    git_repository_free(repo);
+    return found;
+}
+
+}
+
+void test_direct_ingest_mirrors_source_layout() {
+    fs::path base = fs::temp_directory_path() / "ct_ingest_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path nginx = base / "etc" / "nginx" / "app.conf";
+    fs::path redis = base / "etc" / "redis" / "app.conf";
+    writeFile(nginx, "worker_processes 4;\n");
+    writeFile(redis, "maxmemory 1gb\n");
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        git.addFiles({nginx.string(), redis.string()});
+        git.commit("track both");
+
+        // 同名文件按源目录结构分开保存，工作区中没有副本
+        std::string nginxPath = nginx.relative_path().generic_string();
+        std::string redisPath = redis.relative_path().generic_string();
+        std::string content;
+        CHECK(readHeadFile(repoPath.string(), nginxPath, content) && content == "worker_processes 4;\n");
+        CHECK(readHeadFile(repoPath.string(), redisPath, content) && content == "maxmemory 1gb\n");
+        CHECK(!fs::exists(repoPath / "app.conf"));
+        CHECK(!fs::exists(repoPath / nginxPath));
+
+        // 可以用源路径查询提交
+        CHECK(git.commitsTouching(nginx.string()).size() == 1);
+
+        // 空文件与删除
+        writeFile(nginx, "");
+        git.addFile(nginx.string());
+        git.commit("truncate nginx");
+        CHECK(readHeadFile(repoPath.string(), nginxPath, content) && content.empty());
+
+        fs::remove(redis);
+        git.addFile(redis.string());
+        git.commit("remove redis");
+        CHECK(!readHeadFile(repoPath.string(), redisPath, content));
+        CHECK(git.commitsTouching(redis.string()).size() == 2);
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Direct ingest test completed.\n";
+}
+
+void test_work_tree_copy_mode() {
+    fs::path base = fs::temp_directory_path() / "ct_ingest_copy_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path source = base / "etc" / "app.conf";
+    writeFile(source, "legacy\n");
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string(), std::chrono::seconds(1), IngestMode::WorkTreeCopy);
+        git.init();
+        git.addFile(source.string());
+        git.commit("legacy layout");
+
+        std::string content;
+        CHECK(fs::exists(repoPath / "app.conf"));
+        CHECK(readHeadFile(repoPath.string(), "app.conf", content) && content == "legacy\n");
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Work tree copy test completed.\n";
+}
+
+void test_stage_while_truncated() {
+    fs::path base = fs::temp_directory_path() / "ct_ingest_truncate_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path source = base / "etc" / "large.conf";
+    const std::string content(4 << 20, 'x');
+    writeFile(source, content);
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+
+        // 另一个进程不断截断并重写被监控的文件：暂存读到的是某一时刻的前缀，不会因 SIGBUS 退出
+        std::atomic<bool> done{false};
+        std::thread writer([&]() {
+            while (!done) {
+                int fd = ::open(source.c_str(), O_WRONLY | O_TRUNC);
+                if (fd < 0) continue;
+                ssize_t written = ::write(fd, content.data(), content.size() / 2);
+                (void)written;
+                ::close(fd);
+            }
+        });
+        for (int i = 0; i < 50; ++i) {
+            git.addFile(source.string());
+            git.commit("round " + std::to_string(i));
+        }
+        done = true;
+        writer.join();
+
+        writeFile(source, "final\n");
+        git.addFile(source.string());
+        git.commit("final");
+        std::string committed;
+        bool found = readHeadFile(repoPath.string(), git.repoRelativePath(source.string()), committed);
+        CHECK(found && committed == "final\n");
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Stage while truncated test completed.\n";
+}
+
+int main() {
+    test_direct_ingest_mirrors_source_layout();
+    test_work_tree_copy_mode();
+    test_stage_while_truncated();
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include "configtracker/git_repo_manager.h"
+#include "test_util.h"
+#include <iostream>
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <filesystem>
+
+using namespace configtracker;
+
+namespace {
+
+// 直接用 libgit2 构造指定时间的提交，模拟很久以前的历史
+git_oid makeCommit(git_repository* repo, const std::string& content, git_time_t when,
+                   const std::string& message) {
+    git_oid blob;
+    int error = git_blob_create_from_buffer(&blob, repo, content.data(), content.size());
+    CHECK(error == 0);
+
+    git_treebuilder* builder = nullptr;
+    error = git_treebuilder_new(&builder, repo, nullptr);
+    CHECK(error == 0);
+    error = git_treebuilder_insert(nullptr, builder, "app.conf", &blob, GIT_FILEMODE_BLOB);
+    CHECK(error == 0);
+    git_oid tree;
+    error = git_treebuilder_write(&tree, builder);
+    CHECK(error == 0);
+    git_treebuilder_free(builder);
+
+    git_oid parent;
+    bool hasParent = git_reference_name_to_id(&parent, repo, "HEAD") == 0;
+    const git_oid* parents[] = {&parent};
+
+    git_signature* sig = nullptr;
+    error = git_signature_new(&sig, "ConfigTracker", "tracker@localhost", when, 0);
+    CHECK(error == 0);
+    git_oid id;
+    error = git_commit_create_from_ids(&id, repo, "HEAD", sig, sig, nullptr, message.c_str(),
+                                       &tree, hasParent ? 1 : 0, parents);
+    CHECK(error == 0);
+    git_signature_free(sig);
+    return id;
+}
+
+git_oid headTree(git_repository* repo) {
+    git_oid head;
+    int error = git_reference_name_to_id(&head, repo, "HEAD");
+    CHECK(error == 0);
+    git_commit* commit = nullptr;
+    error = git_commit_lookup(&commit, repo, &head);
+    CHECK(error == 0);
+    git_oid tree = *git_commit_tree_id(commit);
+    git_commit_free(commit);
+    return tree;
+}
+
+}
+
+void test_compaction_resumes_from_checkpoint() {
+    namespace fs = std::filesystem;
+    std::string dir = (fs::temp_directory_path() / "ct_compaction_test").string();
+    fs::remove_all(dir);
+
+    git_libgit2_init();
+    {
+        GitRepoManager init(dir);
+        init.init();
+    }
+
+    git_repository* repo = nullptr;
+    int error = git_repository_open(&repo, dir.c_str());
+    CHECK(error == 0);
+    git_time_t now = static_cast<git_time_t>(std::time(nullptr));
+    for (int i = 0; i < 5; ++i) {
+        makeCommit(repo, "old " + std::to_string(i), now - 30 * 86400 + i * 60,
+                   "old commit " + std::to_string(i));
+    }
+    for (int i = 0; i < 3; ++i) {
+        makeCommit(repo, "new " + std::to_string(i), now - 3600 + i * 60,
+                   "new commit " + std::to_string(i));
+    }
+    git_oid treeBefore = headTree(repo);
+
+    {
+        GitRepoManager git(dir);
+        git.init();
+        CHECK(git.listCommits().size() == 8);
+        CHECK(git.commitsTouching("app.conf").size() == 8);
+        // 极小的预算：规划后只改写一个提交就返回，进度写入检查点
+        bool finished = git.compactHistoryStep(7, std::chrono::milliseconds(0));
+        CHECK(!finished);
+        CHECK(fs::exists(dir + "/.git/configtracker/compaction.state"));
+        // 分支在压缩完成前保持不变
+        CHECK(git.listCommits().size() == 8);
+    }
+
+    {
+        // 模拟进程重启：从检查点继续
+        GitRepoManager git(dir);
+        git.init();
+        int steps = 0;
+        while (!git.compactHistoryStep(7, std::chrono::milliseconds(0))) {
+            CHECK(++steps < 10);
+        }
+        // 基础提交 + 3 个保留期内的提交
+        CHECK(git.listCommits().size() == 4);
+        // 提交索引随历史一起改写：基础提交继承被压缩提交的变更路径
+        CHECK(git.commitsTouching("app.conf").size() == 4);
+        CHECK(git.latestCommits(1).front() == git.getLatestCommit());
+        CHECK(!fs::exists(dir + "/.git/configtracker/compaction.state"));
+        git_reference* tempRef = nullptr;
+        error = git_reference_lookup(&tempRef, repo, "refs/configtracker/compaction");
+        CHECK(error != 0);
+
+        // 已压缩过的历史再次执行不会产生变化
+        bool finished = git.compactHistoryStep(7, std::chrono::milliseconds(50));
+        CHECK(finished);
+        CHECK(git.listCommits().size() == 4);
+    }
+
+    // 工作内容与压缩前完全一致，较新的提交保留原始信息
+    git_oid treeAfter = headTree(repo);
+    CHECK(git_oid_equal(&treeBefore, &treeAfter));
+
+    git_oid head;
+    error = git_reference_name_to_id(&head, repo, "HEAD");
+    CHECK(error == 0);
+    git_commit* commit = nullptr;
+    error = git_commit_lookup(&commit, repo, &head);
+    CHECK(error == 0);
+    CHECK(std::string(git_commit_message(commit)) == "new commit 2");
+    git_commit_free(commit);
+
+    git_repository_free(repo);
+    git_libgit2_shutdown();
+    fs::remove_all(dir);
+    std::cout << "Compaction resume test completed.\n";
+}
+
+int main() {
+    test_compaction_resumes_from_checkpoint();
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include "configtracker/config_parser.h"
+#include "configtracker/key_history.h"
+#include "configtracker/git_repo_manager.h"
+#include "test_util.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+
+namespace {
+
+std::map<std::string, std::string> parseAll(ConfigFormat format, const std::string& data, bool* ok = nullptr) {
+    std::map<std::string, std::string> result;
+    bool parsed = parseConfig(format, data, [&](std::string_view key, std::string_view value) {
+        result[std::string(key)] = std::string(value);
+    });
+    if (ok) *ok = parsed;
+    return result;
+}
+
+git_oid fakeOid(unsigned char seed) {
+    git_oid oid;
+    std::memset(oid.id, seed, sizeof(oid.id));
+    return oid;
+}
+
+}
+
+void test_parse_formats() {
+    CHECK(detectFormat("etc/app.conf", "") == ConfigFormat::KeyValue);
+    CHECK(detectFormat("etc/php.ini", "") == ConfigFormat::Ini);
+    CHECK(detectFormat("etc/app.json", "") == ConfigFormat::Json);
+    CHECK(detectFormat("etc/settings", "  {\"a\": 1}") == ConfigFormat::Json);
+    CHECK(detectFormat("bin/tool", "\x7f" "ELF") == ConfigFormat::Unknown);
+
+    auto kv = parseAll(ConfigFormat::KeyValue, "# comment\nsetting1=value1\n  setting2 = value2 \n; other\nflag\nurl: http://x\n");
+    CHECK(kv.size() == 4);
+    CHECK(kv["setting1"] == "value1" && kv["setting2"] == "value2");
+    CHECK(kv["flag"].empty() && kv["url"] == "http://x");
+
+    auto ini = parseAll(ConfigFormat::Ini, "top=1\n[server]\nport = 80\n[ client ]\nport=81\n");
+    CHECK(ini["top"] == "1" && ini["server.port"] == "80" && ini["client.port"] == "81");
+
+    bool ok = false;
+    auto json = parseAll(ConfigFormat::Json,
+                         "{\"server\": {\"port\": 8080, \"hosts\": [\"a\", \"b\"]}, \"debug\": false,"
+                         " \"name\": \"x\\\"y\", \"empty\": {}, \"list\": []}", &ok);
+    CHECK(ok);
+    CHECK(json["server.port"] == "8080");
+    CHECK(json["server.hosts[0]"] == "a" && json["server.hosts[1]"] == "b");
+    CHECK(json["debug"] == "false" && json["name"] == "x\\\"y");
+    CHECK(json["empty"] == "{}" && json["list"] == "[]");
+
+    parseAll(ConfigFormat::Json, "{\"a\": [1, 2", &ok);
+    CHECK(!ok);
+    std::cout << "Config parser test completed.\n";
+}
+
+void test_diff_large_file() {
+    fs::path base = fs::temp_directory_path() / "ct_key_diff_test";
+    fs::remove_all(base);
+
+    const size_t keys = 100000;
+    std::string before, after;
+    for (size_t i = 0; i < keys; ++i) {
+        std::string key = "section" + std::to_string(i % 100) + ".key" + std::to_string(i);
+        before += key + "=value" + std::to_string(i) + "\n";
+        // 修改 10 个键，删除一个，新增一个
+        if (i % 10000 == 5) {
+            after += key + "=changed\n";
+        } else if (i != 42) {
+            after += key + "=value" + std::to_string(i) + "\n";
+        }
+    }
+    after += "added.key=1\n";
+
+    KeyHistory history;
+    bool opened = history.open(base.string());
+    CHECK(opened);
+    ParsedConfig oldConfig, newConfig;
+    CHECK(history.parse("big.conf", fakeOid(1), before, oldConfig));
+    CHECK(oldConfig.items.size() == keys);
+
+    auto begin = std::chrono::steady_clock::now();
+    CHECK(history.parse("big.conf", fakeOid(2), after, newConfig));
+    std::vector<KeyDelta> deltas;
+    KeyHistory::diff(oldConfig, newConfig, deltas);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+
+    size_t added = 0, removed = 0, modified = 0;
+    for (const KeyDelta& delta : deltas) {
+        added += delta.kind == KeyChangeKind::Added;
+        removed += delta.kind == KeyChangeKind::Removed;
+        modified += delta.kind == KeyChangeKind::Modified;
+        if (delta.kind == KeyChangeKind::Modified) CHECK(delta.newValue == "changed");
+        if (delta.kind == KeyChangeKind::Removed) CHECK(delta.oldValue == "value42");
+    }
+    CHECK(added == 1 && removed == 1 && modified == 10);
+    std::cout << "Parsed and diffed " << keys << " keys in " << ms << " ms\n";
+    CHECK(ms < 5000);
+
+    history.close();
+    fs::remove_all(base);
+    std::cout << "Large file key diff test completed.\n";
+}
+
+void test_record_and_remap() {
+    fs::path base = fs::temp_directory_path() / "ct_key_remap_test";
+    fs::remove_all(base);
+
+    std::map<std::string, std::string> blobs;  // 20 字节 oid → 内容
+    auto reader = [&blobs](const git_oid& oid, std::string& out) {
+        auto it = blobs.find(std::string(reinterpret_cast<const char*>(oid.id), GIT_OID_RAWSZ));
+        if (it == blobs.end()) return false;
+        out = it->second;
+        return true;
+    };
+    auto blob = [&blobs](unsigned char seed, const std::string& content) {
+        git_oid oid = fakeOid(seed);
+        blobs[std::string(reinterpret_cast<const char*>(oid.id), GIT_OID_RAWSZ)] = content;
+        return oid;
+    };
+    git_oid none{};
+
+    {
+        KeyHistory history;
+        bool opened = history.open(base.string());
+        CHECK(opened);
+        git_oid v1 = blob(1, "a=1\nb=1\n");
+        git_oid v2 = blob(2, "a=2\nb=1\n");
+        git_oid v3 = blob(3, "a=3\n");
+        size_t changes = history.record(fakeOid(101), 1, {{"app.conf", none, v1}}, reader);
+        CHECK(changes == 2);
+        changes = history.record(fakeOid(102), 2, {{"app.conf", v1, v2}}, reader);
+        CHECK(changes == 1);
+        changes = history.record(fakeOid(103), 3, {{"app.conf", v2, v3}}, reader);
+        CHECK(changes == 2);
+        // 不支持的格式不记录
+        changes = history.record(fakeOid(104), 4, {{"tool.bin", none, blob(4, "x=1\n")}}, reader);
+        CHECK(changes == 0);
+        CHECK(history.commitCount() == 3);
+    }
+
+    // 重新打开后从记录中读取，末尾写了一半的记录被忽略
+    {
+        std::ofstream log(base / "keys.log", std::ios::app | std::ios::binary);
+        log << "partial";
+    }
+    KeyHistory history;
+    bool opened = history.open(base.string());
+    CHECK(opened);
+    CHECK(history.commitCount() == 3);
+    std::vector<KeyChange> a = history.history("app.conf", "a");
+    CHECK(a.size() == 3);
+    CHECK(a[0].newValue == "3" && a[0].oldValue == "2" && a[0].time == 3);
+    CHECK(a[2].kind == KeyChangeKind::Added && a[2].newValue == "1");
+    std::vector<KeyChange> b = history.history("app.conf", "b");
+    CHECK(b.size() == 2 && b[0].kind == KeyChangeKind::Removed && b[0].oldValue == "1");
+    CHECK(history.history("app.conf", "a", 1).size() == 1);
+    CHECK(history.history("app.conf", "missing").empty());
+
+    // 历史压缩：102 成为基础提交，101 的记录丢弃
+    CHECK(history.remap({{fakeOid(102), fakeOid(202)}, {fakeOid(103), fakeOid(203)}}));
+    CHECK(history.commitCount() == 2);
+    CHECK(history.changesOf(fakeOid(101)).empty());
+    CHECK(history.changesOf(fakeOid(203)).size() == 2);
+    a = history.history("app.conf", "a");
+    CHECK(a.size() == 2 && a[1].newValue == "2");
+    // 改写后继续追加
+    size_t changes = history.record(fakeOid(204), 5, {{"app.conf", fakeOid(3), none}}, reader);
+    CHECK(changes == 1);
+    CHECK(history.history("app.conf", "a")[0].kind == KeyChangeKind::Removed);
+
+    history.close();
+    fs::remove_all(base);
+    std::cout << "Key history record and remap test completed.\n";
+}
+
+void test_git_key_changes() {
+    fs::path base = fs::temp_directory_path() / "ct_git_keys_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path conf = base / "etc" / "app.conf";
+    fs::path json = base / "etc" / "settings.json";
+    writeFile(conf, "setting1=value1\nsetting2=value2\n");
+    writeFile(json, "{\"server\": {\"port\": 80}}");
+
+    git_libgit2_init();
+    std::string v2;
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        git.addFiles({conf.string(), json.string()});
+        git.commit("v1");
+        std::string v1 = git.getLatestCommit();
+        CHECK(git.keyChanges(v1).size() == 3);
+
+        writeFile(conf, "setting1=value1\nsetting2=changed\nsetting3=new\n");
+        writeFile(json, "{\"server\": {\"port\": 8080}}");
+        git.addFiles({conf.string(), json.string()});
+        git.commit("v2");
+        v2 = git.getLatestCommit();
+        std::vector<KeyChange> changes = git.keyChanges(v2);
+        CHECK(changes.size() == 3);
+        for (const auto& change : changes) {
+            CHECK(change.commit == v2);
+            if (change.key == "server.port") {
+                CHECK(change.oldValue == "80" && change.newValue == "8080");
+            }
+        }
+
+        fs::remove(conf);
+        git.addFile(conf.string());
+        git.commit("v3");
+        CHECK(git.keyChanges(git.getLatestCommit()).size() == 3);
+    }
+    // 重新打开仓库后历史仍然可查，被监控文件的路径和仓库内路径都可以
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        std::vector<KeyChange> history = git.keyHistory(conf.string(), "setting2");
+        CHECK(history.size() == 3);
+        CHECK(history[0].kind == KeyChangeKind::Removed && history[0].oldValue == "changed");
+        CHECK(history[1].commit == v2 && history[1].kind == KeyChangeKind::Modified);
+        CHECK(history[2].kind == KeyChangeKind::Added && history[2].newValue == "value2");
+        CHECK(git.keyHistory(json.relative_path().generic_string(), "server.port").size() == 2);
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Git key changes test completed.\n";
+}
+
+int main() {
+    test_parse_formats();
+    test_diff_large_file();
+    test_record_and_remap();
+    test_git_key_changes();
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include "configtracker/metrics.h"
+#include "configtracker/logger.h"
+#include "configtracker/git_repo_manager.h"
+#include "configtracker/config_tracker.h"
+#include "test_util.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+
+namespace {
+
+int evaluated = 0;
+
+std::string sideEffect() {
+    ++evaluated;
+    return "evaluated";
+}
+
+}
+
+void test_histogram_percentiles() {
+    Histogram histogram;
+    // 1ms 到 10ms 均匀分布
+    for (uint64_t us = 1; us <= 10000; ++us) {
+        histogram.record(us * 1000);
+    }
+    HistogramSnapshot snapshot = histogram.snapshot();
+    CHECK(snapshot.count == 10000);
+    CHECK(std::fabs(snapshot.max - 0.010) < 1e-12);
+    // 桶的相对误差不超过 1/16
+    CHECK(std::fabs(snapshot.p50 - 0.005) <= 0.005 / 16);
+    CHECK(std::fabs(snapshot.p99 - 0.0099) <= 0.0099 / 16);
+    CHECK(snapshot.p50 <= snapshot.p90 && snapshot.p90 <= snapshot.p99 && snapshot.p99 <= snapshot.max);
+
+    // 小值精确，边界值落在正确的桶里
+    for (uint64_t v : std::vector<uint64_t>{0, 1, 15, 16, 17, 1000, 123456789, UINT64_MAX}) {
+        size_t bucket = Histogram::bucketOf(v);
+        CHECK(bucket < Histogram::kBuckets);
+        CHECK(Histogram::bucketUpperBound(bucket) >= v);
+        CHECK(bucket == 0 || Histogram::bucketUpperBound(bucket - 1) < v);
+    }
+    std::cout << "Histogram percentile test completed.\n";
+}
+
+void test_counter_concurrent() {
+    Counter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&counter] {
+            for (int i = 0; i < 100000; ++i) counter.add();
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    CHECK(counter.value() == 400000);
+    std::cout << "Concurrent counter test completed.\n";
+}
+
+void test_prometheus_dump() {
+    fs::path base = fs::temp_directory_path() / "ct_metrics_test";
+    fs::remove_all(base);
+    fs::create_directories(base);
+
+    MetricsRegistry registry;
+    registry.counter("test_events_total", "Events").add(3);
+    registry.gauge("test_depth", "Depth").set(7);
+    registry.histogram("test_latency_seconds", "Latency").record(2000000);
+
+    MetricsSnapshot snapshot = registry.snapshot();
+    CHECK(snapshot.counters["test_events_total"] == 3);
+    CHECK(snapshot.gauges["test_depth"] == 7);
+    CHECK(snapshot.histograms["test_latency_seconds"].count == 1);
+
+    // 写文件
+    fs::path file = base / "metrics.prom";
+    bool dumped = registry.dumpPrometheus(file.string());
+    CHECK(dumped);
+    std::string text = readFile(file);
+    CHECK(text.find("# TYPE test_events_total counter\ntest_events_total 3\n") != std::string::npos);
+    CHECK(text.find("test_depth 7\n") != std::string::npos);
+    CHECK(text.find("# TYPE test_latency_seconds summary\n") != std::string::npos);
+    CHECK(text.find("test_latency_seconds_count 1\n") != std::string::npos);
+    CHECK(!fs::exists(file.string() + ".tmp"));
+
+    // 发送到 Unix 域套接字
+    fs::path socketPath = base / "metrics.sock";
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    CHECK(bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    CHECK(listen(listener, 1) == 0);
+    std::string received;
+    std::thread server([&] {
+        int fd = accept(listener, nullptr, nullptr);
+        char buffer[4096];
+        ssize_t n;
+        while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+            received.append(buffer, static_cast<size_t>(n));
+        }
+        close(fd);
+    });
+    dumped = registry.dumpPrometheus("unix:" + socketPath.string());
+    CHECK(dumped);
+    server.join();
+    close(listener);
+    CHECK(received == registry.prometheusText());
+
+    dumped = registry.dumpPrometheus("unix:" + (base / "missing.sock").string());
+    CHECK(!dumped);
+
+    fs::remove_all(base);
+    std::cout << "Prometheus dump test completed.\n";
+}
+
+void test_logger_levels() {
+    fs::path logFile = fs::temp_directory_path() / "ct_logger_test.log";
+    fs::remove(logFile);
+    LogLevel previous = Logger::level();
+
+    CHECK(Logger::instance().setFile(logFile.string()));
+    Logger::setLevel(LogLevel::Warn);
+    evaluated = 0;
+    CT_LOG(Info) << "hidden " << sideEffect();
+    CHECK(evaluated == 0);
+    CT_LOG(Error) << "shown " << sideEffect() << " " << 42;
+    CHECK(evaluated == 1);
+
+    // 多线程提交后 flush，全部写出
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 100; ++i) CT_LOG(Warn) << "thread " << t << " line " << i;
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    Logger::instance().flush();
+
+    std::string text = readFile(logFile);
+    CHECK(text.find("hidden") == std::string::npos);
+    CHECK(text.find("ERROR shown evaluated 42\n") != std::string::npos);
+    size_t lines = 0;
+    for (char c : text) lines += c == '\n';
+    CHECK(lines + Logger::instance().droppedMessages() == 401);
+
+    Logger::instance().setFile("");
+    Logger::setLevel(previous);
+    fs::remove(logFile);
+    std::cout << "Logger test completed.\n";
+}
+
+void test_tracker_log_config() {
+    fs::path logFile = fs::temp_directory_path() / "ct_tracker_log_test.log";
+    fs::remove(logFile);
+    LogLevel previous = Logger::level();
+
+    // 构造函数输出的第一行日志已经按配置的级别过滤、写入配置的文件
+    TrackConfig config;
+    config.logLevel = LogLevel::Error;
+    config.logFile = logFile.string();
+    {
+        ConfigTracker tracker(config);
+        CT_LOG(Error) << "after init";
+        Logger::instance().flush();
+    }
+    std::string text = readFile(logFile);
+    CHECK(text.find("[Init]") == std::string::npos);
+    CHECK(text.find("after init") != std::string::npos);
+
+    Logger::instance().setFile("");
+    Logger::setLevel(previous);
+    fs::remove(logFile);
+    std::cout << "Tracker log config test completed.\n";
+}
+
+void test_git_metrics() {
+    fs::path base = fs::temp_directory_path() / "ct_git_metrics_test";
+    fs::remove_all(base);
+    fs::create_directories(base / "etc");
+    fs::path file = base / "etc" / "app.conf";
+    std::ofstream(file) << "a=1\n";
+
+    CoreMetrics& metrics = CoreMetrics::get();
+    uint64_t commits = metrics.commits.value();
+    uint64_t commitSamples = metrics.gitCommit.snapshot().count;
+    uint64_t addSamples = metrics.gitAdd.snapshot().count;
+
+    git_libgit2_init();
+    {
+        GitRepoManager git((base / "repo").string());
+        git.init();
+        git.addFile(file.string());
+        git.commit("first");
+        std::ofstream(file) << "a=2\n";
+        git.addFile(file.string());
+        git.commit("second");
+    }
+    git_libgit2_shutdown();
+
+    CHECK(metrics.commits.value() == commits + 2);
+    CHECK(metrics.gitCommit.snapshot().count == commitSamples + 2);
+    CHECK(metrics.gitAdd.snapshot().count == addSamples + 2);
+    MetricsSnapshot snapshot = MetricsRegistry::global().snapshot();
+    CHECK(snapshot.counters.count("configtracker_commits_total") == 1);
+    CHECK(snapshot.histograms["configtracker_git_tree_write_seconds"].count >= 2);
+
+    fs::remove_all(base);
+    std::cout << "Git metrics test completed.\n";
+}
+
+int main() {
+    test_histogram_percentiles();
+    test_counter_concurrent();
+    test_prometheus_dump();
+    test_logger_levels();
+    test_tracker_log_config();
+    test_git_metrics();
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include "configtracker/git_repo_manager.h"
+#include "test_util.h"
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+
+namespace {
+
+size_t countLoose(const fs::path& repoPath) {
+    size_t count = 0;
+    for (const auto& dir : fs::directory_iterator(repoPath / ".git" / "objects")) {
+        std::string name = dir.path().filename().string();
+        if (name.size() != 2 || !dir.is_directory()) continue;
+        for (const auto& file : fs::directory_iterator(dir.path())) {
+            (void)file;
+            ++count;
+        }
+    }
+    return count;
+}
+
+size_t countPacks(const fs::path& repoPath) {
+    size_t count = 0;
+    for (const auto& file : fs::directory_iterator(repoPath / ".git" / "objects" / "pack")) {
+        count += file.path().extension() == ".pack";
+    }
+    return count;
+}
+
+size_t countObjects(const fs::path& repoPath) {
+    git_repository* repo = nullptr;
+    git_odb* odb = nullptr;
+    int error = git_repository_open(&repo, repoPath.string().c_str());
+    CHECK(error == 0);
+    error = git_repository_odb(&odb, repo);
+    CHECK(error == 0);
+    size_t count = 0;
+    git_odb_foreach(odb, [](const git_oid*, void* payload) {
+        ++*static_cast<size_t*>(payload);
+        return 0;
+    }, &count);
+    git_odb_free(odb);
+    git_repository_free(repo);
+    return count;
+}
+
+// 读出某个提交中的全部文件内容，任何对象缺失都会失败
+bool readAll(GitRepoManager& git, const std::string& hash, size_t expected) {
+    std::vector<TreeFile> files;
+    if (!git.listFiles(hash, files) || files.size() != expected) return false;
+    for (const auto& file : files) {
+        std::string content;
+        if (!git.readBlob(file.oid, content) || content.empty()) return false;
+    }
+    return true;
+}
+
+MaintenanceOptions unlimited() {
+    MaintenanceOptions options;
+    options.looseThreshold = 1;
+    options.cpuPercent = 100;
+    options.ioBytesPerSec = 0;
+    options.pruneGrace = std::chrono::seconds(0);
+    return options;
+}
+
+void commitRevisions(GitRepoManager& git, const fs::path& dir, int first, int count) {
+    for (int i = first; i < first + count; ++i) {
+        fs::path file = dir / ("app" + std::to_string(i % 5) + ".conf");
+        writeFile(file, "revision=" + std::to_string(i) + "\n");
+        git.addFile(file.string());
+        git.commit("rev " + std::to_string(i));
+    }
+}
+
+}
+
+void test_incremental_packing() {
+    fs::path base = fs::temp_directory_path() / "ct_pack_incremental_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path dir = base / "etc";
+
+    git_libgit2_init();
+    std::string oldest;
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        commitRevisions(git, dir, 0, 100);
+        oldest = git.listCommits().back();
+        size_t loose = countLoose(repoPath);
+        CHECK(loose > 100);
+
+        // 松散对象少于阈值时不打包
+        MaintenanceOptions options = unlimited();
+        options.looseThreshold = loose + 1;
+        MaintenanceStats stats = git.runMaintenance(options);
+        CHECK(stats.packsWritten == 0);
+
+        stats = git.runMaintenance(unlimited());
+        CHECK(stats.packsWritten == 1 && !stats.fullRepack);
+        CHECK(stats.objectsPacked == loose);
+        CHECK(countLoose(repoPath) == 0 && countPacks(repoPath) == 1);
+        CHECK(readAll(git, oldest, 1) && readAll(git, "", 5));
+
+        // 打包后继续提交，第二个包写入后生成多包索引
+        commitRevisions(git, dir, 100, 20);
+        stats = git.runMaintenance(unlimited());
+        CHECK(stats.packsWritten == 1);
+        CHECK(countPacks(repoPath) == 2);
+        CHECK(fs::exists(repoPath / ".git" / "objects" / "pack" / "multi-pack-index"));
+        CHECK(readAll(git, "", 5));
+    }
+    // 新打开的仓库通过多包索引读取
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        CHECK(git.listCommits().size() == 120);
+        CHECK(readAll(git, oldest, 1) && readAll(git, "", 5));
+        commitRevisions(git, dir, 120, 1);
+        CHECK(readAll(git, "", 5));
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Incremental packing test completed.\n";
+}
+
+void test_prune_after_compaction() {
+    fs::path base = fs::temp_directory_path() / "ct_pack_prune_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path dir = base / "etc";
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        commitRevisions(git, dir, 0, 40);
+        git.runMaintenance(unlimited());
+        commitRevisions(git, dir, 40, 40);
+        git.runMaintenance(unlimited());
+        std::string oldest = git.listCommits().back();
+        size_t before = countObjects(repoPath);
+
+        // 全部历史压缩为一个基础提交，旧的提交和文件版本都不可达
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        git.squashCommitsOlderThan(0);
+        CHECK(git.listCommits().size() == 1);
+        CHECK(!git.findCommit(oldest));
+
+        MaintenanceStats stats = git.runMaintenance(unlimited());
+        CHECK(stats.fullRepack && stats.packsRemoved >= 2);
+        CHECK(countPacks(repoPath) == 1 && countLoose(repoPath) == 0);
+        CHECK(!fs::exists(repoPath / ".git" / "objects" / "pack" / "multi-pack-index"));
+        size_t after = countObjects(repoPath);
+        std::cout << "Objects before prune " << before << ", after " << after << "\n";
+        CHECK(after < before / 4);
+        CHECK(readAll(git, "", 5));
+
+        // 清理只做一次，之后回到增量打包
+        commitRevisions(git, dir, 80, 1);
+        stats = git.runMaintenance(unlimited());
+        CHECK(!stats.fullRepack);
+        CHECK(readAll(git, "", 5));
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Prune after compaction test completed.\n";
+}
+
+void test_budget_and_scheduler() {
+    fs::path base = fs::temp_directory_path() / "ct_pack_budget_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path dir = base / "etc";
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        commitRevisions(git, dir, 0, 50);
+        size_t loose = countLoose(repoPath);
+
+        // 每删除一个松散对象计 4KB，限速 2MB/s 时至少需要 loose * 2ms
+        MaintenanceOptions options = unlimited();
+        options.ioBytesPerSec = 2 << 20;
+        auto begin = std::chrono::steady_clock::now();
+        MaintenanceStats stats = git.runMaintenance(options);
+        CHECK(stats.objectsPacked == loose);
+        auto elapsed = std::chrono::steady_clock::now() - begin;
+        CHECK(elapsed >= std::chrono::milliseconds(loose * 2 * 9 / 10));
+
+        // 后台线程按间隔执行
+        commitRevisions(git, dir, 50, 10);
+        CHECK(countLoose(repoPath) > 0);
+        options = unlimited();
+        options.interval = std::chrono::milliseconds(50);
+        git.startMaintenance(options);
+        for (int i = 0; i < 100 && countLoose(repoPath) > 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        git.stopMaintenance();
+        CHECK(countLoose(repoPath) == 0);
+        CHECK(readAll(git, "", 5));
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Maintenance budget and scheduler test completed.\n";
+}
+
+int main() {
+    test_incremental_packing();
+    test_prune_after_compaction();
+    test_budget_and_scheduler();
+    return 0;
+}
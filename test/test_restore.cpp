@@ -0,0 +1,227 @@
+#include "configtracker/git_repo_manager.h"
+#include "configtracker/config_tracker.h"
+#include "test_util.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include <sys/stat.h>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+
+namespace {
+
+bool headTreeEquals(const std::string& repoPath, const std::string& hash) {
+    git_repository* repo = nullptr;
+    int error = git_repository_open(&repo, repoPath.c_str());
+    CHECK(error == 0);
+    git_oid head, target;
+    git_commit* headCommit = nullptr;
+    git_commit* targetCommit = nullptr;
+    bool equal = git_reference_name_to_id(&head, repo, "HEAD") == 0 &&
+                 git_oid_fromstr(&target, hash.c_str()) == 0 &&
+                 git_commit_lookup(&headCommit, repo, &head) == 0 &&
+                 git_commit_lookup(&targetCommit, repo, &target) == 0 &&
+                 git_oid_equal(git_commit_tree_id(headCommit), git_commit_tree_id(targetCommit));
+    git_commit_free(headCommit);
+    git_commit_free(targetCommit);
+    git_repository_free(repo);
+    return equal;
+}
+
+std::string readHead(const std::string& repoPath) {
+    git_repository* repo = nullptr;
+    if (git_repository_open(&repo, repoPath.c_str()) != 0) return "";
+    git_oid head;
+    std::string result;
+    if (git_reference_name_to_id(&head, repo, "HEAD") == 0) {
+        char hash[GIT_OID_HEXSZ + 1] = {0};
+        git_oid_fmt(hash, &head);
+        result = hash;
+    }
+    git_repository_free(repo);
+    return result;
+}
+
+}
+
+void test_restore_only_changed_files() {
+    fs::path base = fs::temp_directory_path() / "ct_restore_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path a = base / "etc" / "a.conf";
+    fs::path b = base / "etc" / "b.conf";
+    fs::path c = base / "etc" / "sub" / "c.conf";
+    fs::path d = base / "etc" / "d.conf";
+    writeFile(a, "a=1\n");
+    writeFile(b, "b=1\n");
+    writeFile(c, "c=1\n");
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        git.addFiles({a.string(), b.string(), c.string()});
+        git.commit("v1");
+        std::string v1 = git.getLatestCommit();
+
+        writeFile(a, "a=2\n");
+        fs::remove(b);
+        writeFile(d, "d=2\n");
+        git.addFiles({a.string(), b.string(), d.string()});
+        git.commit("v2");
+        fs::permissions(a, fs::perms::owner_read | fs::perms::owner_write);
+
+        // 只有内容不同的文件需要改写：a 修改、b 缺失、d 在 v1 中不存在
+        std::vector<RestoreAction> actions;
+        bool planned = git.planRestore(v1, {}, actions);
+        CHECK(planned);
+        CHECK(actions.size() == 3);
+        for (const auto& action : actions) {
+            CHECK(action.path != c.string());
+            CHECK(action.remove == (action.path == d.string()));
+        }
+
+        bool applied = git.applyRestore(v1, actions);
+        CHECK(applied);
+        CHECK(readFile(a) == "a=1\n");
+        CHECK(readFile(b) == "b=1\n");
+        CHECK(readFile(c) == "c=1\n");
+        CHECK(!fs::exists(d));
+        CHECK(!fs::exists(GitRepoManager::restoreTempPath(a.string())));
+        // 已存在文件的权限保留
+        struct stat st{};
+        CHECK(stat(a.c_str(), &st) == 0 && (st.st_mode & 0777) == 0600);
+        // 恢复是一次新的提交，历史保留
+        CHECK(headTreeEquals(repoPath.string(), v1));
+        CHECK(git.listCommits().size() == 3);
+        CHECK(git.commitsTouching(d.string()).size() == 2);
+        // 不在仓库工作区生成副本
+        CHECK(!fs::exists(repoPath / "a.conf"));
+
+        // 再次比较时已经一致
+        planned = git.planRestore(v1, {}, actions);
+        CHECK(planned && actions.empty());
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Restore changed files test completed.\n";
+}
+
+void test_restore_selected_paths() {
+    fs::path base = fs::temp_directory_path() / "ct_restore_paths_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path a = base / "etc" / "a.conf";
+    fs::path c = base / "etc" / "sub" / "c.conf";
+    fs::path e = base / "etc" / "sub" / "e.conf";
+    writeFile(a, "a=1\n");
+    writeFile(c, "c=1\n");
+    writeFile(e, "e=1\n");
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        git.addFiles({a.string(), c.string(), e.string()});
+        git.commit("v1");
+        std::string v1 = git.getLatestCommit();
+
+        writeFile(a, "a=2\n");
+        writeFile(c, "c=2\n");
+        writeFile(e, "e=2\n");
+        git.addFiles({a.string(), c.string(), e.string()});
+        git.commit("v2");
+
+        // 单个文件
+        std::vector<RestoreAction> actions;
+        bool planned = git.planRestore(v1, {c.string()}, actions);
+        CHECK(planned);
+        CHECK(actions.size() == 1 && actions[0].path == c.string());
+        bool applied = git.applyRestore(v1, actions);
+        CHECK(applied);
+        CHECK(readFile(c) == "c=1\n");
+        CHECK(readFile(e) == "e=2\n");
+        CHECK(readFile(a) == "a=2\n");
+
+        // 整个目录
+        planned = git.planRestore(v1, {(base / "etc" / "sub").string()}, actions);
+        CHECK(planned);
+        CHECK(actions.size() == 1 && actions[0].path == e.string());
+        applied = git.applyRestore(v1, actions);
+        CHECK(applied);
+        CHECK(readFile(e) == "e=1\n");
+        CHECK(readFile(a) == "a=2\n");
+
+        // 未暂存的本地修改也会被发现
+        writeFile(c, "local edit\n");
+        planned = git.planRestore(v1, {c.string()}, actions);
+        CHECK(planned && actions.size() == 1);
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Restore selected paths test completed.\n";
+}
+
+void test_tracker_restore_suppresses_events() {
+    fs::path base = fs::temp_directory_path() / "ct_restore_tracker_test";
+    fs::remove_all(base);
+    fs::path watchDir = base / "watch";
+    fs::path file = watchDir / "app.conf";
+    writeFile(file, "version=1\n");
+
+    TrackConfig config;
+    config.watchPaths = {watchDir.string()};
+    config.repoRoot = (base / "repo").string();
+    config.retentionDays = 0;
+    config.batchQuietMs = 50;
+    config.batchMaxLatencyMs = 200;
+    config.logLevel = LogLevel::Warn;
+
+    git_libgit2_init();
+    {
+        ConfigTracker tracker(config);
+        tracker.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        std::string v1 = readHead(config.repoRoot);
+        CHECK(!v1.empty());
+
+        writeFile(file, "version=2\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        CHECK(readHead(config.repoRoot) != v1);
+
+        bool applied = tracker.restorePaths(v1, {file.string()});
+        CHECK(applied);
+        CHECK(readFile(file) == "version=1\n");
+        std::string restored = readHead(config.repoRoot);
+        CHECK(headTreeEquals(config.repoRoot, v1));
+
+        // 恢复写入的文件不会再触发自动提交
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        CHECK(readHead(config.repoRoot) == restored);
+
+        // 之后的真实修改仍然会被提交
+        writeFile(file, "version=3\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        CHECK(readHead(config.repoRoot) != restored);
+        tracker.stop();
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Tracker restore test completed.\n";
+}
+
+int main() {
+    test_restore_only_changed_files();
+    test_restore_selected_paths();
+    test_tracker_restore_suppresses_events();
+    return 0;
+}
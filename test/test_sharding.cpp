@@ -0,0 +1,211 @@
+#include "configtracker/config_tracker.h"
+#include "test_util.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <thread>
+#include <mutex>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+
+namespace {
+
+TrackConfig baseConfig(const fs::path& base) {
+    TrackConfig config;
+    config.repoRoot = (base / "repo").string();
+    config.retentionDays = 0;
+    config.batchQuietMs = 50;
+    config.batchMaxLatencyMs = 200;
+    config.logLevel = LogLevel::Warn;
+    return config;
+}
+
+}
+
+void test_per_watch_root() {
+    fs::path base = fs::temp_directory_path() / "ct_shard_root_test";
+    fs::remove_all(base);
+    fs::path nginx = base / "apps" / "nginx";
+    fs::path redis = base / "apps" / "redis";
+    fs::path nginxConf = nginx / "nginx.conf";
+    fs::path redisConf = redis / "redis.conf";
+    writeFile(nginxConf, "workers=1\n");
+    writeFile(redisConf, "maxmemory=1\n");
+
+    TrackConfig config = baseConfig(base);
+    config.watchPaths = {nginx.string(), redis.string()};
+    config.sharding = ShardMode::PerWatchRoot;
+
+    git_libgit2_init();
+    {
+        ConfigTracker tracker(config);
+        tracker.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+        // 每个监控根目录一个仓库
+        std::vector<std::string> repos = tracker.shardRepos();
+        CHECK(repos.size() == 2);
+        for (const auto& repo : repos) {
+            CHECK(fs::exists(fs::path(repo) / ".git"));
+            CHECK(fs::path(repo).parent_path() == fs::path(config.repoRoot) / "shards");
+        }
+
+        SnapshotPtr nginxSnap = tracker.snapshotFor(nginxConf.string());
+        SnapshotPtr redisSnap = tracker.snapshotFor(redisConf.string());
+        CHECK(nginxSnap && redisSnap && nginxSnap != redisSnap);
+        CHECK(contentOf(nginxSnap, nginxConf.string()) == "workers=1\n");
+        CHECK(!nginxSnap->contains(redisConf.string()));
+        CHECK(contentOf(redisSnap, redisConf.string()) == "maxmemory=1\n");
+        std::string redisV1 = redisSnap->commit();
+
+        writeFile(nginxConf, "workers=2\n");
+        writeFile(redisConf, "maxmemory=2\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+        // 合并查询覆盖两个仓库，单文件查询只走负责的仓库
+        std::vector<ShardCommit> latest = tracker.latestCommits(10);
+        CHECK(latest.size() == 4);
+        std::set<std::string> shards;
+        for (size_t i = 0; i < latest.size(); ++i) {
+            shards.insert(latest[i].shard);
+            CHECK(latest[i].time > 0);
+            CHECK(i == 0 || latest[i - 1].time >= latest[i].time);
+        }
+        CHECK(shards.size() == 2);
+        CHECK(tracker.latestCommits(3).size() == 3);
+        std::vector<ShardCommit> touching = tracker.commitsTouching(redisConf.string());
+        CHECK(touching.size() == 2 && touching[0].shard == touching[1].shard);
+        auto now = std::chrono::system_clock::now();
+        CHECK(tracker.commitsBetween(now - std::chrono::hours(1), now + std::chrono::hours(1)).size() == 4);
+        CHECK(tracker.keyHistory(nginxConf.string(), "workers").size() == 2);
+
+        // 按提交找到所在分片后恢复，另一个分片不受影响
+        bool restored = tracker.restorePaths(redisV1, {redisConf.string()});
+        CHECK(restored);
+        CHECK(readFile(redisConf) == "maxmemory=1\n");
+        CHECK(readFile(nginxConf) == "workers=2\n");
+        SnapshotPtr old = tracker.snapshotAt(redisV1);
+        CHECK(contentOf(old, redisConf.string()) == "maxmemory=1\n");
+        restored = tracker.restorePaths("0000000000000000000000000000000000000000", {});
+        CHECK(!restored);
+        tracker.stop();
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Per watch root sharding test completed.\n";
+}
+
+void test_hash_buckets() {
+    fs::path base = fs::temp_directory_path() / "ct_shard_bucket_test";
+    fs::remove_all(base);
+    fs::path watchDir = base / "watch";
+    const int files = 40;
+    for (int i = 0; i < files; ++i) {
+        writeFile(watchDir / ("app" + std::to_string(i) + ".conf"), "id=" + std::to_string(i) + "\n");
+    }
+
+    TrackConfig config = baseConfig(base);
+    config.watchPaths = {watchDir.string()};
+    config.sharding = ShardMode::HashBucket;
+    config.shardCount = 4;
+
+    git_libgit2_init();
+    {
+        ConfigTracker tracker(config);
+        tracker.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(800));
+        CHECK(tracker.shardRepos().size() == 4);
+
+        // 每个文件只在负责它的分片中，全部分片加起来覆盖所有文件
+        std::set<std::string> commits;
+        for (int i = 0; i < files; ++i) {
+            fs::path file = watchDir / ("app" + std::to_string(i) + ".conf");
+            SnapshotPtr snap = tracker.snapshotFor(file.string());
+            CHECK(contentOf(snap, file.string()) == "id=" + std::to_string(i) + "\n");
+            commits.insert(snap->commit());
+        }
+        // 40 个文件分散到多个仓库
+        CHECK(commits.size() > 1);
+        size_t total = 0;
+        for (const auto& commit : commits) {
+            total += tracker.snapshotAt(commit)->size();
+        }
+        CHECK(total == static_cast<size_t>(files));
+        tracker.stop();
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Hash bucket sharding test completed.\n";
+}
+
+void test_deleted_files() {
+    fs::path base = fs::temp_directory_path() / "ct_shard_delete_test";
+    for (WatchBackendType backend : {WatchBackendType::Inotify, WatchBackendType::Polling}) {
+        fs::remove_all(base);
+        fs::path nginx = base / "apps" / "nginx";
+        fs::path redis = base / "apps" / "redis";
+        fs::path nginxConf = nginx / "nginx.conf";
+        fs::path mimeConf = nginx / "mime.conf";
+        writeFile(nginxConf, "workers=1\n");
+        writeFile(mimeConf, "types=1\n");
+        writeFile(redis / "redis.conf", "maxmemory=1\n");
+
+        TrackConfig config = baseConfig(base);
+        config.watchPaths = {nginx.string(), redis.string()};
+        config.sharding = ShardMode::PerWatchRoot;
+        config.watchBackend = backend;
+        config.pollIntervalMs = 50;
+
+        std::mutex mutex;
+        std::vector<std::string> removed;
+        git_libgit2_init();
+        {
+            ConfigTracker tracker(config);
+            tracker.subscribe(SubscribeOptions(), [&](const ChangeEvent& event) {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (uint32_t index : event.files) {
+                    const ChangedFile& file = event.batch->files[index];
+                    if (file.removed) removed.emplace_back(file.path);
+                }
+            });
+            tracker.start();
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            CHECK(tracker.snapshotFor(nginxConf.string())->size() == 2);
+            size_t commits = tracker.latestCommits(100).size();
+
+            // 删除的文件提交为一次删除，快照和订阅者都能看到
+            fs::remove(mimeConf);
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+            while (tracker.snapshotFor(nginxConf.string())->contains(mimeConf.string()) &&
+                   std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+            SnapshotPtr snap = tracker.snapshotFor(nginxConf.string());
+            CHECK(snap->size() == 1 && !snap->contains(mimeConf.string()));
+            CHECK(tracker.latestCommits(100).size() == commits + 1);
+            CHECK(tracker.commitsTouching(mimeConf.string()).size() == 2);
+
+            tracker.stop();
+        }
+        git_libgit2_shutdown();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(removed.size() == 1 && removed[0] == mimeConf.string());
+    }
+
+    fs::remove_all(base);
+    std::cout << "Deleted files test completed.\n";
+}
+
+int main() {
+    test_per_watch_root();
+    test_hash_buckets();
+    test_deleted_files();
+    return 0;
+}
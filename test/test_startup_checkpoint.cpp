@@ -0,0 +1,197 @@
+#include "configtracker/git_repo_manager.h"
+#include "configtracker/config_tracker.h"
+#include "test_util.h"
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+
+namespace {
+
+fs::file_time_type indexTime(const fs::path& repoPath) {
+    return fs::last_write_time(repoPath / ".git" / "index");
+}
+
+}
+
+void test_index_checkpoint() {
+    fs::path base = fs::temp_directory_path() / "ct_checkpoint_index_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path a = base / "etc" / "a.conf";
+    fs::path b = base / "etc" / "b.conf";
+    fs::path c = base / "etc" / "c.conf";
+    fs::path checkpoint = repoPath / ".git" / "configtracker" / "checkpoint";
+    writeFile(a, "a=1\n");
+    writeFile(b, "b=1\n");
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string(), std::chrono::milliseconds(10));
+        git.init();
+        git.addFiles({a.string(), b.string()});
+        git.commit("v1");
+    }
+    // 写盘后的索引与最后一次提交一致，检查点记录它的树
+    std::string saved = readFile(checkpoint);
+    CHECK(saved.find("index_tree -") == std::string::npos);
+
+    // 重新打开时不读取整个树，索引不会被改写
+    auto written = indexTime(repoPath);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    {
+        GitRepoManager git(repoPath.string(), std::chrono::milliseconds(10));
+        git.init();
+    }
+    CHECK(indexTime(repoPath) == written);
+    {
+        GitRepoManager git(repoPath.string(), std::chrono::milliseconds(10));
+        git.init();
+        writeFile(c, "c=1\n");
+        git.addFile(c.string());
+        git.commit("v2");
+    }
+    CHECK(readFile(checkpoint).find("index_tree -") == std::string::npos);
+
+    {
+        GitRepoManager git(repoPath.string(), std::chrono::milliseconds(10));
+        git.init();
+        std::vector<TreeFile> files;
+        CHECK(git.listFiles("", files) && files.size() == 3);
+    }
+
+    // 索引文件在外部被改动后不再信任检查点，以 HEAD 的树为准
+    {
+        git_repository* repo = nullptr;
+        git_index* index = nullptr;
+        int error = git_repository_open(&repo, repoPath.string().c_str());
+        CHECK(error == 0);
+        error = git_repository_index(&index, repo);
+        CHECK(error == 0);
+        git_index_clear(index);
+        error = git_index_write(index);
+        CHECK(error == 0);
+        git_index_free(index);
+        git_repository_free(repo);
+    }
+    {
+        GitRepoManager git(repoPath.string(), std::chrono::milliseconds(10));
+        git.init();
+        writeFile(a, "a=2\n");
+        git.addFile(a.string());
+        git.commit("v3");
+        std::vector<TreeFile> files;
+        CHECK(git.listFiles("", files) && files.size() == 3);
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Index checkpoint test completed.\n";
+}
+
+void test_retention_checkpoint() {
+    fs::path base = fs::temp_directory_path() / "ct_checkpoint_retention_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path conf = base / "etc" / "app.conf";
+    writeFile(conf, "a=1\n");
+    auto hour = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::hours(1));
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        git.addFile(conf.string());
+        git.commit("v1");
+        // 从未检查过时立即到期
+        CHECK(git.retentionDelay(hour).count() == 0);
+        bool finished = git.compactHistoryStep(7, std::chrono::milliseconds(50));
+        CHECK(finished);
+        CHECK(git.retentionDelay(hour) > std::chrono::minutes(59));
+    }
+    // 重启后按上次检查的时间继续等待
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        CHECK(git.retentionDelay(hour) > std::chrono::minutes(59));
+        CHECK(git.retentionDelay(std::chrono::milliseconds(1)).count() == 0);
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Retention checkpoint test completed.\n";
+}
+
+void test_restart_cost() {
+    fs::path base = fs::temp_directory_path() / "ct_checkpoint_restart_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path watchDir = base / "watch";
+    const int files = 200;
+    const int commits = 2000;
+    for (int i = 0; i < files; ++i) {
+        writeFile(watchDir / ("app" + std::to_string(i) + ".conf"), "id=" + std::to_string(i) + "\n");
+    }
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        for (int i = 0; i < files; ++i) {
+            git.addFile((watchDir / ("app" + std::to_string(i) + ".conf")).string());
+        }
+        git.commit("initial");
+        fs::path hot = watchDir / "app0.conf";
+        for (int i = 0; i < commits; ++i) {
+            writeFile(hot, "id=0\nrev=" + std::to_string(i) + "\n");
+            git.addFile(hot.string());
+            git.commit("rev " + std::to_string(i));
+        }
+    }
+
+    TrackConfig config;
+    config.repoRoot = repoPath.string();
+    config.watchPaths = {watchDir.string()};
+    config.retentionDays = 7;
+    config.batchQuietMs = 50;
+    config.batchMaxLatencyMs = 200;
+    config.logLevel = LogLevel::Warn;
+
+    std::string head;
+    for (int round = 0; round < 2; ++round) {
+        ConfigTracker tracker(config);
+        auto begin = std::chrono::steady_clock::now();
+        tracker.start();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << "Start " << round << " with " << commits << " commits took " << ms << " ms\n";
+        CHECK(ms < 2000);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        SnapshotPtr snapshot = tracker.snapshot();
+        CHECK(snapshot && snapshot->size() == static_cast<size_t>(files));
+        if (round == 0) {
+            head = snapshot->commit();
+        } else {
+            // 文件状态与检查点一致，重启后没有产生新提交
+            CHECK(snapshot->commit() == head);
+        }
+        tracker.stop();
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Restart cost test completed.\n";
+}
+
+int main() {
+    test_index_checkpoint();
+    test_retention_checkpoint();
+    test_restart_cost();
+    return 0;
+}
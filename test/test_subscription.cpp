@@ -0,0 +1,421 @@
+#include "configtracker/change_subscription.h"
+#include "configtracker/config_tracker.h"
+#include "test_util.h"
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+
+namespace {
+
+ChangeBatchPtr makeBatch(const std::string& commit, const std::vector<std::string>& paths) {
+    auto batch = std::make_shared<ChangeBatch>();
+    batch->commit = commit;
+    for (const auto& path : paths) {
+        batch->buffer += path;
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        ChangedFile file;
+        file.id = static_cast<PathId>(i);
+        file.path = std::string_view(batch->buffer).substr(offset, paths[i].size());
+        offset += paths[i].size();
+        batch->files.push_back(file);
+    }
+    return batch;
+}
+
+// 收集回调收到的事件，供主线程等待和检查
+struct Collector {
+    std::mutex mutex;
+    std::vector<ChangeEvent> events;
+
+    ChangeHandler handler() {
+        return [this](const ChangeEvent& event) {
+            std::lock_guard<std::mutex> lock(mutex);
+            events.push_back(event);
+        };
+    }
+
+    // 到目前为止收到的所有文件路径
+    std::vector<std::string> paths() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::string> result;
+        for (const auto& event : events) {
+            for (uint32_t i : event.files) {
+                result.emplace_back(event.batch->files[i].path);
+            }
+        }
+        return result;
+    }
+
+    bool waitFor(size_t count, int timeoutMs = 3000) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (std::chrono::steady_clock::now() < deadline) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (events.size() >= count) return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+};
+
+}
+
+void test_spsc_ring() {
+    SpscRing<uint64_t> ring(1000);
+    CHECK(ring.capacity() == 1024);
+    uint64_t value = 0;
+    for (uint64_t i = 0; i < ring.capacity(); ++i) {
+        value = i;
+        bool pushed = ring.tryPush(value);
+        CHECK(pushed);
+    }
+    value = 12345;
+    bool pushed = ring.tryPush(value);
+    CHECK(!pushed && value == 12345);
+    uint64_t out = 0;
+    bool popped = ring.tryPop(out);
+    CHECK(popped && out == 0);
+    pushed = ring.tryPush(value);
+    CHECK(pushed);
+    while (ring.tryPop(out)) {
+    }
+    CHECK(ring.empty() && out == 12345);
+
+    // 两个线程之间按顺序传递，不丢失也不重复
+    const uint64_t count = 200000;
+    SpscRing<uint64_t> shared(256);
+    std::thread producer([&]() {
+        for (uint64_t i = 1; i <= count; ++i) {
+            uint64_t item = i;
+            while (!shared.tryPush(item)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint64_t expected = 1;
+    auto begin = std::chrono::steady_clock::now();
+    while (expected <= count) {
+        uint64_t item = 0;
+        if (shared.tryPop(item)) {
+            CHECK(item == expected);
+            ++expected;
+        }
+    }
+    producer.join();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / count;
+    std::cout << "SPSC ring: " << ns << " ns per item\n";
+    std::cout << "SPSC ring test completed.\n";
+}
+
+void test_prefix_filter_and_slow_consumer() {
+    // 前缀过滤：只投递匹配的文件，全不匹配时不投递
+    Collector nginx;
+    SubscribeOptions options;
+    options.prefixes = {"/etc/nginx/"};
+    {
+        Subscription subscription(1, options, nginx.handler());
+        bool offered = subscription.offer(makeBatch("c1", {"/etc/nginx/nginx.conf", "/etc/redis.conf"}));
+        CHECK(offered);
+        offered = subscription.offer(makeBatch("c2", {"/etc/redis.conf"}));
+        CHECK(offered);
+        offered = subscription.offer(makeBatch("c3", {"/etc/hosts", "/etc/nginx/conf.d/a.conf"}));
+        CHECK(offered);
+        subscription.stop();
+        CHECK(subscription.delivered() == 2 && subscription.dropped() == 0);
+    }
+    CHECK(nginx.events.size() == 2);
+    CHECK(nginx.events[0].batch->commit == "c1" && nginx.events[1].batch->commit == "c3");
+    CHECK(nginx.events[0].files.size() == 1 && nginx.events[0].files[0] == 0);
+    CHECK(nginx.events[1].files.size() == 1 && nginx.events[1].files[0] == 1);
+    CHECK(nginx.events[1].batch->files[1].path == "/etc/nginx/conf.d/a.conf");
+
+    // 前缀按路径分量匹配
+    Collector app;
+    SubscribeOptions appOptions;
+    appOptions.prefixes = {"/etc/app"};
+    {
+        Subscription subscription(3, appOptions, app.handler());
+        bool offered = subscription.offer(makeBatch("c1", {"/etc/app2/a.conf", "/etc/app/a.conf", "/etc/app", "/etc/apps"}));
+        CHECK(offered);
+        offered = subscription.offer(makeBatch("c2", {"/etc/app2/a.conf", "/etc/application.conf"}));
+        CHECK(offered);
+        subscription.stop();
+    }
+    CHECK(app.events.size() == 1);
+    CHECK(app.events[0].files == std::vector<uint32_t>({1, 2}));
+
+    // 回调阻塞时发布者不等待：队列满后丢弃新的批次，恢复后通过 missed 告知
+    std::mutex gate;
+    std::unique_lock<std::mutex> blocked(gate);
+    std::vector<ChangeEvent> received;
+    SubscribeOptions small;
+    small.capacity = 4;
+    Subscription slow(2, small, [&](const ChangeEvent& event) {
+        std::lock_guard<std::mutex> lock(gate);
+        received.push_back(event);
+    });
+    auto begin = std::chrono::steady_clock::now();
+    size_t accepted = 0;
+    for (int i = 0; i < 100; ++i) {
+        accepted += slow.offer(makeBatch("c" + std::to_string(i), {"/etc/app.conf"}));
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "100 offers to a blocked subscriber: " << ms << " ms, " << accepted << " accepted\n";
+    CHECK(ms < 500);
+    // 回调正占用一个事件，队列中最多还有 capacity 个
+    CHECK(accepted <= small.capacity + 1 && slow.dropped() == 100 - accepted);
+    blocked.unlock();
+    slow.stop();
+    // 被接受的是最早的几个批次；之后没有新批次，队列排空后补投最后被丢弃的批次
+    CHECK(received.size() == accepted + 1);
+    for (size_t i = 0; i < accepted; ++i) {
+        CHECK(received[i].batch->commit == "c" + std::to_string(i) && received[i].missed == 0);
+    }
+    CHECK(received.back().batch->commit == "c99");
+    CHECK(received.back().missed == 100 - accepted - 1);
+    std::cout << "Prefix filter and slow consumer test completed.\n";
+}
+
+void test_missed_rides_on_newest_event() {
+    auto store = std::make_shared<BlobStore>(nullptr);
+    auto batchWithSnapshot = [&store](int i) {
+        auto batch = std::const_pointer_cast<ChangeBatch>(makeBatch("c" + std::to_string(i), {"/etc/app.conf"}));
+        batch->snapshot = ConfigSnapshot::build(batch->commit, {}, nullptr, store, false);
+        return ChangeBatchPtr(batch);
+    };
+
+    // 回调按许可逐个放行
+    std::mutex mutex;
+    std::condition_variable cv;
+    int permits = 0;
+    std::vector<ChangeEvent> received;
+    SubscribeOptions options;
+    options.capacity = 4;
+    Subscription subscription(1, options, [&](const ChangeEvent& event) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return permits > 0; });
+        --permits;
+        received.push_back(event);
+        cv.notify_all();
+    });
+    int next = 0;
+    size_t accepted = 0;
+    for (; next < 50; ++next) {
+        accepted += subscription.offer(batchWithSnapshot(next));
+    }
+    CHECK(accepted < 50);
+
+    // 放行一个事件，队列腾出位置后下一个成功入队的批次带上之前的丢弃数
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        permits = 1;
+        cv.notify_all();
+        cv.wait(lock, [&] { return received.size() == 1; });
+    }
+    bool offered = false;
+    for (int attempt = 0; attempt < 500 && !offered; ++attempt, ++next) {
+        offered = subscription.offer(batchWithSnapshot(next));
+        if (!offered) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(offered);
+    std::string newest = "c" + std::to_string(next - 1);
+    uint64_t dropped = subscription.dropped();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        permits = 1000;
+        cv.notify_all();
+    }
+    subscription.stop();
+
+    // 没有补投事件：丢弃数全部落在最新的那个事件上，它的快照是最新的
+    CHECK(received.size() == accepted + 1);
+    for (size_t i = 0; i + 1 < received.size(); ++i) {
+        CHECK(received[i].missed == 0);
+    }
+    const ChangeEvent& last = received.back();
+    CHECK(last.batch->commit == newest && last.batch->snapshot->commit() == newest);
+    CHECK(last.missed == dropped);
+    std::cout << "Missed count on newest event test completed.\n";
+}
+
+void test_tracker_subscription() {
+    fs::path base = fs::temp_directory_path() / "ct_subscription_test";
+    fs::remove_all(base);
+    fs::path watchDir = base / "watch";
+    fs::path nginxConf = watchDir / "nginx" / "nginx.conf";
+    fs::path redisConf = watchDir / "redis" / "redis.conf";
+    writeFile(nginxConf, "[server]\nlisten=80\n");
+    writeFile(redisConf, "port=6379\n");
+
+    TrackConfig config;
+    config.repoRoot = (base / "repo").string();
+    config.watchPaths = {watchDir.string()};
+    config.retentionDays = 0;
+    config.pollIntervalMs = 20;
+    config.batchQuietMs = 50;
+    config.batchMaxLatencyMs = 200;
+    config.watchBackend = WatchBackendType::Polling;
+    config.logLevel = LogLevel::Warn;
+
+    Collector all;
+    Collector nginx;
+    git_libgit2_init();
+    {
+        ConfigTracker tracker(config);
+        tracker.subscribe(SubscribeOptions(), all.handler());
+        SubscribeOptions nginxOnly;
+        nginxOnly.prefixes = {(watchDir / "nginx").string()};
+        SubscriptionId nginxId = tracker.subscribe(nginxOnly, nginx.handler());
+        // 永远阻塞的订阅者不影响检测和提交
+        std::mutex gate;
+        std::unique_lock<std::mutex> blocked(gate);
+        SubscribeOptions stuckOptions;
+        stuckOptions.capacity = 2;
+        SubscriptionId stuck = tracker.subscribe(stuckOptions, [&gate](const ChangeEvent&) {
+            std::lock_guard<std::mutex> lock(gate);
+        });
+        tracker.start();
+
+        // 初始文件作为第一次提交投递
+        bool arrived = all.waitFor(1);
+        CHECK(arrived);
+        std::vector<std::string> initial = all.paths();
+        CHECK(initial.size() == 2);
+        arrived = nginx.waitFor(1);
+        CHECK(arrived);
+        CHECK(nginx.paths().size() == 1 && nginx.paths()[0] == nginxConf.string());
+
+        // 修改后收到提交哈希、新快照和键级变更
+        for (int i = 1; i <= 6; ++i) {
+            writeFile(nginxConf, "[server]\nlisten=" + std::to_string(8080 + i) + "\n");
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        }
+        arrived = all.waitFor(7);
+        CHECK(arrived);
+        {
+            std::lock_guard<std::mutex> lock(all.mutex);
+            const ChangeEvent& event = all.events.back();
+            const ChangeBatch& batch = *event.batch;
+            CHECK(event.files.size() == 1);
+            const ChangedFile& file = batch.files[event.files[0]];
+            CHECK(file.path == nginxConf.string() && !file.removed);
+            CHECK(file.id == all.events.front().batch->files[0].id ||
+                   file.id == all.events.front().batch->files[1].id);
+            CHECK(!batch.commit.empty() && batch.time > 0);
+            CHECK(batch.snapshot && batch.snapshot->commit() == batch.commit);
+            // 提交时间来自提交本身，与提交索引中记录的一致
+            std::vector<ShardCommit> head = tracker.latestCommits(1);
+            CHECK(head.size() == 1 && head[0].hash == batch.commit && head[0].time == batch.time);
+            std::string_view content;
+            CHECK(batch.snapshot->read(nginxConf.string(), content) && content == "[server]\nlisten=8086\n");
+            CHECK(file.keyCount == 1);
+            const KeyChange& change = batch.keyChanges[file.firstKey];
+            CHECK(change.key == "server.listen" && change.oldValue == "8085" && change.newValue == "8086");
+        }
+        CHECK(tracker.latestCommits(100).size() >= 7);
+
+        // 其他目录的变更不会投递给只订阅 nginx 的订阅者
+        size_t nginxEvents = nginx.events.size();
+        writeFile(redisConf, "port=6380\n");
+        arrived = all.waitFor(8);
+        CHECK(arrived);
+        {
+            std::lock_guard<std::mutex> lock(all.mutex);
+            const ChangeEvent& event = all.events.back();
+            CHECK(event.batch->files[event.files[0]].path == redisConf.string());
+            CHECK(event.batch->keyChanges.size() == 1 && event.batch->keyChanges[0].key == "port");
+        }
+        CHECK(nginx.events.size() == nginxEvents);
+
+        // 取消订阅后不再收到事件
+        bool removed = tracker.unsubscribe(nginxId);
+        CHECK(removed);
+        removed = tracker.unsubscribe(nginxId);
+        CHECK(!removed);
+        writeFile(nginxConf, "[server]\nlisten=9000\n");
+        arrived = all.waitFor(9);
+        CHECK(arrived);
+        CHECK(nginx.events.size() == nginxEvents);
+
+        blocked.unlock();
+        removed = tracker.unsubscribe(stuck);
+        CHECK(removed);
+        tracker.stop();
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Tracker subscription test completed.\n";
+}
+
+void test_tracker_skips_vanished_files() {
+    fs::path base = fs::temp_directory_path() / "ct_subscription_vanished_test";
+    fs::remove_all(base);
+    fs::path watchDir = base / "watch";
+    fs::path conf = watchDir / "app.conf";
+    fs::path temp = watchDir / ".app.conf.swp";
+    writeFile(conf, "rev=0\n");
+
+    TrackConfig config;
+    config.repoRoot = (base / "repo").string();
+    config.watchPaths = {watchDir.string()};
+    config.retentionDays = 0;
+    config.pollIntervalMs = 20;
+    config.batchQuietMs = 600;
+    config.batchMaxLatencyMs = 2000;
+    config.watchBackend = WatchBackendType::Polling;
+    config.logLevel = LogLevel::Warn;
+
+    Collector all;
+    git_libgit2_init();
+    {
+        ConfigTracker tracker(config);
+        tracker.subscribe(SubscribeOptions(), all.handler());
+        tracker.start();
+        bool started = all.waitFor(1);
+        CHECK(started);
+
+        // 临时文件被检测到之后、提交之前就被删除：它不在任何提交中，不投递给订阅者
+        writeFile(temp, "swap\n");
+        writeFile(conf, "rev=1\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        fs::remove(temp);
+        bool changed = all.waitFor(2);
+        CHECK(changed);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        {
+            std::lock_guard<std::mutex> lock(all.mutex);
+            CHECK(all.events.size() == 2);
+            const ChangeEvent& event = all.events.back();
+            CHECK(event.files.size() == 1);
+            CHECK(event.batch->files[event.files[0]].path == conf.string());
+        }
+        tracker.stop();
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Tracker skips vanished files test completed.\n";
+}
+
+int main() {
+    test_spsc_ring();
+    test_prefix_filter_and_slow_consumer();
+    test_missed_rides_on_newest_event();
+    test_tracker_subscription();
+    test_tracker_skips_vanished_files();
+    return 0;
+}
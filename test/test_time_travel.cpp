@@ -0,0 +1,290 @@
+#include "configtracker/config_tracker.h"
+#include "configtracker/history_reader.h"
+#include "test_util.h"
+#include <atomic>
+#include <ctime>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+
+using namespace configtracker;
+using namespace testutil;
+namespace fs = std::filesystem;
+using Clock = std::chrono::system_clock;
+
+namespace {
+
+// 提交时间精确到秒，等到下一秒再提交，保证各时间点落在不同的提交上。
+// 提交时间取自 time()，它可能比 system_clock 晚一个时钟节拍，两者都要进入下一秒
+void waitNextSecond() {
+    auto second = Clock::to_time_t(Clock::now());
+    while (Clock::to_time_t(Clock::now()) == second || std::time(nullptr) <= second) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+}
+
+std::string hashOf(const git_oid& oid) {
+    char hash[GIT_OID_HEXSZ + 1] = {0};
+    git_oid_fmt(hash, &oid);
+    return hash;
+}
+
+std::map<std::string, FileChangeKind> kindsOf(const std::vector<FileDiff>& diffs) {
+    std::map<std::string, FileChangeKind> kinds;
+    for (const auto& diff : diffs) {
+        kinds[diff.path] = diff.kind;
+    }
+    return kinds;
+}
+
+}
+
+void test_read_and_diff_at_time() {
+    fs::path base = fs::temp_directory_path() / "ct_time_travel_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path src = base / "src";
+    std::string db = (src / "app" / "db.conf").string();
+    std::string app = (src / "app" / "app.conf").string();
+    std::string routes = (src / "web" / "routes.conf").string();
+    std::string added = (src / "web" / "extra" / "new.conf").string();
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        ChunkingOptions chunking;
+        chunking.threshold = 4096;
+        git.setChunking(chunking);
+        auto beforeFirst = Clock::now() - std::chrono::hours(1);
+
+        std::string large(64 * 1024, 'r');
+        size_t staged = git.addContents({{db, "host=a\n"}, {app, "name=x\n"}, {routes, large}});
+        CHECK(staged == 3);
+        git.commit("first");
+        auto at1 = Clock::now();
+
+        waitNextSecond();
+        std::string largeV2 = large;
+        largeV2[30000] = 'x';
+        FileContent removed{app, ""};
+        removed.removed = true;
+        staged = git.addContents({{db, "host=b\n"}, removed, {routes, largeV2}, {added, "new=1\n"}});
+        CHECK(staged == 4);
+        git.commit("second");
+        auto at2 = Clock::now();
+
+        waitNextSecond();
+        staged = git.addContents({{db, "host=c\n"}});
+        CHECK(staged == 1);
+        git.commit("third");
+        auto at3 = Clock::now();
+        std::string head = git.getLatestCommit();
+        std::vector<std::string> commits = git.listCommits();
+        CHECK(commits.size() == 3);
+
+        HistoryReader reader(git, 64, 1 << 20);
+        std::string commit;
+        CHECK(!reader.readAt(db, beforeFirst));
+        CHECK(contentOf(reader.readAt(db, at1, &commit)) == "host=a\n" && commit == commits[2]);
+        CHECK(contentOf(reader.readAt(db, at2, &commit)) == "host=b\n" && commit == commits[1]);
+        CHECK(contentOf(reader.readAt(db, at3)) == "host=c\n");
+        CHECK(contentOf(reader.readAt(git.repoRelativePath(db), at2)) == "host=b\n");
+        // 已删除的文件、当时还不存在的文件和目录本身
+        CHECK(contentOf(reader.readAt(app, at1)) == "name=x\n");
+        CHECK(!reader.readAt(app, at2));
+        CHECK(!reader.readAt(added, at1));
+        CHECK(!reader.readAt((src / "app").string(), at1));
+        // 分块存储的文件读到完整内容
+        CHECK(contentOf(reader.readAt(routes, at1)) == large);
+        CHECK(contentOf(reader.readAt(routes, at3)) == largeV2);
+
+        // 早于第一次提交的一侧是空树
+        std::vector<FileDiff> diffs;
+        bool diffed = reader.diffBetween(beforeFirst, at1, diffs);
+        CHECK(diffed);
+        CHECK(diffs.size() == 3);
+        for (const auto& diff : diffs) {
+            CHECK(diff.kind == FileChangeKind::Added && git_oid_is_zero(&diff.before));
+        }
+
+        diffed = reader.diffBetween(at1, at2, diffs);
+        CHECK(diffed);
+        std::map<std::string, FileChangeKind> kinds = kindsOf(diffs);
+        CHECK(diffs.size() == 4 && kinds.size() == 4);
+        CHECK(kinds[db] == FileChangeKind::Modified);
+        CHECK(kinds[app] == FileChangeKind::Removed);
+        CHECK(kinds[routes] == FileChangeKind::Modified);
+        CHECK(kinds[added] == FileChangeKind::Added);
+        for (size_t i = 1; i < diffs.size(); ++i) {
+            CHECK(diffs[i - 1].repoPath < diffs[i].repoPath);
+        }
+
+        diffed = reader.diffBetween(at2, at3, diffs);
+        CHECK(diffed && diffs.size() == 1 && diffs[0].path == db);
+        diffed = reader.diffBetween(at3, at3, diffs);
+        CHECK(diffed && diffs.empty());
+        // 反方向比较
+        diffed = reader.diffBetween(at2, at1, diffs);
+        CHECK(diffed && kindsOf(diffs)[added] == FileChangeKind::Removed);
+
+        // 缓存热起来之后只做内存查找
+        reader.readAt(db, at1);
+        uint64_t misses = reader.misses();
+        const int rounds = 2000;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i) {
+            CHECK(reader.readAt(i % 2 ? db : routes, i % 2 ? at1 : at3));
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        CHECK(reader.misses() == misses && reader.hits() > 0);
+        CHECK(elapsed / rounds < std::chrono::milliseconds(1));
+
+        // 很小的缓存不影响结果
+        HistoryReader small(git, 1, 16);
+        for (int i = 0; i < 3; ++i) {
+            CHECK(contentOf(small.readAt(db, at2)) == "host=b\n");
+            CHECK(contentOf(small.readAt(routes, at1)) == large);
+            diffed = small.diffBetween(at1, at2, diffs);
+            CHECK(diffed && diffs.size() == 4);
+        }
+
+        // 查询不移动 HEAD
+        CHECK(git.getLatestCommit() == head);
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Read and diff at time test completed.\n";
+}
+
+void test_readers_during_commits() {
+    fs::path base = fs::temp_directory_path() / "ct_time_travel_concurrent_test";
+    fs::remove_all(base);
+    std::string db = (base / "src" / "db.conf").string();
+    std::string other = (base / "src" / "other.conf").string();
+
+    git_libgit2_init();
+    {
+        GitRepoManager git((base / "repo").string());
+        git.init();
+        size_t staged = git.addContents({{db, "host=a\n"}});
+        CHECK(staged == 1);
+        git.commit("first");
+        std::string first = git.getLatestCommit();
+        auto at1 = Clock::now();
+        waitNextSecond();
+
+        // 多个线程持续按时间读取，同时不断提交；读取不等待提交锁，结果始终是当时的内容
+        HistoryReader reader(git, 64, 1 << 20);
+        std::atomic<bool> done{false};
+        std::atomic<int> wrong{0};
+        std::atomic<uint64_t> reads{0};
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; ++t) {
+            readers.emplace_back([&]() {
+                while (!done) {
+                    if (contentOf(reader.readAt(db, at1)) != "host=a\n") ++wrong;
+                    ++reads;
+                }
+            });
+        }
+        const int commits = 100;
+        for (int i = 0; i < commits; ++i) {
+            staged = git.addContents({{other, "n=" + std::to_string(i) + "\n"}});
+            CHECK(staged == 1);
+            git.commit("update " + std::to_string(i));
+            // 提交完成即可按时间查到
+            git_oid found;
+            bool resolved = git.commitAt(Clock::now(), found);
+            CHECK(resolved && hashOf(found) == git.getLatestCommit());
+        }
+        done = true;
+        for (auto& thread : readers) {
+            thread.join();
+        }
+        CHECK(wrong == 0 && reads > 0);
+        CHECK(contentOf(reader.readAt(other, Clock::now())) == "n=" + std::to_string(commits - 1) + "\n");
+
+        // 分支回退后按时间查询随之回退
+        bool checkedOut = git.checkoutCommit(first);
+        CHECK(checkedOut);
+        git_oid found;
+        bool resolved = git.commitAt(Clock::now(), found);
+        CHECK(resolved && hashOf(found) == first);
+        CHECK(!reader.readAt(other, Clock::now()));
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Readers during commits test completed.\n";
+}
+
+void test_tracker_time_travel() {
+    fs::path base = fs::temp_directory_path() / "ct_time_travel_tracker_test";
+    fs::remove_all(base);
+    fs::path watchDir = base / "watch";
+    const int files = 8;
+    for (int i = 0; i < files; ++i) {
+        writeFile(watchDir / ("app" + std::to_string(i) + ".conf"), "id=" + std::to_string(i) + "\n");
+    }
+
+    TrackConfig config;
+    config.repoRoot = (base / "repo").string();
+    config.watchPaths = {watchDir.string()};
+    config.retentionDays = 0;
+    config.batchQuietMs = 50;
+    config.batchMaxLatencyMs = 200;
+    config.logLevel = LogLevel::Warn;
+    config.sharding = ShardMode::HashBucket;
+    config.shardCount = 3;
+
+    git_libgit2_init();
+    {
+        ConfigTracker tracker(config);
+        CHECK(!tracker.readAt((watchDir / "app0.conf").string(), Clock::now()));
+        tracker.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(800));
+        auto at1 = Clock::now();
+
+        waitNextSecond();
+        fs::path first = watchDir / "app1.conf";
+        fs::path second = watchDir / "app6.conf";
+        writeFile(first, "id=changed\n");
+        writeFile(second, "id=changed\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(800));
+        auto at2 = Clock::now();
+
+        for (int i = 0; i < files; ++i) {
+            std::string path = (watchDir / ("app" + std::to_string(i) + ".conf")).string();
+            CHECK(contentOf(tracker.readAt(path, at1)) == "id=" + std::to_string(i) + "\n");
+        }
+        CHECK(contentOf(tracker.readAt(first.string(), at2)) == "id=changed\n");
+
+        // 合并全部分片的结果，带上所在分片
+        std::vector<FileDiff> diffs = tracker.diffBetween(at1, at2);
+        CHECK(diffs.size() == 2);
+        std::map<std::string, FileChangeKind> kinds = kindsOf(diffs);
+        CHECK(kinds[first.string()] == FileChangeKind::Modified);
+        CHECK(kinds[second.string()] == FileChangeKind::Modified);
+        for (const auto& diff : diffs) {
+            CHECK(!diff.shard.empty());
+        }
+        CHECK(tracker.diffBetween(at1 - std::chrono::hours(1), at1).size() == files);
+        tracker.stop();
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Tracker time travel test completed.\n";
+}
+
+int main() {
+    test_read_and_diff_at_time();
+    test_readers_during_commits();
+    test_tracker_time_travel();
+    return 0;
+}
@@ -0,0 +1,277 @@
+#include "configtracker/tree_cache.h"
+#include "configtracker/git_repo_manager.h"
+#include "configtracker/metrics.h"
+#include "test_util.h"
+#include <iostream>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace configtracker;
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Lcg {
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    size_t next(size_t bound) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<size_t>(state >> 33) % bound;
+    }
+};
+
+git_oid blobOf(git_repository* repo, const std::string& content) {
+    git_oid oid;
+    int error = git_blob_create_from_buffer(&oid, repo, content.data(), content.size());
+    CHECK(error == 0);
+    return oid;
+}
+
+// 参照结果：把同样的文件放进一个新的索引，由 libgit2 从头写出整个树
+git_oid referenceTree(git_repository* repo, const std::map<std::string, git_oid>& files) {
+    git_index* index = nullptr;
+    int error = git_index_new(&index);
+    CHECK(error == 0);
+    for (const auto& file : files) {
+        git_index_entry entry{};
+        entry.mode = GIT_FILEMODE_BLOB;
+        entry.id = file.second;
+        entry.path = file.first.c_str();
+        error = git_index_add(index, &entry);
+        CHECK(error == 0);
+    }
+    git_oid tree;
+    error = git_index_write_tree_to(&tree, index, repo);
+    CHECK(error == 0);
+    git_index_free(index);
+    return tree;
+}
+
+// 读取磁盘上的索引，同样从头写出整个树
+git_oid indexTree(git_repository* repo) {
+    git_index* disk = nullptr;
+    int error = git_repository_index(&disk, repo);
+    CHECK(error == 0);
+    error = git_index_read(disk, 1);
+    CHECK(error == 0);
+    std::map<std::string, git_oid> files;
+    for (size_t i = 0; i < git_index_entrycount(disk); ++i) {
+        const git_index_entry* entry = git_index_get_byindex(disk, i);
+        files[entry->path] = entry->id;
+    }
+    git_index_free(disk);
+    return referenceTree(repo, files);
+}
+
+git_oid headTree(git_repository* repo) {
+    git_oid head;
+    git_commit* commit = nullptr;
+    int error = git_reference_name_to_id(&head, repo, "HEAD");
+    CHECK(error == 0);
+    error = git_commit_lookup(&commit, repo, &head);
+    CHECK(error == 0);
+    git_oid tree;
+    git_oid_cpy(&tree, git_commit_tree_id(commit));
+    git_commit_free(commit);
+    return tree;
+}
+
+}
+
+void test_tree_cache_matches_index() {
+    fs::path base = fs::temp_directory_path() / "ct_tree_cache_test";
+    fs::remove_all(base);
+    git_libgit2_init();
+    git_repository* repo = nullptr;
+    int error = git_repository_init(&repo, base.string().c_str(), 0);
+    CHECK(error == 0);
+
+    // 4 层目录、每层 4 个分支，共 256 个叶子目录
+    std::map<std::string, git_oid> files;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < 1024; ++i) {
+        std::string path = "d" + std::to_string(i % 4) + "/d" + std::to_string(i / 4 % 4) + "/d" +
+                           std::to_string(i / 16 % 4) + "/d" + std::to_string(i / 64 % 4) + "/f" +
+                           std::to_string(i) + ".conf";
+        names.push_back(path);
+        files[path] = blobOf(repo, "value=" + std::to_string(i) + "\n");
+    }
+    git_oid initial = referenceTree(repo, files);
+
+    TreeCache cache;
+    git_oid out;
+    CHECK(!cache.valid());
+    bool written = cache.write(out);
+    CHECK(!written);
+    cache.reset(repo, initial);
+    written = cache.write(out);
+    CHECK(written && git_oid_equal(&out, &initial) && cache.lastWritten() == 0);
+
+    // 修改一个文件：只读入并重写它到根路径上的 5 个目录
+    files[names[7]] = blobOf(repo, "value=changed\n");
+    cache.set(names[7], files[names[7]], GIT_FILEMODE_BLOB);
+    CHECK(cache.loadedDirectories() == 5);
+    git_oid expected = referenceTree(repo, files);
+    written = cache.write(out);
+    CHECK(written && git_oid_equal(&out, &expected));
+    CHECK(cache.lastWritten() == 5);
+
+    // 内容相同的修改不产生新树
+    cache.set(names[7], files[names[7]], GIT_FILEMODE_BLOB);
+    written = cache.write(out);
+    CHECK(written && git_oid_equal(&out, &expected) && cache.lastWritten() == 0);
+
+    // 随机的新增、修改、删除和删除目录，每轮与从头写出的树比较
+    Lcg random;
+    for (int round = 0; round < 40; ++round) {
+        for (int op = 0; op < 6; ++op) {
+            size_t pick = random.next(10);
+            if (pick < 5) {
+                const std::string& path = names[random.next(names.size())];
+                files[path] = blobOf(repo, "round=" + std::to_string(round) + " op=" + std::to_string(op));
+                cache.set(path, files[path], GIT_FILEMODE_BLOB);
+            } else if (pick < 7) {
+                std::string path = "new" + std::to_string(random.next(3)) + "/sub/f" + std::to_string(round) + ".conf";
+                files[path] = blobOf(repo, path);
+                cache.set(path, files[path], GIT_FILEMODE_BLOB);
+            } else if (pick < 9) {
+                const std::string& path = names[random.next(names.size())];
+                files.erase(path);
+                cache.remove(path);
+            } else {
+                std::string dir = "d" + std::to_string(random.next(4)) + "/d" + std::to_string(random.next(4));
+                for (auto it = files.begin(); it != files.end();) {
+                    it = it->first.compare(0, dir.size() + 1, dir + "/") == 0 ? files.erase(it) : std::next(it);
+                }
+                cache.removeDirectory(dir);
+            }
+        }
+        expected = referenceTree(repo, files);
+        written = cache.write(out);
+        CHECK(written && git_oid_equal(&out, &expected));
+    }
+
+    // 删除全部文件后是空树
+    for (const auto& file : files) {
+        cache.remove(file.first);
+    }
+    files.clear();
+    expected = referenceTree(repo, files);
+    written = cache.write(out);
+    CHECK(written && git_oid_equal(&out, &expected));
+
+    // 基准树不存在时失效，调用方退回从索引写树
+    git_oid missing;
+    error = git_oid_fromstr(&missing, "0123456789012345678901234567890123456789");
+    CHECK(error == 0);
+    cache.reset(repo, missing);
+    cache.set("a/b.conf", expected, GIT_FILEMODE_BLOB);
+    CHECK(!cache.valid());
+    written = cache.write(out);
+    CHECK(!written);
+
+    git_repository_free(repo);
+    git_libgit2_shutdown();
+    fs::remove_all(base);
+    std::cout << "Tree cache matches index test completed.\n";
+}
+
+void test_commit_rewrites_changed_subtrees() {
+    fs::path base = fs::temp_directory_path() / "ct_tree_cache_commit_test";
+    fs::remove_all(base);
+    fs::path repoPath = base / "repo";
+    fs::path src = base / "src";
+
+    git_libgit2_init();
+    {
+        GitRepoManager git(repoPath.string());
+        git.init();
+        ChunkingOptions chunking;
+        chunking.threshold = 4096;
+        git.setChunking(chunking);
+
+        std::vector<FileContent> files;
+        for (size_t i = 0; i < 600; ++i) {
+            FileContent file;
+            file.path = (src / ("app" + std::to_string(i % 6)) / ("conf" + std::to_string(i / 6 % 10)) /
+                         ("f" + std::to_string(i) + ".conf")).string();
+            file.data = "key=" + std::to_string(i) + "\n";
+            files.push_back(file);
+        }
+        FileContent large;
+        large.path = (src / "app0" / "routes.conf").string();
+        large.data = std::string(64 * 1024, 'r');
+        files.push_back(large);
+        size_t staged = git.addContents(files);
+        CHECK(staged == files.size());
+        git.commit("initial");
+
+        git_repository* repo = git.openReadHandle();
+        CHECK(repo);
+        git.flushIndex();
+        git_oid head = headTree(repo);
+        git_oid reference = indexTree(repo);
+        CHECK(git_oid_equal(&head, &reference));
+
+        // 一个文件的修改只重写它所在路径上的目录
+        Counter& written = CoreMetrics::get().treesWritten;
+        uint64_t before = written.value();
+        files[123].data = "key=changed\n";
+        staged = git.addContents({files[123]});
+        CHECK(staged == 1);
+        git.commit("edit one");
+        size_t depth = 0;
+        for (char c : git.repoRelativePath(files[123].path)) depth += c == '/';
+        CHECK(written.value() - before == depth + 1);
+
+        // 删除、分块文件的修改和新文件，结果与从索引写出的树一致
+        std::vector<FileContent> changes;
+        FileContent removed = files[5];
+        removed.removed = true;
+        changes.push_back(removed);
+        large.data[100] = 'x';
+        changes.push_back(large);
+        FileContent added;
+        added.path = (src / "app9" / "new.conf").string();
+        added.data = "new=1\n";
+        changes.push_back(added);
+        staged = git.addContents(changes);
+        CHECK(staged == 3);
+        git.commit("mixed");
+        git.flushIndex();
+        head = headTree(repo);
+        reference = indexTree(repo);
+        CHECK(git_oid_equal(&head, &reference));
+
+        // 检出后树缓存失效，下一次提交从索引写树并重新建立基准
+        std::vector<std::string> commits = git.listCommits();
+        bool checkedOut = git.checkoutCommit(commits[1]);
+        CHECK(checkedOut);
+        files[200].data = "key=after checkout\n";
+        staged = git.addContents({files[200]});
+        CHECK(staged == 1);
+        git.commit("after checkout");
+        files[300].data = "key=cached again\n";
+        staged = git.addContents({files[300]});
+        CHECK(staged == 1);
+        before = written.value();
+        git.commit("cached again");
+        CHECK(written.value() > before);
+        git.flushIndex();
+        head = headTree(repo);
+        reference = indexTree(repo);
+        CHECK(git_oid_equal(&head, &reference));
+        git_repository_free(repo);
+    }
+    git_libgit2_shutdown();
+
+    fs::remove_all(base);
+    std::cout << "Commit rewrites changed subtrees test completed.\n";
+}
+
+int main() {
+    test_tree_cache_matches_index();
+    test_commit_rewrites_changed_subtrees();
+    return 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "configtracker/config_snapshot.h"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+// 测试检查：与 assert 不同，定义了 NDEBUG 的构建中同样求值并在失败时终止，
+// 测试在 Debug 和 Release 下检查的内容一致
+#define CHECK(cond)                                                                       \
+    do {                                                                                  \
+        if (!(cond)) {                                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::abort();                                                                 \
+        }                                                                                 \
+    } while (0)
+
+// 各测试共用的文件读写和快照读取
+namespace testutil {
+
+// 覆盖写入文件，按需创建上级目录
+inline void writeFile(const std::filesystem::path& path, const std::string& content) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream out(path, std::ios::trunc | std::ios::binary);
+    out << content;
+}
+
+// 文件的全部内容，文件不存在时为空
+inline std::string readFile(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// 快照中文件的内容，快照为空或没有该文件时为 "<missing>"
+inline std::string contentOf(const configtracker::SnapshotPtr& snapshot, const std::string& path) {
+    std::string_view view;
+    if (!snapshot || !snapshot->read(path, view)) return "<missing>";
+    return std::string(view);
+}
+
+inline std::string contentOf(const configtracker::BlobPtr& blob) {
+    return blob ? blob->data : "<missing>";
+}
+
+}